@@ -1,21 +1,87 @@
 #version 460 core
 
+// Keywords the engine defines for each variant, these defaults are the full shader
+#ifndef NUM_DIR_LIGHTS
+#define NUM_DIR_LIGHTS 2 // 2 = Number of available directional lights that can be used
+#endif
+
+// 0 skips the clustered point light loop when the scene has no point lights
+#ifndef HAS_POINT_LIGHTS
+#define HAS_POINT_LIGHTS 1
+#endif
+
+// 0 skips the specular highlights of materials without a specular map
+#ifndef HAS_SPECULAR_MAP
+#define HAS_SPECULAR_MAP 1
+#endif
+
+// 0 skips tinting by the vertex colour for meshes without one
+#ifndef HAS_VERTEX_COLOURS
+#define HAS_VERTEX_COLOURS 1
+#endif
+
 in vec3 fColour;
 in vec2 fTexCoords;
 in vec3 fNormals;
 in vec3 fVertPos;
 in vec3 fViewPos;
 
-struct Material
+// ID of the draw's material in the material buffer
+flat in int fMaterialID;
+
+// Per material data written by the engine, only updated when a material changes
+struct MaterialData
 {
-	sampler2D baseColourMap;
-	sampler2D specularMap;
+	// Part of the array layer each map covers as x, y, width, height
+	vec4 baseColourRect;
+	vec4 specularRect;
+
+	// Layer of the texture array for each map, -1 samples the material's own map
+	int baseColourLayer;
+	int specularLayer;
+
 	float shininess;
 	float specularStrength;
 };
 
-// The material for the shader to interface with our engine material
-uniform Material material; 
+layout (std430, binding = 1) readonly buffer MaterialBuffer
+{
+	MaterialData materials[];
+};
+
+// Maps of the material that aren't in a texture array
+uniform sampler2D baseColourMap;
+uniform sampler2D specularMap;
+
+// Texture arrays that the maps are packed into
+uniform sampler2DArray baseColourArray;
+uniform sampler2DArray specularArray;
+
+// Sample a map from its texture array layer, or from its own texture if it isn't in one
+vec4 SampleMap(sampler2D map, sampler2DArray arrayMap, int layer, vec4 rect, vec2 uv)
+{
+	if (layer < 0)
+		return texture(map, uv);
+
+	// Whole layers repeat with the sampler
+	if (rect.z >= 1.0f && rect.w >= 1.0f)
+		return texture(arrayMap, vec3(uv, layer));
+
+	// Atlas entries repeat inside their part of the page
+	// The gradients come from the unwrapped coordinates so the mip level doesn't jump at the seams
+	vec2 atlasUV = rect.xy + fract(uv) * rect.zw;
+	vec2 gradX = dFdx(uv) * rect.zw;
+	vec2 gradY = dFdy(uv) * rect.zw;
+
+	// Entries are packed without a gutter, keep the filter half a texel inside the entry at the level being read
+	// so bilinear and mip sampling don't blend in the neighbouring entries
+	vec2 pageSize = vec2(textureSize(arrayMap, 0).xy);
+	float lod = clamp(log2(max(length(gradX * pageSize), length(gradY * pageSize))), 0.0f, float(textureQueryLevels(arrayMap) - 1));
+	vec2 halfTexel = min(0.5f * exp2(lod) / pageSize, 0.5f * rect.zw);
+	atlasUV = clamp(atlasUV, rect.xy + halfTexel, rect.xy + rect.zw - halfTexel);
+
+	return textureGrad(arrayMap, vec3(atlasUV, layer), gradX, gradY);
+}
 
 struct DirLight {
 	vec3 colour;
@@ -24,19 +90,69 @@ struct DirLight {
 	float intensity;
 };
 
+// Arrays can't be empty so variants without directional lights don't declare them
+#if NUM_DIR_LIGHTS > 0
+uniform DirLight dirLights[NUM_DIR_LIGHTS]; // Create a directional light array
+#endif
+
+#if HAS_POINT_LIGHTS
+// Point lights in the frustum, written by the engine every frame
 struct PointLight {
-	 vec3 colour;
-	 vec3 position;
-	 float intensity;
-	 float linear;
-	 float quadratic;
+	// World position and the distance the light reaches
+	vec4 positionRadius;
+
+	// Colour multiplied by intensity
+	vec4 colour;
+
+	float linear;
+	float quadratic;
 };
 
-#define NUM_DIR_LIGHTS 2 // 2 = Number of available directional lights that can be used
-uniform DirLight dirLights[NUM_DIR_LIGHTS]; // Create a directional light array
+layout (std430, binding = 2) readonly buffer PointLightBuffer
+{
+	PointLight pointLights[];
+};
+
+// The view frustum split into a grid of clusters, each cluster is a range of the light index buffer
+layout (std430, binding = 3) readonly buffer ClusterBuffer
+{
+	// Clusters across, down and deep
+	uvec4 clusterGrid;
+
+	// Slices per log of depth, depth the log slices start at, near and far clip
+	vec4 clusterDepth;
+
+	// Clusters per pixel across and down
+	vec4 clusterTileScale;
+
+	// Offset and count of each cluster's lights
+	uvec2 clusters[];
+};
+
+layout (std430, binding = 4) readonly buffer LightIndexBuffer
+{
+	uint lightIndices[];
+};
+
+// Find the cluster the fragment is in from its position on screen and its depth
+uint GetClusterIndex()
+{
+	// Undo the perspective depth to get the distance from the camera
+	float near = clusterDepth.z;
+	float far = clusterDepth.w;
+	float depth = 2.0f * near * far / (far + near - (gl_FragCoord.z * 2.0f - 1.0f) * (far - near));
+
+	// Slice 0 is everything in front of where the log slices start
+	uint slice = 0;
+
+	if (depth >= clusterDepth.y)
+		slice = min(1 + uint(log(depth / clusterDepth.y) * clusterDepth.x), clusterGrid.z - 1);
 
-#define NUM_POINT_LIGHTS 20
-uniform PointLight pointLights[NUM_POINT_LIGHTS];
+	uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterTileScale.xy), clusterGrid.xy - 1);
+
+	return tile.x + clusterGrid.x * (tile.y + clusterGrid.y * slice);
+}
+#endif
 
 // out = going out of the shader into something else
 out vec4 finalColour;
@@ -46,16 +162,26 @@ void main() {
 	//				   vec3(rgb), alpha
 	vec3 result = vec3(0.0f);
 
+	// Read the draw's material from the buffer
+	MaterialData material = materials[fMaterialID];
+
 	// Base colour that the object starts at
-	vec3 baseColour = texture(material.baseColourMap, fTexCoords).rgb * fColour;
+	vec3 baseColour = SampleMap(baseColourMap, baseColourArray, material.baseColourLayer, material.baseColourRect, fTexCoords).rgb;
+
+#if HAS_VERTEX_COLOURS
+	baseColour *= fColour;
+#endif
 
+#if HAS_SPECULAR_MAP
 	// Specular map value
-	vec3 specularColour = texture(material.specularMap, fTexCoords).rgb;
+	vec3 specularColour = SampleMap(specularMap, specularArray, material.specularLayer, material.specularRect, fTexCoords).rgb;
+#endif
 
 	// Get the view direction
 	vec3 viewDir = normalize(fViewPos - fVertPos);
 
 	// DIRECTIONAL LIGHTS
+#if NUM_DIR_LIGHTS > 0
 	for (int i = 0; i < NUM_DIR_LIGHTS; ++i)
 	{
 		// Material light direction
@@ -79,20 +205,31 @@ void main() {
 		lightColour *= colourIntensity;
 		lightColour *= dirLights[i].intensity;
 
+		vec3 specular = vec3(0.0f);
+
+#if HAS_SPECULAR_MAP
 		// Specular power algorithm, calculate the shininesse of the model
 		float specPower = pow(max(dot(viewDir, reflectDir), 0.0f), material.shininess);
-		vec3 specular = specularColour * specPower;
+		specular = specularColour * specPower;
 		specular *= material.specularStrength;
+#endif
 
 		// Add our light values together to get the result
 		result += (ambientLight + lightColour + specular);
 	}
+#endif
 
 	// POINT LIGHTS
-		for (int i = 0; i < NUM_POINT_LIGHTS; ++i)
+	// Only the lights that reach the fragment's cluster are looped over
+#if HAS_POINT_LIGHTS
+	uvec2 cluster = clusters[GetClusterIndex()];
+
+	for (uint i = 0; i < cluster.y; ++i)
 	{
+		PointLight pointLight = pointLights[lightIndices[cluster.x + i]];
+
 		// Light direction from the point light to the vertex
-		vec3 lightDir = normalize(pointLights[i].position - fVertPos);
+		vec3 lightDir = normalize(pointLight.positionRadius.xyz - fVertPos);
 
 		// Get the reflection light value
 		vec3 reflectDir = reflect(-lightDir, fNormals);
@@ -101,10 +238,10 @@ void main() {
 		float diff = max(dot(fNormals, lightDir), 0.0f);
 
 		// Distance between the lights position and vertex position
-		float distance = length(pointLights[i].position - fVertPos);
+		float distance = length(pointLight.positionRadius.xyz - fVertPos);
 
 		// Actual attenuation calculation
-		float attenCalc = 1.0f + pointLights[i].linear * distance + pointLights[i].quadratic * (distance * distance);
+		float attenCalc = 1.0f + pointLight.linear * distance + pointLight.quadratic * (distance * distance);
 
 		// Distance that the light can reach
 		// Value between 1 and 0 ---- 1 is full light, 0 is no light
@@ -116,21 +253,32 @@ void main() {
 			attenuation = 1.0f / attenCalc;
 		}
 
+		// Fade to nothing at the radius so the light doesn't cut off at the edge of its clusters
+		float fade = clamp(1.0f - pow(distance / pointLight.positionRadius.w, 4.0f), 0.0f, 1.0f);
+		attenuation *= fade * fade;
+
 		// Light colour algorithm
 		// Adjusts how much colour you can see based on the normal direction
-		vec3 lightColour = pointLights[i].colour;
+		vec3 lightColour = pointLight.colour.rgb;
 		lightColour *= diff;
 		lightColour *= attenuation;
-		lightColour *= pointLights[i].intensity;
 
+		vec3 specular = vec3(0.0f);
+
+#if HAS_SPECULAR_MAP
 		// Specular power algorithm, calculate the shininesse of the model
 		float specPower = pow(max(dot(viewDir, reflectDir), 0.0f), material.shininess);
-		vec3 specular = specularColour * specPower;
+		specular = specularColour * specPower;
 		specular *= material.specularStrength;
 
+		// Fall off and fade with the diffuse so highlights don't stop at the cluster edges
+		specular *= attenuation;
+#endif
+
 		// Add our light values together to get the result
 		result += (lightColour + specular);
 	}
+#endif
 
 	finalColour = vec4(result, 1.0f);
 }
\ No newline at end of file
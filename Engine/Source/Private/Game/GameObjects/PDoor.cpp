@@ -0,0 +1,27 @@
+#include "Game/GameObjects/PDoor.h"
+#include "Graphics/PPortalGraph.h"
+
+PDoor::PDoor()
+{
+	m_PortalIndex = -1;
+	m_IsOpen = true;
+}
+
+void PDoor::SetPortal(const TWeak<PPortalGraph>& portalGraph, const PUi32& portalIndex)
+{
+	m_PortalGraph = portalGraph;
+	m_PortalIndex = static_cast<int>(portalIndex);
+
+	SetOpen(m_IsOpen);
+}
+
+void PDoor::SetOpen(const bool& isOpen)
+{
+	m_IsOpen = isOpen;
+
+	if (m_PortalIndex < 0)
+		return;
+
+	if (const auto& graphRef = m_PortalGraph.lock())
+		graphRef->SetPortalOpen(static_cast<PUi32>(m_PortalIndex), m_IsOpen);
+}
@@ -0,0 +1,208 @@
+#include "Graphics/PAssetManager.h"
+#include "Graphics/PModel.h"
+#include "Graphics/PTexture.h"
+#include "Graphics/PSMaterial.h"
+
+// System Libs
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+
+PAssetManager::~PAssetManager()
+{
+	m_LoadingModels.clear();
+	m_LoadingTextures.clear();
+	m_Models.clear();
+	m_Textures.clear();
+	m_Materials.clear();
+}
+
+TShared<PModel> PAssetManager::LoadModel(const PString& path, const PSMeshSettings& meshSettings)
+{
+	// Different settings make different meshes so they are stored separately
+	char settingsText[17];
+	snprintf(settingsText, sizeof(settingsText), "%016llx", static_cast<unsigned long long>(meshSettings.GetHash()));
+
+	const PString key = NormalisePath(path) + "|" + settingsText;
+
+	const auto found = m_Models.find(key);
+
+	if (found != m_Models.end())
+		return found->second;
+
+	const auto newModel = TMakeShared<PModel>();
+	newModel->ImportModelAsync(path, meshSettings);
+
+	m_Models.emplace(key, newModel);
+	m_LoadingModels.push_back(newModel);
+
+	return newModel;
+}
+
+TShared<PTexture> PAssetManager::LoadTexture(const PString& name, const PString& path)
+{
+	const PString key = NormalisePath(path);
+
+	const auto found = m_Textures.find(key);
+
+	if (found != m_Textures.end())
+		return found->second;
+
+	const auto newTexture = TMakeShared<PTexture>();
+	newTexture->LoadTextureAsync(name, path, true);
+
+	m_Textures.emplace(key, newTexture);
+	m_LoadingTextures.push_back(newTexture);
+
+	return newTexture;
+}
+
+TShared<PSMaterial> PAssetManager::GetMaterial(const PString& name)
+{
+	auto& material = m_Materials[name];
+
+	if (material == nullptr)
+		material = TMakeShared<PSMaterial>();
+
+	return material;
+}
+
+void PAssetManager::Update()
+{
+	for (PUi32 i = 0; i < m_LoadingModels.size();)
+	{
+		if (m_LoadingModels[i]->UpdateImport())
+			m_LoadingModels.erase(m_LoadingModels.begin() + i);
+		else
+			++i;
+	}
+
+	for (PUi32 i = 0; i < m_LoadingTextures.size();)
+	{
+		const TShared<PTexture> texture = m_LoadingTextures[i];
+
+		if (!texture->UpdateLoad())
+		{
+			++i;
+			continue;
+		}
+
+		m_LoadingTextures.erase(m_LoadingTextures.begin() + i);
+
+		// Don't store failed textures so they can be tried again
+		if (texture->GetLoadState() == LS_FAILED)
+		{
+			const auto found = m_Textures.find(NormalisePath(texture->GetImportPath()));
+
+			if (found != m_Textures.end() && found->second == texture)
+				m_Textures.erase(found);
+		}
+	}
+}
+
+PUi32 PAssetManager::ReleaseUnused()
+{
+	PUi32 released = 0;
+
+	// The manager holds one reference, anything more is in use
+	auto releaseFrom = [&released](auto& assets)
+		{
+			for (auto it = assets.begin(); it != assets.end();)
+			{
+				if (it->second.use_count() <= 1)
+				{
+					it = assets.erase(it);
+					++released;
+				}
+				else
+				{
+					++it;
+				}
+			}
+		};
+
+	// Materials hold textures so release them first
+	releaseFrom(m_Materials);
+
+	// Assets that are still loading are also held by the loading lists so they are kept
+	releaseFrom(m_Models);
+	releaseFrom(m_Textures);
+
+	return released;
+}
+
+TArray<PSAssetInfo> PAssetManager::GetAssetInfo() const
+{
+	TArray<PSAssetInfo> assets;
+	assets.reserve(m_Models.size() + m_Textures.size() + m_Materials.size());
+
+	for (const auto& model : m_Models)
+	{
+		PSAssetInfo info;
+		info.type = AT_MODEL;
+		info.key = model.first;
+		info.memorySize = model.second->GetMemorySize();
+
+		// Every instance holds the source so the references are the instances
+		const bool isLoading = std::find(m_LoadingModels.begin(), m_LoadingModels.end(), model.second) != m_LoadingModels.end();
+		info.refCount = static_cast<PUi32>(model.second.use_count() - (isLoading ? 2 : 1));
+
+		assets.push_back(info);
+	}
+
+	for (const auto& texture : m_Textures)
+	{
+		PSAssetInfo info;
+		info.type = AT_TEXTURE;
+		info.key = texture.first;
+		info.memorySize = texture.second->GetMemorySize();
+		info.refCount = static_cast<PUi32>(texture.second.use_count() - 1);
+
+		assets.push_back(info);
+	}
+
+	for (const auto& material : m_Materials)
+	{
+		PSAssetInfo info;
+		info.type = AT_MATERIAL;
+		info.key = material.first;
+		info.refCount = static_cast<PUi32>(material.second.use_count() - 1);
+
+		assets.push_back(info);
+	}
+
+	return assets;
+}
+
+void PAssetManager::LogAssets() const
+{
+	const char* typeNames[] = { "Model", "Texture", "Material" };
+
+	PUi64 totalMemory = 0;
+
+	for (const auto& info : GetAssetInfo())
+	{
+		PDebug::Log(PString(typeNames[info.type]) + " " + info.key + " | " + std::to_string(info.memorySize / 1024)
+			+ " KB | References: " + std::to_string(info.refCount));
+
+		totalMemory += info.memorySize;
+	}
+
+	PDebug::Log("Assets: " + std::to_string(m_Models.size()) + " models, " + std::to_string(m_Textures.size())
+		+ " textures, " + std::to_string(m_Materials.size()) + " materials, " + std::to_string(totalMemory / 1024) + " KB total");
+}
+
+PString PAssetManager::NormalisePath(const PString& path)
+{
+	// Remove "." and ".." and use forward slashes
+	PString normalPath = std::filesystem::path(path).lexically_normal().generic_string();
+
+#ifdef _WIN32
+	// Windows paths aren't case sensitive
+	std::transform(normalPath.begin(), normalPath.end(), normalPath.begin(),
+		[](const unsigned char& c) { return static_cast<char>(std::tolower(c)); });
+#endif
+
+	return normalPath;
+}
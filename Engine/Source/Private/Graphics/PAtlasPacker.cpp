@@ -0,0 +1,69 @@
+#include "Graphics/PAtlasPacker.h"
+
+PAtlasPacker::PAtlasPacker()
+{
+	m_Size = 0;
+	m_Alignment = 1;
+	m_EntryCount = 0;
+}
+
+void PAtlasPacker::Reset(const PUi32& size, const PUi32& alignment)
+{
+	m_Shelves.clear();
+	m_Size = size;
+	m_Alignment = alignment > 0 ? alignment : 1;
+	m_EntryCount = 0;
+}
+
+bool PAtlasPacker::Allocate(const PUi32& width, const PUi32& height, PUi32& outX, PUi32& outY)
+{
+	const PUi32 alignedWidth = (width + m_Alignment - 1) / m_Alignment * m_Alignment;
+	const PUi32 alignedHeight = (height + m_Alignment - 1) / m_Alignment * m_Alignment;
+
+	if (alignedWidth == 0 || alignedWidth > m_Size || alignedHeight > m_Size)
+		return false;
+
+	// Pick the shelf that wastes the least height, shelves more than twice as tall would waste too much
+	PSAtlasShelf* bestShelf = nullptr;
+
+	for (auto& shelf : m_Shelves)
+	{
+		if (shelf.height < alignedHeight || shelf.height > alignedHeight * 2 || shelf.usedWidth + alignedWidth > m_Size)
+			continue;
+
+		if (bestShelf == nullptr || shelf.height < bestShelf->height)
+			bestShelf = &shelf;
+	}
+
+	// Open a new shelf below the last one
+	if (bestShelf == nullptr)
+	{
+		const PUi32 top = m_Shelves.empty() ? 0 : m_Shelves.back().y + m_Shelves.back().height;
+
+		if (top + alignedHeight > m_Size)
+			return false;
+
+		PSAtlasShelf shelf;
+		shelf.y = top;
+		shelf.height = alignedHeight;
+		m_Shelves.push_back(shelf);
+		bestShelf = &m_Shelves.back();
+	}
+
+	outX = bestShelf->usedWidth;
+	outY = bestShelf->y;
+	bestShelf->usedWidth += alignedWidth;
+	++m_EntryCount;
+
+	return true;
+}
+
+void PAtlasPacker::Free()
+{
+	if (m_EntryCount == 0)
+		return;
+
+	// Shelves can't be split up again so the page is only reused once it is empty
+	if (--m_EntryCount == 0)
+		m_Shelves.clear();
+}
@@ -0,0 +1,529 @@
+#include "Graphics/PBlockCompression.h"
+#include "Threading/PThreadPool.h"
+
+// External Libs
+#include <GLEW/glew.h>
+#include <GLM/glm.hpp>
+
+// System Libs
+#include <cfloat>
+#include <cstring>
+
+// Weights of the second endpoint for each 4 bit BC7 index, out of 64
+const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Find the direction the pixels vary the most along using power iteration
+template<int N>
+static glm::vec<N, float> FindPrincipalAxis(const glm::vec<N, float>* points, const int& count, const glm::vec<N, float>& mean)
+{
+	glm::mat<N, N, float> covariance(0.0f);
+
+	for (int i = 0; i < count; ++i)
+	{
+		const glm::vec<N, float> offset = points[i] - mean;
+		covariance += glm::outerProduct(offset, offset);
+	}
+
+	// Start from the column of the channel that varies the most
+	// The box around the points can't be used as it loses which channels move in opposite directions
+	int largest = 0;
+
+	for (int i = 1; i < N; ++i)
+	{
+		if (covariance[i][i] > covariance[largest][largest])
+			largest = i;
+	}
+
+	glm::vec<N, float> axis = covariance[largest];
+
+	if (glm::dot(axis, axis) < 1e-8f)
+		return glm::vec<N, float>(0.0f);
+
+	for (int i = 0; i < 8; ++i)
+	{
+		const glm::vec<N, float> next = covariance * axis;
+		const float length = glm::length(next);
+
+		if (length < 1e-8f)
+			break;
+
+		axis = next / length;
+	}
+
+	return glm::normalize(axis);
+}
+
+// Writes values into a block one bit at a time starting from the lowest bit
+struct PSBitWriter
+{
+	PSBitWriter(PUi8* block, const PUi32& size) : data(block), position(0) { std::memset(data, 0, size); }
+
+	void Write(const PUi32& value, const PUi32& bitCount)
+	{
+		for (PUi32 i = 0; i < bitCount; ++i, ++position)
+		{
+			if (value & (1U << i))
+				data[position >> 3] |= static_cast<PUi8>(1U << (position & 7));
+		}
+	}
+
+	PUi8* data;
+	PUi32 position;
+};
+
+// Round a colour to 5:6:5 bits
+static PUi16 PackRGB565(const glm::vec3& colour)
+{
+	const glm::vec3 clamped = glm::clamp(colour, 0.0f, 255.0f);
+	const PUi32 r = static_cast<PUi32>(clamped.r * 31.0f / 255.0f + 0.5f);
+	const PUi32 g = static_cast<PUi32>(clamped.g * 63.0f / 255.0f + 0.5f);
+	const PUi32 b = static_cast<PUi32>(clamped.b * 31.0f / 255.0f + 0.5f);
+
+	return static_cast<PUi16>((r << 11) | (g << 5) | b);
+}
+
+// Expand a 5:6:5 colour back to 0 - 255 the way the GPU does
+static glm::vec3 UnpackRGB565(const PUi16& colour)
+{
+	const PUi32 r = (colour >> 11) & 31;
+	const PUi32 g = (colour >> 5) & 63;
+	const PUi32 b = colour & 31;
+
+	return glm::vec3(
+		static_cast<float>((r << 3) | (r >> 2)),
+		static_cast<float>((g << 2) | (g >> 4)),
+		static_cast<float>((b << 3) | (b >> 2))
+	);
+}
+
+// Pick the closest of the 4 BC1 palette colours for each pixel and return the total error
+static float FindBC1Indices(const glm::vec3* pixels, const PUi16& colour0, const PUi16& colour1, PUi32* outIndices)
+{
+	const glm::vec3 end0 = UnpackRGB565(colour0);
+	const glm::vec3 end1 = UnpackRGB565(colour1);
+	const glm::vec3 palette[4] = { end0, end1, (end0 * 2.0f + end1) / 3.0f, (end0 + end1 * 2.0f) / 3.0f };
+
+	float totalError = 0.0f;
+
+	for (int i = 0; i < 16; ++i)
+	{
+		float bestError = FLT_MAX;
+
+		for (PUi32 j = 0; j < 4; ++j)
+		{
+			const glm::vec3 offset = pixels[i] - palette[j];
+			const float error = glm::dot(offset, offset);
+
+			if (error < bestError)
+			{
+				bestError = error;
+				outIndices[i] = j;
+			}
+		}
+
+		totalError += bestError;
+	}
+
+	return totalError;
+}
+
+PUi32 PBlockCompression::GetBlockSize(const PETextureCompression& compression)
+{
+	return compression == TC_BC1 ? 8 : 16;
+}
+
+PUi64 PBlockCompression::GetImageSize(const PETextureCompression& compression, const PUi32& width, const PUi32& height)
+{
+	const PUi64 blocksWide = (width + 3) / 4;
+	const PUi64 blocksHigh = (height + 3) / 4;
+
+	return blocksWide * blocksHigh * GetBlockSize(compression);
+}
+
+PUi32 PBlockCompression::GetGLFormat(const PETextureCompression& compression)
+{
+	switch (compression)
+	{
+	case TC_BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case TC_BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case TC_BC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	case TC_BC7:
+		return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	default:
+		return 0;
+	}
+}
+
+void PBlockCompression::CompressImage(const PUi8* pixels, const PUi32& width, const PUi32& height,
+	const PETextureCompression& compression, TArray<PUi8>& outData)
+{
+	const PUi32 blocksWide = (width + 3) / 4;
+	const PUi32 blocksHigh = (height + 3) / 4;
+	const PUi32 blockSize = GetBlockSize(compression);
+
+	outData.resize(GetImageSize(compression, width, height));
+
+	PThreadPool::GetPool().ParallelFor(blocksHigh, [&](PUi32 blockY)
+		{
+			PUi8 block[64];
+
+			for (PUi32 blockX = 0; blockX < blocksWide; ++blockX)
+			{
+				// Copy the 4x4 pixels, repeating the edge for images that aren't a multiple of 4
+				for (PUi32 y = 0; y < 4; ++y)
+				{
+					const PUi32 sourceY = std::min(blockY * 4 + y, height - 1);
+
+					for (PUi32 x = 0; x < 4; ++x)
+					{
+						const PUi32 sourceX = std::min(blockX * 4 + x, width - 1);
+						std::memcpy(&block[(y * 4 + x) * 4], &pixels[(static_cast<PUi64>(sourceY) * width + sourceX) * 4], 4);
+					}
+				}
+
+				PUi8* outBlock = &outData[(static_cast<PUi64>(blockY) * blocksWide + blockX) * blockSize];
+
+				switch (compression)
+				{
+				case TC_BC1:
+					EncodeBC1(block, outBlock);
+					break;
+				case TC_BC3:
+					EncodeBC3(block, outBlock);
+					break;
+				case TC_BC5:
+					EncodeBC5(block, outBlock);
+					break;
+				default:
+					EncodeBC7(block, outBlock);
+					break;
+				}
+			}
+		});
+}
+
+void PBlockCompression::EncodeBC1(const PUi8* pixels, PUi8* outBlock)
+{
+	glm::vec3 colours[16];
+	glm::vec3 mean(0.0f);
+
+	for (int i = 0; i < 16; ++i)
+	{
+		colours[i] = glm::vec3(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2]);
+		mean += colours[i];
+	}
+
+	mean /= 16.0f;
+
+	// Start with the ends of the line through the colours
+	const glm::vec3 axis = FindPrincipalAxis<3>(colours, 16, mean);
+	float minT = FLT_MAX, maxT = -FLT_MAX;
+
+	for (int i = 0; i < 16; ++i)
+	{
+		const float t = glm::dot(colours[i] - mean, axis);
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	glm::vec3 end0 = mean + axis * maxT;
+	glm::vec3 end1 = mean + axis * minT;
+
+	PUi16 bestColour0 = 0, bestColour1 = 0;
+	PUi32 bestIndices[16] = {};
+	float bestError = FLT_MAX;
+
+	for (int iteration = 0; iteration < 3; ++iteration)
+	{
+		const PUi16 colour0 = PackRGB565(end0);
+		const PUi16 colour1 = PackRGB565(end1);
+
+		PUi32 indices[16];
+		const float error = FindBC1Indices(colours, colour0, colour1, indices);
+
+		if (error < bestError)
+		{
+			bestError = error;
+			bestColour0 = colour0;
+			bestColour1 = colour1;
+			std::memcpy(bestIndices, indices, sizeof(indices));
+		}
+
+		// Refit the ends to the chosen indices with least squares
+		const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		glm::vec3 ax(0.0f), bx(0.0f);
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const float a = weights[indices[i]];
+			const float b = 1.0f - a;
+
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax += colours[i] * a;
+			bx += colours[i] * b;
+		}
+
+		const float determinant = aa * bb - ab * ab;
+
+		if (std::abs(determinant) < 1e-6f)
+			break;
+
+		end0 = (ax * bb - bx * ab) / determinant;
+		end1 = (bx * aa - ax * ab) / determinant;
+	}
+
+	// Colour 0 must be larger to use the 4 colour mode
+	// Swapping the ends means swapping the indices that point at them
+	if (bestColour0 < bestColour1)
+	{
+		std::swap(bestColour0, bestColour1);
+		const PUi32 swapped[4] = { 1, 0, 3, 2 };
+
+		for (auto& index : bestIndices)
+			index = swapped[index];
+	}
+	else if (bestColour0 == bestColour1)
+	{
+		// Equal ends use the 3 colour mode where index 3 is black
+		for (auto& index : bestIndices)
+			index = 0;
+	}
+
+	PUi32 indexBits = 0;
+
+	for (int i = 0; i < 16; ++i)
+		indexBits |= bestIndices[i] << (i * 2);
+
+	outBlock[0] = static_cast<PUi8>(bestColour0 & 0xFF);
+	outBlock[1] = static_cast<PUi8>(bestColour0 >> 8);
+	outBlock[2] = static_cast<PUi8>(bestColour1 & 0xFF);
+	outBlock[3] = static_cast<PUi8>(bestColour1 >> 8);
+	std::memcpy(outBlock + 4, &indexBits, 4);
+}
+
+void PBlockCompression::EncodeBC3(const PUi8* pixels, PUi8* outBlock)
+{
+	// The alpha block comes first and is the same layout as BC4
+	EncodeBC4(pixels, 3, outBlock);
+	EncodeBC1(pixels, outBlock + 8);
+}
+
+void PBlockCompression::EncodeBC5(const PUi8* pixels, PUi8* outBlock)
+{
+	EncodeBC4(pixels, 0, outBlock);
+	EncodeBC4(pixels, 1, outBlock + 8);
+}
+
+void PBlockCompression::EncodeBC4(const PUi8* pixels, const PUi32& channel, PUi8* outBlock)
+{
+	int minValue = 255, maxValue = 0;
+
+	for (int i = 0; i < 16; ++i)
+	{
+		minValue = std::min(minValue, static_cast<int>(pixels[i * 4 + channel]));
+		maxValue = std::max(maxValue, static_cast<int>(pixels[i * 4 + channel]));
+	}
+
+	outBlock[0] = static_cast<PUi8>(maxValue);
+	outBlock[1] = static_cast<PUi8>(minValue);
+
+	// A larger first value uses 6 values between the ends
+	float palette[8];
+	palette[0] = static_cast<float>(maxValue);
+	palette[1] = static_cast<float>(minValue);
+
+	for (int i = 2; i < 8; ++i)
+		palette[i] = (static_cast<float>(8 - i) * maxValue + static_cast<float>(i - 1) * minValue) / 7.0f;
+
+	PUi64 indexBits = 0;
+
+	// Flat blocks leave every index at 0
+	if (maxValue != minValue)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			const float value = static_cast<float>(pixels[i * 4 + channel]);
+			float bestError = FLT_MAX;
+			PUi64 bestIndex = 0;
+
+			for (PUi64 j = 0; j < 8; ++j)
+			{
+				const float error = std::abs(value - palette[j]);
+
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = j;
+				}
+			}
+
+			indexBits |= bestIndex << (i * 3);
+		}
+	}
+
+	for (int i = 0; i < 6; ++i)
+		outBlock[2 + i] = static_cast<PUi8>((indexBits >> (i * 8)) & 0xFF);
+}
+
+void PBlockCompression::EncodeBC7(const PUi8* pixels, PUi8* outBlock)
+{
+	glm::vec4 colours[16];
+	glm::vec4 mean(0.0f);
+
+	for (int i = 0; i < 16; ++i)
+	{
+		colours[i] = glm::vec4(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2], pixels[i * 4 + 3]);
+		mean += colours[i];
+	}
+
+	mean /= 16.0f;
+
+	const glm::vec4 axis = FindPrincipalAxis<4>(colours, 16, mean);
+	float minT = FLT_MAX, maxT = -FLT_MAX;
+
+	for (int i = 0; i < 16; ++i)
+	{
+		const float t = glm::dot(colours[i] - mean, axis);
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	glm::vec4 end0 = mean + axis * minT;
+	glm::vec4 end1 = mean + axis * maxT;
+
+	// Mode 6 stores 7 bits per channel and a shared low bit for each end
+	glm::ivec4 bestQuantized0(0), bestQuantized1(0);
+	int bestPBit0 = 0, bestPBit1 = 0;
+	int bestIndices[16] = {};
+	float bestError = FLT_MAX;
+
+	for (int iteration = 0; iteration < 2; ++iteration)
+	{
+		int iterationIndices[16] = {};
+		float iterationError = FLT_MAX;
+
+		for (int pBits = 0; pBits < 4; ++pBits)
+		{
+			const int pBit0 = pBits & 1;
+			const int pBit1 = pBits >> 1;
+
+			const glm::ivec4 quantized0 = glm::clamp(glm::ivec4(glm::round((end0 - static_cast<float>(pBit0)) * 0.5f)), 0, 127);
+			const glm::ivec4 quantized1 = glm::clamp(glm::ivec4(glm::round((end1 - static_cast<float>(pBit1)) * 0.5f)), 0, 127);
+			const glm::ivec4 decoded0 = quantized0 * 2 + pBit0;
+			const glm::ivec4 decoded1 = quantized1 * 2 + pBit1;
+
+			glm::vec4 palette[16];
+
+			for (int j = 0; j < 16; ++j)
+				palette[j] = glm::vec4((decoded0 * (64 - bc7Weights[j]) + decoded1 * bc7Weights[j] + 32) >> 6);
+
+			// Project onto the line between the ends to guess the index then check its neighbours
+			const glm::vec4 direction = glm::vec4(decoded1 - decoded0);
+			const float lengthSquared = glm::dot(direction, direction);
+
+			int indices[16];
+			float error = 0.0f;
+
+			for (int i = 0; i < 16; ++i)
+			{
+				int guess = 0;
+
+				if (lengthSquared > 0.0f)
+				{
+					const float t = glm::dot(colours[i] - glm::vec4(decoded0), direction) / lengthSquared;
+					guess = glm::clamp(static_cast<int>(t * 15.0f + 0.5f), 0, 15);
+				}
+
+				float pixelError = FLT_MAX;
+
+				for (int j = std::max(guess - 1, 0); j <= std::min(guess + 1, 15); ++j)
+				{
+					const glm::vec4 offset = colours[i] - palette[j];
+					const float candidate = glm::dot(offset, offset);
+
+					if (candidate < pixelError)
+					{
+						pixelError = candidate;
+						indices[i] = j;
+					}
+				}
+
+				error += pixelError;
+			}
+
+			if (error < iterationError)
+			{
+				iterationError = error;
+				std::memcpy(iterationIndices, indices, sizeof(indices));
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				bestQuantized0 = quantized0;
+				bestQuantized1 = quantized1;
+				bestPBit0 = pBit0;
+				bestPBit1 = pBit1;
+				std::memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+
+		// Refit the ends to the chosen indices with least squares
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		glm::vec4 ax(0.0f), bx(0.0f);
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const float b = static_cast<float>(bc7Weights[iterationIndices[i]]) / 64.0f;
+			const float a = 1.0f - b;
+
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax += colours[i] * a;
+			bx += colours[i] * b;
+		}
+
+		const float determinant = aa * bb - ab * ab;
+
+		if (std::abs(determinant) < 1e-6f)
+			break;
+
+		end0 = glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f);
+		end1 = glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f);
+	}
+
+	// The first index only has 3 bits so its top bit must be 0
+	// Swapping the ends flips every index to keep the same colours
+	if (bestIndices[0] & 8)
+	{
+		std::swap(bestQuantized0, bestQuantized1);
+		std::swap(bestPBit0, bestPBit1);
+
+		for (auto& index : bestIndices)
+			index = 15 - index;
+	}
+
+	PSBitWriter writer(outBlock, 16);
+
+	// Mode 6 is 6 zero bits followed by a 1
+	writer.Write(1 << 6, 7);
+
+	for (int channel = 0; channel < 4; ++channel)
+	{
+		writer.Write(static_cast<PUi32>(bestQuantized0[channel]), 7);
+		writer.Write(static_cast<PUi32>(bestQuantized1[channel]), 7);
+	}
+
+	writer.Write(static_cast<PUi32>(bestPBit0), 1);
+	writer.Write(static_cast<PUi32>(bestPBit1), 1);
+
+	for (int i = 0; i < 16; ++i)
+		writer.Write(static_cast<PUi32>(bestIndices[i]), i == 0 ? 3 : 4);
+}
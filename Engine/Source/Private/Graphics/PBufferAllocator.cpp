@@ -0,0 +1,388 @@
+#include "Graphics/PBufferAllocator.h"
+
+// System Libs
+#include <algorithm>
+#include <bit>
+
+// Each first level is split into 2^3 bins
+const PUi32 secondLevelBits = 3;
+const PUi32 secondLevelCount = 1 << secondLevelBits;
+
+// Enough first levels for any 32 bit size
+const PUi32 firstLevelCount = 32;
+
+// Marks a missing block
+const PUi32 noBlock = UINT32_MAX;
+
+PBufferAllocator::PBufferAllocator()
+{
+	m_FirstLevelMap = 0;
+	m_FirstBlock = m_LastBlock = noBlock;
+	m_Capacity = 0;
+	m_Used = 0;
+	m_AllocationCount = 0;
+}
+
+void PBufferAllocator::Reset(const PUi32& capacity)
+{
+	m_Blocks.clear();
+	m_UnusedBlocks.clear();
+	m_BinHeads.assign(firstLevelCount * secondLevelCount, noBlock);
+	m_SecondLevelMaps.assign(firstLevelCount, 0);
+	m_FirstLevelMap = 0;
+	m_FirstBlock = m_LastBlock = noBlock;
+	m_Capacity = 0;
+	m_Used = 0;
+	m_AllocationCount = 0;
+
+	Grow(capacity);
+}
+
+bool PBufferAllocator::Allocate(const PUi32& size, PSBufferAllocation& outAllocation)
+{
+	if (size == 0 || size > m_Capacity - m_Used)
+		return false;
+
+	// Round the size up to the next bin so every block in the bin found is big enough
+	PUi64 searchSize = size;
+
+	if (size >= secondLevelCount)
+	{
+		const PUi32 topBit = static_cast<PUi32>(std::bit_width(size)) - 1;
+		searchSize += (1ULL << (topBit - secondLevelBits)) - 1;
+	}
+
+	PUi32 block = noBlock;
+
+	if (searchSize <= UINT32_MAX)
+	{
+		PUi32 first = 0, second = 0;
+		GetBin(static_cast<PUi32>(searchSize), first, second);
+
+		// Look for a bin in the same first level first, then the smallest first level above it
+		PUi32 secondMap = m_SecondLevelMaps[first] & (0xFFU << second);
+
+		if (secondMap == 0)
+		{
+			const PUi32 firstMap = first + 1 < firstLevelCount ? m_FirstLevelMap & (~0U << (first + 1)) : 0;
+
+			if (firstMap != 0)
+			{
+				first = static_cast<PUi32>(std::countr_zero(firstMap));
+				secondMap = m_SecondLevelMaps[first];
+			}
+		}
+
+		if (secondMap != 0)
+			block = m_BinHeads[first * secondLevelCount + std::countr_zero(secondMap)];
+	}
+
+	// The rounded up bins are empty but a block in the size's own bin may still be big enough
+	if (block == noBlock)
+	{
+		PUi32 first = 0, second = 0;
+		GetBin(size, first, second);
+
+		for (PUi32 i = m_BinHeads[first * secondLevelCount + second]; i != noBlock; i = m_Blocks[i].nextFree)
+		{
+			if (m_Blocks[i].size >= size)
+			{
+				block = i;
+				break;
+			}
+		}
+
+		if (block == noBlock)
+			return false;
+	}
+
+	RemoveFree(block);
+
+	// Split off the end of the block if it is bigger than needed
+	if (m_Blocks[block].size > size)
+	{
+		const PUi32 remainder = CreateBlock();
+		PSBufferBlock& used = m_Blocks[block];
+		PSBufferBlock& rest = m_Blocks[remainder];
+
+		rest.offset = used.offset + size;
+		rest.size = used.size - size;
+		rest.prevPhysical = block;
+		rest.nextPhysical = used.nextPhysical;
+		used.size = size;
+		used.nextPhysical = remainder;
+
+		if (rest.nextPhysical != noBlock)
+			m_Blocks[rest.nextPhysical].prevPhysical = remainder;
+		else
+			m_LastBlock = remainder;
+
+		InsertFree(remainder);
+	}
+
+	outAllocation.block = block;
+	outAllocation.offset = m_Blocks[block].offset;
+	outAllocation.size = size;
+
+	m_Used += size;
+	++m_AllocationCount;
+
+	return true;
+}
+
+void PBufferAllocator::Free(const PSBufferAllocation& allocation)
+{
+	if (!allocation.IsValid() || m_Blocks[allocation.block].isFree)
+		return;
+
+	PUi32 block = allocation.block;
+
+	m_Used -= m_Blocks[block].size;
+	--m_AllocationCount;
+
+	// Merge into the free block before it
+	const PUi32 prev = m_Blocks[block].prevPhysical;
+
+	if (prev != noBlock && m_Blocks[prev].isFree)
+	{
+		RemoveFree(prev);
+
+		m_Blocks[prev].size += m_Blocks[block].size;
+		m_Blocks[prev].nextPhysical = m_Blocks[block].nextPhysical;
+
+		if (m_Blocks[prev].nextPhysical != noBlock)
+			m_Blocks[m_Blocks[prev].nextPhysical].prevPhysical = prev;
+		else
+			m_LastBlock = prev;
+
+		DestroyBlock(block);
+		block = prev;
+	}
+
+	// Merge the free block after it in
+	const PUi32 next = m_Blocks[block].nextPhysical;
+
+	if (next != noBlock && m_Blocks[next].isFree)
+	{
+		RemoveFree(next);
+
+		m_Blocks[block].size += m_Blocks[next].size;
+		m_Blocks[block].nextPhysical = m_Blocks[next].nextPhysical;
+
+		if (m_Blocks[block].nextPhysical != noBlock)
+			m_Blocks[m_Blocks[block].nextPhysical].prevPhysical = block;
+		else
+			m_LastBlock = block;
+
+		DestroyBlock(next);
+	}
+
+	InsertFree(block);
+}
+
+void PBufferAllocator::Grow(const PUi32& newCapacity)
+{
+	if (newCapacity <= m_Capacity)
+		return;
+
+	if (m_BinHeads.empty())
+	{
+		m_BinHeads.assign(firstLevelCount * secondLevelCount, noBlock);
+		m_SecondLevelMaps.assign(firstLevelCount, 0);
+	}
+
+	const PUi32 extra = newCapacity - m_Capacity;
+
+	if (m_LastBlock != noBlock && m_Blocks[m_LastBlock].isFree)
+	{
+		// Extend the free space at the end
+		RemoveFree(m_LastBlock);
+		m_Blocks[m_LastBlock].size += extra;
+		InsertFree(m_LastBlock);
+	}
+	else
+	{
+		const PUi32 block = CreateBlock();
+		m_Blocks[block].offset = m_Capacity;
+		m_Blocks[block].size = extra;
+		m_Blocks[block].prevPhysical = m_LastBlock;
+
+		if (m_LastBlock != noBlock)
+			m_Blocks[m_LastBlock].nextPhysical = block;
+		else
+			m_FirstBlock = block;
+
+		m_LastBlock = block;
+		InsertFree(block);
+	}
+
+	m_Capacity = newCapacity;
+}
+
+void PBufferAllocator::Compact(TArray<PSBufferMove>& outMoves)
+{
+	outMoves.clear();
+
+	// Find the allocated blocks in buffer order and drop the free ones
+	TArray<PUi32> usedBlocks;
+	usedBlocks.reserve(m_AllocationCount);
+
+	for (PUi32 i = m_FirstBlock; i != noBlock;)
+	{
+		const PUi32 next = m_Blocks[i].nextPhysical;
+
+		if (m_Blocks[i].isFree)
+		{
+			RemoveFree(i);
+			DestroyBlock(i);
+		}
+		else
+		{
+			usedBlocks.push_back(i);
+		}
+
+		i = next;
+	}
+
+	// Pack them together from the start, each only moves towards the start so the moves can run in order
+	PUi32 offset = 0;
+	PUi32 prev = noBlock;
+	m_FirstBlock = noBlock;
+
+	for (const PUi32 i : usedBlocks)
+	{
+		PSBufferBlock& block = m_Blocks[i];
+
+		if (block.offset != offset)
+		{
+			PSBufferMove move;
+			move.from = block.offset;
+			move.to = offset;
+			move.size = block.size;
+			outMoves.push_back(move);
+
+			block.offset = offset;
+		}
+
+		block.prevPhysical = prev;
+		block.nextPhysical = noBlock;
+
+		if (prev != noBlock)
+			m_Blocks[prev].nextPhysical = i;
+		else
+			m_FirstBlock = i;
+
+		offset += block.size;
+		prev = i;
+	}
+
+	m_LastBlock = prev;
+
+	// The rest of the range is one free block
+	const PUi32 capacity = m_Capacity;
+	m_Capacity = offset;
+	Grow(capacity);
+}
+
+PSBufferAllocatorStats PBufferAllocator::GetStats() const
+{
+	PSBufferAllocatorStats stats;
+	stats.capacity = m_Capacity;
+	stats.used = m_Used;
+	stats.allocationCount = m_AllocationCount;
+
+	for (const PUi32 head : m_BinHeads)
+	{
+		for (PUi32 i = head; i != noBlock; i = m_Blocks[i].nextFree)
+		{
+			++stats.freeBlockCount;
+			stats.largestFreeBlock = std::max(stats.largestFreeBlock, m_Blocks[i].size);
+		}
+	}
+
+	return stats;
+}
+
+void PBufferAllocator::GetBin(const PUi32& size, PUi32& outFirst, PUi32& outSecond)
+{
+	// Small sizes get a bin each in the first level
+	if (size < secondLevelCount)
+	{
+		outFirst = 0;
+		outSecond = size;
+		return;
+	}
+
+	// The top bit picks the first level and the bits after it pick the bin
+	const PUi32 topBit = static_cast<PUi32>(std::bit_width(size)) - 1;
+	outFirst = topBit - secondLevelBits + 1;
+	outSecond = (size >> (topBit - secondLevelBits)) & (secondLevelCount - 1);
+}
+
+PUi32 PBufferAllocator::CreateBlock()
+{
+	if (m_UnusedBlocks.empty())
+	{
+		m_Blocks.emplace_back();
+		return static_cast<PUi32>(m_Blocks.size() - 1);
+	}
+
+	const PUi32 block = m_UnusedBlocks.back();
+	m_UnusedBlocks.pop_back();
+	m_Blocks[block] = PSBufferBlock();
+
+	return block;
+}
+
+void PBufferAllocator::DestroyBlock(const PUi32& block)
+{
+	m_UnusedBlocks.push_back(block);
+}
+
+void PBufferAllocator::InsertFree(const PUi32& block)
+{
+	PUi32 first = 0, second = 0;
+	GetBin(m_Blocks[block].size, first, second);
+
+	PUi32& head = m_BinHeads[first * secondLevelCount + second];
+
+	m_Blocks[block].isFree = true;
+	m_Blocks[block].prevFree = noBlock;
+	m_Blocks[block].nextFree = head;
+
+	if (head != noBlock)
+		m_Blocks[head].prevFree = block;
+
+	head = block;
+
+	m_FirstLevelMap |= 1U << first;
+	m_SecondLevelMaps[first] |= static_cast<PUi8>(1U << second);
+}
+
+void PBufferAllocator::RemoveFree(const PUi32& block)
+{
+	PUi32 first = 0, second = 0;
+	GetBin(m_Blocks[block].size, first, second);
+
+	PSBufferBlock& freeBlock = m_Blocks[block];
+
+	if (freeBlock.prevFree != noBlock)
+		m_Blocks[freeBlock.prevFree].nextFree = freeBlock.nextFree;
+	else
+		m_BinHeads[first * secondLevelCount + second] = freeBlock.nextFree;
+
+	if (freeBlock.nextFree != noBlock)
+		m_Blocks[freeBlock.nextFree].prevFree = freeBlock.prevFree;
+
+	freeBlock.isFree = false;
+	freeBlock.prevFree = freeBlock.nextFree = noBlock;
+
+	// Clear the bitmap bits once the bin is empty
+	if (m_BinHeads[first * secondLevelCount + second] == noBlock)
+	{
+		m_SecondLevelMaps[first] &= static_cast<PUi8>(~(1U << second));
+
+		if (m_SecondLevelMaps[first] == 0)
+			m_FirstLevelMap &= ~(1U << first);
+	}
+}
@@ -0,0 +1,451 @@
+#include "Graphics/PGLState.h"
+
+// External Libs
+#include <GLEW/glew.h>
+
+// System Libs
+#include <algorithm>
+#include <iterator>
+
+// Marks state that hasn't been set through the cache yet
+const PUi32 unknownState = UINT32_MAX;
+const PUi8 unknownFlag = 2;
+
+// Amount of texture units the cache tracks, units past this are always bound
+const PUi32 trackedTextureUnits = 32;
+
+// Buffer targets the cache tracks, the element array buffer isn't one as it belongs to the VAO
+const PUi32 trackedBufferTargets[] = {
+	GL_ARRAY_BUFFER,
+	GL_COPY_READ_BUFFER,
+	GL_COPY_WRITE_BUFFER,
+	GL_PIXEL_UNPACK_BUFFER,
+	GL_DRAW_INDIRECT_BUFFER,
+	GL_SHADER_STORAGE_BUFFER,
+	GL_UNIFORM_BUFFER
+};
+
+// Amount of indexed shader storage and uniform buffer bindings the cache tracks
+const PUi32 trackedIndexedBindings = 8;
+
+// Capabilities the cache tracks
+const PUi32 trackedCapabilities[] = {
+	GL_DEPTH_TEST,
+	GL_BLEND,
+	GL_CULL_FACE
+};
+
+PGLState::PGLState()
+{
+	m_IssuedCalls = m_FilteredCalls = 0;
+
+	Invalidate();
+}
+
+void PGLState::UseProgram(const PUi32& program)
+{
+	if (m_Program == program)
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	glUseProgram(program);
+	m_Program = program;
+	++m_IssuedCalls;
+}
+
+void PGLState::BindVertexArray(const PUi32& vao)
+{
+	if (m_VAO == vao)
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	glBindVertexArray(vao);
+	m_VAO = vao;
+	++m_IssuedCalls;
+}
+
+void PGLState::BindVertexBuffers(const PUi32& vao, const PUi32& vertexBuffer, const PUi32& stride, const PUi32& elementBuffer)
+{
+	BindVertexArray(vao);
+
+	// Find what is attached to the VAO, there is only one VAO for each vertex layout so the list is short
+	auto found = std::find_if(m_VertexArrayBuffers.begin(), m_VertexArrayBuffers.end(),
+		[&vao](const PSGLVertexArrayBuffers& buffers) { return buffers.vao == vao; });
+
+	if (found == m_VertexArrayBuffers.end())
+	{
+		PSGLVertexArrayBuffers buffers;
+		buffers.vao = vao;
+		m_VertexArrayBuffers.push_back(buffers);
+		found = m_VertexArrayBuffers.end() - 1;
+	}
+
+	if (found->vertexBuffer == vertexBuffer)
+	{
+		++m_FilteredCalls;
+	}
+	else
+	{
+		glVertexArrayVertexBuffer(vao, 0, vertexBuffer, 0, static_cast<GLsizei>(stride));
+		found->vertexBuffer = vertexBuffer;
+		++m_IssuedCalls;
+	}
+
+	if (found->elementBuffer == elementBuffer)
+	{
+		++m_FilteredCalls;
+	}
+	else
+	{
+		glVertexArrayElementBuffer(vao, elementBuffer);
+		found->elementBuffer = elementBuffer;
+		++m_IssuedCalls;
+	}
+}
+
+void PGLState::BindTexture(const PUi32& unit, const PUi32& target, const PUi32& texture)
+{
+	const bool isTracked = unit < trackedTextureUnits;
+
+	if (isTracked && m_Textures[unit] == texture)
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	if (m_ActiveUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		m_ActiveUnit = unit;
+		++m_IssuedCalls;
+	}
+
+	glBindTexture(target, texture);
+	++m_IssuedCalls;
+
+	if (isTracked)
+		m_Textures[unit] = texture;
+}
+
+void PGLState::BindTextures(const PUi32& firstUnit, const PUi32& count, const PUi32* textures)
+{
+	// Find the smallest run of units that has a change
+	PUi32 first = count, last = 0;
+
+	for (PUi32 i = 0; i < count; ++i)
+	{
+		const PUi32 unit = firstUnit + i;
+
+		if (unit < trackedTextureUnits && m_Textures[unit] == textures[i])
+		{
+			++m_FilteredCalls;
+			continue;
+		}
+
+		first = std::min(first, i);
+		last = i;
+	}
+
+	if (first == count)
+		return;
+
+	if (GLEW_VERSION_4_4 || GLEW_ARB_multi_bind)
+	{
+		// Binds each texture to its own target in one call
+		glBindTextures(firstUnit + first, static_cast<GLsizei>(last - first + 1), textures + first);
+		++m_IssuedCalls;
+
+		for (PUi32 i = first; i <= last; ++i)
+		{
+			if (firstUnit + i < trackedTextureUnits)
+				m_Textures[firstUnit + i] = textures[i];
+		}
+
+		return;
+	}
+
+	// Without multi bind each unit is bound on its own, still using each texture's own target
+	for (PUi32 i = first; i <= last; ++i)
+	{
+		glBindTextureUnit(firstUnit + i, textures[i]);
+		++m_IssuedCalls;
+
+		if (firstUnit + i < trackedTextureUnits)
+			m_Textures[firstUnit + i] = textures[i];
+	}
+}
+
+void PGLState::BindBuffer(const PUi32& target, const PUi32& buffer)
+{
+	PUi32 slot = 0;
+	const bool isTracked = GetBufferSlot(target, slot);
+
+	if (isTracked && m_Buffers[slot] == buffer)
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	glBindBuffer(target, buffer);
+	++m_IssuedCalls;
+
+	if (isTracked)
+		m_Buffers[slot] = buffer;
+}
+
+void PGLState::BindBufferRange(const PUi32& target, const PUi32& index, const PUi32& buffer, const PUi64& offset, const PUi64& size)
+{
+	PSGLBufferRange* bindings = GetIndexedBindings(target);
+	const bool isTracked = bindings != nullptr && index < trackedIndexedBindings;
+
+	if (isTracked && bindings[index].buffer == buffer && bindings[index].offset == offset && bindings[index].size == size)
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	glBindBufferRange(target, index, buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+	++m_IssuedCalls;
+
+	if (isTracked)
+	{
+		bindings[index].buffer = buffer;
+		bindings[index].offset = offset;
+		bindings[index].size = size;
+	}
+
+	PUi32 slot = 0;
+
+	if (GetBufferSlot(target, slot))
+		m_Buffers[slot] = buffer;
+}
+
+void PGLState::BindBufferBase(const PUi32& target, const PUi32& index, const PUi32& buffer)
+{
+	PSGLBufferRange* bindings = GetIndexedBindings(target);
+	const bool isTracked = bindings != nullptr && index < trackedIndexedBindings;
+
+	// A size of 0 marks the whole buffer
+	if (isTracked && bindings[index].buffer == buffer && bindings[index].offset == 0 && bindings[index].size == 0)
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	glBindBufferBase(target, index, buffer);
+	++m_IssuedCalls;
+
+	if (isTracked)
+	{
+		bindings[index].buffer = buffer;
+		bindings[index].offset = 0;
+		bindings[index].size = 0;
+	}
+
+	PUi32 slot = 0;
+
+	if (GetBufferSlot(target, slot))
+		m_Buffers[slot] = buffer;
+}
+
+void PGLState::SetEnabled(const PUi32& capability, const bool& enabled)
+{
+	PUi32 slot = 0;
+	const bool isTracked = GetCapabilitySlot(capability, slot);
+
+	if (isTracked && m_Capabilities[slot] == static_cast<PUi8>(enabled))
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+
+	++m_IssuedCalls;
+
+	if (isTracked)
+		m_Capabilities[slot] = static_cast<PUi8>(enabled);
+}
+
+void PGLState::SetBlendFunc(const PUi32& source, const PUi32& destination)
+{
+	if (m_BlendSource == source && m_BlendDestination == destination)
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	glBlendFunc(source, destination);
+	m_BlendSource = source;
+	m_BlendDestination = destination;
+	++m_IssuedCalls;
+}
+
+void PGLState::SetDepthFunc(const PUi32& func)
+{
+	if (m_DepthFunc == func)
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	glDepthFunc(func);
+	m_DepthFunc = func;
+	++m_IssuedCalls;
+}
+
+void PGLState::SetDepthMask(const bool& write)
+{
+	if (m_DepthMask == static_cast<PUi8>(write))
+	{
+		++m_FilteredCalls;
+		return;
+	}
+
+	glDepthMask(write ? GL_TRUE : GL_FALSE);
+	m_DepthMask = static_cast<PUi8>(write);
+	++m_IssuedCalls;
+}
+
+void PGLState::DeleteTexture(PUi32& texture)
+{
+	if (texture == 0)
+		return;
+
+	for (auto& bound : m_Textures)
+	{
+		if (bound == texture)
+			bound = 0;
+	}
+
+	glDeleteTextures(1, &texture);
+	texture = 0;
+}
+
+void PGLState::DeleteBuffer(PUi32& buffer)
+{
+	if (buffer == 0)
+		return;
+
+	for (auto& bound : m_Buffers)
+	{
+		if (bound == buffer)
+			bound = 0;
+	}
+
+	// Not every indexed binding is reset by open gl so let the next bind make the call
+	for (auto& range : m_StorageRanges)
+	{
+		if (range.buffer == buffer)
+			range = PSGLBufferRange();
+	}
+
+	for (auto& range : m_UniformRanges)
+	{
+		if (range.buffer == buffer)
+			range = PSGLBufferRange();
+	}
+
+	// VAOs keep their attachments so the ID must be attached again even if it is reused
+	for (auto& buffers : m_VertexArrayBuffers)
+	{
+		if (buffers.vertexBuffer == buffer)
+			buffers.vertexBuffer = unknownState;
+
+		if (buffers.elementBuffer == buffer)
+			buffers.elementBuffer = unknownState;
+	}
+
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void PGLState::DeleteVertexArray(PUi32& vao)
+{
+	if (vao == 0)
+		return;
+
+	if (m_VAO == vao)
+		m_VAO = 0;
+
+	m_VertexArrayBuffers.erase(std::remove_if(m_VertexArrayBuffers.begin(), m_VertexArrayBuffers.end(),
+		[&vao](const PSGLVertexArrayBuffers& buffers) { return buffers.vao == vao; }), m_VertexArrayBuffers.end());
+
+	glDeleteVertexArrays(1, &vao);
+	vao = 0;
+}
+
+void PGLState::DeleteProgram(PUi32& program)
+{
+	if (program == 0)
+		return;
+
+	// A new program can get the same ID so the next use has to make the call
+	if (m_Program == program)
+		m_Program = 0;
+
+	glDeleteProgram(program);
+	program = 0;
+}
+
+void PGLState::Invalidate()
+{
+	m_Program = unknownState;
+	m_VAO = unknownState;
+	m_VertexArrayBuffers.clear();
+	m_ActiveUnit = unknownState;
+	m_Textures.assign(trackedTextureUnits, unknownState);
+	m_Buffers.assign(std::size(trackedBufferTargets), unknownState);
+	m_StorageRanges.assign(trackedIndexedBindings, PSGLBufferRange());
+	m_UniformRanges.assign(trackedIndexedBindings, PSGLBufferRange());
+	m_Capabilities.assign(std::size(trackedCapabilities), unknownFlag);
+	m_BlendSource = m_BlendDestination = unknownState;
+	m_DepthFunc = unknownState;
+	m_DepthMask = unknownFlag;
+}
+
+bool PGLState::GetBufferSlot(const PUi32& target, PUi32& outSlot)
+{
+	for (PUi32 i = 0; i < std::size(trackedBufferTargets); ++i)
+	{
+		if (trackedBufferTargets[i] == target)
+		{
+			outSlot = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool PGLState::GetCapabilitySlot(const PUi32& capability, PUi32& outSlot)
+{
+	for (PUi32 i = 0; i < std::size(trackedCapabilities); ++i)
+	{
+		if (trackedCapabilities[i] == capability)
+		{
+			outSlot = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+PSGLBufferRange* PGLState::GetIndexedBindings(const PUi32& target)
+{
+	if (target == GL_SHADER_STORAGE_BUFFER)
+		return m_StorageRanges.data();
+
+	if (target == GL_UNIFORM_BUFFER)
+		return m_UniformRanges.data();
+
+	return nullptr;
+}
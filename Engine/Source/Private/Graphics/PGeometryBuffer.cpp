@@ -0,0 +1,479 @@
+#include "Graphics/PGeometryBuffer.h"
+#include "Debug/PDebug.h"
+#include "Graphics/PUploadQueue.h"
+#include "Graphics/PRingBuffer.h"
+#include "Graphics/PGLState.h"
+#include "Graphics/PVertexLayouts.h"
+
+// External Libs
+#include <GLEW/glew.h>
+
+// System Libs
+#include <algorithm>
+
+// Arenas meshes upload into, one for each vertex format and index size
+struct PSMeshArenas
+{
+	// If meshes upload into the arenas
+	bool isEnabled = false;
+
+	// Starting capacity of each arena
+	PUi32 vertexCapacity = 0;
+	PUi32 indexCapacity = 0;
+
+	// Arena for each vertex format and index size, null until it is first used
+	// Indexed by vertex format * 2, + 1 for 32 bit indices
+	TArray<TUnique<PGeometryBuffer>> arenas;
+
+	// Arenas that failed to be created so they aren't tried again
+	TArray<bool> failed;
+
+	// Every arena that has been created
+	TArray<PGeometryBuffer*> created;
+};
+
+static PSMeshArenas meshArenas;
+
+PGeometryBuffer::PGeometryBuffer()
+{
+	m_VBO = m_EAO = 0;
+	m_CommandBuffer = m_DrawDataBuffer = 0;
+	m_VertexFormat = VF_FULL;
+	m_VertexStride = PMesh::GetVertexStride(m_VertexFormat);
+	m_IndexSize = sizeof(PUi32);
+	m_PassCommands = nullptr;
+	m_PassDrawData = nullptr;
+	m_PassBuffer = 0;
+	m_PassCommandOffset = m_PassDrawDataOffset = 0;
+	m_DrawCount = m_PassCapacity = 0;
+	m_StorageAlignment = 256;
+}
+
+PGeometryBuffer::~PGeometryBuffer()
+{
+	// Delete any buffers that were created
+	PGLState& glState = PGLState::GetState();
+	glState.DeleteBuffer(m_VBO);
+	glState.DeleteBuffer(m_EAO);
+	glState.DeleteBuffer(m_CommandBuffer);
+	glState.DeleteBuffer(m_DrawDataBuffer);
+}
+
+bool PGeometryBuffer::InitMeshArenas(const PUi32& vertexCapacity, const PUi32& indexCapacity)
+{
+	// Multi draw indirect and gl_DrawID require open gl 4.6
+	if (!GLEW_VERSION_4_6)
+	{
+		PDebug::Log("Geometry buffer requires open gl 4.6 for multi draw indirect", LT_WARN);
+		return false;
+	}
+
+	meshArenas.isEnabled = true;
+	meshArenas.vertexCapacity = vertexCapacity;
+	meshArenas.indexCapacity = indexCapacity;
+
+	return true;
+}
+
+PGeometryBuffer* PGeometryBuffer::GetMeshArena(const PEVertexFormat& vertexFormat, const PUi32& indexSize)
+{
+	if (!meshArenas.isEnabled)
+		return nullptr;
+
+	const size_t index = static_cast<size_t>(vertexFormat) * 2 + (indexSize == sizeof(PUi32) ? 1 : 0);
+
+	if (index >= meshArenas.arenas.size())
+	{
+		meshArenas.arenas.resize(index + 1);
+		meshArenas.failed.resize(index + 1, false);
+	}
+
+	if (meshArenas.arenas[index] || meshArenas.failed[index])
+		return meshArenas.arenas[index].get();
+
+	// Create the arena the first time a mesh with the format and index size is uploaded
+	auto arena = TMakeUnique<PGeometryBuffer>();
+
+	if (!arena->Init(vertexFormat, indexSize, meshArenas.vertexCapacity, meshArenas.indexCapacity))
+	{
+		PDebug::Log("Geometry buffer failed to create a mesh arena, meshes in the format will use their own buffers", LT_WARN);
+		meshArenas.failed[index] = true;
+		return nullptr;
+	}
+
+	meshArenas.created.push_back(arena.get());
+	meshArenas.arenas[index] = std::move(arena);
+
+	return meshArenas.arenas[index].get();
+}
+
+const TArray<PGeometryBuffer*>& PGeometryBuffer::GetMeshArenas()
+{
+	return meshArenas.created;
+}
+
+void PGeometryBuffer::ShutdownMeshArenas()
+{
+	meshArenas = PSMeshArenas();
+}
+
+bool PGeometryBuffer::Init(const PEVertexFormat& vertexFormat, const PUi32& indexSize, const PUi32& vertexCapacity, const PUi32& indexCapacity)
+{
+	// Multi draw indirect and gl_DrawID require open gl 4.6
+	if (!GLEW_VERSION_4_6)
+	{
+		PDebug::Log("Geometry buffer requires open gl 4.6 for multi draw indirect", LT_WARN);
+		return false;
+	}
+
+	m_VertexFormat = vertexFormat;
+	m_VertexStride = PMesh::GetVertexStride(m_VertexFormat);
+	m_IndexSize = indexSize == sizeof(PUi16) ? sizeof(PUi16) : sizeof(PUi32);
+	m_VertexAllocator.Reset(vertexCapacity);
+	m_IndexAllocator.Reset(indexCapacity);
+
+	// Meshes draw through the VAO shared by every mesh with the same vertex format
+	// The shared buffers are attached to it when the pass is drawn
+	if (PVertexLayouts::GetLayouts().GetVAO(m_VertexFormat) == 0)
+		return false;
+
+	// Create the shared vertex and index buffers with the starting capacity and no data
+	// The data is copied in later by the upload queue as meshes are given ranges
+	if (!CreateStorage(m_VBO, static_cast<PUi64>(m_VertexAllocator.GetCapacity()) * m_VertexStride)
+		|| !CreateStorage(m_EAO, static_cast<PUi64>(m_IndexAllocator.GetCapacity()) * m_IndexSize))
+		return false;
+
+	// Create the buffers that are rewritten every pass
+	// They stay mutable so they can be orphaned when there is no ring buffer
+	glCreateBuffers(1, &m_CommandBuffer);
+	glCreateBuffers(1, &m_DrawDataBuffer);
+
+	if (m_CommandBuffer == 0 || m_DrawDataBuffer == 0)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Geometry buffer failed to create draw buffers: " + errorMsg, LT_WARN);
+		return false;
+	}
+
+	// Per draw data ranges in a ring buffer must start on this boundary
+	GLint storageAlignment = 0;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+
+	if (storageAlignment > 0)
+		m_StorageAlignment = static_cast<PUi32>(storageAlignment);
+
+	PDebug::Log("Geometry buffer created for multi draw indirect", LT_SUCCESS);
+
+	return true;
+}
+
+bool PGeometryBuffer::AddMeshData(const void* owner, const TShared<TArray<PUi8>>& vertexData, const PUi32& vertexCount,
+	const TShared<TArray<PUi8>>& indexData, const PUi32& indexCount, PSGeometryAllocation& outAllocation,
+	const std::function<void()>& onComplete)
+{
+	if (m_VBO == 0)
+		return false;
+
+	// Take a range of each buffer, growing them if there is no free block big enough
+	PSGeometryAllocation allocation;
+
+	if (!AllocateRange(m_VertexAllocator, m_VBO, m_VertexStride, vertexCount, allocation.vertices))
+		return false;
+
+	if (!AllocateRange(m_IndexAllocator, m_EAO, m_IndexSize, indexCount, allocation.indices))
+	{
+		m_VertexAllocator.Free(allocation.vertices);
+		return false;
+	}
+
+	// Queue the vertices and indices to be copied into their ranges
+	// Uploads finish in order so the callback runs once both have been copied
+	PUploadQueue& uploadQueue = PUploadQueue::GetQueue();
+
+	uploadQueue.UploadBuffer(owner, m_VBO,
+		static_cast<PUi64>(allocation.vertices.offset) * m_VertexStride,
+		vertexData->data(),
+		static_cast<PUi64>(vertexCount) * m_VertexStride,
+		vertexData);
+
+	uploadQueue.UploadBuffer(owner, m_EAO,
+		static_cast<PUi64>(allocation.indices.offset) * m_IndexSize,
+		indexData->data(),
+		static_cast<PUi64>(indexCount) * m_IndexSize,
+		indexData, onComplete);
+
+	outAllocation = allocation;
+
+	return true;
+}
+
+void PGeometryBuffer::RemoveMeshData(const PSGeometryAllocation& allocation)
+{
+	m_VertexAllocator.Free(allocation.vertices);
+	m_IndexAllocator.Free(allocation.indices);
+}
+
+PSGeometryRange PGeometryBuffer::GetRange(const PSGeometryAllocation& allocation) const
+{
+	// Indices stay relative to the mesh, baseVertex offsets them when drawing
+	// The offsets are read from the allocators as compacting moves the ranges
+	PSGeometryRange range;
+	range.baseVertex = m_VertexAllocator.GetOffset(allocation.vertices);
+	range.firstIndex = m_IndexAllocator.GetOffset(allocation.indices);
+	range.indexCount = allocation.indices.size;
+
+	return range;
+}
+
+bool PGeometryBuffer::Compact()
+{
+	if (m_VBO == 0)
+		return false;
+
+	// Queued uploads point at the old offsets
+	PUploadQueue::GetQueue().Flush();
+
+	return CompactBuffer(m_VertexAllocator, m_VBO, m_VertexStride)
+		&& CompactBuffer(m_IndexAllocator, m_EAO, m_IndexSize);
+}
+
+PUi32 PGeometryBuffer::GetIndexType() const
+{
+	return m_IndexSize == sizeof(PUi16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+bool PGeometryBuffer::BindBuffers()
+{
+	// Growing and compacting replace the buffers so they are attached again if they changed
+	return m_VBO != 0 && PVertexLayouts::GetLayouts().Bind(m_VertexFormat, m_VBO, m_EAO);
+}
+
+void PGeometryBuffer::BeginPass(PRingBuffer* ringBuffer, const PUi32& drawCount)
+{
+	m_DrawCount = 0;
+	m_PassCapacity = drawCount;
+	m_PassBuffer = 0;
+
+	PSRingAllocation commandAllocation, drawDataAllocation;
+
+	// Indirect commands only need to be 4 byte aligned
+	if (ringBuffer != nullptr
+		&& ringBuffer->Allocate(drawCount * sizeof(PSDrawElementsIndirectCommand), sizeof(PUi32), commandAllocation)
+		&& ringBuffer->Allocate(drawCount * sizeof(PSIndirectDrawData), m_StorageAlignment, drawDataAllocation))
+	{
+		m_PassCommands = static_cast<PSDrawElementsIndirectCommand*>(commandAllocation.data);
+		m_PassDrawData = static_cast<PSIndirectDrawData*>(drawDataAllocation.data);
+		m_PassBuffer = ringBuffer->GetID();
+		m_PassCommandOffset = commandAllocation.offset;
+		m_PassDrawDataOffset = drawDataAllocation.offset;
+		return;
+	}
+
+	m_Commands.resize(drawCount);
+	m_DrawData.resize(drawCount);
+	m_PassCommands = m_Commands.data();
+	m_PassDrawData = m_DrawData.data();
+}
+
+void PGeometryBuffer::AddDraw(const PSGeometryRange& range, const glm::mat4& model, const glm::mat4& mesh,
+	const glm::vec3& positionOffset, const glm::vec3& positionScale, const PUi32& materialID)
+{
+	if (m_DrawCount >= m_PassCapacity)
+		return;
+
+	// Built on the stack and written once, mapped memory is slow to read back
+	PSDrawElementsIndirectCommand command;
+	command.count = range.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = range.firstIndex;
+	command.baseVertex = static_cast<int>(range.baseVertex);
+	command.baseInstance = 0;
+	m_PassCommands[m_DrawCount] = command;
+
+	// The draw data index matches the command index which is gl_DrawID in the shader
+	PSIndirectDrawData drawData;
+	drawData.model = model;
+	drawData.mesh = mesh;
+	drawData.positionOffset = glm::vec4(positionOffset, 0.0f);
+	drawData.positionScale = glm::vec4(positionScale, 0.0f);
+	drawData.materialID = materialID;
+	m_PassDrawData[m_DrawCount] = drawData;
+
+	++m_DrawCount;
+}
+
+void PGeometryBuffer::Draw()
+{
+	if (m_DrawCount == 0 || m_VBO == 0)
+		return;
+
+	const GLsizeiptr drawDataSize = static_cast<GLsizeiptr>(m_DrawCount * sizeof(PSIndirectDrawData));
+	const GLsizeiptr commandSize = static_cast<GLsizeiptr>(m_DrawCount * sizeof(PSDrawElementsIndirectCommand));
+
+	// Offset of the first command in the bound indirect buffer
+	PUi64 commandOffset = 0;
+
+	PGLState& glState = PGLState::GetState();
+
+	if (m_PassBuffer > 0)
+	{
+		// The data is already in the ring buffer, bind the pass's ranges of it
+		glState.BindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_PassBuffer, m_PassDrawDataOffset, static_cast<PUi64>(drawDataSize));
+		glState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_PassBuffer);
+		commandOffset = m_PassCommandOffset;
+	}
+	else
+	{
+		// Upload the per draw data to the shader storage buffer at binding 0
+		// Passing null first orphans the old data so we don't wait for the last pass to finish
+		glNamedBufferData(m_DrawDataBuffer, drawDataSize, nullptr, GL_STREAM_DRAW);
+		glNamedBufferSubData(m_DrawDataBuffer, 0, drawDataSize, m_DrawData.data());
+		glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_DrawDataBuffer);
+
+		// Upload the commands the same way
+		glNamedBufferData(m_CommandBuffer, commandSize, nullptr, GL_STREAM_DRAW);
+		glNamedBufferSubData(m_CommandBuffer, 0, commandSize, m_Commands.data());
+		glState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+	}
+
+	// The VAO and buffers are left bound, the state cache skips binding them again next pass
+	if (!BindBuffers())
+		return;
+
+	// Draw every command in the pass with one call
+	glMultiDrawElementsIndirect(
+		GL_TRIANGLES, // Draw the meshes as triangles
+		GetIndexType(), // What type of data is the index array
+		reinterpret_cast<const void*>(static_cast<uintptr_t>(commandOffset)), // Byte offset of the pass in the command buffer
+		static_cast<GLsizei>(m_DrawCount), // How many commands to draw
+		0 // The commands are tightly packed
+	);
+}
+
+bool PGeometryBuffer::AllocateRange(PBufferAllocator& allocator, PUi32& bufferID, const PUi32& stride,
+	const PUi32& count, PSBufferAllocation& outAllocation)
+{
+	if (allocator.Allocate(count, outAllocation))
+		return true;
+
+	// Double the buffer, or more if a single mesh needs it
+	// Worked out in 64 bits so big buffers can't wrap around, ranges are still 32 bit so it is clamped
+	const PUi32 capacity = allocator.GetCapacity();
+	const PUi64 wantedCapacity = std::max(static_cast<PUi64>(capacity) * 2, static_cast<PUi64>(capacity) + count);
+	const PUi32 newCapacity = static_cast<PUi32>(std::min<PUi64>(wantedCapacity, UINT32_MAX));
+
+	if (newCapacity - capacity < count)
+	{
+		PDebug::Log("Geometry buffer can't grow to fit " + std::to_string(count) + " more elements", LT_WARN);
+		return false;
+	}
+
+	if (!GrowBuffer(bufferID,
+		static_cast<PUi64>(capacity) * stride,
+		static_cast<PUi64>(newCapacity) * stride))
+		return false;
+
+	allocator.Grow(newCapacity);
+
+	return allocator.Allocate(count, outAllocation);
+}
+
+bool PGeometryBuffer::GrowBuffer(PUi32& bufferID, const PUi64& usedBytes, const PUi64& newBytes)
+{
+	// Uploads still queued for the old buffer would be lost when it is deleted
+	PUploadQueue::GetQueue().Flush();
+
+	// Create a bigger buffer
+	PUi32 newBuffer = 0;
+
+	if (!CreateStorage(newBuffer, newBytes))
+		return false;
+
+	// Copy the existing data across on the GPU
+	// Free blocks are copied too, the ranges are spread through the whole buffer
+	if (usedBytes > 0)
+		glCopyNamedBufferSubData(bufferID, newBuffer, 0, 0, static_cast<GLsizeiptr>(usedBytes));
+
+	// The new buffer is attached to the VAO the next time the pass is drawn
+	PGLState::GetState().DeleteBuffer(bufferID);
+	bufferID = newBuffer;
+
+	return true;
+}
+
+bool PGeometryBuffer::CompactBuffer(PBufferAllocator& allocator, PUi32& bufferID, const PUi32& stride)
+{
+	// Copy into a new buffer, moves inside one buffer can't overlap
+	// Created before the allocator moves any ranges so a failure leaves everything where it was
+	PUi32 newBuffer = 0;
+
+	if (!CreateStorage(newBuffer, static_cast<PUi64>(allocator.GetCapacity()) * stride))
+		return false;
+
+	TArray<PSBufferMove> moves;
+	allocator.Compact(moves);
+
+	PGLState& glState = PGLState::GetState();
+
+	// Already packed
+	if (moves.empty())
+	{
+		glState.DeleteBuffer(newBuffer);
+		return true;
+	}
+
+	const PUi32 oldBuffer = bufferID;
+
+	const auto copyRange = [&oldBuffer, &newBuffer, &stride](const PUi32& from, const PUi32& to, const PUi32& size)
+		{
+			glCopyNamedBufferSubData(oldBuffer, newBuffer,
+				static_cast<GLintptr>(static_cast<PUi64>(from) * stride),
+				static_cast<GLintptr>(static_cast<PUi64>(to) * stride),
+				static_cast<GLsizeiptr>(static_cast<PUi64>(size) * stride));
+		};
+
+	// Everything before the first move stayed where it was
+	if (moves[0].to > 0)
+		copyRange(0, 0, moves[0].to);
+
+	// Blocks that were next to each other move together so copy them as one range
+	PSBufferMove run = moves[0];
+
+	for (size_t i = 1; i < moves.size(); ++i)
+	{
+		const PSBufferMove& move = moves[i];
+
+		if (move.from == run.from + run.size && move.to == run.to + run.size)
+		{
+			run.size += move.size;
+			continue;
+		}
+
+		copyRange(run.from, run.to, run.size);
+		run = move;
+	}
+
+	copyRange(run.from, run.to, run.size);
+
+	glState.DeleteBuffer(bufferID);
+	bufferID = newBuffer;
+
+	return true;
+}
+
+bool PGeometryBuffer::CreateStorage(PUi32& outBuffer, const PUi64& bytes)
+{
+	glCreateBuffers(1, &outBuffer);
+
+	if (outBuffer == 0)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Geometry buffer failed to create a buffer: " + errorMsg, LT_WARN);
+		return false;
+	}
+
+	// Immutable storage, dynamic so the upload queue can write straight in if it has no staging buffer
+	glNamedBufferStorage(outBuffer, static_cast<GLsizeiptr>(bytes), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	return true;
+}
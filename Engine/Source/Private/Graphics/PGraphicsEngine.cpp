@@ -5,16 +5,68 @@
 #include "Graphics/PTexture.h"
 #include "Graphics/PSCamera.h"
 #include "Graphics/PSLight.h"
+#include "Graphics/PGeometryBuffer.h"
+#include "Graphics/PPortalGraph.h"
+#include "Graphics/PAssetManager.h"
+#include "Graphics/PTextureStreamer.h"
+#include "Graphics/PUploadQueue.h"
+#include "Graphics/PRingBuffer.h"
+#include "Graphics/PGLState.h"
+#include "Graphics/PVertexLayouts.h"
+#include "Graphics/PTextureArrays.h"
+#include "Graphics/PMaterialBuffer.h"
+#include "Graphics/PShaderVariants.h"
+#include "Graphics/PLightClusters.h"
 
 // External Libs
 #include <GLEW/glew.h>
 #include <SDL/SDL.h>
 #include <SDL/SDL_opengl.h>
 
+// System Libs
+#include <algorithm>
+
 // Test mesh for debug
 TWeak<PModel> m_Throne;
 TWeak<PSPointLight> m_PointLight;
 
+PGraphicsEngine::PGraphicsEngine()
+{
+	m_SDLGLContext = nullptr;
+	m_UseIndirectDraw = false;
+	m_UseTextureArrays = true;
+	m_UseOcclusionCulling = true;
+	m_PortalGraph = TMakeShared<PPortalGraph>();
+	m_AssetManager = TMakeShared<PAssetManager>();
+	m_TextureStreamer = TMakeUnique<PTextureStreamer>();
+	m_UseLOD = true;
+	m_MinPixelSize = 2.0f;
+	m_LODHysteresis = 0.1f;
+	m_ViewportHeight = 720;
+	m_IndirectPassCount = 0;
+}
+
+PGraphicsEngine::~PGraphicsEngine()
+{
+	// Destroy the models before the shared buffer that their meshes are stored in
+	m_LoadingModels.clear();
+	m_Models.clear();
+	m_AssetManager = nullptr;
+	PGeometryBuffer::ShutdownMeshArenas();
+	m_FrameRingBuffer = nullptr;
+	m_TextureArrays = nullptr;
+	m_MaterialBuffer = nullptr;
+	m_LightClusters = nullptr;
+	m_Shader = nullptr;
+	m_IndirectShader = nullptr;
+	m_ShaderVariants = nullptr;
+	m_IndirectShaderVariants = nullptr;
+
+	// Free the staging buffer and shared VAOs while the context is still alive
+	PUploadQueue::GetQueue().Shutdown();
+	PVertexLayouts::GetLayouts().Shutdown();
+}
+
 bool PGraphicsEngine::InitEngine(SDL_Window* sdlWindow, const bool& vsync)
 {
 	if (sdlWindow == nullptr)
@@ -69,19 +121,88 @@ bool PGraphicsEngine::InitEngine(SDL_Window* sdlWindow, const bool& vsync)
 		return false;
 	}
 
+	// Meshes and textures are created and edited without binding them
+	if (!GLEW_VERSION_4_5 && !GLEW_ARB_direct_state_access)
+	{
+		PDebug::Log("Graphics engine requires open gl 4.5 for direct state access", LT_ERROR);
+		return false;
+	}
+
 	// Enable depth to be tested
-	glEnable(GL_DEPTH_TEST);
+	PGLState::GetState().SetEnabled(GL_DEPTH_TEST, true);
+
+	// Let the driver compile shader variants on as many threads as it wants
+	if (GLEW_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	else if (GLEW_ARB_parallel_shader_compile)
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
 
-	// Create the shader object
-	m_Shader = TMakeShared<PShaderProgram>();
+	// Read the shader the variants are compiled from
+	// The variant with every keyword is the fallback for the others so it is compiled before anything is drawn
+	m_ShaderVariants = TMakeUnique<PShaderVariants>();
+
+	if (m_ShaderVariants->Init("Shaders/SimpleShader/SimpleShader.vertex", "Shaders/SimpleShader/SimpleShader.frag"))
+		m_Shader = m_ShaderVariants->GetVariant(PSShaderKeywords(), true);
 
 	// Attempt to initialise shdaer and test if failed
-	if (!m_Shader->InitShader("Shaders/SimpleShader/SimpleShader.vertex", "Shaders/SimpleShader/SimpleShader.frag"))
+	if (!m_Shader)
 	{
 		PDebug::Log("Graphics engine failed to intialise due to shader failure");
 		return false;
 	}
 
+	// Create the buffer every material's properties are kept in
+	m_MaterialBuffer = TMakeUnique<PMaterialBuffer>();
+
+	if (!m_MaterialBuffer->Init())
+	{
+		PDebug::Log("Graphics engine failed to intialise due to material buffer failure");
+		return false;
+	}
+
+	// Create the buffers the point lights are assigned to clusters in
+	m_LightClusters = TMakeUnique<PLightClusters>();
+
+	if (!m_LightClusters->Init())
+	{
+		PDebug::Log("Graphics engine failed to intialise due to light cluster failure");
+		return false;
+	}
+
+	// Create the texture arrays that material textures are copied into
+	m_TextureArrays = TMakeUnique<PTextureArrays>();
+
+	// Create the ring buffer that per frame data is written into
+	// Without persistent mapping the data is uploaded with glBufferSubData instead
+	m_FrameRingBuffer = TMakeUnique<PRingBuffer>();
+
+	if (!m_FrameRingBuffer->Init(1024 * 1024))
+		m_FrameRingBuffer = nullptr;
+
+	// Turn on the shared geometry buffers that meshes upload into and draw from
+	// There is one for each vertex format and index size so mesh data is uploaded as it is
+	// Each starts with room for about a quarter of a million vertices and a million indices and grows when it is full
+	// Without them every mesh uses its own buffers and multi draw indirect is disabled
+	if (PGeometryBuffer::InitMeshArenas(1 << 18, 1 << 20))
+	{
+		// The indirect shader shares the fragment shader with the standard shader
+		m_IndirectShaderVariants = TMakeUnique<PShaderVariants>();
+
+		if (m_IndirectShaderVariants->Init("Shaders/SimpleShader/SimpleShaderIndirect.vertex", "Shaders/SimpleShader/SimpleShader.frag"))
+			m_IndirectShader = m_IndirectShaderVariants->GetVariant(PSShaderKeywords(), true);
+
+		if (!m_IndirectShader)
+		{
+			PDebug::Log("Indirect shader failed, multi draw indirect disabled", LT_WARN);
+			m_IndirectShaderVariants = nullptr;
+		}
+	}
+
+	// Startup shaders are warm when every one was loaded from the binary cache
+	const bool isWarm = m_Shader->IsFromCache() && (!m_IndirectShader || m_IndirectShader->IsFromCache());
+	const double shaderTime = m_Shader->GetInitTime() + (m_IndirectShader ? m_IndirectShader->GetInitTime() : 0.0);
+	PDebug::Log("Startup shaders initialised " + PString(isWarm ? "warm" : "cold") + " in " + std::to_string(shaderTime) + " ms");
+
 	// Create the camera
 	m_Camera = TMakeShared<PSCamera>();
 	m_Camera->transform.position.z = -25.0f;
@@ -93,12 +214,10 @@ bool PGraphicsEngine::InitEngine(SDL_Window* sdlWindow, const bool& vsync)
 	m_Throne.lock()->GetTransform().position.z = 200.0f;
 	m_Throne.lock()->GetTransform().rotation.y = 180.0f;
 	// textures
-	TShared<PTexture> tex = TMakeShared<PTexture>();
-	tex->LoadTexture("Throne base colour", "Models/Throne/textures/RustedThrone_Base_Color.png");
-	TShared<PTexture> specTex = TMakeShared<PTexture>();
-	specTex->LoadTexture("Throne specular", "Models/Throne/textures/RustedThrone_Specular.png");
+	TShared<PTexture> tex = LoadTexture("Throne base colour", "Models/Throne/textures/RustedThrone_Base_Color.png");
+	TShared<PTexture> specTex = LoadTexture("Throne specular", "Models/Throne/textures/RustedThrone_Specular.png");
 	// materials
-	TShared<PSMaterial> mat = TMakeShared<PSMaterial>();
+	TShared<PSMaterial> mat = m_AssetManager->GetMaterial("Throne");
 	mat->m_BaseColourMap = tex;
 	mat->m_SpecularMap = specTex;
 
@@ -118,6 +237,23 @@ bool PGraphicsEngine::InitEngine(SDL_Window* sdlWindow, const bool& vsync)
 		lightRef->direction = glm::vec3(0.0f, -1.0f, 0.0f);
 	}
 
+	// Start compiling the variants the scene's lights need while the models load
+	TArray<PSShaderKeywords> warmUpKeywords;
+	PSShaderKeywords lightKeywords;
+	lightKeywords.SetLightCounts(m_Lights);
+
+	for (const bool hasSpecularMap : { true, false })
+	{
+		for (const bool hasVertexColours : { true, false })
+		{
+			warmUpKeywords.push_back(lightKeywords);
+			warmUpKeywords.back().hasSpecularMap = hasSpecularMap;
+			warmUpKeywords.back().hasVertexColours = hasVertexColours;
+		}
+	}
+
+	WarmUpShaders(warmUpKeywords);
+
 	// Log the success of the graphics engine
 	PDebug::Log("Successfully initialised graphics engine", LT_SUCCESS);
 
@@ -138,24 +274,478 @@ void PGraphicsEngine::Render(SDL_Window* sdlWindow)
 
 	//m_PointLight.lock()->position.z += 0.1f;
 
-	// Activate the shader
-	m_Shader->Activate();
+	// Reset the counters for this frame
+	m_Stats = PSRenderStats();
+	PGLState& glState = PGLState::GetState();
+	glState.ResetCounters();
 
-	// Set the world transformations based on the camera
-	m_Shader->SetWorldTransform(m_Camera);
+	// Move to the next region of the per frame ring buffer
+	// Waits here if the CPU is a whole ring ahead of the GPU
+	if (m_FrameRingBuffer)
+	{
+		m_FrameRingBuffer->BeginFrame();
+		m_Stats.fenceWaitTime = m_FrameRingBuffer->GetWaitTime();
+		m_Stats.fenceWaits = m_FrameRingBuffer->GetWaitCount();
+	}
 
-	// Render custom graphics
-	// Models will update their own positions in the mesh based on the transform
-	for (const auto& modelRef : m_Models)
+	// Screen sizes are measured against the window height
+	int windowWidth = 0;
+	SDL_GetWindowSize(sdlWindow, &windowWidth, &m_ViewportHeight);
+
+	// Upload any models that finished loading since the last frame
+	UpdateImports();
+
+	// Find the meshes that can be seen by the camera
+	BuildDrawList();
+
+	// Load the texture detail the visible meshes need before they are drawn
+	StreamTextures();
+
+	// Copy this frame's share of the queued mesh and texture data to the GPU
+	PUploadQueue& uploadQueue = PUploadQueue::GetQueue();
+	uploadQueue.Update();
+	m_Stats.uploadedBytes = uploadQueue.GetBytesUploaded();
+	m_Stats.pendingUploadBytes = uploadQueue.GetBytesPending();
+
+	// Copy the textures asked for last frame into the texture arrays, after the streamed levels have arrived
+	if (m_UseTextureArrays)
+		m_TextureArrays->Update();
+
+	m_Stats.textureArrayMemory = m_TextureArrays->GetMemorySize();
+
+	// Write any new or changed materials before anything is drawn with them
+	UpdateMaterials();
+
+	// Find the point lights that reach each cluster of the frustum, fragments only shade their cluster's lights
+	m_LightClusters->Update(m_Camera, m_Lights, m_Frustum, windowWidth, m_ViewportHeight);
+	m_Stats.visibleLights = m_LightClusters->GetVisibleLightCount();
+	m_Stats.clusterLightIndices = m_LightClusters->GetLightIndexCount();
+
+	// Finish any shader variants the driver has compiled since the last frame
+	m_ShaderVariants->Update();
+
+	if (m_IndirectShaderVariants)
+		m_IndirectShaderVariants->Update();
+
+	// Every variant needs the camera and lights set again this frame
+	m_PreparedShaders.clear();
+
+	if (m_UseIndirectDraw)
 	{
-		modelRef->Render(m_Shader, m_Lights);
-	} 
+		RenderIndirect();
+	}
+	else
+	{
+		// Render custom graphics
+		// Models will update their own positions in the mesh based on the transform
+		// The state cache skips activating the variant if the last draw used the same one
+		for (const auto& draw : m_DrawList)
+		{
+			const TShared<PShaderProgram> shader = UseShaderVariant(*m_ShaderVariants, m_Shader, draw.keywords);
+
+			m_MaterialBuffer->BindTextures(draw.materialID);
+			draw.model->RenderMesh(draw.meshIndex, shader);
+		}
+	}
+
+	m_Stats.shaderVariants = m_ShaderVariants->GetVariantCount()
+		+ (m_IndirectShaderVariants ? m_IndirectShaderVariants->GetVariantCount() : 0);
+	m_Stats.pendingShaderVariants = GetPendingShaderCount();
+
+	// Fence the per frame data so its region isn't written again until the GPU has read it
+	if (m_FrameRingBuffer)
+		m_FrameRingBuffer->EndFrame();
+
+	m_Stats.stateChanges = glState.GetIssuedCalls();
+	m_Stats.filteredStateChanges = glState.GetFilteredCalls();
 
 	// Presented the frame to the window
 	// Swapping the back buffer with the front buffer
 	SDL_GL_SwapWindow(sdlWindow);
 }
 
+void PGraphicsEngine::BuildDrawList()
+{
+	m_DrawList.clear();
+	m_VisibleProxies.clear();
+
+	// Get the planes of the camera view in world space
+	m_Frustum.FromMatrix(m_Camera->GetProjectionMatrix() * m_Camera->GetViewMatrix());
+
+	// Refit the proxies of any model that moved
+	// Testing for a move only compares the transform so this stays cheap
+	for (const auto& modelRef : m_Models)
+	{
+		if (!modelRef->UpdateWorldBounds())
+			continue;
+
+		for (PUi32 i = 0; i < modelRef->GetMeshCount(); ++i)
+			m_CullingTree.MoveProxy(modelRef->GetMeshProxy(i), modelRef->GetMeshWorldBounds(i));
+	}
+
+	// Run any pending or periodic rebuilds of the tree
+	m_CullingTree.Update();
+
+	// Walk the tree so only branches that touch the frustum are visited
+	m_CullingTree.QueryFrustum(m_Frustum, m_VisibleProxies, &m_Stats.nodesTested);
+
+	for (const int& proxyID : m_VisibleProxies)
+	{
+		// The material and keywords are filled in by UpdateMaterials
+		PSMeshDraw draw;
+		draw.model = static_cast<PModel*>(m_CullingTree.GetUserData(proxyID));
+		draw.meshIndex = m_CullingTree.GetUserIndex(proxyID);
+		m_DrawList.push_back(draw);
+	}
+
+	m_Stats.culledMeshes = m_CullingTree.GetProxyCount() - static_cast<PUi32>(m_DrawList.size());
+
+	if (m_PortalGraph->GetCellCount() > 0)
+		PortalCullDrawList();
+
+	if (m_UseOcclusionCulling)
+		OcclusionCullDrawList();
+
+	SelectDrawLODs();
+
+	m_Stats.visibleMeshes = static_cast<PUi32>(m_DrawList.size());
+}
+
+void PGraphicsEngine::PortalCullDrawList()
+{
+	// Outside of every cell, for example outdoors, so the frustum is enough
+	if (!m_PortalGraph->UpdateVisibility(m_Camera->transform.position, m_Camera->GetProjectionMatrix() * m_Camera->GetViewMatrix()))
+		return;
+
+	// Models that aren't in a cell are always kept
+	const auto hiddenIt = std::remove_if(m_DrawList.begin(), m_DrawList.end(), [this](const PSMeshDraw& draw)
+		{
+			const int cell = draw.model->GetCell();
+
+			if (cell < 0)
+				return false;
+
+			return !m_PortalGraph->TestBounds(cell, draw.model->GetMeshWorldBounds(draw.meshIndex));
+		});
+
+	m_Stats.portalCulledMeshes = static_cast<PUi32>(std::distance(hiddenIt, m_DrawList.end()));
+	m_DrawList.erase(hiddenIt, m_DrawList.end());
+}
+
+void PGraphicsEngine::OcclusionCullDrawList()
+{
+	m_OcclusionCuller.BeginFrame(m_Camera->GetProjectionMatrix() * m_Camera->GetViewMatrix());
+
+	// Only occluders inside the frustum can hide anything
+	for (const auto& draw : m_DrawList)
+	{
+		const PMesh* mesh = draw.model->GetMesh(draw.meshIndex);
+
+		if (!mesh->IsOccluder() || mesh->GetIndices().empty())
+			continue;
+
+		const auto& vertices = mesh->GetVertices();
+		const auto& indices = mesh->GetIndices();
+
+		// Occluders always use full detail, a simplified mesh could cover more than the real one
+		m_OcclusionCuller.AddOccluder(&vertices[0].m_Position[0], sizeof(PSVertexData), static_cast<PUi32>(vertices.size()),
+			indices.data(), mesh->GetLOD(0).indexCount, draw.model->GetWorldMatrix() * mesh->GetRelativeTransform());
+	}
+
+	// Nothing to test against
+	if (m_OcclusionCuller.GetTriangleCount() == 0)
+		return;
+
+	m_OcclusionCuller.Rasterize();
+
+	// Occluders are always drawn, everything else has to be in front of them
+	const auto hiddenIt = std::remove_if(m_DrawList.begin(), m_DrawList.end(), [this](const PSMeshDraw& draw)
+		{
+			if (draw.model->GetMesh(draw.meshIndex)->IsOccluder())
+				return false;
+
+			return !m_OcclusionCuller.TestBounds(draw.model->GetMeshWorldBounds(draw.meshIndex));
+		});
+
+	m_Stats.occludedMeshes = static_cast<PUi32>(std::distance(hiddenIt, m_DrawList.end()));
+	m_DrawList.erase(hiddenIt, m_DrawList.end());
+}
+
+void PGraphicsEngine::SelectDrawLODs()
+{
+	const glm::vec3 cameraPosition = m_Camera->transform.position;
+
+	// Distance where a sphere of radius 1 fills the screen height
+	const float invTanHalfFov = 1.0f / glm::tan(glm::radians(m_Camera->fov) * 0.5f);
+
+	const auto smallIt = std::remove_if(m_DrawList.begin(), m_DrawList.end(), [&](const PSMeshDraw& draw)
+		{
+			const PMesh* mesh = draw.model->GetMesh(draw.meshIndex);
+			PUi32 lod = 0;
+
+			if (m_UseLOD)
+			{
+				// Fraction of the screen height covered by the bounding sphere
+				const PSBounds& bounds = draw.model->GetMeshWorldBounds(draw.meshIndex);
+				const float distance = glm::length(bounds.center - cameraPosition);
+				const float screenSize = distance > bounds.radius ? bounds.radius * invTanHalfFov / distance : FLT_MAX;
+
+				if (screenSize * static_cast<float>(m_ViewportHeight) < m_MinPixelSize)
+					return true;
+
+				lod = mesh->SelectLOD(screenSize, draw.model->GetMeshLOD(draw.meshIndex), m_LODHysteresis);
+			}
+
+			draw.model->SetMeshLOD(draw.meshIndex, lod);
+
+			m_Stats.triangles += mesh->GetTriangleCount(lod);
+			m_Stats.fullTriangles += mesh->GetTriangleCount(0);
+
+			return false;
+		});
+
+	m_Stats.tooSmallMeshes = static_cast<PUi32>(std::distance(smallIt, m_DrawList.end()));
+	m_DrawList.erase(smallIt, m_DrawList.end());
+}
+
+void PGraphicsEngine::StreamTextures()
+{
+	m_TextureStreamer->BeginFrame();
+
+	const glm::vec3 cameraPosition = m_Camera->transform.position;
+
+	// Distance where a sphere of radius 1 fills the screen height
+	const float invTanHalfFov = 1.0f / glm::tan(glm::radians(m_Camera->fov) * 0.5f);
+
+	for (const auto& draw : m_DrawList)
+	{
+		const TShared<PSMaterial>& material = draw.model->GetMeshMaterial(draw.meshIndex);
+
+		if (material == nullptr)
+			continue;
+
+		// Pixels covered by the bounding sphere, the camera being inside it needs full detail
+		const PSBounds& bounds = draw.model->GetMeshWorldBounds(draw.meshIndex);
+		const float distance = glm::length(bounds.center - cameraPosition);
+		const float screenSize = distance > bounds.radius ? bounds.radius * invTanHalfFov / distance : FLT_MAX;
+		const float screenPixels = std::min(screenSize, 1.0e6f) * static_cast<float>(m_ViewportHeight);
+
+		m_TextureStreamer->RequestTexture(material->m_BaseColourMap, screenPixels);
+		m_TextureStreamer->RequestTexture(material->m_SpecularMap, screenPixels);
+	}
+
+	m_TextureStreamer->Update();
+	m_Stats.textureMemory = m_TextureStreamer->GetMemoryUsed();
+}
+
+void PGraphicsEngine::UpdateMaterials()
+{
+	m_MaterialBuffer->BeginFrame();
+	m_MaterialBuffer->SetTextureArrays(m_UseTextureArrays ? m_TextureArrays.get() : nullptr);
+
+	// Every draw shades the same lights, only the maps and vertex colours change between draws
+	PSShaderKeywords lightKeywords;
+	lightKeywords.SetLightCounts(m_Lights);
+
+	for (auto& draw : m_DrawList)
+	{
+		const TShared<PSMaterial> material = draw.model->GetMeshMaterial(draw.meshIndex);
+		draw.materialID = m_MaterialBuffer->UseMaterial(material);
+
+		// Compact meshes don't store colours so there is nothing to tint the base colour with
+		draw.keywords = lightKeywords;
+		draw.keywords.hasSpecularMap = material && material->m_SpecularMap;
+		draw.keywords.hasVertexColours = draw.model->GetMesh(draw.meshIndex)->GetVertexFormat() != VF_COMPACT;
+	}
+
+	m_MaterialBuffer->Upload();
+	m_Stats.materialUpdates = m_MaterialBuffer->GetUpdateCount();
+}
+
+void PGraphicsEngine::SetTextureMemoryBudget(const PUi64& bytes)
+{
+	m_TextureStreamer->SetMemoryBudget(bytes);
+}
+
+void PGraphicsEngine::SetTextureMipBias(const float& bias)
+{
+	m_TextureStreamer->SetMipBias(bias);
+}
+
+void PGraphicsEngine::SetUploadBudget(const PUi64& bytes, const double& milliseconds)
+{
+	PUploadQueue& uploadQueue = PUploadQueue::GetQueue();
+	uploadQueue.SetByteBudget(bytes);
+	uploadQueue.SetTimeBudget(milliseconds);
+}
+
+void PGraphicsEngine::CompactGeometry()
+{
+	const auto logStats = [](const PString& name, const PSBufferAllocatorStats& stats)
+		{
+			PDebug::Log(name + ": " + std::to_string(stats.allocationCount) + " blocks, "
+				+ std::to_string(static_cast<int>(stats.GetUtilisation() * 100.0f)) + "% used, "
+				+ std::to_string(stats.freeBlockCount) + " free blocks, "
+				+ std::to_string(static_cast<int>(stats.GetFragmentation() * 100.0f)) + "% fragmented");
+		};
+
+	for (PGeometryBuffer* geometryBuffer : PGeometryBuffer::GetMeshArenas())
+	{
+		const PString name = "Geometry buffer (format " + std::to_string(geometryBuffer->GetVertexFormat()) + ", "
+			+ std::to_string(geometryBuffer->GetIndexSize() * 8) + " bit indices)";
+
+		PDebug::Log(name + " before compacting");
+		logStats("Vertices", geometryBuffer->GetVertexStats());
+		logStats("Indices", geometryBuffer->GetIndexStats());
+
+		if (!geometryBuffer->Compact())
+			continue;
+
+		PDebug::Log(name + " after compacting");
+		logStats("Vertices", geometryBuffer->GetVertexStats());
+		logStats("Indices", geometryBuffer->GetIndexStats());
+	}
+}
+
+void PGraphicsEngine::WarmUpShaders(const TArray<PSShaderKeywords>& keywords)
+{
+	m_ShaderVariants->WarmUp(keywords);
+
+	if (m_IndirectShaderVariants)
+		m_IndirectShaderVariants->WarmUp(keywords);
+}
+
+PUi32 PGraphicsEngine::GetPendingShaderCount() const
+{
+	return m_ShaderVariants->GetPendingCount() + (m_IndirectShaderVariants ? m_IndirectShaderVariants->GetPendingCount() : 0);
+}
+
+TShared<PShaderProgram> PGraphicsEngine::UseShaderVariant(PShaderVariants& variants, const TShared<PShaderProgram>& fallback, const PSShaderKeywords& keywords)
+{
+	TShared<PShaderProgram> shader = variants.GetVariant(keywords);
+
+	if (!shader)
+		shader = fallback;
+
+	shader->Activate();
+
+	// Values shared by every draw are only set once a frame for each variant
+	if (std::find(m_PreparedShaders.begin(), m_PreparedShaders.end(), shader.get()) == m_PreparedShaders.end())
+	{
+		shader->SetWorldTransform(m_Camera);
+		shader->SetLights(m_Lights);
+		m_PreparedShaders.push_back(shader.get());
+	}
+
+	return shader;
+}
+
+void PGraphicsEngine::RenderIndirect()
+{
+	// Textures and shaders can't change inside one draw call so group the draws by the textures their material needs bound
+	// and the shader variant they need
+	// Materials with every map in a texture array share a pass with any other material in the same arrays
+	// Each pass also draws from a single geometry buffer as the vertex format and index type can't change either
+	m_IndirectPassLookup.clear();
+	m_IndirectPassCount = 0;
+
+	for (PUi32 i = 0; i < static_cast<PUi32>(m_DrawList.size()); ++i)
+	{
+		const PSMeshDraw& draw = m_DrawList[i];
+
+		const PMesh* mesh = draw.model->GetMesh(draw.meshIndex);
+
+		// Meshes that aren't in a geometry buffer are drawn on their own
+		if (!mesh->IsInGeometryBuffer())
+			continue;
+
+		PSIndirectPassKey key;
+		key.textures = m_MaterialBuffer->GetTextures(draw.materialID);
+		key.keywordKey = draw.keywords.GetKey();
+		key.geometryBuffer = mesh->GetGeometryBuffer();
+
+		const auto [it, isNew] = m_IndirectPassLookup.try_emplace(key, m_IndirectPassCount);
+
+		// Start a new pass, reusing one from an earlier frame if there is one
+		if (isNew)
+		{
+			if (m_IndirectPassCount == m_IndirectPasses.size())
+				m_IndirectPasses.emplace_back();
+
+			PSIndirectPass& pass = m_IndirectPasses[m_IndirectPassCount++];
+			pass.textures = key.textures;
+			pass.keywords = draw.keywords;
+			pass.geometryBuffer = key.geometryBuffer;
+			pass.draws.clear();
+		}
+
+		m_IndirectPasses[it->second].draws.push_back(i);
+	}
+
+	PGLState& glState = PGLState::GetState();
+
+	// Draw each pass with one multi draw call
+	for (PUi32 i = 0; i < m_IndirectPassCount; ++i)
+	{
+		const PSIndirectPass& pass = m_IndirectPasses[i];
+
+		PGeometryBuffer* geometryBuffer = pass.geometryBuffer;
+
+		// The pass is written straight into this frame's region of the ring buffer
+		geometryBuffer->BeginPass(m_FrameRingBuffer.get(), static_cast<PUi32>(pass.draws.size()));
+
+		for (const PUi32& drawIndex : pass.draws)
+		{
+			const PSMeshDraw& draw = m_DrawList[drawIndex];
+			const PMesh* mesh = draw.model->GetMesh(draw.meshIndex);
+
+			glm::vec3 positionOffset, positionScale;
+			mesh->GetPositionDecode(geometryBuffer->GetVertexFormat(), positionOffset, positionScale);
+
+			geometryBuffer->AddDraw(mesh->GetGeometryRange(draw.model->GetMeshLOD(draw.meshIndex)), draw.model->GetWorldMatrix(),
+				mesh->GetRelativeTransform(), positionOffset, positionScale, draw.materialID);
+		}
+
+		UseShaderVariant(*m_IndirectShaderVariants, m_IndirectShader, pass.keywords);
+
+		// Units 0 - 3 match the samplers set when the shader was linked
+		glState.BindTextures(0, 4, pass.textures.data());
+		geometryBuffer->Draw();
+	}
+
+	// Draw any meshes that failed to be added to the geometry buffer
+	for (const auto& draw : m_DrawList)
+	{
+		if (draw.model->GetMesh(draw.meshIndex)->IsInGeometryBuffer())
+			continue;
+
+		const TShared<PShaderProgram> shader = UseShaderVariant(*m_ShaderVariants, m_Shader, draw.keywords);
+
+		m_MaterialBuffer->BindTextures(draw.materialID);
+		draw.model->RenderMesh(draw.meshIndex, shader);
+	}
+}
+
+void PGraphicsEngine::SetIndirectDrawEnabled(const bool& enable)
+{
+	if (enable && !m_IndirectShader)
+	{
+		PDebug::Log("Multi draw indirect is not supported, using standard draws", LT_WARN);
+		return;
+	}
+
+	m_UseIndirectDraw = enable;
+}
+
+void PGraphicsEngine::SetTextureArraysEnabled(const bool& enable)
+{
+	m_UseTextureArrays = enable;
+
+	// Free the copies, they are made again when the arrays are turned back on
+	if (!enable)
+		m_TextureArrays->Clear();
+}
+
 TWeak<PSPointLight> PGraphicsEngine::CreatePointLight()
 {
 	const auto& newLight = TMakeShared<PSPointLight>();
@@ -172,14 +762,53 @@ TWeak<PSDirLight> PGraphicsEngine::CreateDirLight()
 	return newLight;
 }
 
-TWeak<PModel> PGraphicsEngine::ImportModel(const PString& path)
+TWeak<PModel> PGraphicsEngine::ImportModel(const PString& path, const PSMeshSettings& meshSettings)
 {
+	// The asset manager loads the meshes once, every model placed is an instance of them
 	const auto& newModel = TMakeShared<PModel>();
-	newModel->ImportModel(path);
+	newModel->CreateInstance(m_AssetManager->LoadModel(path, meshSettings));
+
+	// The model has no meshes until it is ready so it draws nothing until then
 	m_Models.push_back(newModel);
+	m_LoadingModels.push_back(newModel);
+
 	return newModel;
 }
 
+void PGraphicsEngine::UpdateImports()
+{
+	// Upload the shared meshes first so the instances waiting on them can be added this frame
+	m_AssetManager->Update();
+
+	for (PUi32 i = 0; i < m_LoadingModels.size();)
+	{
+		const auto& model = m_LoadingModels[i];
+
+		// Still on a worker thread
+		if (!model->UpdateImport())
+		{
+			++i;
+			continue;
+		}
+
+		if (model->GetLoadState() == LS_READY)
+		{
+			// Add each mesh into the culling tree as a static proxy
+			model->UpdateWorldBounds();
+
+			for (PUi32 j = 0; j < model->GetMeshCount(); ++j)
+				model->SetMeshProxy(j, m_CullingTree.CreateProxy(model->GetMeshWorldBounds(j), model.get(), j));
+		}
+
+		m_LoadingModels.erase(m_LoadingModels.begin() + i);
+	}
+}
+
+TShared<PTexture> PGraphicsEngine::LoadTexture(const PString& name, const PString& path)
+{
+	return m_AssetManager->LoadTexture(name, path);
+}
+
 TShared<PSMaterial> PGraphicsEngine::CreateMaterial()
 {
 	return TMakeShared<PSMaterial>();
@@ -0,0 +1,318 @@
+#include "Graphics/PLightClusters.h"
+#include "Debug/PDebug.h"
+#include "Graphics/PSCamera.h"
+#include "Graphics/PSLight.h"
+#include "Graphics/PGLState.h"
+#include "Math/PSFrustum.h"
+
+// External Libs
+#include <GLEW/glew.h>
+#include <GLM/glm.hpp>
+
+// System Libs
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+// Amount of clusters across, down and deep
+const PUi32 clusterCountX = 16;
+const PUi32 clusterCountY = 9;
+const PUi32 clusterCountZ = 24;
+const PUi32 clusterCount = clusterCountX * clusterCountY * clusterCountZ;
+
+// Depth the log slices start at, everything closer is in the first slice
+// Starting the log slices at the near clip would spend most of them on the first few units
+const float clusterStartDepth = 1.0f;
+
+// Most point lights drawn in a frame, lights past this are ignored
+const PUi32 maxPointLights = 4096;
+
+// Most lights that can shade one cluster
+const PUi32 maxClusterLights = 256;
+
+// Words of the cluster buffer taken by the header before the cluster ranges
+const PUi32 headerWords = sizeof(PSClusterHeader) / sizeof(PUi32);
+
+// Shader storage bindings the fragment shader reads the lights and clusters from
+const PUi32 lightBinding = 2;
+const PUi32 clusterBinding = 3;
+const PUi32 indexBinding = 4;
+
+PLightClusters::PLightClusters()
+{
+	m_LightBuffer = m_ClusterBuffer = m_IndexBuffer = 0;
+	m_LightCapacity = m_ClusterCapacity = m_IndexCapacity = 0;
+	m_Projection = glm::mat4(0.0f);
+}
+
+PLightClusters::~PLightClusters()
+{
+	PGLState& glState = PGLState::GetState();
+	glState.DeleteBuffer(m_LightBuffer);
+	glState.DeleteBuffer(m_ClusterBuffer);
+	glState.DeleteBuffer(m_IndexBuffer);
+}
+
+bool PLightClusters::Init()
+{
+	glCreateBuffers(1, &m_LightBuffer);
+	glCreateBuffers(1, &m_ClusterBuffer);
+	glCreateBuffers(1, &m_IndexBuffer);
+
+	if (m_LightBuffer == 0 || m_ClusterBuffer == 0 || m_IndexBuffer == 0)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Light clusters failed to create buffers: " + errorMsg, LT_ERROR);
+		return false;
+	}
+
+	m_Header.grid[0] = clusterCountX;
+	m_Header.grid[1] = clusterCountY;
+	m_Header.grid[2] = clusterCountZ;
+
+	return true;
+}
+
+void PLightClusters::Update(const TShared<PSCamera>& camera, const TArray<TShared<PSLight>>& lights, const PSFrustum& frustum,
+	const int& viewportWidth, const int& viewportHeight)
+{
+	const glm::mat4 view = camera->GetViewMatrix();
+	const glm::mat4 projection = camera->GetProjectionMatrix();
+
+	// The bounds only change with the camera's projection, not as it moves
+	if (projection != m_Projection)
+	{
+		BuildClusterBounds(projection, camera->nearClip, camera->farClip);
+		m_Projection = projection;
+	}
+
+	m_Header.tileScale[0] = static_cast<float>(clusterCountX) / static_cast<float>(std::max(viewportWidth, 1));
+	m_Header.tileScale[1] = static_cast<float>(clusterCountY) / static_cast<float>(std::max(viewportHeight, 1));
+
+	// Find the point lights that reach into the frustum
+	m_LightData.clear();
+	m_LightX.clear();
+	m_LightY.clear();
+	m_LightZ.clear();
+	m_LightRadius.clear();
+
+	for (const auto& light : lights)
+	{
+		const TShared<PSPointLight> pointLight = std::dynamic_pointer_cast<PSPointLight>(light);
+
+		if (!pointLight)
+			continue;
+
+		if (m_LightData.size() >= maxPointLights)
+			break;
+
+		const float radius = pointLight->GetRadius();
+
+		if (radius <= 0.0f || !frustum.TestSphere(pointLight->position, radius))
+			continue;
+
+		PSPointLightData data;
+		data.positionRadius = glm::vec4(pointLight->position, radius);
+		data.colour = glm::vec4(pointLight->colour * pointLight->intensity, 1.0f);
+		data.linear = pointLight->linear;
+		data.quadratic = pointLight->quadratic;
+		m_LightData.push_back(data);
+
+		const glm::vec3 viewPosition = glm::vec3(view * glm::vec4(pointLight->position, 1.0f));
+		m_LightX.push_back(viewPosition.x);
+		m_LightY.push_back(viewPosition.y);
+		m_LightZ.push_back(viewPosition.z);
+		m_LightRadius.push_back(radius);
+	}
+
+	// Fill the clusters slice by slice, each slice only tests the lights that reach its depth
+	m_ClusterRanges.assign(headerWords + clusterCount * 2, 0);
+	m_LightIndices.clear();
+
+	if (!m_LightData.empty())
+	{
+		for (PUi32 slice = 0; slice < clusterCountZ; ++slice)
+			AssignSlice(slice);
+	}
+
+	std::memcpy(m_ClusterRanges.data(), &m_Header, sizeof(m_Header));
+
+	UploadBuffer(m_LightBuffer, m_LightCapacity, m_LightData.data(), m_LightData.size() * sizeof(PSPointLightData));
+	UploadBuffer(m_ClusterBuffer, m_ClusterCapacity, m_ClusterRanges.data(), m_ClusterRanges.size() * sizeof(PUi32));
+	UploadBuffer(m_IndexBuffer, m_IndexCapacity, m_LightIndices.data(), m_LightIndices.size() * sizeof(PUi32));
+
+	PGLState& glState = PGLState::GetState();
+	glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, lightBinding, m_LightBuffer);
+	glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, clusterBinding, m_ClusterBuffer);
+	glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, indexBinding, m_IndexBuffer);
+}
+
+void PLightClusters::BuildClusterBounds(const glm::mat4& projection, const float& nearClip, const float& farClip)
+{
+	// Slice 0 runs from the near clip to the start depth, the rest split the remaining depth evenly in log space
+	const float startDepth = glm::clamp(clusterStartDepth, nearClip, farClip);
+	const float logSlices = static_cast<float>(clusterCountZ - 1);
+
+	m_SliceDepths.resize(clusterCountZ + 1);
+	m_SliceDepths[0] = nearClip;
+
+	for (PUi32 i = 1; i <= clusterCountZ; ++i)
+		m_SliceDepths[i] = startDepth * std::pow(farClip / startDepth, static_cast<float>(i - 1) / logSlices);
+
+	m_Header.depth[0] = logSlices / std::log(farClip / startDepth);
+	m_Header.depth[1] = startDepth;
+	m_Header.depth[2] = nearClip;
+	m_Header.depth[3] = farClip;
+
+	// Direction through each tile corner scaled so it is 1 deep, multiplying by a depth gives the corner at that depth
+	const glm::mat4 inverseProjection = glm::inverse(projection);
+	TArray<glm::vec3> corners((clusterCountX + 1) * (clusterCountY + 1));
+
+	for (PUi32 y = 0; y <= clusterCountY; ++y)
+	{
+		for (PUi32 x = 0; x <= clusterCountX; ++x)
+		{
+			const glm::vec2 ndc(static_cast<float>(x) / clusterCountX * 2.0f - 1.0f, static_cast<float>(y) / clusterCountY * 2.0f - 1.0f);
+			const glm::vec4 point = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+			const glm::vec3 viewPoint = glm::vec3(point) / point.w;
+
+			corners[x + y * (clusterCountX + 1)] = viewPoint / -viewPoint.z;
+		}
+	}
+
+	m_ClusterMin.resize(clusterCount);
+	m_ClusterMax.resize(clusterCount);
+
+	for (PUi32 z = 0; z < clusterCountZ; ++z)
+	{
+		for (PUi32 y = 0; y < clusterCountY; ++y)
+		{
+			for (PUi32 x = 0; x < clusterCountX; ++x)
+			{
+				const PUi32 cluster = x + clusterCountX * (y + clusterCountY * z);
+				glm::vec3 boundsMin(INFINITY), boundsMax(-INFINITY);
+
+				// Bounds of the tile's corners at the front and back of the slice
+				for (PUi32 corner = 0; corner < 4; ++corner)
+				{
+					const glm::vec3& direction = corners[(x + (corner & 1)) + (y + (corner >> 1)) * (clusterCountX + 1)];
+
+					for (PUi32 side = 0; side < 2; ++side)
+					{
+						const glm::vec3 point = direction * m_SliceDepths[z + side];
+						boundsMin = glm::min(boundsMin, point);
+						boundsMax = glm::max(boundsMax, point);
+					}
+				}
+
+				m_ClusterMin[cluster] = boundsMin;
+				m_ClusterMax[cluster] = boundsMax;
+			}
+		}
+	}
+}
+
+void PLightClusters::AssignSlice(const PUi32& slice)
+{
+	const float sliceNear = m_SliceDepths[slice];
+	const float sliceFar = m_SliceDepths[slice + 1];
+
+	m_SliceX.clear();
+	m_SliceY.clear();
+	m_SliceZ.clear();
+	m_SliceRadius.clear();
+	m_SliceLights.clear();
+
+	// View space looks down -z so the depth of a light is its negative z
+	for (PUi32 i = 0; i < m_LightData.size(); ++i)
+	{
+		const float depth = -m_LightZ[i];
+
+		if (depth + m_LightRadius[i] < sliceNear || depth - m_LightRadius[i] > sliceFar)
+			continue;
+
+		m_SliceX.push_back(m_LightX[i]);
+		m_SliceY.push_back(m_LightY[i]);
+		m_SliceZ.push_back(m_LightZ[i]);
+		m_SliceRadius.push_back(m_LightRadius[i]);
+		m_SliceLights.push_back(i);
+	}
+
+	const PUi32 sliceLightCount = static_cast<PUi32>(m_SliceLights.size());
+
+	if (sliceLightCount == 0)
+		return;
+
+	// Pad the lists so the last 4 lights can be loaded at once, the padding is masked out of the results
+	const size_t paddedCount = (sliceLightCount + 3) & ~static_cast<size_t>(3);
+	m_SliceX.resize(paddedCount, 0.0f);
+	m_SliceY.resize(paddedCount, 0.0f);
+	m_SliceZ.resize(paddedCount, 0.0f);
+	m_SliceRadius.resize(paddedCount, 0.0f);
+
+	const __m128 zero = _mm_setzero_ps();
+
+	for (PUi32 y = 0; y < clusterCountY; ++y)
+	{
+		for (PUi32 x = 0; x < clusterCountX; ++x)
+		{
+			const PUi32 cluster = x + clusterCountX * (y + clusterCountY * slice);
+			const PUi32 offset = static_cast<PUi32>(m_LightIndices.size());
+
+			const __m128 minX = _mm_set1_ps(m_ClusterMin[cluster].x);
+			const __m128 minY = _mm_set1_ps(m_ClusterMin[cluster].y);
+			const __m128 minZ = _mm_set1_ps(m_ClusterMin[cluster].z);
+			const __m128 maxX = _mm_set1_ps(m_ClusterMax[cluster].x);
+			const __m128 maxY = _mm_set1_ps(m_ClusterMax[cluster].y);
+			const __m128 maxZ = _mm_set1_ps(m_ClusterMax[cluster].z);
+
+			for (PUi32 i = 0; i < sliceLightCount; i += 4)
+			{
+				const __m128 lightX = _mm_loadu_ps(&m_SliceX[i]);
+				const __m128 lightY = _mm_loadu_ps(&m_SliceY[i]);
+				const __m128 lightZ = _mm_loadu_ps(&m_SliceZ[i]);
+				const __m128 radius = _mm_loadu_ps(&m_SliceRadius[i]);
+
+				// Distance from each light to the closest point of the cluster, 0 on an axis the light is inside
+				const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, lightX), _mm_sub_ps(lightX, maxX)), zero);
+				const __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, lightY), _mm_sub_ps(lightY, maxY)), zero);
+				const __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, lightZ), _mm_sub_ps(lightZ, maxZ)), zero);
+
+				__m128 distanceSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+				distanceSq = _mm_add_ps(distanceSq, _mm_mul_ps(dz, dz));
+
+				int hitMask = _mm_movemask_ps(_mm_cmple_ps(distanceSq, _mm_mul_ps(radius, radius)));
+
+				// Ignore the padding on the last 4 lights
+				if (sliceLightCount - i < 4)
+					hitMask &= (1 << (sliceLightCount - i)) - 1;
+
+				for (PUi32 lane = 0; lane < 4 && hitMask != 0; ++lane)
+				{
+					if ((hitMask & (1 << lane)) == 0 || m_LightIndices.size() - offset >= maxClusterLights)
+						continue;
+
+					m_LightIndices.push_back(m_SliceLights[i + lane]);
+				}
+			}
+
+			m_ClusterRanges[headerWords + cluster * 2] = offset;
+			m_ClusterRanges[headerWords + cluster * 2 + 1] = static_cast<PUi32>(m_LightIndices.size()) - offset;
+		}
+	}
+}
+
+void PLightClusters::UploadBuffer(const PUi32& buffer, PUi64& capacity, const void* data, const PUi64& size)
+{
+	// Grow to at least double so a rising light count doesn't make a new buffer every frame
+	// Empty buffers still get storage so binding them is valid
+	if (size > capacity || capacity == 0)
+	{
+		capacity = std::max<PUi64>(std::max<PUi64>(size, capacity * 2), 256);
+		glNamedBufferData(buffer, static_cast<GLsizeiptr>(capacity), nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	if (size > 0)
+		glNamedBufferSubData(buffer, 0, static_cast<GLsizeiptr>(size), data);
+}
@@ -0,0 +1,192 @@
+#include "Graphics/PMaterialBuffer.h"
+#include "Debug/PDebug.h"
+#include "Graphics/PSMaterial.h"
+#include "Graphics/PTexture.h"
+#include "Graphics/PTextureArrays.h"
+#include "Graphics/PGLState.h"
+
+// External Libs
+#include <GLEW/glew.h>
+
+// System Libs
+#include <algorithm>
+
+// Shader storage binding the fragment shader reads the materials from
+const PUi32 materialBinding = 1;
+
+// Marks an empty dirty range
+const PUi32 noSlot = UINT32_MAX;
+
+PMaterialBuffer::PMaterialBuffer()
+{
+	m_Buffer = 0;
+	m_Capacity = 0;
+	m_DirtyFirst = noSlot;
+	m_DirtyLast = 0;
+	m_TextureArrays = nullptr;
+	m_Frame = 0;
+	m_DirtyCount = m_UpdateCount = 0;
+}
+
+PMaterialBuffer::~PMaterialBuffer()
+{
+	PGLState::GetState().DeleteBuffer(m_Buffer);
+}
+
+bool PMaterialBuffer::Init(const PUi32& capacity)
+{
+	glCreateBuffers(1, &m_Buffer);
+
+	if (m_Buffer == 0)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Material buffer failed to create a buffer: " + errorMsg, LT_ERROR);
+		return false;
+	}
+
+	// Mutable storage so the buffer can grow without changing its ID
+	m_Capacity = std::max(capacity, 1U);
+	m_Data.assign(m_Capacity, PSMaterialData());
+	glNamedBufferData(m_Buffer, static_cast<GLsizeiptr>(m_Capacity * sizeof(PSMaterialData)), m_Data.data(), GL_DYNAMIC_DRAW);
+
+	// Meshes without a material draw with the default one in slot 0
+	m_DefaultMaterial = TMakeShared<PSMaterial>();
+	UseMaterial(m_DefaultMaterial);
+
+	return true;
+}
+
+void PMaterialBuffer::BeginFrame()
+{
+	++m_Frame;
+
+	// Free the slots of destroyed materials, the default material is never destroyed
+	for (PUi32 i = 0; i < m_Slots.size(); ++i)
+	{
+		PSMaterialSlot& slot = m_Slots[i];
+
+		if (!slot.isUsed || !slot.material.expired())
+			continue;
+
+		slot = PSMaterialSlot();
+		m_FreeSlots.push_back(i);
+	}
+}
+
+PUi32 PMaterialBuffer::UseMaterial(const TShared<PSMaterial>& material)
+{
+	const TShared<PSMaterial>& used = material ? material : m_DefaultMaterial;
+	PSMaterial& usedMaterial = *used;
+
+	// A material new to the buffer, or a copy of one that has a slot, gets its own slot
+	if (usedMaterial.materialID >= m_Slots.size() || m_Slots[usedMaterial.materialID].material.lock() != used)
+	{
+		usedMaterial.materialID = AllocateSlot();
+		usedMaterial.isDirty = true;
+
+		PSMaterialSlot& slot = m_Slots[usedMaterial.materialID];
+		slot.material = used;
+		slot.isUsed = true;
+	}
+
+	const PUi32 materialID = usedMaterial.materialID;
+	PSMaterialSlot& slot = m_Slots[materialID];
+
+	if (slot.lastUsedFrame == m_Frame && !usedMaterial.isDirty)
+		return materialID;
+
+	slot.lastUsedFrame = m_Frame;
+
+	// The properties are only read when the material has been marked dirty
+	PSMaterialData data = m_Data[materialID];
+	const bool wasDirty = usedMaterial.isDirty;
+
+	if (wasDirty)
+	{
+		data.shininess = usedMaterial.shininess;
+		data.specularStrength = usedMaterial.specularStrength;
+		usedMaterial.isDirty = false;
+	}
+
+	// Maps can finish streaming or move in the texture arrays at any time so they are looked up every frame
+	std::array<PUi32, 4> textures = { 0, 0, 0, 0 };
+
+	const auto setMap = [this, &textures](const TShared<PTexture>& map, const PUi32& unit, int& outLayer, glm::vec4& outRect)
+		{
+			PSTextureArraySlot arraySlot;
+			outLayer = -1;
+			outRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+			// Maps in an array are sampled by layer, the rest are bound on their own
+			if (m_TextureArrays != nullptr && m_TextureArrays->GetSlot(map, arraySlot))
+			{
+				outLayer = static_cast<int>(arraySlot.layer);
+				outRect = arraySlot.rect;
+				textures[unit + 2] = m_TextureArrays->GetArrayID(arraySlot.pool);
+			}
+			else if (map)
+			{
+				textures[unit] = map->GetID();
+			}
+		};
+
+	setMap(usedMaterial.m_BaseColourMap, 0, data.baseColourLayer, data.baseColourRect);
+	setMap(usedMaterial.m_SpecularMap, 1, data.specularLayer, data.specularRect);
+	slot.textures = textures;
+
+	if (!wasDirty && data == m_Data[materialID])
+		return materialID;
+
+	m_Data[materialID] = data;
+	m_DirtyFirst = std::min(m_DirtyFirst, materialID);
+	m_DirtyLast = std::max(m_DirtyLast, materialID);
+	++m_DirtyCount;
+
+	return materialID;
+}
+
+void PMaterialBuffer::Upload()
+{
+	// Write every changed material with one call, unchanged materials between them are written too
+	// Open gl keeps frames that are still reading the old values correct
+	if (m_DirtyFirst != noSlot)
+	{
+		glNamedBufferSubData(m_Buffer, static_cast<GLintptr>(m_DirtyFirst * sizeof(PSMaterialData)),
+			static_cast<GLsizeiptr>((m_DirtyLast - m_DirtyFirst + 1) * sizeof(PSMaterialData)), &m_Data[m_DirtyFirst]);
+	}
+
+	m_DirtyFirst = noSlot;
+	m_DirtyLast = 0;
+	m_UpdateCount = m_DirtyCount;
+	m_DirtyCount = 0;
+
+	PGLState::GetState().BindBufferBase(GL_SHADER_STORAGE_BUFFER, materialBinding, m_Buffer);
+}
+
+void PMaterialBuffer::BindTextures(const PUi32& materialID) const
+{
+	// Units 0 - 3 match the samplers set when the shader was linked
+	PGLState::GetState().BindTextures(0, 4, m_Slots[materialID].textures.data());
+}
+
+PUi32 PMaterialBuffer::AllocateSlot()
+{
+	if (!m_FreeSlots.empty())
+	{
+		const PUi32 slot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+		return slot;
+	}
+
+	// Double the buffer, the CPU copy has every material so the whole buffer is written again
+	if (m_Slots.size() >= m_Capacity)
+	{
+		m_Capacity *= 2;
+		m_Data.resize(m_Capacity);
+		glNamedBufferData(m_Buffer, static_cast<GLsizeiptr>(m_Capacity * sizeof(PSMaterialData)), m_Data.data(), GL_DYNAMIC_DRAW);
+	}
+
+	m_Slots.emplace_back();
+
+	return static_cast<PUi32>(m_Slots.size() - 1);
+}
@@ -1,179 +1,436 @@
 #include "Graphics/PMesh.h"
 #include "Debug/PDebug.h"
 #include "Graphics/PShaderProgram.h"
+#include "Graphics/PGeometryBuffer.h"
+#include "Graphics/PMeshSimplifier.h"
+#include "Graphics/PMeshOptimiser.h"
+#include "Graphics/PUploadQueue.h"
+#include "Graphics/PGLState.h"
+#include "Graphics/PVertexLayouts.h"
+#include "Graphics/PSMaterial.h"
 
 // External Libs
 #include <GLEW/glew.h>
+#include <GLM/gtc/packing.hpp>
+
+// System Libs
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 
 PMesh::PMesh()
 {
-	m_VAO = m_VBO = m_EAO = 0;
+	m_VBO = m_EAO = 0;
 	m_MatTransform = glm::mat4(1.0f);
 	materialIndex = 0;
+	m_GeometryBuffer = nullptr;
+	m_IsUploaded = false;
+	m_IsOccluder = false;
+	m_VertexFormat = VF_FULL;
+	m_IndexSize = sizeof(PUi32);
 }
 
 PMesh::~PMesh()
 {
+	// The upload callbacks point at the mesh
+	PUploadQueue::GetQueue().Cancel(this);
+
+	// Give the blocks back so other meshes can use the space
+	if (m_GeometryBuffer != nullptr)
+		m_GeometryBuffer->RemoveMeshData(m_GeometryAllocation);
+
+	// Delete the mesh's own buffers if it had to make them
+	PGLState& glState = PGLState::GetState();
+	glState.DeleteBuffer(m_VBO);
+	glState.DeleteBuffer(m_EAO);
+}
 
+bool PMesh::CreateMesh(const std::vector<PSVertexData>& vertices, const std::vector<uint32_t>& indices, const PSMeshSettings& settings)
+{
+	return PrepareMesh(vertices, indices, settings) && UploadMesh();
 }
 
-bool PMesh::CreateMesh(const std::vector<PSVertexData>& vertices, const std::vector<uint32_t>& indices)
+bool PMesh::PrepareMesh(const std::vector<PSVertexData>& vertices, const std::vector<uint32_t>& indices, const PSMeshSettings& settings)
 {
 	// Store the vertex data
 	m_Vertices = vertices;
 	m_Indices = indices;
+	m_LODs.clear();
+
+	// Fit the bounds around the vertices
+	// Compact formats store positions relative to the bounds
+	m_Bounds = PSBounds();
+
+	for (const auto& vertex : m_Vertices)
+		m_Bounds.AddPoint({ vertex.m_Position[0], vertex.m_Position[1], vertex.m_Position[2] });
+
+	m_Bounds.UpdateSphere();
 
-	// Create a vertex array object (VAO)
-	// Assign the id for the object to the m_VAO variable
-	// Stores a reference to any VBO's attached to the VAO
-	glGenVertexArrays(1, &m_VAO);
+	// Only keep the colour in the compact format if the mesh isn't all white
+	m_VertexFormat = settings.vertexFormat;
 
-	if (m_VAO == 0)
+	if (m_VertexFormat == VF_COMPACT)
 	{
-		// Convert the error into a readable string
-		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
-		PDebug::Log("Mesh failed to create VAO: " + errorMsg, LT_WARN);
-		return false;
+		for (const auto& vertex : m_Vertices)
+		{
+			if (vertex.m_Colour[0] != 1.0f || vertex.m_Colour[1] != 1.0f || vertex.m_Colour[2] != 1.0f)
+			{
+				m_VertexFormat = VF_COMPACT_COLOUR;
+				break;
+			}
+		}
 	}
 
-	// This says use the VAO as the active working VAO for any VAO functions
-	glBindVertexArray(m_VAO);
+	const PSLODSettings& lodSettings = settings.lod;
 
-	// Create a buffer object
-	// The vertex buffer object holds the data for the vertices in the gpu
-	glGenBuffers(1, &m_VBO);
+	// The full detail mesh is always the first level
+	PSMeshLOD fullLOD;
+	fullLOD.indexCount = static_cast<PUi32>(indices.size());
+	fullLOD.screenSize = FLT_MAX;
+	m_LODs.push_back(fullLOD);
 
-	// Test if the VBO failed
-	if (m_VBO == 0)
+	// Each level is simplified from the level before, they all share the vertices
+	TArray<PUi32> lodIndices;
+	float lodScreenSize = lodSettings.screenSize;
+
+	for (PUi32 i = 1; i < lodSettings.levelCount; ++i)
 	{
-		// Convert the error into a readable string
-		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
-		PDebug::Log("Mesh failed to create VBO: " + errorMsg, LT_WARN);
-		return false;
+		const PSMeshLOD& previous = m_LODs.back();
+		const TArray<PUi32> previousIndices(m_Indices.begin() + previous.firstIndex,
+			m_Indices.begin() + previous.firstIndex + previous.indexCount);
+
+		const PUi32 targetCount = static_cast<PUi32>(previous.indexCount * lodSettings.triangleRatio);
+		PMeshSimplifier::Simplify(m_Vertices, previousIndices, targetCount, lodSettings.maxError, lodIndices);
+
+		// Stop when the error limit stops the mesh getting meaningfully smaller
+		if (lodIndices.empty() || lodIndices.size() > previous.indexCount * 0.9f)
+			break;
+
+		// Collapses leave the triangles out of cache order
+		if (settings.optimise)
+			PMeshOptimiser::OptimiseVertexCache(lodIndices, static_cast<PUi32>(m_Vertices.size()));
+
+		PSMeshLOD newLOD;
+		newLOD.firstIndex = static_cast<PUi32>(m_Indices.size());
+		newLOD.indexCount = static_cast<PUi32>(lodIndices.size());
+		newLOD.screenSize = lodScreenSize;
+		m_LODs.push_back(newLOD);
+
+		m_Indices.insert(m_Indices.end(), lodIndices.begin(), lodIndices.end());
+		lodScreenSize *= 0.5f;
 	}
 
-	// Bind the buffer object to say this is the active working VBO
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	// Convert the vertices into the layout of the vertex format
+	BuildVertexData(m_VertexFormat, m_UploadVertexData);
 
-	// Create an element array buffer
-	glGenBuffers(1, &m_EAO);
+	// Use 16 bit indices when every vertex can be reached with them
+	// This halves the size of the index buffer
+	m_IndexSize = m_Vertices.size() < 65536 ? sizeof(PUi16) : sizeof(PUi32);
+	m_UploadIndexData.resize(m_Indices.size() * m_IndexSize);
 
-	// Test if the EAO failed
-	if (m_EAO == 0)
+	if (m_IndexSize == sizeof(PUi16))
 	{
-		// Convert the error into a readable string
-		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
-		PDebug::Log("Mesh failed to create EAO: " + errorMsg, LT_WARN);
-		return false;
+		PUi16* shortIndices = reinterpret_cast<PUi16*>(m_UploadIndexData.data());
+
+		for (size_t i = 0; i < m_Indices.size(); ++i)
+			shortIndices[i] = static_cast<PUi16>(m_Indices[i]);
 	}
+	else
+	{
+		std::memcpy(m_UploadIndexData.data(), m_Indices.data(), m_UploadIndexData.size());
+	}
+
+	return true;
+}
 
-	// Bind the EAO as the active elemnt array buffer object
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EAO);
+bool PMesh::UploadMesh()
+{
+	// The upload queue owns the data until it has been copied to the GPU
+	const auto vertexData = TMakeShared<TArray<PUi8>>(std::move(m_UploadVertexData));
+	const auto indexData = TMakeShared<TArray<PUi8>>(std::move(m_UploadIndexData));
 
-	// Set the buffer data
-	// Start with the VBO which stores the vertex data
-	glBufferData(
-		GL_ARRAY_BUFFER, //  Type of data that we're storing
-		static_cast<GLsizeiptr>(m_Vertices.size() * sizeof(PSVertexData)), // Size of each data in bytes
-		m_Vertices.data(), // Memory location of the data
-		GL_STATIC_DRAW // This data will not be modified frequently
-	);
+	m_UploadVertexData.clear();
+	m_UploadIndexData.clear();
 
-	// Set the data for the EAO
-	glBufferData(
-		GL_ELEMENT_ARRAY_BUFFER,
-		static_cast<GLsizeiptr>(m_Indices.size()) * sizeof(uint32_t),
-		m_Indices.data(),
-		GL_STATIC_DRAW
-	);
+	return UploadData(vertexData, indexData);
+}
 
-	// Pass out the vertex data in separate formats
-	// POSITION
-	glEnableVertexAttribArray(0);
-
-	// Set the position of that data to the 0 index of the attribute array
-	glVertexAttribPointer(
-		0, // Location to store the data in the attribute array
-		3, // How many numbers to pass into the attribute array index
-		GL_FLOAT, // The type of data to store (only one per index)
-		GL_FALSE, // Should we normalise the values, generally no
-		sizeof(PSVertexData), // How big is each data array in a VertexData
-		nullptr // How many numbers to skip
-	);
+bool PMesh::CreateMesh(const PSCookedMeshData& data)
+{
+	// Keep a copy on the CPU for occlusion and the geometry buffer
+	m_Vertices.assign(data.vertices, data.vertices + data.vertexCount);
+	m_Indices.assign(data.indices, data.indices + data.indexCount);
+	m_LODs.assign(data.lods, data.lods + data.lodCount);
+
+	m_Bounds = data.bounds;
+	m_Bounds.UpdateSphere();
+	m_VertexFormat = data.vertexFormat;
+	m_IndexSize = data.indexSize;
+	m_MatTransform = data.relativeTransform;
+	materialIndex = data.materialIndex;
+
+	const PUi64 vertexBytes = static_cast<PUi64>(data.vertexCount) * GetVertexStride(m_VertexFormat);
+	const PUi64 indexBytes = static_cast<PUi64>(data.indexCount) * m_IndexSize;
+
+	// The cooked file is closed before the upload queue gets to the data so copy the streams out
+	const PUi8* vertexStream = static_cast<const PUi8*>(data.vertexData);
+	const PUi8* indexStream = static_cast<const PUi8*>(data.indexData);
+
+	return UploadData(TMakeShared<TArray<PUi8>>(vertexStream, vertexStream + vertexBytes),
+		TMakeShared<TArray<PUi8>>(indexStream, indexStream + indexBytes));
+}
 
-	// Pass out the vertex data in separate formats
-	// COLOUR
-	glEnableVertexAttribArray(1);
-
-	// Set the colour of that data to the 1 index of the attribute array
-	glVertexAttribPointer(
-		1, // Location to store the data in the attribute array
-		3, // How many numbers to pass into the attribute array index
-		GL_FLOAT, // The type of data to store (only one per index)
-		GL_FALSE, // Should we normalise the values, generally no
-		sizeof(PSVertexData), // How big is each data array in a VertexData
-		(void*)(sizeof(float) * 3) // How many numbers to skip in bytes (skipping the 3 position values)
-	);
+bool PMesh::UploadData(const TShared<TArray<PUi8>>& vertexData, const TShared<TArray<PUi8>>& indexData)
+{
+	m_IsUploaded = false;
 
-	// Pass out the vertex data in separate formats
-	// TEXTURE COORDINATES
-	glEnableVertexAttribArray(2);
-
-	// Set the texture coordinates of that data to the 2 index of the attribute array
-	glVertexAttribPointer(
-		2, // Location to store the data in the attribute array
-		2, // How many numbers to pass into the attribute array index
-		GL_FLOAT, // The type of data to store (only one per index)
-		GL_FALSE, // Should we normalise the values, generally no
-		sizeof(PSVertexData), // How big is each data array in a VertexData
-		(void*)(sizeof(float) * 6) // How many numbers to skip in bytes (skipping the position and colour values)
-	);
+	// Meshes share the arena for their format and index size so they don't each make small buffers of their own
+	PGeometryBuffer* meshArena = PGeometryBuffer::GetMeshArena(m_VertexFormat, m_IndexSize);
+
+	if (meshArena != nullptr && RegisterGeometry(*meshArena, vertexData, indexData))
+		return true;
 
-	// Pass out the vertex data in separate formats
-	// NORMALS
-	glEnableVertexAttribArray(3);
-
-	// Set the texture coordinates of that data to the 3 index of the attribute array
-	glVertexAttribPointer(
-		3, // Location to store the data in the attribute array
-		3, // How many numbers to pass into the attribute array index
-		GL_FLOAT, // The type of data to store (only one per index)
-		GL_FALSE, // Should we normalise the values, generally no
-		sizeof(PSVertexData), // How big is each data array in a VertexData
-		(void*)(sizeof(float) * 8) // How many numbers to skip in bytes (skipping the position and colour values)
+	return CreateBuffers(vertexData, indexData);
+}
+
+bool PMesh::CreateBuffers(const TShared<TArray<PUi8>>& vertexData, const TShared<TArray<PUi8>>& indexData)
+{
+	m_IsUploaded = false;
+
+	// Create the buffer objects without binding them
+	// The vertex buffer object holds the data for the vertices in the gpu
+	// The element array object holds the indices
+	glCreateBuffers(1, &m_VBO);
+	glCreateBuffers(1, &m_EAO);
+
+	// Test if the buffers failed
+	if (m_VBO == 0 || m_EAO == 0)
+	{
+		// Convert the error into a readable string
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Mesh failed to create buffers: " + errorMsg, LT_WARN);
+		return false;
+	}
+
+	// Allocate immutable storage with no data
+	// Dynamic storage lets the upload queue write straight into the buffers if it has no staging buffer
+	glNamedBufferStorage(
+		m_VBO, // Buffer to allocate
+		static_cast<GLsizeiptr>(vertexData->size()), // Size of the data in bytes
+		nullptr, // The data is copied in by the upload queue
+		GL_DYNAMIC_STORAGE_BIT // Allow glNamedBufferSubData
 	);
 
-	// Common practice to clear the VAO from the GPU
-	glBindVertexArray(0); // Set to 0 because there is no such thing as a 0 id
+	glNamedBufferStorage(m_EAO, static_cast<GLsizeiptr>(indexData->size()), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	// The layout isn't set up here, the mesh draws through the VAO shared by every mesh with its vertex format
+	// Spread the data over the next frames, uploads finish in order so the indices are last
+	PUploadQueue& uploadQueue = PUploadQueue::GetQueue();
+	uploadQueue.UploadBuffer(this, m_VBO, 0, vertexData->data(), vertexData->size(), vertexData);
+	uploadQueue.UploadBuffer(this, m_EAO, 0, indexData->data(), indexData->size(), indexData,
+		[this]() { m_IsUploaded = true; });
 
 	return true;
 }
 
-void PMesh::Render(const std::shared_ptr<PShaderProgram>& shader, const PSTransform& transform, const TArray<TShared<PSLight>>& lights, const TShared<PSMaterial>& material)
+void PMesh::Render(const std::shared_ptr<PShaderProgram>& shader, const glm::mat4& modelMatrix, const TShared<PSMaterial>& material, const PUi32& lod)
 {
-	// Update the material in the shader
-	shader->SetMaterial(material);
+	// The buffers are still being filled by the upload queue
+	if (!m_IsUploaded)
+		return;
+
+	const PUi32 usedLOD = std::min(lod, GetLODCount() - 1);
+	const PSMeshLOD& meshLOD = m_LODs[usedLOD];
 
 	// Update the transform of the mesh based on the model transform
-	shader->SetModelTransform(transform);
+	shader->SetModelTransform(modelMatrix);
 
 	// Set the relative transform for the mesh in the shader
 	shader->SetMeshTransform(m_MatTransform);
 
-	// Set the lights in the shader for the mesh
-	shader->SetLights(lights);
+	// Set how the shader turns the stored positions back into mesh space
+	glm::vec3 positionOffset, positionScale;
+	GetPositionDecode(m_VertexFormat, positionOffset, positionScale);
+	shader->SetPositionDecode(positionOffset, positionScale);
 
-	// Binding this mesh as the active VAO
-	glBindVertexArray(m_VAO);
+	// The shader reads the material from the material buffer using the base instance
+	// Materials the buffer hasn't seen use the default material in slot 0
+	const PUi32 materialID = material && material->materialID != UINT32_MAX ? material->materialID : 0;
+
+	if (m_GeometryBuffer != nullptr)
+	{
+		// Every mesh in the arena shares the VAO and buffers so the state cache skips the bind after the first draw
+		if (!m_GeometryBuffer->BindBuffers())
+			return;
+
+		// Read the range every draw, compacting the arena moves it
+		const PSGeometryRange range = GetGeometryRange(usedLOD);
+
+		glDrawElementsInstancedBaseVertexBaseInstance(
+			GL_TRIANGLES, // Draw the mesh as triangles
+			static_cast<GLsizei>(range.indexCount), // How many vertices are there
+			m_GeometryBuffer->GetIndexType(), // The arena's indices are the same size as the mesh's
+			(void*)(static_cast<PUi64>(range.firstIndex) * m_GeometryBuffer->GetIndexSize()), // Byte offset of the level in the arena
+			1, // Draw the mesh once
+			static_cast<GLint>(range.baseVertex), // Indices are relative to the mesh's first vertex
+			materialID // Passed to the shader as gl_BaseInstance
+		);
+
+		return;
+	}
+
+	// Bind the VAO for the mesh's vertex format with the mesh's own buffers attached
+	// It is left bound, the state cache skips the bind if the next draw uses the same mesh
+	if (!PVertexLayouts::GetLayouts().Bind(m_VertexFormat, m_VBO, m_EAO))
+		return;
 
 	// Render the VAO
-	glDrawElements(
+	glDrawElementsInstancedBaseInstance(
 		GL_TRIANGLES, // Draw the mesh as triangles
-		static_cast<GLsizei>(m_Indices.size()), // How many vertices are there
-		GL_UNSIGNED_INT, // What type of data is the index array
-		nullptr // How many are you gonna skip
+		static_cast<GLsizei>(meshLOD.indexCount), // How many vertices are there
+		m_IndexSize == sizeof(PUi16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, // What type of data is the index array
+		(void*)(static_cast<PUi64>(meshLOD.firstIndex) * m_IndexSize), // How many bytes are you gonna skip
+		1, // Draw the mesh once
+		materialID // Passed to the shader as gl_BaseInstance
 	);
-	
-	// Clear the VAO
-	glBindVertexArray(0);
+}
+
+bool PMesh::RegisterGeometry(PGeometryBuffer& geometryBuffer, const TShared<TArray<PUi8>>& vertexData, const TShared<TArray<PUi8>>& indexData)
+{
+	// Queue the vertex and index data to be copied into the shared buffers
+	// The arena matches the mesh's format and index size so the data is copied as it is
+	// The mesh is only drawn once the copy has finished
+	if (!geometryBuffer.AddMeshData(this, vertexData, static_cast<PUi32>(m_Vertices.size()), indexData, static_cast<PUi32>(m_Indices.size()),
+		m_GeometryAllocation, [this]() { m_IsUploaded = true; }))
+	{
+		PDebug::Log("Mesh failed to add data to the geometry buffer, using its own buffers", LT_WARN);
+		return false;
+	}
+
+	m_GeometryBuffer = &geometryBuffer;
+
+	return true;
+}
+
+PUi32 PMesh::SelectLOD(const float& screenSize, const PUi32& currentLOD, const float& hysteresis) const
+{
+	PUi32 lod = std::min(currentLOD, GetLODCount() - 1);
+
+	// Move to a lower detail level once the mesh is clearly smaller than its switch size
+	while (lod + 1 < GetLODCount() && screenSize < m_LODs[lod + 1].screenSize * (1.0f - hysteresis))
+		++lod;
+
+	// Move back to a higher detail level once the mesh is clearly bigger than the switch size
+	while (lod > 0 && screenSize > m_LODs[lod].screenSize * (1.0f + hysteresis))
+		--lod;
+
+	return lod;
+}
+
+PUi64 PMesh::GetIndexBufferSize() const
+{
+	// Report what the arena holds for the mesh
+	if (m_GeometryBuffer != nullptr)
+		return static_cast<PUi64>(m_GeometryAllocation.indices.size) * m_GeometryBuffer->GetIndexSize();
+
+	return static_cast<PUi64>(m_Indices.size()) * m_IndexSize;
+}
+
+PUi64 PMesh::GetVertexBufferSize() const
+{
+	if (m_GeometryBuffer != nullptr)
+		return static_cast<PUi64>(m_GeometryAllocation.vertices.size) * m_GeometryBuffer->GetVertexStride();
+
+	return static_cast<PUi64>(m_Vertices.size()) * GetVertexStride(m_VertexFormat);
+}
+
+PSGeometryRange PMesh::GetGeometryRange(const PUi32& lod) const
+{
+	// Read the offsets every time, compacting the geometry buffer moves them
+	PSGeometryRange range = m_GeometryBuffer->GetRange(m_GeometryAllocation);
+	range.firstIndex += m_LODs[lod].firstIndex;
+	range.indexCount = m_LODs[lod].indexCount;
+
+	return range;
+}
+
+void PMesh::BuildVertexData(const PEVertexFormat& format, TArray<PUi8>& outData) const
+{
+	const PUi32 stride = GetVertexStride(format);
+	outData.resize(static_cast<size_t>(m_Vertices.size()) * stride);
+
+	if (format == VF_FULL)
+	{
+		std::memcpy(outData.data(), m_Vertices.data(), outData.size());
+		return;
+	}
+
+	// Positions are stored as a fraction of the way across the bounds
+	// Flat meshes have no size on an axis so avoid dividing by 0
+	const glm::vec3 boundsSize = m_Bounds.max - m_Bounds.min;
+	const glm::vec3 invSize = glm::vec3(
+		boundsSize.x > 0.0f ? 1.0f / boundsSize.x : 0.0f,
+		boundsSize.y > 0.0f ? 1.0f / boundsSize.y : 0.0f,
+		boundsSize.z > 0.0f ? 1.0f / boundsSize.z : 0.0f
+	);
+
+	for (size_t i = 0; i < m_Vertices.size(); ++i)
+	{
+		const PSVertexData& vertex = m_Vertices[i];
+		PSCompactVertexData compact;
+
+		for (int j = 0; j < 3; ++j)
+		{
+			const float fraction = glm::clamp((vertex.m_Position[j] - m_Bounds.min[j]) * invSize[j], 0.0f, 1.0f);
+			compact.m_Position[j] = static_cast<PUi16>(fraction * 65535.0f + 0.5f);
+		}
+
+		// Each normal axis is stored as a signed 10 bit value, the last 2 bits are unused
+		PUi32 packedNormal = 0;
+
+		for (int j = 0; j < 3; ++j)
+		{
+			const int axis = static_cast<int>(glm::round(glm::clamp(vertex.m_Normal[j], -1.0f, 1.0f) * 511.0f));
+			packedNormal |= (static_cast<PUi32>(axis) & 0x3FF) << (j * 10);
+		}
+
+		compact.m_Normal = packedNormal;
+
+		compact.m_TexCoords[0] = glm::packHalf1x16(vertex.m_TexCoords[0]);
+		compact.m_TexCoords[1] = glm::packHalf1x16(vertex.m_TexCoords[1]);
+
+		for (int j = 0; j < 3; ++j)
+			compact.m_Colour[j] = static_cast<PUi8>(glm::clamp(vertex.m_Colour[j], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+		// VF_COMPACT stops before the colour
+		std::memcpy(outData.data() + i * stride, &compact, stride);
+	}
+}
+
+void PMesh::GetPositionDecode(const PEVertexFormat& format, glm::vec3& outOffset, glm::vec3& outScale) const
+{
+	// Full floats are already in mesh space
+	if (format == VF_FULL)
+	{
+		outOffset = glm::vec3(0.0f);
+		outScale = glm::vec3(1.0f);
+		return;
+	}
+
+	// The GPU normalises the stored 16 bit positions to 0 - 1 across the bounds
+	outOffset = m_Bounds.min;
+	outScale = m_Bounds.max - m_Bounds.min;
+}
+
+PUi32 PMesh::GetVertexStride(const PEVertexFormat& format)
+{
+	switch (format)
+	{
+	case VF_COMPACT:
+		return static_cast<PUi32>(offsetof(PSCompactVertexData, m_Colour));
+	case VF_COMPACT_COLOUR:
+		return static_cast<PUi32>(sizeof(PSCompactVertexData));
+	default:
+		return static_cast<PUi32>(sizeof(PSVertexData));
+	}
 }
@@ -0,0 +1,307 @@
+#include "Graphics/PMeshCache.h"
+#include "Debug/PDebug.h"
+#include "IO/PMappedFile.h"
+#include "Math/PSHash.h"
+
+// System Libs
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Folder the cooked files are written to
+const char* const cookedFolder = "Cache/Meshes/";
+
+// "PMSH" read as little endian
+const PUi32 cookedMagic = 0x48534D50;
+
+// Change this whenever the cooked layout or the import changes
+// Old files then stop matching and are cooked again
+const PUi32 cookedVersion = 1;
+
+// Streams start on this boundary so they can be read directly from the mapped file
+const PUi64 cookedAlignment = 16;
+
+// Start of every cooked file
+struct PSCookedFileHeader
+{
+	PUi32 magic;
+	PUi32 version;
+
+	// Key made from the source file and import settings
+	PUi64 key;
+
+	// Size of the whole file, catches files that were only partly written
+	PUi64 fileSize;
+
+	PUi32 meshCount;
+	PUi32 materialCount;
+};
+
+// Description of each mesh, these follow the header
+// Offsets are in bytes from the start of the file
+struct PSCookedMeshEntry
+{
+	glm::mat4 relativeTransform;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	PUi32 materialIndex;
+	PUi32 vertexFormat;
+	PUi32 indexSize;
+	PUi32 vertexCount;
+	PUi32 indexCount;
+	PUi32 lodCount;
+
+	PUi64 lodOffset;
+	PUi64 vertexOffset;
+	PUi64 indexOffset;
+	PUi64 gpuVertexOffset;
+	PUi64 gpuIndexOffset;
+};
+
+// Round an offset up to the stream alignment
+static PUi64 AlignOffset(const PUi64& offset)
+{
+	return (offset + cookedAlignment - 1) / cookedAlignment * cookedAlignment;
+}
+
+// Test if a block of data is fully inside the file and aligned for reading
+static bool IsBlockValid(const PUi64& offset, const PUi64& size, const PUi64& fileSize)
+{
+	return offset % cookedAlignment == 0 && offset <= fileSize && size <= fileSize - offset;
+}
+
+// Add a block of data to the end of the file and return its offset
+static PUi64 AppendBlock(TArray<PUi8>& file, const void* data, const PUi64& size)
+{
+	// Pad up to the alignment first
+	const PUi64 offset = AlignOffset(file.size());
+	file.resize(static_cast<size_t>(offset + size), 0);
+
+	if (size > 0)
+		std::memcpy(file.data() + offset, data, static_cast<size_t>(size));
+
+	return offset;
+}
+
+PString PMeshCache::GetCookedPath(const PString& sourcePath)
+{
+	// Name the file after the path so models with the same file name don't overwrite each other
+	const PString normalPath = std::filesystem::path(sourcePath).lexically_normal().generic_string();
+	const PUi64 pathHash = PSHash::FNV1a(normalPath.data(), normalPath.size());
+
+	char hashText[17];
+	snprintf(hashText, sizeof(hashText), "%016llx", static_cast<unsigned long long>(pathHash));
+
+	return cookedFolder + std::filesystem::path(sourcePath).filename().string() + "_" + hashText + ".pmesh";
+}
+
+PUi64 PMeshCache::MakeKey(const PString& sourcePath, const PSMeshSettings& settings)
+{
+	PMappedFile source;
+
+	if (!source.Open(sourcePath))
+		return 0;
+
+	PUi64 key = PSHash::FNV1a(&cookedVersion, sizeof(cookedVersion));
+	key = PSHash::FNV1a(source.GetData(), static_cast<size_t>(source.GetSize()), key);
+
+	key = settings.GetHash(key);
+
+	// 0 is used to say there is no key
+	return key != 0 ? key : 1;
+}
+
+bool PMeshCache::Read(const PString& cookedPath, const PUi64& key, PSCookedModel& outModel)
+{
+	PMappedFile& file = outModel.file;
+	outModel.meshes.clear();
+
+	// Not cooked yet
+	if (!file.Open(cookedPath))
+		return false;
+
+	const PUi8* data = file.GetData();
+	const PUi64 fileSize = file.GetSize();
+
+	if (fileSize < sizeof(PSCookedFileHeader))
+	{
+		PDebug::Log("Cooked mesh file is too small: " + cookedPath, LT_WARN);
+		return false;
+	}
+
+	PSCookedFileHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != cookedMagic || header.version != cookedVersion || header.fileSize != fileSize)
+	{
+		PDebug::Log("Cooked mesh file is not valid and will be cooked again: " + cookedPath, LT_WARN);
+		return false;
+	}
+
+	// The source or settings have changed since it was cooked
+	if (header.key != key)
+		return false;
+
+	// The mesh table comes straight after the header
+	const PUi64 entriesOffset = AlignOffset(sizeof(PSCookedFileHeader));
+
+	if (!IsBlockValid(entriesOffset, static_cast<PUi64>(header.meshCount) * sizeof(PSCookedMeshEntry), fileSize))
+	{
+		PDebug::Log("Cooked mesh file has a broken mesh table: " + cookedPath, LT_WARN);
+		return false;
+	}
+
+	outModel.meshes.reserve(header.meshCount);
+
+	for (PUi32 i = 0; i < header.meshCount; ++i)
+	{
+		PSCookedMeshEntry entry;
+		std::memcpy(&entry, data + entriesOffset + static_cast<PUi64>(i) * sizeof(PSCookedMeshEntry), sizeof(entry));
+
+		const PEVertexFormat format = static_cast<PEVertexFormat>(entry.vertexFormat);
+		const PUi64 vertexCount = entry.vertexCount;
+		const PUi64 indexCount = entry.indexCount;
+
+		// Make sure every stream is inside the file before anything reads it
+		const bool isValid = entry.vertexFormat <= VF_COMPACT_COLOUR
+			&& (entry.indexSize == sizeof(PUi16) || entry.indexSize == sizeof(PUi32))
+			&& entry.lodCount > 0
+			&& IsBlockValid(entry.lodOffset, entry.lodCount * sizeof(PSMeshLOD), fileSize)
+			&& IsBlockValid(entry.vertexOffset, vertexCount * sizeof(PSVertexData), fileSize)
+			&& IsBlockValid(entry.indexOffset, indexCount * sizeof(PUi32), fileSize)
+			&& IsBlockValid(entry.gpuVertexOffset, vertexCount * PMesh::GetVertexStride(format), fileSize)
+			&& IsBlockValid(entry.gpuIndexOffset, indexCount * entry.indexSize, fileSize);
+
+		if (!isValid)
+		{
+			PDebug::Log("Cooked mesh file has a broken mesh: " + cookedPath, LT_WARN);
+			return false;
+		}
+
+		PSCookedMeshData meshData;
+		meshData.vertexFormat = format;
+		meshData.indexSize = entry.indexSize;
+		meshData.vertexCount = entry.vertexCount;
+		meshData.indexCount = entry.indexCount;
+		meshData.vertices = reinterpret_cast<const PSVertexData*>(data + entry.vertexOffset);
+		meshData.indices = reinterpret_cast<const PUi32*>(data + entry.indexOffset);
+		meshData.vertexData = data + entry.gpuVertexOffset;
+		meshData.indexData = data + entry.gpuIndexOffset;
+		meshData.lods = reinterpret_cast<const PSMeshLOD*>(data + entry.lodOffset);
+		meshData.lodCount = entry.lodCount;
+		meshData.bounds.min = entry.boundsMin;
+		meshData.bounds.max = entry.boundsMax;
+		meshData.relativeTransform = entry.relativeTransform;
+		meshData.materialIndex = entry.materialIndex;
+
+		// Levels of detail must stay inside the indices
+		for (PUi32 j = 0; j < entry.lodCount; ++j)
+		{
+			const PSMeshLOD& lod = meshData.lods[j];
+
+			if (static_cast<PUi64>(lod.firstIndex) + lod.indexCount > indexCount)
+			{
+				PDebug::Log("Cooked mesh file has a broken level of detail: " + cookedPath, LT_WARN);
+				return false;
+			}
+		}
+
+		outModel.meshes.push_back(meshData);
+	}
+
+	outModel.materialCount = header.materialCount;
+
+	return true;
+}
+
+bool PMeshCache::Save(const PString& cookedPath, const PUi64& key, const TArray<TUnique<PMesh>>& meshes, const PUi32& materialCount)
+{
+	PSCookedFileHeader header;
+	header.magic = cookedMagic;
+	header.version = cookedVersion;
+	header.key = key;
+	header.fileSize = 0;
+	header.meshCount = static_cast<PUi32>(meshes.size());
+	header.materialCount = materialCount;
+
+	// Leave room for the header and mesh table, they are filled in once the offsets are known
+	TArray<PUi8> file;
+	AppendBlock(file, &header, sizeof(header));
+
+	TArray<PSCookedMeshEntry> entries(meshes.size());
+	const PUi64 entriesOffset = AppendBlock(file, entries.data(), entries.size() * sizeof(PSCookedMeshEntry));
+
+	TArray<PUi8> gpuVertices;
+	TArray<PUi16> shortIndices;
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const PMesh& mesh = *meshes[i];
+		PSCookedMeshEntry& entry = entries[i];
+
+		const auto& vertices = mesh.GetVertices();
+		const auto& indices = mesh.GetIndices();
+
+		entry.relativeTransform = mesh.GetRelativeTransform();
+		entry.boundsMin = mesh.GetBounds().min;
+		entry.boundsMax = mesh.GetBounds().max;
+		entry.materialIndex = mesh.materialIndex;
+		entry.vertexFormat = mesh.GetVertexFormat();
+		entry.indexSize = mesh.GetIndexSize();
+		entry.vertexCount = static_cast<PUi32>(vertices.size());
+		entry.indexCount = static_cast<PUi32>(indices.size());
+		entry.lodCount = mesh.GetLODCount();
+
+		TArray<PSMeshLOD> lods(entry.lodCount);
+
+		for (PUi32 j = 0; j < entry.lodCount; ++j)
+			lods[j] = mesh.GetLOD(j);
+
+		entry.lodOffset = AppendBlock(file, lods.data(), lods.size() * sizeof(PSMeshLOD));
+		entry.vertexOffset = AppendBlock(file, vertices.data(), vertices.size() * sizeof(PSVertexData));
+		entry.indexOffset = AppendBlock(file, indices.data(), indices.size() * sizeof(PUi32));
+
+		// Store the streams exactly as the mesh uploaded them
+		mesh.BuildVertexData(mesh.GetVertexFormat(), gpuVertices);
+		entry.gpuVertexOffset = AppendBlock(file, gpuVertices.data(), gpuVertices.size());
+
+		if (entry.indexSize == sizeof(PUi16))
+		{
+			shortIndices.assign(indices.begin(), indices.end());
+			entry.gpuIndexOffset = AppendBlock(file, shortIndices.data(), shortIndices.size() * sizeof(PUi16));
+		}
+		else
+		{
+			entry.gpuIndexOffset = AppendBlock(file, indices.data(), indices.size() * sizeof(PUi32));
+		}
+	}
+
+	header.fileSize = file.size();
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::memcpy(file.data() + entriesOffset, entries.data(), entries.size() * sizeof(PSCookedMeshEntry));
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(cookedPath).parent_path(), error);
+
+	std::ofstream stream(cookedPath, std::ios::binary | std::ios::trunc);
+
+	if (!stream.is_open())
+	{
+		PDebug::Log("Failed to open cooked mesh file for writing: " + cookedPath, LT_WARN);
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+
+	if (!stream.good())
+	{
+		PDebug::Log("Failed to write cooked mesh file: " + cookedPath, LT_WARN);
+		return false;
+	}
+
+	PDebug::Log("Cooked mesh file written (" + std::to_string(file.size() / 1024) + " KB): " + cookedPath);
+
+	return true;
+}
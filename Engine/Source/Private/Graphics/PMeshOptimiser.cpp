@@ -0,0 +1,379 @@
+#include "Graphics/PMeshOptimiser.h"
+#include "Math/PSHash.h"
+
+// External Libs
+#include <GLM/glm.hpp>
+
+// System Libs
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+// Size of the cache the vertex cache optimisation scores against
+const int forsythCacheSize = 32;
+
+// Score of a vertex based on its place in the cache and how many triangles still use it
+static float ForsythVertexScore(const int& cachePosition, const PUi32& remainingTriangles)
+{
+	// Nothing left to draw with this vertex
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+
+	if (cachePosition >= 0)
+	{
+		// The last triangle's vertices score the same so there is no preference for its winding
+		if (cachePosition < 3)
+		{
+			score = 0.75f;
+		}
+		else
+		{
+			const float scale = 1.0f / static_cast<float>(forsythCacheSize - 3);
+			score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scale, 1.5f);
+		}
+	}
+
+	// Finish off vertices with few triangles left so they can leave the cache
+	score += 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+
+	return score;
+}
+
+PUi32 PMeshOptimiser::WeldVertices(TArray<PSVertexData>& vertices, TArray<PUi32>& indices)
+{
+	const PUi32 oldCount = static_cast<PUi32>(vertices.size());
+
+	TArray<PSVertexData> welded;
+	TArray<PUi32> remap(oldCount);
+	welded.reserve(vertices.size());
+
+	// Every attribute must match for vertices to be merged
+	std::unordered_map<PSVertexData, PUi32, PSBytesHash<PSVertexData>, PSBytesEqual<PSVertexData>> vertexMap;
+	vertexMap.reserve(vertices.size());
+
+	for (PUi32 i = 0; i < oldCount; ++i)
+	{
+		const auto result = vertexMap.emplace(vertices[i], static_cast<PUi32>(welded.size()));
+
+		if (result.second)
+			welded.push_back(vertices[i]);
+
+		remap[i] = result.first->second;
+	}
+
+	for (auto& index : indices)
+		index = remap[index];
+
+	vertices.swap(welded);
+
+	return oldCount - static_cast<PUi32>(vertices.size());
+}
+
+void PMeshOptimiser::OptimiseVertexCache(TArray<PUi32>& indices, const PUi32& vertexCount)
+{
+	const PUi32 triangleCount = static_cast<PUi32>(indices.size() / 3);
+
+	if (triangleCount == 0)
+		return;
+
+	// Find the triangles that use each vertex
+	TArray<PUi32> remaining(vertexCount, 0);
+
+	for (const auto& index : indices)
+		++remaining[index];
+
+	TArray<PUi32> triangleStart(vertexCount + 1, 0);
+
+	for (PUi32 v = 0; v < vertexCount; ++v)
+		triangleStart[v + 1] = triangleStart[v] + remaining[v];
+
+	TArray<PUi32> vertexTriangles(indices.size());
+	TArray<PUi32> fillCount(vertexCount, 0);
+
+	for (PUi32 t = 0; t < triangleCount; ++t)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			const PUi32 v = indices[t * 3 + i];
+			vertexTriangles[triangleStart[v] + fillCount[v]++] = t;
+		}
+	}
+
+	// Score every vertex and triangle before anything is in the cache
+	TArray<int> cachePosition(vertexCount, -1);
+	TArray<float> vertexScore(vertexCount);
+
+	for (PUi32 v = 0; v < vertexCount; ++v)
+		vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+
+	TArray<float> triangleScore(triangleCount);
+	TArray<bool> triangleAdded(triangleCount, false);
+
+	for (PUi32 t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	// Start with the best triangle overall
+	int bestTriangle = static_cast<int>(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+
+	TArray<PUi32> cache;
+	TArray<PUi32> newCache;
+	TArray<PUi32> output;
+	output.reserve(indices.size());
+
+	// Next triangle to check when nothing in the cache has triangles left
+	PUi32 searchStart = 0;
+
+	for (PUi32 added = 0; added < triangleCount; ++added)
+	{
+		// Nothing in the cache is useful so find the next triangle that hasn't been added
+		if (bestTriangle < 0)
+		{
+			while (triangleAdded[searchStart])
+				++searchStart;
+
+			bestTriangle = static_cast<int>(searchStart);
+		}
+
+		const PUi32* triangle = &indices[static_cast<PUi32>(bestTriangle) * 3];
+		triangleAdded[bestTriangle] = true;
+
+		output.push_back(triangle[0]);
+		output.push_back(triangle[1]);
+		output.push_back(triangle[2]);
+
+		// Remove the triangle from the list of each of its vertices
+		for (int i = 0; i < 3; ++i)
+		{
+			const PUi32 v = triangle[i];
+			PUi32* begin = &vertexTriangles[triangleStart[v]];
+			PUi32* end = begin + remaining[v];
+
+			std::iter_swap(std::find(begin, end, static_cast<PUi32>(bestTriangle)), end - 1);
+			--remaining[v];
+		}
+
+		// Move the triangle's vertices to the front of the cache
+		newCache.assign(triangle, triangle + 3);
+
+		for (const auto& v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache.push_back(v);
+		}
+
+		// Vertices pushed out of the cache lose their cache score
+		for (size_t i = forsythCacheSize; i < newCache.size(); ++i)
+			cachePosition[newCache[i]] = -1;
+
+		if (newCache.size() > forsythCacheSize)
+			newCache.resize(forsythCacheSize);
+
+		for (size_t i = 0; i < newCache.size(); ++i)
+			cachePosition[newCache[i]] = static_cast<int>(i);
+
+		// Rescore the vertices that moved and the triangles around them
+		// Evicted vertices are rescored too so their triangles drop back down
+		TArray<PUi32> changed = newCache;
+
+		for (const auto& v : cache)
+		{
+			if (cachePosition[v] < 0)
+				changed.push_back(v);
+		}
+
+		for (const auto& v : changed)
+			vertexScore[v] = ForsythVertexScore(cachePosition[v], remaining[v]);
+
+		float bestScore = -FLT_MAX;
+		bestTriangle = -1;
+
+		for (const auto& v : changed)
+		{
+			for (PUi32 i = 0; i < remaining[v]; ++i)
+			{
+				const PUi32 t = vertexTriangles[triangleStart[v] + i];
+				const float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				triangleScore[t] = score;
+
+				// Only triangles touching the cache are candidates
+				if (cachePosition[v] >= 0 && score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = static_cast<int>(t);
+				}
+			}
+		}
+
+		cache.swap(newCache);
+	}
+
+	indices.swap(output);
+}
+
+void PMeshOptimiser::OptimiseOverdraw(const TArray<PSVertexData>& vertices, TArray<PUi32>& indices)
+{
+	const PUi32 triangleCount = static_cast<PUi32>(indices.size() / 3);
+
+	if (triangleCount == 0)
+		return;
+
+	// Split the triangles where every vertex misses a FIFO cache
+	// That is where the cache has effectively restarted so reordering there costs nothing
+	const PUi32 cacheSize = 16;
+	TArray<PUi32> cacheTime(vertices.size(), 0);
+	PUi32 time = cacheSize + 1;
+
+	TArray<PUi32> clusterStarts;
+
+	for (PUi32 t = 0; t < triangleCount; ++t)
+	{
+		PUi32 misses = 0;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const PUi32 v = indices[t * 3 + i];
+
+			if (time - cacheTime[v] > cacheSize)
+			{
+				cacheTime[v] = time++;
+				++misses;
+			}
+		}
+
+		if (t == 0 || misses == 3)
+			clusterStarts.push_back(t);
+	}
+
+	clusterStarts.push_back(triangleCount);
+
+	const PUi32 clusterCount = static_cast<PUi32>(clusterStarts.size() - 1);
+
+	if (clusterCount < 2)
+		return;
+
+	// Find the center of the whole mesh weighted by area
+	auto getPosition = [&vertices](const PUi32& index)
+		{
+			const float* position = vertices[index].m_Position;
+			return glm::vec3(position[0], position[1], position[2]);
+		};
+
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+
+	TArray<glm::vec3> clusterCenters(clusterCount, glm::vec3(0.0f));
+	TArray<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	TArray<float> clusterAreas(clusterCount, 0.0f);
+
+	for (PUi32 c = 0; c < clusterCount; ++c)
+	{
+		for (PUi32 t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+		{
+			const glm::vec3 p0 = getPosition(indices[t * 3]);
+			const glm::vec3 p1 = getPosition(indices[t * 3 + 1]);
+			const glm::vec3 p2 = getPosition(indices[t * 3 + 2]);
+
+			// The cross product length is twice the area so it weights the normal by area
+			const glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(cross) * 0.5f;
+			const glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+
+			clusterCenters[c] += center * area;
+			clusterNormals[c] += cross;
+			clusterAreas[c] += area;
+		}
+
+		meshCenter += clusterCenters[c];
+		meshArea += clusterAreas[c];
+	}
+
+	if (meshArea > 0.0f)
+		meshCenter /= meshArea;
+
+	// Clusters that face away from the center are on the outside of the mesh
+	// Drawing those first lets the depth test reject the hidden clusters behind them
+	TArray<float> clusterSort(clusterCount, 0.0f);
+
+	for (PUi32 c = 0; c < clusterCount; ++c)
+	{
+		if (clusterAreas[c] <= 0.0f)
+			continue;
+
+		const glm::vec3 center = clusterCenters[c] / clusterAreas[c];
+		const float normalLength = glm::length(clusterNormals[c]);
+
+		if (normalLength > 0.0f)
+			clusterSort[c] = glm::dot(center - meshCenter, clusterNormals[c] / normalLength);
+	}
+
+	TArray<PUi32> clusterOrder(clusterCount);
+
+	for (PUi32 c = 0; c < clusterCount; ++c)
+		clusterOrder[c] = c;
+
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusterSort](const PUi32& a, const PUi32& b)
+		{
+			return clusterSort[a] > clusterSort[b];
+		});
+
+	TArray<PUi32> output;
+	output.reserve(indices.size());
+
+	for (const auto& c : clusterOrder)
+	{
+		output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	}
+
+	indices.swap(output);
+}
+
+void PMeshOptimiser::OptimiseVertexFetch(TArray<PSVertexData>& vertices, TArray<PUi32>& indices)
+{
+	const PUi32 unused = UINT32_MAX;
+	TArray<PUi32> remap(vertices.size(), unused);
+	TArray<PSVertexData> ordered;
+	ordered.reserve(vertices.size());
+
+	// Give each vertex a new index in the order it is first drawn
+	for (auto& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<PUi32>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(ordered);
+}
+
+float PMeshOptimiser::CalculateACMR(const TArray<PUi32>& indices, const PUi32& vertexCount, const PUi32& cacheSize)
+{
+	const PUi32 triangleCount = static_cast<PUi32>(indices.size() / 3);
+
+	if (triangleCount == 0)
+		return 0.0f;
+
+	// Store when each vertex was added so the FIFO can be tested without moving anything
+	TArray<PUi32> cacheTime(vertexCount, 0);
+	PUi32 time = cacheSize + 1;
+	PUi32 misses = 0;
+
+	for (const auto& index : indices)
+	{
+		if (time - cacheTime[index] > cacheSize)
+		{
+			cacheTime[index] = time++;
+			++misses;
+		}
+	}
+
+	return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
@@ -0,0 +1,388 @@
+#include "Graphics/PMeshSimplifier.h"
+#include "Math/PSHash.h"
+
+// External Libs
+#include <GLM/glm.hpp>
+
+// System Libs
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+// Symmetric 4x4 matrix that measures the squared distance of a point to a set of planes
+struct PSQuadric
+{
+	// Upper triangle of the matrix
+	double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+	double b2 = 0.0, bc = 0.0, bd = 0.0;
+	double c2 = 0.0, cd = 0.0;
+	double d2 = 0.0;
+
+	// Total weight of the planes, used to average the error
+	double weight = 0.0;
+
+	// Add a plane scaled by a weight
+	void AddPlane(const glm::dvec4& plane, const double& planeWeight)
+	{
+		a2 += plane.x * plane.x * planeWeight; ab += plane.x * plane.y * planeWeight;
+		ac += plane.x * plane.z * planeWeight; ad += plane.x * plane.w * planeWeight;
+		b2 += plane.y * plane.y * planeWeight; bc += plane.y * plane.z * planeWeight;
+		bd += plane.y * plane.w * planeWeight;
+		c2 += plane.z * plane.z * planeWeight; cd += plane.z * plane.w * planeWeight;
+		d2 += plane.w * plane.w * planeWeight;
+		weight += planeWeight;
+	}
+
+	// Combine with another quadric
+	void Add(const PSQuadric& other)
+	{
+		a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+		b2 += other.b2; bc += other.bc; bd += other.bd;
+		c2 += other.c2; cd += other.cd;
+		d2 += other.d2;
+		weight += other.weight;
+	}
+
+	// Average squared distance from the point to the planes
+	double Error(const glm::dvec3& p) const
+	{
+		const double error = a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x
+			+ b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y
+			+ c2 * p.z * p.z + 2.0 * cd * p.z
+			+ d2;
+
+		return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+	}
+};
+
+// A possible collapse of one vertex onto another
+struct PSEdgeCollapse
+{
+	// Error caused by the collapse
+	double cost = 0.0;
+
+	// Vertex that is removed
+	PUi32 from = 0;
+
+	// Vertex that is kept
+	PUi32 to = 0;
+
+	// Sort so the cheapest collapse is at the top of the queue
+	bool operator>(const PSEdgeCollapse& other) const { return cost > other.cost; }
+};
+
+// Position of a vertex as a key
+struct PSPositionKey
+{
+	float position[3];
+};
+
+// Get the position of a vertex
+static glm::dvec3 GetPosition(const TArray<PSVertexData>& vertices, const PUi32& index)
+{
+	const float* position = vertices[index].m_Position;
+	return glm::dvec3(position[0], position[1], position[2]);
+}
+
+// Combine a vertex pair into one key for the edge maps
+static PUi64 EdgeKey(PUi32 a, PUi32 b)
+{
+	if (a > b)
+		std::swap(a, b);
+
+	return (static_cast<PUi64>(a) << 32) | b;
+}
+
+PUi32 PMeshSimplifier::Simplify(const TArray<PSVertexData>& vertices, const TArray<PUi32>& indices,
+	const PUi32& targetIndexCount, const float& maxError, TArray<PUi32>& outIndices)
+{
+	outIndices.clear();
+
+	const PUi32 vertexCount = static_cast<PUi32>(vertices.size());
+
+	// Imported meshes often have a separate vertex for every corner of every triangle
+	// Find the vertices that are exact copies so the triangles are connected
+	TArray<PUi32> canonical(vertexCount);
+	std::unordered_map<PSVertexData, PUi32, PSBytesHash<PSVertexData>, PSBytesEqual<PSVertexData>> vertexMap;
+
+	for (PUi32 i = 0; i < vertexCount; ++i)
+		canonical[i] = vertexMap.emplace(vertices[i], i).first->second;
+
+	// Vertices at the same position with different normals or texture coordinates form a seam
+	TArray<PUi32> positionGroup(vertexCount);
+	TArray<PUi32> groupVertex;
+	TArray<bool> locked(vertexCount, false);
+	std::unordered_map<PSPositionKey, PUi32, PSBytesHash<PSPositionKey>, PSBytesEqual<PSPositionKey>> positionMap;
+
+	for (PUi32 i = 0; i < vertexCount; ++i)
+	{
+		if (canonical[i] != i)
+			continue;
+
+		PSPositionKey key;
+		std::memcpy(key.position, vertices[i].m_Position, sizeof(key.position));
+
+		const auto result = positionMap.emplace(key, static_cast<PUi32>(groupVertex.size()));
+		positionGroup[i] = result.first->second;
+
+		if (result.second)
+		{
+			groupVertex.push_back(i);
+		}
+		else
+		{
+			// Moving one side of a seam would tear the mesh open
+			locked[i] = true;
+			locked[groupVertex[positionGroup[i]]] = true;
+		}
+	}
+
+	// Build the triangles from the connected vertices and skip any with no area
+	TArray<PUi32> triangles;
+	triangles.reserve(indices.size());
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const PUi32 a = canonical[indices[i]];
+		const PUi32 b = canonical[indices[i + 1]];
+		const PUi32 c = canonical[indices[i + 2]];
+
+		if (a == b || b == c || a == c)
+			continue;
+
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	}
+
+	PUi32 triangleCount = static_cast<PUi32>(triangles.size() / 3);
+
+	// Edges that only have one triangle are on a border of the mesh
+	std::unordered_map<PUi64, PUi32> edgeUses;
+
+	for (PUi32 t = 0; t < triangleCount; ++t)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			const PUi32 a = positionGroup[triangles[t * 3 + e]];
+			const PUi32 b = positionGroup[triangles[t * 3 + (e + 1) % 3]];
+			++edgeUses[EdgeKey(a, b)];
+		}
+	}
+
+	for (PUi32 t = 0; t < triangleCount; ++t)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			const PUi32 a = triangles[t * 3 + e];
+			const PUi32 b = triangles[t * 3 + (e + 1) % 3];
+
+			if (edgeUses[EdgeKey(positionGroup[a], positionGroup[b])] == 1)
+				locked[a] = locked[b] = true;
+		}
+	}
+
+	// Each vertex starts with the planes of the triangles around it
+	// Bigger triangles count for more
+	TArray<PSQuadric> quadrics(vertexCount);
+	TArray<TArray<PUi32>> vertexTriangles(vertexCount);
+	PSBounds bounds;
+
+	for (PUi32 t = 0; t < triangleCount; ++t)
+	{
+		const PUi32* corner = &triangles[t * 3];
+		const glm::dvec3 p0 = GetPosition(vertices, corner[0]);
+		const glm::dvec3 p1 = GetPosition(vertices, corner[1]);
+		const glm::dvec3 p2 = GetPosition(vertices, corner[2]);
+
+		const glm::dvec3 cross = glm::cross(p1 - p0, p2 - p0);
+		const double area = glm::length(cross) * 0.5;
+
+		if (area > 0.0)
+		{
+			const glm::dvec3 normal = cross / (area * 2.0);
+			const glm::dvec4 plane(normal, -glm::dot(normal, p0));
+
+			for (int i = 0; i < 3; ++i)
+				quadrics[corner[i]].AddPlane(plane, area);
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			vertexTriangles[corner[i]].push_back(t);
+			bounds.AddPoint(glm::vec3(GetPosition(vertices, corner[i])));
+		}
+	}
+
+	bounds.UpdateSphere();
+
+	const double maxErrorDistance = static_cast<double>(maxError) * bounds.radius;
+	const double maxCost = maxErrorDistance * maxErrorDistance;
+
+	TArray<bool> triangleAlive(triangleCount, true);
+	TArray<PUi32> collapsedTo(vertexCount);
+
+	for (PUi32 i = 0; i < vertexCount; ++i)
+		collapsedTo[i] = i;
+
+	// Queue every unlocked direction of every edge
+	std::priority_queue<PSEdgeCollapse, TArray<PSEdgeCollapse>, std::greater<PSEdgeCollapse>> collapseQueue;
+
+	auto addCollapse = [&](const PUi32& from, const PUi32& to)
+		{
+			if (locked[from])
+				return;
+
+			PSQuadric combined = quadrics[from];
+			combined.Add(quadrics[to]);
+
+			collapseQueue.push({ combined.Error(GetPosition(vertices, to)), from, to });
+		};
+
+	for (PUi32 t = 0; t < triangleCount; ++t)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			const PUi32 a = triangles[t * 3 + e];
+			const PUi32 b = triangles[t * 3 + (e + 1) % 3];
+
+			addCollapse(a, b);
+			addCollapse(b, a);
+		}
+	}
+
+	const PUi32 targetTriangles = targetIndexCount / 3;
+
+	while (triangleCount > targetTriangles && !collapseQueue.empty())
+	{
+		const PSEdgeCollapse collapse = collapseQueue.top();
+		collapseQueue.pop();
+
+		if (collapse.cost > maxCost)
+			break;
+
+		const PUi32 from = collapse.from;
+		const PUi32 to = collapse.to;
+
+		// Skip collapses of vertices that have already been removed
+		if (collapsedTo[from] != from || collapsedTo[to] != to)
+			continue;
+
+		// The queue keeps old costs so check it hasn't gone up since it was added
+		PSQuadric combined = quadrics[from];
+		combined.Add(quadrics[to]);
+		const double cost = combined.Error(GetPosition(vertices, to));
+
+		if (cost > collapse.cost * 1.0001 + 1e-12)
+		{
+			collapseQueue.push({ cost, from, to });
+			continue;
+		}
+
+		// Make sure the vertices are still connected and no triangle would flip over
+		bool isConnected = false;
+		bool isFlipped = false;
+		const glm::dvec3 toPosition = GetPosition(vertices, to);
+
+		for (const PUi32& t : vertexTriangles[from])
+		{
+			if (!triangleAlive[t])
+				continue;
+
+			const PUi32* corner = &triangles[t * 3];
+
+			if (corner[0] == to || corner[1] == to || corner[2] == to)
+			{
+				isConnected = true;
+				continue;
+			}
+
+			glm::dvec3 p[3];
+
+			for (int i = 0; i < 3; ++i)
+				p[i] = GetPosition(vertices, corner[i]);
+
+			const glm::dvec3 oldNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+			for (int i = 0; i < 3; ++i)
+			{
+				if (corner[i] == from)
+					p[i] = toPosition;
+			}
+
+			const glm::dvec3 newNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+			if (glm::dot(oldNormal, newNormal) <= 0.2 * glm::length(oldNormal) * glm::length(newNormal))
+			{
+				isFlipped = true;
+				break;
+			}
+		}
+
+		if (!isConnected || isFlipped)
+			continue;
+
+		// Move every triangle on the removed vertex onto the kept vertex
+		// Triangles that had both vertices become empty and are removed
+		for (const PUi32& t : vertexTriangles[from])
+		{
+			if (!triangleAlive[t])
+				continue;
+
+			PUi32* corner = &triangles[t * 3];
+
+			if (corner[0] == to || corner[1] == to || corner[2] == to)
+			{
+				triangleAlive[t] = false;
+				--triangleCount;
+				continue;
+			}
+
+			for (int i = 0; i < 3; ++i)
+			{
+				if (corner[i] == from)
+					corner[i] = to;
+			}
+
+			vertexTriangles[to].push_back(t);
+		}
+
+		vertexTriangles[from].clear();
+		collapsedTo[from] = to;
+		quadrics[to] = combined;
+
+		// Costs around the kept vertex have changed
+		for (const PUi32& t : vertexTriangles[to])
+		{
+			if (!triangleAlive[t])
+				continue;
+
+			for (int i = 0; i < 3; ++i)
+			{
+				const PUi32 other = triangles[t * 3 + i];
+
+				if (other == to)
+					continue;
+
+				addCollapse(to, other);
+				addCollapse(other, to);
+			}
+		}
+	}
+
+	// Copy out the triangles that are left
+	outIndices.reserve(static_cast<size_t>(triangleCount) * 3);
+
+	for (PUi32 t = 0; t < triangleAlive.size(); ++t)
+	{
+		if (!triangleAlive[t])
+			continue;
+
+		outIndices.push_back(triangles[t * 3]);
+		outIndices.push_back(triangles[t * 3 + 1]);
+		outIndices.push_back(triangles[t * 3 + 2]);
+	}
+
+	return static_cast<PUi32>(outIndices.size());
+}
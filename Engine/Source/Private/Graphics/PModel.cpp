@@ -1,4 +1,8 @@
 #include "Graphics/PModel.h"
+#include "Graphics/PMeshOptimiser.h"
+#include "Graphics/PMeshCache.h"
+#include "Graphics/PShaderProgram.h"
+#include "Threading/PThreadPool.h"
 
 // External Libs
 #include <ASSIMP/Importer.hpp>
@@ -6,9 +10,168 @@
 #include <ASSIMP/postprocess.h>
 #include <ASSIMP/mesh.h>
 
-void PModel::ImportModel(const PString& filePath)
+// System Libs
+#include <atomic>
+#include <chrono>
+
+// Everything an import needs, shared with the worker so it is safe if the model is destroyed first
+struct PSModelImport
+{
+	// Path of the source model
+	PString filePath;
+
+	// Settings every mesh is created with
+	PSMeshSettings meshSettings;
+
+	// Set by the worker once the CPU stages have finished
+	std::atomic<bool> isDone = false;
+
+	// If the CPU stages succeeded
+	bool success = false;
+
+	// Meshes converted on the CPU waiting to be uploaded
+	TArray<TUnique<PMesh>> meshes;
+
+	// Cooked file used instead of ASSIMP when it matched the source
+	PSCookedModel cooked;
+
+	// If the meshes come from the cooked file
+	bool isCooked = false;
+
+	// Amount of material slots on the model
+	PUi32 materialCount = 0;
+
+	// When the import started
+	std::chrono::steady_clock::time_point startTime;
+
+	// Time spent reading and converting on the CPU in milliseconds
+	double loadTime = 0.0;
+};
+
+// A mesh found in the ASSIMP scene
+struct PSImportedMesh
+{
+	// Index of the mesh in the scene
+	PUi32 sceneIndex = 0;
+
+	// Transform of the mesh relative to the model
+	glm::mat4 relativeTransform = glm::mat4(1.0f);
+};
+
+void PModel::ImportModel(const PString& filePath, const PSMeshSettings& meshSettings)
+{
+	PSModelImport import;
+	import.filePath = filePath;
+	import.meshSettings = meshSettings;
+	import.startTime = std::chrono::steady_clock::now();
+
+	m_LoadState = LS_LOADING;
+
+	LoadImport(import);
+	UploadImport(import);
+}
+
+void PModel::ImportModelAsync(const PString& filePath, const PSMeshSettings& meshSettings)
 {
+	// Only one import can run on a model at a time
+	if (m_Import)
+	{
+		PDebug::Log("Model is already importing, can't import: " + filePath, LT_WARN);
+		return;
+	}
+
+	m_Import = TMakeShared<PSModelImport>();
+	m_Import->filePath = filePath;
+	m_Import->meshSettings = meshSettings;
+	m_Import->startTime = std::chrono::steady_clock::now();
+
+	m_LoadState = LS_LOADING;
+
+	// The job keeps its own reference so the model can be destroyed while it runs
+	const TShared<PSModelImport> import = m_Import;
+
+	PThreadPool::GetPool().AddJob([import]()
+		{
+			LoadImport(*import);
+			import->isDone.store(true);
+		});
+}
+
+bool PModel::UpdateImport()
+{
+	// Instances wait for their source to be uploaded
+	if (m_Source && m_LoadState == LS_LOADING)
+	{
+		const PELoadState sourceState = m_Source->GetLoadState();
+
+		if (sourceState == LS_LOADING)
+			return false;
+
+		if (sourceState == LS_READY)
+		{
+			m_MeshStack = m_Source->m_MeshStack;
+			FinishImport(static_cast<PUi32>(m_Source->m_MaterialsStack.size()));
+			m_LoadState = LS_READY;
+		}
+		else
+		{
+			m_LoadState = LS_FAILED;
+		}
+
+		return true;
+	}
+
+	if (!m_Import || !m_Import->isDone.load())
+		return false;
+
+	UploadImport(*m_Import);
+	m_Import = nullptr;
+
+	return true;
+}
+
+void PModel::CreateInstance(const TShared<PModel>& source)
+{
+	if (source == nullptr || source.get() == this || !m_MeshStack.empty() || m_Import)
+	{
+		PDebug::Log("Model can't become an instance, it must be empty and the source must exist", LT_WARN);
+		return;
+	}
+
+	// Always start loading so the meshes are added in UpdateImport() even if the source is ready
+	m_Source = source;
+	m_LoadState = LS_LOADING;
+}
+
+PUi64 PModel::GetMemorySize() const
+{
+	PUi64 memorySize = 0;
+
+	for (const auto& mesh : m_MeshStack)
+		memorySize += mesh->GetVertexBufferSize() + mesh->GetIndexBufferSize();
+
+	return memorySize;
+}
+
+void PModel::LoadImport(PSModelImport& import)
+{
+	const PString& filePath = import.filePath;
+
+	// Use the cooked meshes if the source file and settings haven't changed since they were cooked
+	const PString cookedPath = PMeshCache::GetCookedPath(filePath);
+	const PUi64 cookedKey = PMeshCache::MakeKey(filePath, import.meshSettings);
+
+	if (cookedKey != 0 && PMeshCache::Read(cookedPath, cookedKey, import.cooked))
+	{
+		import.isCooked = true;
+		import.materialCount = import.cooked.materialCount;
+		import.success = true;
+		import.loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - import.startTime).count();
+		return;
+	}
+
 	// Create an assimp importer
+	// Each import has its own so imports can run at the same time
 	Assimp::Importer importer;
 
 	// Read the file and convert the model to an assimp scene
@@ -36,33 +199,222 @@ void PModel::ImportModel(const PString& filePath)
 	// Set the scale to x1, y1, z1
 	aiMatrix4x4::Scaling({ 1.0f, 1.0f, 1.0f }, sceneTransform);
 
-	// Meshes count
-	PUi32 meshesCreated = 0;
+	// Find all meshes in the scene
+	TArray<PSImportedMesh> sceneMeshes;
+	FindMeshes(*scene->mRootNode, sceneTransform, sceneMeshes);
+
+	// Convert the meshes in parallel, each one only reads its own aiMesh
+	const PUi32 meshCount = static_cast<PUi32>(sceneMeshes.size());
+	import.meshes.resize(meshCount);
+	std::atomic<bool> meshFailed = false;
+
+	PThreadPool::GetPool().ParallelFor(meshCount, [&](PUi32 i)
+		{
+			const PSImportedMesh& sceneMesh = sceneMeshes[i];
+			const aiMesh& aMesh = *scene->mMeshes[sceneMesh.sceneIndex];
+
+			// Create the mesh object
+			auto pMesh = TMakeUnique<PMesh>();
+
+			// Test if the mesh fails to convert
+			if (!ConvertMesh(aMesh, import.meshSettings, *pMesh))
+			{
+				meshFailed.store(true);
+				return;
+			}
+
+			// Get the material index from the assimp mesh and set our mesh index to the same
+			pMesh->materialIndex = aMesh.mMaterialIndex;
+
+			// Update the relative transform on the mesh
+			pMesh->SetRelativeTransform(sceneMesh.relativeTransform);
 
-	// Find all meshes in the scene and fail if any of them fail
-	if (!FindAndImportMeshes(*scene->mRootNode, *scene, sceneTransform, &meshesCreated))
+			import.meshes[i] = std::move(pMesh);
+		});
+
+	// Fail if any of the meshes failed
+	if (meshFailed.load())
 	{
 		PDebug::Log("Model failed to convert ASSIMP scene: " + filePath, LT_ERROR);
+		import.meshes.clear();
 		return;
 	}
 
-	// Set the material stack size to the amount of materials on the model
-	m_MaterialsStack.resize(scene->mNumMaterials);
+	import.materialCount = scene->mNumMaterials;
+	import.success = true;
+	import.loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - import.startTime).count();
+
+	// Cook the meshes so the next import can skip ASSIMP
+	if (cookedKey != 0)
+		PMeshCache::Save(cookedPath, cookedKey, import.meshes, import.materialCount);
+}
+
+void PModel::UploadImport(PSModelImport& import)
+{
+	if (!import.success)
+	{
+		m_LoadState = LS_FAILED;
+		return;
+	}
+
+	TArray<TShared<PMesh>> meshes;
+
+	if (import.isCooked)
+	{
+		// Upload the streams straight from the mapped file
+		for (const auto& meshData : import.cooked.meshes)
+		{
+			auto pMesh = TMakeUnique<PMesh>();
+
+			if (!pMesh->CreateMesh(meshData))
+			{
+				PDebug::Log("Mesh failed to create from cooked data: " + import.filePath, LT_ERROR);
+				m_LoadState = LS_FAILED;
+				return;
+			}
+
+			meshes.push_back(std::move(pMesh));
+		}
+
+		import.cooked.file.Close();
+	}
+	else
+	{
+		for (auto& pMesh : import.meshes)
+		{
+			if (!pMesh->UploadMesh())
+			{
+				PDebug::Log("Mesh failed to upload: " + import.filePath, LT_ERROR);
+				m_LoadState = LS_FAILED;
+				return;
+			}
+
+			meshes.push_back(std::move(pMesh));
+		}
+
+		import.meshes.clear();
+	}
+
+	// Add the new meshes to the mesh stack
+	for (auto& pMesh : meshes)
+		m_MeshStack.push_back(std::move(pMesh));
+
+	FinishImport(import.materialCount);
+	m_LoadState = LS_READY;
+
+	// Compare the vertex memory against storing every vertex as full floats
+	PUi64 vertexBytes = 0;
+	PUi64 fullVertexBytes = 0;
+	PUi64 indexBytes = 0;
+
+	for (const auto& mesh : m_MeshStack)
+	{
+		vertexBytes += mesh->GetVertexBufferSize();
+		fullVertexBytes += static_cast<PUi64>(mesh->GetVertices().size()) * sizeof(PSVertexData);
+		indexBytes += mesh->GetIndexBufferSize();
+	}
+
+	PDebug::Log("Model vertex data: " + std::to_string(vertexBytes / 1024) + " KB (" 
+		+ std::to_string(fullVertexBytes / 1024) + " KB as full floats), index data: " + std::to_string(indexBytes / 1024) + " KB");
+
+	const double totalTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - import.startTime).count();
 
 	// Log the successful import of the model
-	PDebug::Log("Model successfully imported with (" + std::to_string(meshesCreated) + ") meshes: " +  filePath, LT_SUCCESS);
+	PDebug::Log("Model successfully " + PString(import.isCooked ? "loaded from cooked file" : "imported") + " with ("
+		+ std::to_string(meshes.size()) + ") meshes, " + std::to_string(import.loadTime) + " ms on the CPU, "
+		+ std::to_string(totalTime) + " ms total: " + import.filePath, LT_SUCCESS);
+}
+
+void PModel::FinishImport(const PUi32& materialCount)
+{
+	// Slots set while loading that the model doesn't have are dropped
+	for (PUi32 slot = materialCount; slot < m_MaterialsStack.size(); ++slot)
+	{
+		if (m_MaterialsStack[slot])
+			PDebug::Log("No material slot exists at that index: " + std::to_string(slot), LT_WARN);
+	}
+
+	// Set the material stack size to the amount of materials on the model
+	m_MaterialsStack.resize(materialCount);
+
+	// Make sure the world bounds include the new meshes
+	m_MeshWorldBounds.resize(m_MeshStack.size());
+	m_MeshProxies.resize(m_MeshStack.size(), -1);
+	m_MeshLODs.resize(m_MeshStack.size(), 0);
+	m_BoundsDirty = true;
+
+	// Only turn occlusion on, instances share meshes so another instance may have already set it
+	if (m_IsOccluder)
+	{
+		for (const auto& mesh : m_MeshStack)
+			mesh->SetOccluder(true);
+	}
 }
 
 void PModel::Render(const TShared<PShaderProgram>& shader, const TArray<TShared<PSLight>>& lights)
 {
+	// Set the lights once for every mesh in the model
+	shader->SetLights(lights);
+
 	for (const auto& mesh : m_MeshStack)
 	{
-		mesh->Render(shader, m_Transform, lights, m_MaterialsStack[mesh->materialIndex]);
+		mesh->Render(shader, m_Transform.GetMatrix(), m_MaterialsStack[mesh->materialIndex]);
 	}
 }
 
+void PModel::RenderMesh(const PUi32& meshIndex, const TShared<PShaderProgram>& shader)
+{
+	const auto& mesh = m_MeshStack[meshIndex];
+	mesh->Render(shader, m_WorldMatrix, m_MaterialsStack[mesh->materialIndex], m_MeshLODs[meshIndex]);
+}
+
+bool PModel::UpdateWorldBounds()
+{
+	// Only update the bounds when the model has moved
+	if (!m_BoundsDirty && m_Transform == m_LastTransform)
+		return false;
+
+	m_LastTransform = m_Transform;
+	m_BoundsDirty = false;
+	m_WorldMatrix = m_Transform.GetMatrix();
+	m_WorldBounds = PSBounds();
+
+	// Move the mesh bounds into world space through the mesh and model transforms
+	for (PUi32 i = 0; i < m_MeshStack.size(); ++i)
+	{
+		const auto& mesh = m_MeshStack[i];
+		m_MeshWorldBounds[i] = mesh->GetBounds().Transformed(m_WorldMatrix * mesh->GetRelativeTransform());
+		m_WorldBounds.AddBounds(m_MeshWorldBounds[i]);
+	}
+
+	return true;
+}
+
+bool PModel::IsInGeometryBuffer() const
+{
+	for (const auto& mesh : m_MeshStack)
+	{
+		if (!mesh->IsInGeometryBuffer())
+			return false;
+	}
+
+	return true;
+}
+
+void PModel::SetOccluder(const bool& isOccluder)
+{
+	m_IsOccluder = isOccluder;
+
+	for (const auto& mesh : m_MeshStack)
+		mesh->SetOccluder(isOccluder);
+}
+
 void PModel::SetMaterialBySlot(unsigned int slot, const TShared<PSMaterial>& material)
 {
+	// The slots aren't known until the model has loaded so make room for it
+	if (m_LoadState == LS_LOADING && slot >= m_MaterialsStack.size())
+		m_MaterialsStack.resize(slot + 1);
+
 	// Ensure that the material slot exists
 	if (slot >= m_MaterialsStack.size())
 	{
@@ -74,133 +426,132 @@ void PModel::SetMaterialBySlot(unsigned int slot, const TShared<PSMaterial>& mat
 	m_MaterialsStack[slot] = material;
 }
 
-bool PModel::FindAndImportMeshes(const aiNode& node, const aiScene& scene, const aiMatrix4x4& parentTransform, PUi32* meshesCreated)
+void PModel::FindMeshes(const aiNode& node, const aiMatrix4x4& parentTransform, TArray<PSImportedMesh>& outMeshes)
 {
+	// Set the relative transformation for the meshes in the node
+	const aiMatrix4x4 relTransform = parentTransform * node.mTransformation;
+
+	// Set a default matrix transform for glm
+	glm::mat4 matTransform(1.0f);
+
+	// Conert the relative ASSIMP transform into a glm transform
+	matTransform[0][0] = relTransform.a1; matTransform[1][0] = relTransform.a2;
+	matTransform[2][0] = relTransform.a3; matTransform[3][0] = relTransform.a4;
+
+	matTransform[0][1] = relTransform.b1; matTransform[1][1] = relTransform.b2;
+	matTransform[2][1] = relTransform.b3; matTransform[3][1] = relTransform.b4;
+
+	matTransform[0][2] = relTransform.c1; matTransform[1][2] = relTransform.c2;
+	matTransform[2][2] = relTransform.c3; matTransform[3][2] = relTransform.c4;
+
+	matTransform[0][3] = relTransform.d1; matTransform[1][3] = relTransform.d2;
+	matTransform[2][3] = relTransform.d3; matTransform[3][3] = relTransform.d4;
+
 	// Looping through all the meshes in the node
 	for (PUi32 i = 0; i < node.mNumMeshes; ++i)
 	{
-		// TO DO: Convert aiMesh to PMesh
-		
-		// Get the mesh index for the mesh in the scene
-		const auto aMesh = scene.mMeshes[node.mMeshes[i]];
+		PSImportedMesh sceneMesh;
+		sceneMesh.sceneIndex = node.mMeshes[i];
+		sceneMesh.relativeTransform = matTransform;
+		outMeshes.push_back(sceneMesh);
+	}
 
-		// Store mesh vertices and indices
-		TArray<PSVertexData> meshVertices;
-		TArray<PUi32> meshIndices;
+	// Loop through all of the child nodes inside this node
+	for (PUi32 i = 0; i < node.mNumChildren; ++i)
+	{
+		FindMeshes(*node.mChildren[i], relTransform, outMeshes);
+	}
+}
 
-		// Loop through every vertex and get the data for conversion
-		for (PUi64 j = 0; j < aMesh->mNumVertices; ++j)
-		{
-			// Create an empty vertex
-			PSVertexData vertex;
+bool PModel::ConvertMesh(const aiMesh& aMesh, const PSMeshSettings& meshSettings, PMesh& outMesh)
+{
+	// Store mesh vertices and indices
+	TArray<PSVertexData> meshVertices;
+	TArray<PUi32> meshIndices;
 
-			// Get the positions of the vertex
-			vertex.m_Position[0] = aMesh->mVertices[j].x;
-			vertex.m_Position[1] = aMesh->mVertices[j].y;
-			vertex.m_Position[2] = aMesh->mVertices[j].z;
+	// Loop through every vertex and get the data for conversion
+	for (PUi64 j = 0; j < aMesh.mNumVertices; ++j)
+	{
+		// Create an empty vertex
+		PSVertexData vertex;
 
-			// If there are vertex colours then update
-			if (aMesh->HasVertexColors(j))
-			{
-				vertex.m_Colour[0] = aMesh->mColors[j]->r;
-				vertex.m_Colour[1] = aMesh->mColors[j]->g;
-				vertex.m_Colour[2] = aMesh->mColors[j]->b;
-			}
+		// Get the positions of the vertex
+		vertex.m_Position[0] = aMesh.mVertices[j].x;
+		vertex.m_Position[1] = aMesh.mVertices[j].y;
+		vertex.m_Position[2] = aMesh.mVertices[j].z;
 
-			// Set the texture coordinates
-			// Texture coordinates can have multiple sets
-			// The first array index is the set number [0]
-			// The second array index is the vertex data
-			if (aMesh->HasTextureCoords(0))
-			{
-				vertex.m_TexCoords[0] = aMesh->mTextureCoords[0][j].x;
-				vertex.m_TexCoords[1] = aMesh->mTextureCoords[0][j].y;
-			}
-			
-			// Get the normals for the model
-			vertex.m_Normal[0] = aMesh->mNormals[j].x;
-			vertex.m_Normal[1] = aMesh->mNormals[j].y;
-			vertex.m_Normal[2] = aMesh->mNormals[j].z;
-
-			// Add the data into our vertex array
-			meshVertices.push_back(vertex);
+		// If there are vertex colours then update
+		if (aMesh.HasVertexColors(j))
+		{
+			vertex.m_Colour[0] = aMesh.mColors[j]->r;
+			vertex.m_Colour[1] = aMesh.mColors[j]->g;
+			vertex.m_Colour[2] = aMesh.mColors[j]->b;
 		}
 
-		// The gpu requires a minimum of 3 vertices to render (triangle)
-		// Fail if there are less than 3
-		if (meshVertices.size() < 3)
+		// Set the texture coordinates
+		// Texture coordinates can have multiple sets
+		// The first array index is the set number [0]
+		// The second array index is the vertex data
+		if (aMesh.HasTextureCoords(0))
 		{
-			PDebug::Log("Mesh has less than 3 vertices", LT_ERROR);
-			return false;
+			vertex.m_TexCoords[0] = aMesh.mTextureCoords[0][j].x;
+			vertex.m_TexCoords[1] = aMesh.mTextureCoords[0][j].y;
 		}
+		
+		// Get the normals for the model
+		vertex.m_Normal[0] = aMesh.mNormals[j].x;
+		vertex.m_Normal[1] = aMesh.mNormals[j].y;
+		vertex.m_Normal[2] = aMesh.mNormals[j].z;
 
-		// Loop through all of the faces on the mesh to get the indices
-		for (PUi64 j = 0; j < aMesh->mNumFaces; ++j)
-		{
-			// Store the face as a variable
-			auto face = aMesh->mFaces[j];
+		// Add the data into our vertex array
+		meshVertices.push_back(vertex);
+	}
 
-			// Looping through all the indices in the face, should only be 3
-			for (PUi32 k = 0; k < face.mNumIndices; ++k)
-			{
-				meshIndices.push_back(face.mIndices[k]);
-			}
-		}
+	// The gpu requires a minimum of 3 vertices to render (triangle)
+	// Fail if there are less than 3
+	if (meshVertices.size() < 3)
+	{
+		PDebug::Log("Mesh has less than 3 vertices", LT_ERROR);
+		return false;
+	}
 
-		// Create the mesh object
-		auto pMesh = TMakeUnique<PMesh>();
+	// Loop through all of the faces on the mesh to get the indices
+	for (PUi64 j = 0; j < aMesh.mNumFaces; ++j)
+	{
+		// Store the face as a variable
+		auto face = aMesh.mFaces[j];
 
-		// Test if the mesh fails to create
-		if (!pMesh->CreateMesh(meshVertices, meshIndices))
+		// Looping through all the indices in the face, should only be 3
+		for (PUi32 k = 0; k < face.mNumIndices; ++k)
 		{
-			PDebug::Log("Mesh failed to convert from A Mesh to P Mesh", LT_ERROR);
-			return false;
+			meshIndices.push_back(face.mIndices[k]);
 		}
+	}
 
-		// Get the material index from the assimp mesh and set our mesh index to the same
-		pMesh->materialIndex = aMesh->mMaterialIndex; 
-
-		// Set the relative transformation for the mesh
-		aiMatrix4x4 relTransform = parentTransform * node.mTransformation;
-
-		// Set a default matrix transform for glm
-		glm::mat4 matTransform(1.0f);
-
-		// Conert the relative ASSIMP transform into a glm transform
-		matTransform[0][0] = relTransform.a1; matTransform[1][0] = relTransform.a2;
-		matTransform[2][0] = relTransform.a3; matTransform[3][0] = relTransform.a4;
-
-		matTransform[0][1] = relTransform.b1; matTransform[1][1] = relTransform.b2;
-		matTransform[2][1] = relTransform.b3; matTransform[3][1] = relTransform.b4;
-
-		matTransform[0][2] = relTransform.c1; matTransform[1][2] = relTransform.c2;
-		matTransform[2][2] = relTransform.c3; matTransform[3][2] = relTransform.c4;
-
-		matTransform[0][3] = relTransform.d1; matTransform[1][3] = relTransform.d2;
-		matTransform[2][3] = relTransform.d3; matTransform[3][3] = relTransform.d4;
-
-		// Update the relative transform on the mesh
-		pMesh->SetRelativeTransform(matTransform);
+	// Reorder the mesh data for the GPU caches
+	if (meshSettings.optimise)
+	{
+		const PUi32 oldVertexCount = static_cast<PUi32>(meshVertices.size());
+		const float oldACMR = PMeshOptimiser::CalculateACMR(meshIndices, oldVertexCount);
 
-		// Add the new mesh to the mesh stack
-		m_MeshStack.push_back(std::move(pMesh));
+		PMeshOptimiser::WeldVertices(meshVertices, meshIndices);
+		PMeshOptimiser::OptimiseVertexCache(meshIndices, static_cast<PUi32>(meshVertices.size()));
+		PMeshOptimiser::OptimiseOverdraw(meshVertices, meshIndices);
+		PMeshOptimiser::OptimiseVertexFetch(meshVertices, meshIndices);
 
-		// Count the meshes created
-		++*meshesCreated;
+		const float newACMR = PMeshOptimiser::CalculateACMR(meshIndices, static_cast<PUi32>(meshVertices.size()));
 
+		PDebug::Log("Mesh " + PString(aMesh.mName.C_Str()) + " optimised, ACMR: " + std::to_string(oldACMR)
+			+ " -> " + std::to_string(newACMR) + ", vertices: " + std::to_string(oldVertexCount)
+			+ " -> " + std::to_string(meshVertices.size()));
 	}
 
-	// Adding the relative transform to the parent transform
-	const aiMatrix4x4 nodeRelTransform = parentTransform * node.mTransformation;
-
-	// Loop through all of the child nodes inside this node
-	for (PUi32 i = 0; i < node.mNumChildren; ++i)
+	// Test if the mesh fails to create
+	if (!outMesh.PrepareMesh(meshVertices, meshIndices, meshSettings))
 	{
-		if (!FindAndImportMeshes(*node.mChildren[i], scene, nodeRelTransform, meshesCreated))
-		{
-			return false;
-		}
+		PDebug::Log("Mesh failed to convert from A Mesh to P Mesh", LT_ERROR);
+		return false;
 	}
 
 	return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,357 @@
+#include "Graphics/POcclusionCuller.h"
+#include "Threading/PThreadPool.h"
+
+// External Libs
+#include <GLM/glm.hpp>
+
+// System Libs
+#include <algorithm>
+#include <cfloat>
+#include <emmintrin.h>
+
+// Size of each tile in pixels
+// The width must be a multiple of 4 so rows can be filled 4 pixels at a time
+const PUi32 tileWidth = 32;
+const PUi32 tileHeight = 16;
+
+// Corners closer than this to the camera plane can't be projected
+const float minClipW = 1e-4f;
+
+POcclusionCuller::POcclusionCuller()
+{
+	m_Width = m_Height = 0;
+	m_TilesX = m_TilesY = 0;
+	m_ViewProjection = glm::mat4(1.0f);
+
+	// Low resolution is enough for large occluders like walls
+	SetResolution(320, 192);
+}
+
+void POcclusionCuller::SetResolution(const PUi32& width, const PUi32& height)
+{
+	m_TilesX = std::max(1U, (width + tileWidth - 1) / tileWidth);
+	m_TilesY = std::max(1U, (height + tileHeight - 1) / tileHeight);
+	m_Width = m_TilesX * tileWidth;
+	m_Height = m_TilesY * tileHeight;
+
+	m_TileBins.resize(m_TilesX * m_TilesY);
+
+	// Create each depth level down to 1x1
+	m_HiZ.clear();
+	m_HiZWidth.clear();
+	m_HiZHeight.clear();
+
+	PUi32 levelWidth = m_Width;
+	PUi32 levelHeight = m_Height;
+
+	while (true)
+	{
+		m_HiZ.emplace_back(levelWidth * levelHeight, 1.0f);
+		m_HiZWidth.push_back(levelWidth);
+		m_HiZHeight.push_back(levelHeight);
+
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+
+		levelWidth = std::max(1U, (levelWidth + 1) / 2);
+		levelHeight = std::max(1U, (levelHeight + 1) / 2);
+	}
+}
+
+void POcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+	m_ViewProjection = viewProjection;
+	m_Triangles.clear();
+
+	for (auto& bin : m_TileBins)
+		bin.clear();
+
+	// Clear to the far plane
+	std::fill(m_HiZ[0].begin(), m_HiZ[0].end(), 1.0f);
+}
+
+void POcclusionCuller::AddOccluder(const float* positions, const PUi32& stride, const PUi32& vertexCount,
+	const PUi32* indices, const PUi32& indexCount, const glm::mat4& worldMatrix)
+{
+	const glm::mat4 matrix = m_ViewProjection * worldMatrix;
+	const PUi8* vertexBytes = reinterpret_cast<const PUi8*>(positions);
+
+	// Project every vertex once
+	TArray<glm::vec4> clipPositions(vertexCount);
+
+	for (PUi32 i = 0; i < vertexCount; ++i)
+	{
+		const float* position = reinterpret_cast<const float*>(vertexBytes + static_cast<PUi64>(i) * stride);
+		clipPositions[i] = matrix * glm::vec4(position[0], position[1], position[2], 1.0f);
+	}
+
+	const float width = static_cast<float>(m_Width);
+	const float height = static_cast<float>(m_Height);
+
+	for (PUi32 i = 0; i + 2 < indexCount; i += 3)
+	{
+		const glm::vec4& a = clipPositions[indices[i]];
+		const glm::vec4& b = clipPositions[indices[i + 1]];
+		const glm::vec4& c = clipPositions[indices[i + 2]];
+
+		// Skip triangles crossing the camera plane
+		// Drawing less of an occluder only hides less so this is safe
+		if (a.w < minClipW || b.w < minClipW || c.w < minClipW)
+			continue;
+
+		PSOcclusionTriangle triangle;
+		const glm::vec4* corners[3] = { &a, &b, &c };
+
+		for (int j = 0; j < 3; ++j)
+		{
+			const glm::vec4& corner = *corners[j];
+			triangle.x[j] = (corner.x / corner.w * 0.5f + 0.5f) * width;
+			triangle.y[j] = (corner.y / corner.w * 0.5f + 0.5f) * height;
+			triangle.z[j] = glm::clamp(corner.z / corner.w * 0.5f + 0.5f, 0.0f, 1.0f);
+		}
+
+		// Find the pixels the triangle covers
+		const float minX = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		const float maxX = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		const float minY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+		const float maxY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+
+		// Skip triangles that are off screen
+		if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+			continue;
+
+		const PUi32 triangleIndex = static_cast<PUi32>(m_Triangles.size());
+		m_Triangles.push_back(triangle);
+
+		// Add the triangle to the bin of each tile it touches
+		const PUi32 tileX0 = static_cast<PUi32>(std::max(minX, 0.0f)) / tileWidth;
+		const PUi32 tileY0 = static_cast<PUi32>(std::max(minY, 0.0f)) / tileHeight;
+		const PUi32 tileX1 = std::min(static_cast<PUi32>(maxX) / tileWidth, m_TilesX - 1);
+		const PUi32 tileY1 = std::min(static_cast<PUi32>(maxY) / tileHeight, m_TilesY - 1);
+
+		for (PUi32 ty = tileY0; ty <= tileY1; ++ty)
+		{
+			for (PUi32 tx = tileX0; tx <= tileX1; ++tx)
+				m_TileBins[ty * m_TilesX + tx].push_back(triangleIndex);
+		}
+	}
+}
+
+void POcclusionCuller::Rasterize()
+{
+	// Every tile only writes to its own pixels so they can all run at once
+	PThreadPool::GetPool().ParallelFor(m_TilesX * m_TilesY, [this](PUi32 tileIndex)
+		{
+			RasterizeTile(tileIndex);
+		});
+
+	BuildHiZ();
+}
+
+bool POcclusionCuller::TestBounds(const PSBounds& bounds) const
+{
+	if (!bounds.IsValid())
+		return false;
+
+	float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+	// Project all 8 corners to find the area and the closest depth
+	for (int i = 0; i < 8; ++i)
+	{
+		const glm::vec3 corner(
+			(i & 1) ? bounds.max.x : bounds.min.x,
+			(i & 2) ? bounds.max.y : bounds.min.y,
+			(i & 4) ? bounds.max.z : bounds.min.z
+		);
+
+		const glm::vec4 clip = m_ViewProjection * glm::vec4(corner, 1.0f);
+
+		// The box surrounds the camera so it can't be hidden
+		if (clip.w < minClipW)
+			return true;
+
+		minX = std::min(minX, clip.x / clip.w);
+		maxX = std::max(maxX, clip.x / clip.w);
+		minY = std::min(minY, clip.y / clip.w);
+		maxY = std::max(maxY, clip.y / clip.w);
+		minZ = std::min(minZ, clip.z / clip.w);
+	}
+
+	// In front of the near plane
+	const float nearestDepth = minZ * 0.5f + 0.5f;
+
+	if (nearestDepth <= 0.0f)
+		return true;
+
+	// Convert to pixels and clamp to the depth buffer
+	const float width = static_cast<float>(m_Width);
+	const float height = static_cast<float>(m_Height);
+
+	const int x0 = std::max(0, static_cast<int>((minX * 0.5f + 0.5f) * width));
+	const int y0 = std::max(0, static_cast<int>((minY * 0.5f + 0.5f) * height));
+	const int x1 = std::min(static_cast<int>(m_Width) - 1, static_cast<int>((maxX * 0.5f + 0.5f) * width));
+	const int y1 = std::min(static_cast<int>(m_Height) - 1, static_cast<int>((maxY * 0.5f + 0.5f) * height));
+
+	// Off screen is left to frustum culling
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	// Pick the depth level where the box covers at most 3x3 pixels
+	const int size = std::max(x1 - x0, y1 - y0) + 1;
+	PUi32 level = 0;
+
+	while ((size >> level) > 2 && level + 1 < m_HiZ.size())
+		++level;
+
+	const TArray<float>& depthLevel = m_HiZ[level];
+	const PUi32 levelWidth = m_HiZWidth[level];
+
+	// Visible if the box is closer than the farthest occluder depth anywhere it covers
+	for (int y = y0 >> level; y <= (y1 >> level); ++y)
+	{
+		for (int x = x0 >> level; x <= (x1 >> level); ++x)
+		{
+			if (nearestDepth <= depthLevel[y * levelWidth + x])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+void POcclusionCuller::RasterizeTile(const PUi32& tileIndex)
+{
+	const TArray<PUi32>& bin = m_TileBins[tileIndex];
+
+	if (bin.empty())
+		return;
+
+	float* depth = m_HiZ[0].data();
+
+	// Pixel bounds of the tile
+	const int tileX0 = static_cast<int>((tileIndex % m_TilesX) * tileWidth);
+	const int tileY0 = static_cast<int>((tileIndex / m_TilesX) * tileHeight);
+	const int tileX1 = tileX0 + static_cast<int>(tileWidth) - 1;
+	const int tileY1 = tileY0 + static_cast<int>(tileHeight) - 1;
+
+	// Offsets to the center of 4 pixels in a row
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (const PUi32& triangleIndex : bin)
+	{
+		const PSOcclusionTriangle& triangle = m_Triangles[triangleIndex];
+
+		float x[3] = { triangle.x[0], triangle.x[1], triangle.x[2] };
+		float y[3] = { triangle.y[0], triangle.y[1], triangle.y[2] };
+		float z[3] = { triangle.z[0], triangle.z[1], triangle.z[2] };
+
+		// Twice the area of the triangle, negative if the winding is clockwise
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+
+		// Occluders are drawn from both sides so flip clockwise triangles
+		if (area < 0.0f)
+		{
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+
+		// Skip triangles with no area
+		if (area < 1e-6f)
+			continue;
+
+		// Edge equations in the form a * px + b * py + c
+		// An edge is >= 0 for points on the inside
+		float edgeA[3], edgeB[3], edgeC[3];
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const int from = (i + 1) % 3;
+			const int to = (i + 2) % 3;
+
+			edgeA[i] = -(y[to] - y[from]);
+			edgeB[i] = x[to] - x[from];
+			edgeC[i] = -(edgeA[i] * x[from] + edgeB[i] * y[from]);
+		}
+
+		// Depth plane in the form a * px + b * py + c
+		const float invArea = 1.0f / area;
+		const float depthA = (edgeA[0] * z[0] + edgeA[1] * z[1] + edgeA[2] * z[2]) * invArea;
+		const float depthB = (edgeB[0] * z[0] + edgeB[1] * z[1] + edgeB[2] * z[2]) * invArea;
+		const float depthC = (edgeC[0] * z[0] + edgeC[1] * z[1] + edgeC[2] * z[2]) * invArea;
+
+		// Only visit the pixels of the tile the triangle covers
+		// Start on a multiple of 4 so each block lines up with the row
+		const int minX = std::max(tileX0, static_cast<int>(std::min({ x[0], x[1], x[2] }))) & ~3;
+		const int maxX = std::min(tileX1, static_cast<int>(std::max({ x[0], x[1], x[2] })));
+		const int minY = std::max(tileY0, static_cast<int>(std::min({ y[0], y[1], y[2] })));
+		const int maxY = std::min(tileY1, static_cast<int>(std::max({ y[0], y[1], y[2] })));
+
+		for (int py = minY; py <= maxY; ++py)
+		{
+			const float centerY = static_cast<float>(py) + 0.5f;
+			float* row = depth + static_cast<PUi64>(py) * m_Width;
+
+			// Values that stay the same along the row
+			const __m128 edgeRow0 = _mm_set1_ps(edgeB[0] * centerY + edgeC[0]);
+			const __m128 edgeRow1 = _mm_set1_ps(edgeB[1] * centerY + edgeC[1]);
+			const __m128 edgeRow2 = _mm_set1_ps(edgeB[2] * centerY + edgeC[2]);
+			const __m128 depthRow = _mm_set1_ps(depthB * centerY + depthC);
+
+			for (int px = minX; px <= maxX; px += 4)
+			{
+				const __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(px)), pixelOffsets);
+
+				// Test the 4 pixels against every edge
+				const __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), centerX), edgeRow0);
+				const __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), centerX), edgeRow1);
+				const __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), centerX), edgeRow2);
+
+				__m128 inside = _mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(w2, zero));
+
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				// Keep the closest depth for covered pixels
+				const __m128 pixelDepth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), centerX), depthRow);
+				const __m128 oldDepth = _mm_loadu_ps(row + px);
+				const __m128 closer = _mm_and_ps(inside, _mm_cmplt_ps(pixelDepth, oldDepth));
+
+				_mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(closer, pixelDepth), _mm_andnot_ps(closer, oldDepth)));
+			}
+		}
+	}
+}
+
+void POcclusionCuller::BuildHiZ()
+{
+	for (PUi32 level = 1; level < m_HiZ.size(); ++level)
+	{
+		const TArray<float>& source = m_HiZ[level - 1];
+		TArray<float>& target = m_HiZ[level];
+
+		const PUi32 sourceWidth = m_HiZWidth[level - 1];
+		const PUi32 sourceHeight = m_HiZHeight[level - 1];
+
+		for (PUi32 y = 0; y < m_HiZHeight[level]; ++y)
+		{
+			for (PUi32 x = 0; x < m_HiZWidth[level]; ++x)
+			{
+				// Clamp for odd sizes so the edge pixels are still included
+				const PUi32 x0 = std::min(x * 2, sourceWidth - 1);
+				const PUi32 x1 = std::min(x * 2 + 1, sourceWidth - 1);
+				const PUi32 y0 = std::min(y * 2, sourceHeight - 1);
+				const PUi32 y1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+				// Keep the farthest depth so a box has to be behind everything to be hidden
+				target[y * m_HiZWidth[level] + x] = std::max(
+					std::max(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+					std::max(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1]));
+			}
+		}
+	}
+}
@@ -0,0 +1,281 @@
+#include "Graphics/PPortalGraph.h"
+
+// System Libs
+#include <algorithm>
+
+// Stops long chains of portals from taking too long
+const PUi32 maxPortalDepth = 16;
+
+// Limit the views into one cell, after this the cell uses the full camera view
+const PUi32 maxCellViews = 8;
+
+PPortalGraph::PPortalGraph()
+{
+	m_ViewProjection = glm::mat4(1.0f);
+	m_CameraPosition = glm::vec3(0.0f);
+	m_VisibleCellCount = 0;
+	m_PortalMargin = 0.5f;
+}
+
+PUi32 PPortalGraph::AddCell(const PString& name, const PSBounds& bounds)
+{
+	PSCell newCell;
+	newCell.name = name;
+	newCell.bounds = bounds;
+
+	m_Cells.push_back(newCell);
+	m_CellViews.emplace_back();
+	m_CellOnPath.push_back(false);
+
+	return static_cast<PUi32>(m_Cells.size() - 1);
+}
+
+int PPortalGraph::AddPortal(const PUi32& cellA, const PUi32& cellB, const TArray<glm::vec3>& points)
+{
+	if (cellA >= m_Cells.size() || cellB >= m_Cells.size() || cellA == cellB)
+	{
+		PDebug::Log("Portal cells don't exist: " + std::to_string(cellA) + ", " + std::to_string(cellB), LT_WARN);
+		return -1;
+	}
+
+	if (points.size() < 3)
+	{
+		PDebug::Log("Portal needs at least 3 points", LT_WARN);
+		return -1;
+	}
+
+	PSPortal newPortal;
+	newPortal.points = points;
+	newPortal.cellA = cellA;
+	newPortal.cellB = cellB;
+
+	for (const auto& point : points)
+		newPortal.bounds.AddPoint(point);
+
+	newPortal.bounds.UpdateSphere();
+
+	const PUi32 portalIndex = static_cast<PUi32>(m_Portals.size());
+	m_Portals.push_back(newPortal);
+
+	m_Cells[cellA].portals.push_back(portalIndex);
+	m_Cells[cellB].portals.push_back(portalIndex);
+
+	return static_cast<int>(portalIndex);
+}
+
+void PPortalGraph::SetPortalOpen(const PUi32& portalIndex, const bool& isOpen)
+{
+	if (portalIndex >= m_Portals.size())
+	{
+		PDebug::Log("No portal exists at that index: " + std::to_string(portalIndex), LT_WARN);
+		return;
+	}
+
+	m_Portals[portalIndex].isOpen = isOpen;
+}
+
+bool PPortalGraph::IsPortalOpen(const PUi32& portalIndex) const
+{
+	return portalIndex < m_Portals.size() && m_Portals[portalIndex].isOpen;
+}
+
+int PPortalGraph::FindCell(const glm::vec3& point) const
+{
+	int bestCell = -1;
+	float bestVolume = FLT_MAX;
+
+	// Cells can overlap at doorways so use the smallest one
+	for (PUi32 i = 0; i < m_Cells.size(); ++i)
+	{
+		const PSBounds& bounds = m_Cells[i].bounds;
+
+		if (glm::any(glm::lessThan(point, bounds.min)) || glm::any(glm::greaterThan(point, bounds.max)))
+			continue;
+
+		const glm::vec3 size = bounds.max - bounds.min;
+		const float volume = size.x * size.y * size.z;
+
+		if (volume < bestVolume)
+		{
+			bestVolume = volume;
+			bestCell = static_cast<int>(i);
+		}
+	}
+
+	return bestCell;
+}
+
+bool PPortalGraph::UpdateVisibility(const glm::vec3& cameraPosition, const glm::mat4& viewProjection)
+{
+	for (auto& views : m_CellViews)
+		views.clear();
+
+	m_VisibleCellCount = 0;
+	m_CameraPosition = cameraPosition;
+	m_ViewProjection = viewProjection;
+	m_CameraFrustum.FromMatrix(viewProjection);
+
+	const int cameraCell = FindCell(cameraPosition);
+
+	if (cameraCell < 0)
+		return false;
+
+	// Start with the whole screen
+	VisitCell(static_cast<PUi32>(cameraCell), m_CameraFrustum, glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f), 0);
+
+	return true;
+}
+
+bool PPortalGraph::IsCellVisible(const int& cellIndex) const
+{
+	if (cellIndex < 0 || cellIndex >= static_cast<int>(m_CellViews.size()))
+		return false;
+
+	return !m_CellViews[cellIndex].empty();
+}
+
+bool PPortalGraph::TestBounds(const int& cellIndex, const PSBounds& bounds) const
+{
+	if (!IsCellVisible(cellIndex))
+		return false;
+
+	for (const auto& view : m_CellViews[cellIndex])
+	{
+		if (view.TestBounds(bounds) != FR_OUTSIDE)
+			return true;
+	}
+
+	return false;
+}
+
+void PPortalGraph::VisitCell(const PUi32& cellIndex, const PSFrustum& frustum, const glm::vec4& rect, const PUi32& depth)
+{
+	AddCellView(cellIndex, frustum);
+
+	if (depth >= maxPortalDepth)
+		return;
+
+	m_CellOnPath[cellIndex] = true;
+
+	for (const PUi32& portalIndex : m_Cells[cellIndex].portals)
+	{
+		const PSPortal& portal = m_Portals[portalIndex];
+		const PUi32 nextCell = portal.cellA == cellIndex ? portal.cellB : portal.cellA;
+
+		if (!portal.isOpen || m_CellOnPath[nextCell])
+			continue;
+
+		// Standing in the doorway, the near plane would cut the portal away
+		// so look into the next cell with the same view
+		const glm::vec3 marginMin = portal.bounds.min - glm::vec3(m_PortalMargin);
+		const glm::vec3 marginMax = portal.bounds.max + glm::vec3(m_PortalMargin);
+
+		if (glm::all(glm::greaterThanEqual(m_CameraPosition, marginMin)) && glm::all(glm::lessThanEqual(m_CameraPosition, marginMax)))
+		{
+			VisitCell(nextCell, frustum, rect, depth + 1);
+			continue;
+		}
+
+		// Only the part of the portal inside the current view can be looked through
+		TArray<glm::vec3> polygon = portal.points;
+		ClipPolygon(frustum, polygon);
+
+		if (polygon.size() < 3)
+			continue;
+
+		// Find the screen area of what is left of the portal
+		glm::vec4 portalRect(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		for (const auto& point : polygon)
+		{
+			const glm::vec4 clip = m_ViewProjection * glm::vec4(point, 1.0f);
+
+			// Clipping by the near plane keeps w above 0
+			const glm::vec2 screen = glm::vec2(clip) / glm::max(clip.w, 1e-6f);
+
+			portalRect.x = glm::min(portalRect.x, screen.x);
+			portalRect.y = glm::min(portalRect.y, screen.y);
+			portalRect.z = glm::max(portalRect.z, screen.x);
+			portalRect.w = glm::max(portalRect.w, screen.y);
+		}
+
+		// Can only get smaller than the view it was seen through
+		portalRect.x = glm::max(portalRect.x, rect.x);
+		portalRect.y = glm::max(portalRect.y, rect.y);
+		portalRect.z = glm::min(portalRect.z, rect.z);
+		portalRect.w = glm::min(portalRect.w, rect.w);
+
+		if (portalRect.x >= portalRect.z || portalRect.y >= portalRect.w)
+			continue;
+
+		// Squash the screen area of the portal to fill the screen
+		// The frustum of the new matrix only covers the portal
+		const glm::vec2 rectCenter = (glm::vec2(portalRect.x, portalRect.y) + glm::vec2(portalRect.z, portalRect.w)) * 0.5f;
+		const glm::vec2 rectHalfSize = (glm::vec2(portalRect.z, portalRect.w) - glm::vec2(portalRect.x, portalRect.y)) * 0.5f;
+
+		glm::mat4 rectMatrix(1.0f);
+		rectMatrix[0][0] = 1.0f / rectHalfSize.x;
+		rectMatrix[1][1] = 1.0f / rectHalfSize.y;
+		rectMatrix[3][0] = -rectCenter.x / rectHalfSize.x;
+		rectMatrix[3][1] = -rectCenter.y / rectHalfSize.y;
+
+		PSFrustum portalFrustum;
+		portalFrustum.FromMatrix(rectMatrix * m_ViewProjection);
+
+		VisitCell(nextCell, portalFrustum, portalRect, depth + 1);
+	}
+
+	m_CellOnPath[cellIndex] = false;
+}
+
+void PPortalGraph::AddCellView(const PUi32& cellIndex, const PSFrustum& frustum)
+{
+	TArray<PSFrustum>& views = m_CellViews[cellIndex];
+
+	if (views.empty())
+		++m_VisibleCellCount;
+
+	if (views.size() < maxCellViews)
+	{
+		views.push_back(frustum);
+		return;
+	}
+
+	// Too many ways in, the full camera view is always safe to use
+	views.resize(1);
+	views[0] = m_CameraFrustum;
+}
+
+void PPortalGraph::ClipPolygon(const PSFrustum& frustum, TArray<glm::vec3>& polygon)
+{
+	TArray<glm::vec3> clipped;
+
+	// Clip against the left, right, bottom, top and near planes
+	// The far plane can't make a portal smaller in a useful way
+	for (int planeIndex = 0; planeIndex < 5 && polygon.size() >= 3; ++planeIndex)
+	{
+		const glm::vec4 plane = frustum.GetPlane(planeIndex);
+		clipped.clear();
+
+		for (size_t i = 0; i < polygon.size(); ++i)
+		{
+			const glm::vec3& current = polygon[i];
+			const glm::vec3& next = polygon[(i + 1) % polygon.size()];
+
+			const float currentDist = glm::dot(glm::vec3(plane), current) + plane.w;
+			const float nextDist = glm::dot(glm::vec3(plane), next) + plane.w;
+
+			if (currentDist >= 0.0f)
+				clipped.push_back(current);
+
+			// The edge crosses the plane so add the point where it crosses
+			if ((currentDist >= 0.0f) != (nextDist >= 0.0f))
+			{
+				const float t = currentDist / (currentDist - nextDist);
+				clipped.push_back(current + (next - current) * t);
+			}
+		}
+
+		polygon.swap(clipped);
+	}
+}
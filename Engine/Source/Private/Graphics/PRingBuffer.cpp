@@ -0,0 +1,205 @@
+#include "Graphics/PRingBuffer.h"
+#include "Graphics/PGLState.h"
+
+// External Libs
+#include <GLEW/glew.h>
+
+// System Libs
+#include <algorithm>
+#include <chrono>
+
+// Longest time to wait for the GPU to finish with a region in nanoseconds
+const PUi64 ringWaitTimeout = 1000000000ULL;
+
+PRingBuffer::PRingBuffer()
+{
+	m_Buffer = 0;
+	m_Data = nullptr;
+	m_FrameSize = 0;
+	m_FrameCount = 0;
+	m_FrameIndex = 0;
+	m_FrameUsed = 0;
+	m_HasOverflowed = false;
+	m_HasWaited = false;
+	m_WaitTime = 0.0;
+	m_WaitCount = 0;
+}
+
+PRingBuffer::~PRingBuffer()
+{
+	DestroyStorage();
+}
+
+bool PRingBuffer::Init(const PUi64& frameSize, const PUi32& frameCount)
+{
+	// Persistent mapping requires open gl 4.4
+	if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+	{
+		PDebug::Log("Ring buffer requires open gl 4.4 for persistent mapping", LT_WARN);
+		return false;
+	}
+
+	m_FrameSize = frameSize;
+	m_FrameCount = std::max(frameCount, 1U);
+
+	return CreateStorage();
+}
+
+void PRingBuffer::BeginFrame()
+{
+	m_HasWaited = false;
+	m_WaitTime = 0.0;
+
+	if (!IsValid())
+		return;
+
+	// Double the regions if the last frame didn't fit, the GPU must be done with every region first
+	if (m_HasOverflowed)
+	{
+		m_HasOverflowed = false;
+
+		DestroyStorage();
+		m_FrameSize *= 2;
+
+		if (!CreateStorage())
+			return;
+
+		PDebug::Log("Ring buffer grew to " + std::to_string(m_FrameSize / 1024) + " KB per frame", LT_WARN);
+	}
+
+	m_FrameIndex = (m_FrameIndex + 1) % m_FrameCount;
+	m_FrameUsed = 0;
+
+	GLsync& fence = m_Fences[m_FrameIndex];
+
+	if (fence == nullptr)
+		return;
+
+	// The GPU is usually a frame or two behind so the fence has normally already passed
+	const GLenum result = glClientWaitSync(fence, 0, 0);
+
+	if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+	{
+		glDeleteSync(fence);
+		fence = nullptr;
+		return;
+	}
+
+	// The CPU has got a whole ring ahead of the GPU
+	const auto startTime = std::chrono::steady_clock::now();
+
+	WaitFence(fence);
+
+	m_HasWaited = true;
+	m_WaitTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	++m_WaitCount;
+}
+
+void PRingBuffer::EndFrame()
+{
+	if (!IsValid() || m_FrameUsed == 0)
+		return;
+
+	m_Fences[m_FrameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool PRingBuffer::Allocate(const PUi64& size, const PUi64& alignment, PSRingAllocation& outAllocation)
+{
+	if (!IsValid())
+		return false;
+
+	const PUi64 regionStart = static_cast<PUi64>(m_FrameIndex) * m_FrameSize;
+
+	// Align the offset in the whole buffer, binding a range checks the offset not the position in the region
+	const PUi64 start = regionStart + m_FrameUsed;
+	const PUi64 offset = (start + alignment - 1) / alignment * alignment;
+
+	if (offset + size > regionStart + m_FrameSize)
+	{
+		m_HasOverflowed = true;
+		return false;
+	}
+
+	outAllocation.data = m_Data + offset;
+	outAllocation.offset = offset;
+	outAllocation.size = size;
+
+	m_FrameUsed = offset + size - regionStart;
+
+	return true;
+}
+
+bool PRingBuffer::CreateStorage()
+{
+	glCreateBuffers(1, &m_Buffer);
+
+	if (m_Buffer == 0)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Ring buffer failed to create buffer: " + errorMsg, LT_WARN);
+		return false;
+	}
+
+	// Coherent so the writes are seen by the GPU without flushing each range
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr bufferSize = static_cast<GLsizeiptr>(m_FrameSize * m_FrameCount);
+
+	glNamedBufferStorage(m_Buffer, bufferSize, nullptr, flags);
+	m_Data = static_cast<PUi8*>(glMapNamedBufferRange(m_Buffer, 0, bufferSize, flags));
+
+	if (m_Data == nullptr)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Ring buffer failed to map buffer: " + errorMsg, LT_WARN);
+
+		PGLState::GetState().DeleteBuffer(m_Buffer);
+		return false;
+	}
+
+	m_Fences.assign(m_FrameCount, nullptr);
+	m_FrameIndex = 0;
+	m_FrameUsed = 0;
+
+	return true;
+}
+
+void PRingBuffer::DestroyStorage()
+{
+	// The GPU may still be reading the buffer
+	for (auto& fence : m_Fences)
+	{
+		if (fence != nullptr)
+			WaitFence(fence);
+	}
+
+	m_Fences.clear();
+
+	// Deleting the buffer also unmaps it
+	PGLState::GetState().DeleteBuffer(m_Buffer);
+	m_Data = nullptr;
+}
+
+bool PRingBuffer::WaitFence(GLsync& fence)
+{
+	// Flush on the first wait so the fence can't be stuck in the command queue
+	GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	GLenum result = GL_TIMEOUT_EXPIRED;
+
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(fence, waitFlags, ringWaitTimeout);
+		waitFlags = 0;
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+
+	if (result == GL_WAIT_FAILED)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Ring buffer failed to wait for the GPU: " + errorMsg, LT_WARN);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,185 @@
+#include "Graphics/PShaderCache.h"
+#include "Debug/PDebug.h"
+#include "IO/PMappedFile.h"
+#include "Math/PSHash.h"
+
+// External Libs
+#include <GLEW/glew.h>
+
+// System Libs
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Folder the cached binaries are written to
+const char* const cachedFolder = "Cache/Shaders/";
+
+// "PSHD" read as little endian
+const PUi32 cachedMagic = 0x44485350;
+
+// Change this whenever the cached layout changes
+const PUi32 cachedVersion = 1;
+
+// Start of every cached binary file, the binary follows it
+struct PSCachedShaderHeader
+{
+	PUi32 magic;
+	PUi32 version;
+
+	// Key made from the sources, defines and driver
+	PUi64 key;
+
+	// Size of the whole file, catches files that were only partly written
+	PUi64 fileSize;
+
+	// Format open gl gave the binary in
+	PUi32 binaryFormat;
+	PUi32 binarySize;
+};
+
+// Get an open gl string, drivers without it give an empty string
+static PString GetGLString(const GLenum& name)
+{
+	const GLubyte* value = glGetString(name);
+	return value != nullptr ? reinterpret_cast<const char*>(value) : "";
+}
+
+bool PShaderCache::IsSupported()
+{
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+		return false;
+
+	// Some drivers support the calls but have no formats to save in
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	return formatCount > 0;
+}
+
+PUi64 PShaderCache::MakeKey(const PString& vShaderSource, const PString& fShaderSource, const PString& defines)
+{
+	PUi64 key = PSHash::FNV1a(&cachedVersion, sizeof(cachedVersion));
+
+	// Sizes are hashed between the strings so moving text from one to the next changes the key
+	for (const PString& text : { vShaderSource, fShaderSource, defines,
+		GetGLString(GL_VENDOR), GetGLString(GL_RENDERER), GetGLString(GL_VERSION) })
+	{
+		const PUi64 size = text.size();
+		key = PSHash::FNV1a(&size, sizeof(size), key);
+		key = PSHash::FNV1a(text.data(), text.size(), key);
+	}
+
+	// 0 is used to say there is no key
+	return key != 0 ? key : 1;
+}
+
+PString PShaderCache::GetCachedPath(const PUi64& key)
+{
+	char keyText[17];
+	snprintf(keyText, sizeof(keyText), "%016llx", static_cast<unsigned long long>(key));
+
+	return cachedFolder + PString(keyText) + ".pshader";
+}
+
+bool PShaderCache::Load(const PUi32& program, const PUi64& key)
+{
+	const PString cachedPath = GetCachedPath(key);
+	PMappedFile file;
+
+	// Not cached yet
+	if (!file.Open(cachedPath))
+		return false;
+
+	const PUi8* data = file.GetData();
+	const PUi64 fileSize = file.GetSize();
+
+	if (fileSize < sizeof(PSCachedShaderHeader))
+	{
+		PDebug::Log("Cached shader binary is too small: " + cachedPath, LT_WARN);
+		return false;
+	}
+
+	PSCachedShaderHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != cachedMagic || header.version != cachedVersion || header.key != key
+		|| header.fileSize != fileSize || header.binarySize != fileSize - sizeof(header))
+	{
+		PDebug::Log("Cached shader binary is not valid and will be compiled again: " + cachedPath, LT_WARN);
+		return false;
+	}
+
+	glProgramBinary(program, header.binaryFormat, data + sizeof(header), static_cast<GLsizei>(header.binarySize));
+
+	// The driver rejects binaries it can't use by failing the link
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+	if (!success)
+	{
+		PDebug::Log("Cached shader binary was rejected by the driver and will be compiled again: " + cachedPath, LT_WARN);
+		return false;
+	}
+
+	return true;
+}
+
+bool PShaderCache::Save(const PUi32& program, const PUi64& key)
+{
+	const PString cachedPath = GetCachedPath(key);
+
+	GLint binarySize = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+
+	if (binarySize <= 0)
+	{
+		PDebug::Log("Shader program has no binary to cache: " + cachedPath, LT_WARN);
+		return false;
+	}
+
+	// Read the binary straight in after the header
+	TArray<PUi8> file(sizeof(PSCachedShaderHeader) + static_cast<size_t>(binarySize));
+
+	GLenum binaryFormat = 0;
+	GLsizei writtenSize = 0;
+	glGetProgramBinary(program, binarySize, &writtenSize, &binaryFormat, file.data() + sizeof(PSCachedShaderHeader));
+
+	if (writtenSize <= 0)
+	{
+		PDebug::Log("Failed to get the shader program binary: " + cachedPath, LT_WARN);
+		return false;
+	}
+
+	file.resize(sizeof(PSCachedShaderHeader) + static_cast<size_t>(writtenSize));
+
+	PSCachedShaderHeader header;
+	header.magic = cachedMagic;
+	header.version = cachedVersion;
+	header.key = key;
+	header.fileSize = file.size();
+	header.binaryFormat = binaryFormat;
+	header.binarySize = static_cast<PUi32>(writtenSize);
+	std::memcpy(file.data(), &header, sizeof(header));
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(cachedPath).parent_path(), error);
+
+	std::ofstream stream(cachedPath, std::ios::binary | std::ios::trunc);
+
+	if (!stream.is_open())
+	{
+		PDebug::Log("Failed to open cached shader binary for writing: " + cachedPath, LT_WARN);
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+
+	if (!stream.good())
+	{
+		PDebug::Log("Failed to write cached shader binary: " + cachedPath, LT_WARN);
+		return false;
+	}
+
+	return true;
+}
@@ -4,7 +4,8 @@
 #include "Graphics/PTexture.h"
 #include "Graphics/PSCamera.h"
 #include "Graphics/PSLight.h"
-#include "Graphics/PSMaterial.h"
+#include "Graphics/PGLState.h"
+#include "Graphics/PShaderCache.h"
 
 // External Libs
 #include <GLEW/glew.h>
@@ -13,25 +14,94 @@
 // System Libs
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 #define LGET_GLEW_ERROR reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
 
 // Constant value for light amounts
 const PUi32 maxDirLights = 2;
-const PUi32 maxPointLights = 20;
+
+// Texture units each sampler reads from
+const int baseColourUnit = 0;
+const int specularUnit = 1;
+const int baseColourArrayUnit = 2;
+const int specularArrayUnit = 3;
+
+PUi64 PSShaderKeywords::GetKey() const
+{
+	// Light counts are far below 16 bits so every set of keywords packs into its own number
+	return static_cast<PUi64>(dirLights)
+		| static_cast<PUi64>(hasPointLights) << 16
+		| static_cast<PUi64>(hasSpecularMap) << 32
+		| static_cast<PUi64>(hasVertexColours) << 33;
+}
+
+PString PSShaderKeywords::ToDefines() const
+{
+	return "#define NUM_DIR_LIGHTS " + std::to_string(dirLights) + "\n"
+		+ "#define HAS_POINT_LIGHTS " + std::to_string(hasPointLights ? 1 : 0) + "\n"
+		+ "#define HAS_SPECULAR_MAP " + std::to_string(hasSpecularMap ? 1 : 0) + "\n"
+		+ "#define HAS_VERTEX_COLOURS " + std::to_string(hasVertexColours ? 1 : 0) + "\n";
+}
+
+void PSShaderKeywords::SetLightCounts(const TArray<TShared<PSLight>>& lights)
+{
+	dirLights = 0;
+	hasPointLights = false;
+
+	for (const auto& light : lights)
+	{
+		if (std::dynamic_pointer_cast<PSDirLight>(light))
+			++dirLights;
+		else if (std::dynamic_pointer_cast<PSPointLight>(light))
+			hasPointLights = true;
+	}
+
+	// Lights past the most the shader supports are ignored by SetLights() anyway
+	dirLights = std::min(dirLights, maxDirLights);
+}
 
 PShaderProgram::PShaderProgram()
 {
 	m_ProgramID = 0;
+	m_LoadState = LS_NONE;
+	m_IsFromCache = false;
+	m_CacheKey = 0;
+	m_InitTime = 0.0;
 }
 
 PShaderProgram::~PShaderProgram()
 {
-	PDebug::Log("Shader program " + std::to_string(m_ProgramID) + " destroyed");
+	PGLState::GetState().DeleteProgram(m_ProgramID);
+	PDebug::Log("Shader program destroyed");
+}
+
+bool PShaderProgram::InitShader(const PString& vShaderPath, const PString& fShaderPath, const PString& defines)
+{
+	// Store the file paths
+	m_FilePath[ST_VERTEX] = vShaderPath;
+	m_FilePath[ST_FRAGMENT] = fShaderPath;
+
+	// Convert the shaders to strings
+	const PString vShaderSource = ConvertFileToString(vShaderPath);
+	const PString fShaderSource = ConvertFileToString(fShaderPath);
+
+	// Make sure both files were read
+	if (vShaderSource.empty() || fShaderSource.empty())
+	{
+		// Error that the string failed to import
+		PDebug::Log("Shader failed to import", LT_ERROR);
+		return false;
+	}
+
+	return InitShaderSource(vShaderSource, fShaderSource, defines);
 }
 
-bool PShaderProgram::InitShader(const PString& vShaderPath, const PString& fShaderPath)
+bool PShaderProgram::InitShaderSource(const PString& vShaderSource, const PString& fShaderSource, const PString& defines, const bool& async)
 {
+	m_StartTime = std::chrono::steady_clock::now();
+	m_LoadState = LS_LOADING;
+
 	// Create the shader program in open gl
 	m_ProgramID = glCreateProgram();
 
@@ -40,22 +110,66 @@ bool PShaderProgram::InitShader(const PString& vShaderPath, const PString& fShad
 	{
 		const std::string errorMessage = LGET_GLEW_ERROR;
 		PDebug::Log("Shader failed to initialise, couldn't create program: " + errorMessage);
+		m_LoadState = LS_FAILED;
 		return false;
 	}
 
-	// If either of the shaders fail to import then fail the whole program
-	if (!ImportShaderByType(vShaderPath, ST_VERTEX) || !ImportShaderByType(fShaderPath, ST_FRAGMENT))
+	// Use the binary linked by an earlier launch if the sources, defines and driver all match
+	const bool useCache = PShaderCache::IsSupported();
+	m_CacheKey = useCache ? PShaderCache::MakeKey(vShaderSource, fShaderSource, defines) : 0;
+
+	m_IsFromCache = useCache && PShaderCache::Load(m_ProgramID, m_CacheKey);
+
+	if (m_IsFromCache)
+		return FinishLink();
+
+	// If either of the shaders fail to compile then fail the whole program
+	if (!CompileShaderByType(vShaderSource, ST_VERTEX, defines) || !CompileShaderByType(fShaderSource, ST_FRAGMENT, defines))
 	{
-		PDebug::Log("Shader program failed to initialise, couldn't import shaders");
+		PDebug::Log("Shader program failed to initialise, couldn't compile shaders");
+		m_LoadState = LS_FAILED;
 		return false;
 	}
 
-	return LinkToGPU();
+	// Ask the driver to keep the binary so it can be cached after linking
+	if (useCache)
+		glProgramParameteri(m_ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	LinkToGPU();
+
+	// Without parallel compiling the first status query would wait for the driver anyway
+	if (async && IsParallelCompileSupported())
+		return true;
+
+	return FinishLink();
+}
+
+bool PShaderProgram::UpdateLoad(const bool& wait)
+{
+	if (m_LoadState != LS_LOADING)
+		return false;
+
+	// Ask if the driver's compiler threads are done without waiting for them
+	GLint isComplete = GL_TRUE;
+
+	if (!wait && IsParallelCompileSupported())
+		glGetProgramiv(m_ProgramID, GL_COMPLETION_STATUS_KHR, &isComplete);
+
+	if (!isComplete)
+		return false;
+
+	FinishLink();
+	return true;
+}
+
+bool PShaderProgram::IsParallelCompileSupported()
+{
+	return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
 }
 
 void PShaderProgram::Activate()
 {
-	glUseProgram(m_ProgramID);
+	PGLState::GetState().UseProgram(m_ProgramID);
 }
 
 void PShaderProgram::SetMeshTransform(const glm::mat4& matTransform)
@@ -70,41 +184,32 @@ void PShaderProgram::SetMeshTransform(const glm::mat4& matTransform)
 
 void PShaderProgram::SetModelTransform(const PSTransform& transform)
 {
-	// Translate (move) > rotate > scale (this allows us to rotate around the new location)
-	// Initialise a default matrix transform
-	glm::mat4 matrixT = glm::mat4(1.0f);
-
-	// Translate the matrix
-	matrixT = glm::translate(matrixT, transform.position);
-
-	// Rotate per axis
-	matrixT = glm::rotate(matrixT, glm::radians(transform.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-	matrixT = glm::rotate(matrixT, glm::radians(transform.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-	matrixT = glm::rotate(matrixT, glm::radians(transform.rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-
-	// Scale the matrix
-	matrixT = glm::scale(matrixT, transform.scale);
+	// Convert the transform into a model matrix
+	SetModelTransform(transform.GetMatrix());
+}
 
+void PShaderProgram::SetModelTransform(const glm::mat4& matTransform)
+{
 	// Find the variable in the shader
 	// All uniform variables are given an ID by gl
 	const int varID = glGetUniformLocation(m_ProgramID, "model");
 
 	// Update the value
-	glUniformMatrix4fv(varID, 1, GL_FALSE, value_ptr(matrixT));
+	glUniformMatrix4fv(varID, 1, GL_FALSE, value_ptr(matTransform));
 }
 
-void PShaderProgram::SetWorldTransform(const TShared<PSCamera>& camera)
+void PShaderProgram::SetPositionDecode(const glm::vec3& offset, const glm::vec3& scale)
 {
-	// Initialise a matrix
-	glm::mat4 matrixT = glm::mat4(1.0f);
+	// Find the variables in the shader and update them
+	glUniform3fv(glGetUniformLocation(m_ProgramID, "positionOffset"), 1, glm::value_ptr(offset));
+	glUniform3fv(glGetUniformLocation(m_ProgramID, "positionScale"), 1, glm::value_ptr(scale));
+}
 
+void PShaderProgram::SetWorldTransform(const TShared<PSCamera>& camera)
+{
 	// HANDLE THE VIEW MATRIX
 	// Translate  and rotate the matrix based on the camera position
-	matrixT = glm::lookAt(
-		camera->transform.position,
-		camera->transform.position + camera->transform.Forward(),
-		camera->transform.Up()
-	);
+	glm::mat4 matrixT = camera->GetViewMatrix();
 
 	// Find the variable in the shader and update it
 	int varID = glGetUniformLocation(m_ProgramID, "view");
@@ -114,11 +219,7 @@ void PShaderProgram::SetWorldTransform(const TShared<PSCamera>& camera)
 
 	// HANDLE THE PROJECTION MATRIX
 	// Set the projectino matrix to a perspective view
-	matrixT = glm::perspective(glm::radians(
-		camera->fov), // The zoom of your camera
-		camera->aspectRatio, // How wide the view is
-		camera->nearClip, // How close you can see 3D models
-		camera->farClip); // How far you can see 3D models - all other models woll not render
+	matrixT = camera->GetProjectionMatrix();
 
 	// Find the variable in the shader for the projection matrix
 	varID = glGetUniformLocation(m_ProgramID, "projection");
@@ -130,11 +231,9 @@ void PShaderProgram::SetWorldTransform(const TShared<PSCamera>& camera)
 void PShaderProgram::SetLights(const TArray<TShared<PSLight>>& lights)
 {
 	PUi32 dirLights = 0;
-	PUi32 pointLights = 0;
 	int varID = 0;
 
 	// Name of the variable array
-	// Will set in the loop depending on the light type
 	PString lightIndexStr = "";
 
 	// Loop through all of the lights and add them to the shader
@@ -185,127 +284,20 @@ void PShaderProgram::SetLights(const TArray<TShared<PSLight>>& lights)
 
 			// Increase the dirLights count
 			++dirLights;
-			continue;
-		}
-
-		if (const TShared<PSPointLight>& lightRef = std::dynamic_pointer_cast<PSPointLight>(lights[i]))
-		{
-			// Ensure only max lights
-			if (pointLights >= maxPointLights)
-			{
-				continue;
-			}
-
-			// Add a dirLight and use as index
-			lightIndexStr = "pointLights[" + std::to_string(pointLights) + "]";
-
-			// COLOUR
-			// Get the colour variable from the dir light struct in the shader
-			varID = glGetUniformLocation(m_ProgramID,
-				(lightIndexStr + ".colour").c_str());
-
-			// Change the colour
-			glUniform3fv(varID, 1, glm::value_ptr(lightRef->colour));
-
-			// POSITION
-			// Get the shader variable ID
-			varID = glGetUniformLocation(m_ProgramID,
-				(lightIndexStr + ".position").c_str());
-
-			// Update the shader value
-			glUniform3fv(varID, 1, glm::value_ptr(lightRef->position));
-
-			// INTENSITY
-			// Get the intensity variable from the fir light struct in the shader
-			varID = glGetUniformLocation(m_ProgramID,
-				(lightIndexStr + ".intensity").c_str());
-
-			// Change the intensity
-			glUniform1f(varID, lightRef->intensity);
-
-			// LINEAR ATTENUATION
-			// Get the variable ID
-			varID = glGetUniformLocation(m_ProgramID, (lightIndexStr + ".linear").c_str());
-
-			// Change the value
-			glUniform1f(varID, lightRef->linear);
-
-			// QUADRATIC ATTENUATION
-			// Get the variable ID
-			varID = glGetUniformLocation(m_ProgramID, (lightIndexStr + ".quadratic").c_str());
-
-			// Change the value
-			glUniform1f(varID, lightRef->quadratic);
-
-			// Increment the point light index
-			++pointLights;
-			
 		}
 	}
 }
 
-void PShaderProgram::SetMaterial(const TShared<PSMaterial>& material)
+bool PShaderProgram::CompileShaderByType(const PString& source, PEShaderType shaderType, const PString& defines)
 {
-	if (material == nullptr)
-	{
-		return;
-	}
-
-	// The ID for the variable in the shader
-	int varID = 0;
-
-	// BASE COLOUR (DIFFUSE)
-	if (material->m_BaseColourMap)
-	{
-		// Bind the texture to the 0 index
-		material->m_BaseColourMap->BindTexture(0);
-
-		// Get the base colour map id
-		varID = glGetUniformLocation(m_ProgramID, "material.baseColourMap");
-
-		// Update the shader
-		glUniform1i(varID, 0);
-	}
-
-	// SPECULAR MAP
-	if (material->m_SpecularMap)
-	{
-		// Bind the texture to the 1 index
-		material->m_SpecularMap->BindTexture(1);
+	// #version has to stay the first line so the defines go straight after it
+	// #line puts the line numbers in compile errors back to the lines of the file
+	PString shaderStr = source;
+	const size_t versionPos = source.find("#version");
+	const size_t versionEnd = versionPos == PString::npos ? PString::npos : source.find('\n', versionPos);
 
-		// Get the specular map id
-		varID = glGetUniformLocation(m_ProgramID, "material.specularMap");
-
-		glUniform1f(varID, 1);
-	}
-
-	// SHININESS
-	// Get the base colour map id
-	varID = glGetUniformLocation(m_ProgramID, "material.shininess");
-
-	// Update the shader
-	glUniform1f(varID, material->shininess);
-
-	// SPECULAR STRENGTH
-	// Get the base colour map id
-	varID = glGetUniformLocation(m_ProgramID, "material.specularStrength");
-
-	// Update the shader
-	glUniform1f(varID, material->specularStrength);
-}
-
-bool PShaderProgram::ImportShaderByType(const PString& filePath, PEShaderType shaderType)
-{
-	// Convert the shader to a string
-	const PString shaderStr = ConvertFileToString(filePath);
-
-	// Make sure there is a string path
-	if (shaderStr.empty())
-	{
-		// Error that the string failed to import
-		PDebug::Log("Shader failed to import", LT_ERROR);
-		return false;
-	}
+	if (!defines.empty() && versionEnd != PString::npos)
+		shaderStr = source.substr(0, versionEnd + 1) + defines + "#line 2\n" + source.substr(versionEnd + 1);
 
 	// Set and create an ID for the shader based on the shader type
 	switch (shaderType)
@@ -330,27 +322,11 @@ bool PShaderProgram::ImportShaderByType(const PString& filePath, PEShaderType sh
 	}
 
 	// Compile the shader onto the GPU
+	// The compile status isn't read here so the driver can keep compiling while the other shader is sent
 	const char* shaderCStr = shaderStr.c_str();
 	glShaderSource(m_ShaderIDs[shaderType], 1, &shaderCStr, nullptr);
 	glCompileShader(m_ShaderIDs[shaderType]);
 
-	// Test if the compile worked
-	GLint success;
-	glGetShaderiv(m_ShaderIDs[shaderType], GL_COMPILE_STATUS, &success);
-
-	if (!success)
-	{
-		// Create an empty log
-		char infoLog[512];
-			
-		// Fill the log with info from gl about what happened
-		glGetShaderInfoLog(m_ShaderIDs[shaderType], 512, nullptr, infoLog);
-
-		// Log it
-		PDebug::Log("Shader compilation error: " + PString(infoLog), LT_ERROR);
-		return false;
-	}
-
 	// Attach the shader to the program ID
 	glAttachShader(m_ProgramID, m_ShaderIDs[shaderType]);
 
@@ -382,13 +358,17 @@ PString PShaderProgram::ConvertFileToString(const PString& filePath)
 	return shaderStream.str();;
 }
 
-bool PShaderProgram::LinkToGPU()
+void PShaderProgram::LinkToGPU()
 {
 	// Link the program to the GPU
+	// With parallel compiling this returns straight away and the driver links on its own threads
 	glLinkProgram(m_ProgramID);
+}
 
-	// Test if the compile worked
-	GLint success;
+bool PShaderProgram::FinishLink()
+{
+	// Test if the compile and link worked, this waits for the driver if it hasn't finished
+	GLint success = GL_FALSE;
 	glGetProgramiv(m_ProgramID, GL_LINK_STATUS, &success);
 
 	if (!success)
@@ -396,15 +376,62 @@ bool PShaderProgram::LinkToGPU()
 		// Create an empty log
 		char infoLog[512];
 
-		// Fill the log with info from gl about what happened
-		glGetShaderInfoLog(m_ProgramID, 512, nullptr, infoLog);
+		// A failed compile also fails the link so log the shader that caused it first
+		for (const PUi32& shaderID : m_ShaderIDs)
+		{
+			if (shaderID == 0)
+				continue;
+
+			GLint compiled = GL_TRUE;
+			glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compiled);
+
+			if (compiled)
+				continue;
+
+			// Fill the log with info from gl about what happened
+			glGetShaderInfoLog(shaderID, 512, nullptr, infoLog);
+			PDebug::Log("Shader compilation error: " + PString(infoLog), LT_ERROR);
+		}
+
+		glGetProgramInfoLog(m_ProgramID, 512, nullptr, infoLog);
 
 		// Log it
 		PDebug::Log("Shader link error: " + PString(infoLog), LT_ERROR);
+		m_LoadState = LS_FAILED;
 		return false;
 	}
 
-	PDebug::Log("Shader successfully initialised and linked at index: " + std::to_string(m_ProgramID));
+	// The program keeps its own copy of the compiled code so the shaders aren't needed anymore
+	for (PUi32& shaderID : m_ShaderIDs)
+	{
+		if (shaderID == 0)
+			continue;
+
+		glDetachShader(m_ProgramID, shaderID);
+		glDeleteShader(shaderID);
+		shaderID = 0;
+	}
+
+	if (!m_IsFromCache && m_CacheKey != 0)
+		PShaderCache::Save(m_ProgramID, m_CacheKey);
+
+	SetSamplerUnits();
+
+	m_InitTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_StartTime).count();
+	m_LoadState = LS_READY;
+
+	PDebug::Log("Shader program " + std::to_string(m_ProgramID) + (m_IsFromCache ? " loaded from binary cache (warm)" : " compiled from source (cold)")
+		+ " in " + std::to_string(m_InitTime) + " ms");
 
 	return true;
 }
+
+void PShaderProgram::SetSamplerUnits()
+{
+	// Give every sampler its own texture unit once, 2D and array samplers can't share a unit
+	// Samplers the shader doesn't have are -1 and ignored
+	glProgramUniform1i(m_ProgramID, glGetUniformLocation(m_ProgramID, "baseColourMap"), baseColourUnit);
+	glProgramUniform1i(m_ProgramID, glGetUniformLocation(m_ProgramID, "specularMap"), specularUnit);
+	glProgramUniform1i(m_ProgramID, glGetUniformLocation(m_ProgramID, "baseColourArray"), baseColourArrayUnit);
+	glProgramUniform1i(m_ProgramID, glGetUniformLocation(m_ProgramID, "specularArray"), specularArrayUnit);
+}
@@ -0,0 +1,105 @@
+#include "Graphics/PShaderVariants.h"
+#include "Debug/PDebug.h"
+
+// System Libs
+#include <algorithm>
+
+bool PShaderVariants::Init(const PString& vShaderPath, const PString& fShaderPath)
+{
+	m_VertexPath = vShaderPath;
+	m_FragmentPath = fShaderPath;
+	m_VertexSource = PShaderProgram::ConvertFileToString(vShaderPath);
+	m_FragmentSource = PShaderProgram::ConvertFileToString(fShaderPath);
+	m_Variants.clear();
+	m_Pending.clear();
+
+	if (m_VertexSource.empty() || m_FragmentSource.empty())
+	{
+		PDebug::Log("Shader variants failed to read " + vShaderPath + " and " + fShaderPath, LT_ERROR);
+		return false;
+	}
+
+	return true;
+}
+
+TShared<PShaderProgram> PShaderVariants::GetVariant(const PSShaderKeywords& keywords, const bool& wait)
+{
+	const PUi64 key = keywords.GetKey();
+	const auto found = m_Variants.find(key);
+	TShared<PShaderProgram> variant = found != m_Variants.end() ? found->second : StartVariant(keywords);
+
+	if (!variant)
+		return nullptr;
+
+	// Finish the compile now if the variant can't wait for Update()
+	if (wait && variant->GetLoadState() == LS_LOADING)
+	{
+		variant->UpdateLoad(true);
+		m_Pending.erase(std::remove(m_Pending.begin(), m_Pending.end(), key), m_Pending.end());
+	}
+
+	if (variant->GetLoadState() == LS_READY)
+		return variant;
+
+	if (variant->GetLoadState() == LS_FAILED)
+	{
+		PDebug::Log("Shader variant failed for " + m_FragmentPath + " with:\n" + keywords.ToDefines(), LT_WARN);
+		m_Variants[key] = nullptr;
+	}
+
+	return nullptr;
+}
+
+void PShaderVariants::WarmUp(const TArray<PSShaderKeywords>& keywords)
+{
+	for (const PSShaderKeywords& variantKeywords : keywords)
+	{
+		if (m_Variants.find(variantKeywords.GetKey()) == m_Variants.end())
+			StartVariant(variantKeywords);
+	}
+}
+
+void PShaderVariants::Update()
+{
+	for (size_t i = 0; i < m_Pending.size();)
+	{
+		TShared<PShaderProgram>& variant = m_Variants[m_Pending[i]];
+
+		if (!variant->UpdateLoad())
+		{
+			++i;
+			continue;
+		}
+
+		// Failed variants are kept as null so draws go straight to the fallback
+		if (variant->GetLoadState() == LS_FAILED)
+		{
+			PDebug::Log("Shader variant failed to compile for " + m_FragmentPath, LT_WARN);
+			variant = nullptr;
+		}
+
+		m_Pending[i] = m_Pending.back();
+		m_Pending.pop_back();
+	}
+}
+
+TShared<PShaderProgram> PShaderVariants::StartVariant(const PSShaderKeywords& keywords)
+{
+	const PUi64 key = keywords.GetKey();
+	TShared<PShaderProgram> variant = TMakeShared<PShaderProgram>();
+
+	// Variants that fail before the driver starts compiling are remembered straight away
+	if (!variant->InitShaderSource(m_VertexSource, m_FragmentSource, keywords.ToDefines(), true))
+	{
+		PDebug::Log("Shader variant failed for " + m_FragmentPath + " with:\n" + keywords.ToDefines(), LT_WARN);
+		variant = nullptr;
+	}
+	else if (variant->GetLoadState() == LS_LOADING)
+	{
+		m_Pending.push_back(key);
+	}
+
+	m_Variants[key] = variant;
+
+	return variant;
+}
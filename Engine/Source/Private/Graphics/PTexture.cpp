@@ -1,131 +1,539 @@
 #include "Graphics/PTexture.h"
+#include "Graphics/PTextureCooker.h"
+#include "Graphics/PUploadQueue.h"
+#include "Graphics/PGLState.h"
+#include "Threading/PThreadPool.h"
 
 // External Libs
 #include <GLEW/glew.h>
 #include <STB_IMAGE/stb_image.h>
 
+// System Libs
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <emmintrin.h>
+
+// Mip maps of a streamed texture no larger than this are always on the GPU
+const PUi32 streamedTailSize = 64;
+
+// Everything a load needs, shared with the worker so it is safe if the texture is destroyed first
+// Streamed textures keep it after the upload as the CPU copy of their levels
+struct PSTextureImport
+{
+    // Custom name of the texture
+    PString fileName;
+
+    // Path of the source image
+    PString path;
+
+    // Set by the worker once the CPU stages have finished
+    std::atomic<bool> isDone = false;
+
+    // If the CPU stages succeeded
+    bool success = false;
+
+    // Cooked file used instead of decoding the image when it matched the source
+    PSCookedTexture cooked;
+
+    // If the texture comes from the cooked file
+    bool isCooked = false;
+
+    // Decoded image and its mip maps one after the other
+    // Always 4 channels so every row is 4 byte aligned
+    TArray<PUi8> pixels;
+
+    // Every mip level, points into the cooked file or the decoded pixels
+    TArray<PSCookedTextureLevel> levels;
+
+    // Amount of channels in the source image
+    int channels = 0;
+
+    // When the load started
+    std::chrono::steady_clock::time_point startTime;
+
+    // Time spent reading and decoding on the CPU in milliseconds
+    double loadTime = 0.0;
+};
+
+// Expand RGB pixels to RGBA with an alpha of 255
+// Each group of 4 pixels is shifted into its own 32 bit lanes with SSE2
+static void ExpandRGBToRGBA(const PUi8* rgb, PUi8* rgba, const PUi64& pixelCount)
+{
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    const __m128i lane0 = _mm_set_epi32(0, 0, 0, 0x00FFFFFF);
+    const __m128i lane1 = _mm_set_epi32(0, 0, 0x00FFFFFF, 0);
+    const __m128i lane2 = _mm_set_epi32(0, 0x00FFFFFF, 0, 0);
+    const __m128i lane3 = _mm_set_epi32(0x00FFFFFF, 0, 0, 0);
+
+    PUi64 i = 0;
+
+    // Each load reads 16 bytes but only uses 12, stop early so the last load stays inside the image
+    for (; i + 6 <= pixelCount; i += 4)
+    {
+        const __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3));
+
+        // Pixel n starts at byte 3n and needs to start at byte 4n
+        __m128i result = _mm_and_si128(source, lane0);
+        result = _mm_or_si128(result, _mm_and_si128(_mm_slli_si128(source, 1), lane1));
+        result = _mm_or_si128(result, _mm_and_si128(_mm_slli_si128(source, 2), lane2));
+        result = _mm_or_si128(result, _mm_and_si128(_mm_slli_si128(source, 3), lane3));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), _mm_or_si128(result, alpha));
+    }
+
+    for (; i < pixelCount; ++i)
+    {
+        rgba[i * 4] = rgb[i * 3];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
 PTexture::PTexture()
 {
     m_Path = m_FileName = "";
     m_ID = 0U;
     m_Width = m_Height = m_Channels = 0;
+    m_MemorySize = 0;
+    m_IsCooked = false;
+    m_InternalFormat = 0;
+    m_LevelCount = 0;
+    m_ResidentMip = 0;
+    m_LoadedMip = 0;
+    m_TailMip = 0;
+    m_IsStreamed = false;
+    m_LoadState = LS_NONE;
 }
 
 PTexture::~PTexture()
 {
+    // The upload callbacks point at the texture
+    PUploadQueue::GetQueue().Cancel(this);
+
     // As long as an ID was generated, delete the texture
-    if (m_ID > 0)
-        glDeleteTextures(1, &m_ID);
+    PGLState::GetState().DeleteTexture(m_ID);
 
     PDebug::Log("Texture destroyed: " + m_FileName);
 }
 
 bool PTexture::LoadTexture(const PString& fileName, const PString& path)
 {
+    // Only one load can run on a texture at a time
+    if (m_Import)
+    {
+        PDebug::Log("Texture is already loading, can't load: " + path, LT_WARN);
+        return false;
+    }
+
     // Assign the file name and path
     m_FileName = fileName;
     m_Path = path;
+    m_IsStreamed = false;
+
+    const auto import = TMakeShared<PSTextureImport>();
+    import->fileName = fileName;
+    import->path = path;
+    import->startTime = std::chrono::steady_clock::now();
+
+    m_LoadState = LS_LOADING;
 
+    ReadImport(*import);
+
+    if (!UploadImport(import))
+        return false;
+
+    // Copy every level now instead of spreading them over the next frames
+    PUploadQueue::GetQueue().Flush();
+
+    return true;
+}
+
+void PTexture::LoadTextureAsync(const PString& fileName, const PString& path, const bool& streamed)
+{
+    // Only one load can run on a texture at a time
+    if (m_Import)
+    {
+        PDebug::Log("Texture is already loading, can't load: " + path, LT_WARN);
+        return;
+    }
+
+    m_FileName = fileName;
+    m_Path = path;
+    m_IsStreamed = streamed;
+
+    m_Import = TMakeShared<PSTextureImport>();
+    m_Import->fileName = fileName;
+    m_Import->path = path;
+    m_Import->startTime = std::chrono::steady_clock::now();
+
+    m_LoadState = LS_LOADING;
+
+    // The job keeps its own reference so the texture can be destroyed while it runs
+    const TShared<PSTextureImport> import = m_Import;
+
+    PThreadPool::GetPool().AddJob([import]()
+        {
+            ReadImport(*import);
+            import->isDone.store(true);
+        });
+}
+
+bool PTexture::UpdateLoad()
+{
+    if (!m_Import || !m_Import->isDone.load())
+        return false;
+
+    UploadImport(m_Import);
+    m_Import = nullptr;
+
+    return true;
+}
+
+PUi64 PTexture::GetResidentSize(const PUi32& mip) const
+{
+    // Textures that aren't streamed always have every level on the GPU
+    if (!m_Source)
+        return m_MemorySize;
+
+    PUi64 size = 0;
+
+    for (PUi32 i = std::min(mip, m_LevelCount); i < m_LevelCount; ++i)
+        size += m_Source->levels[i].size;
+
+    return size;
+}
+
+bool PTexture::SetResidentMip(const PUi32& mip)
+{
+    if (!m_Source || m_LoadState != LS_READY)
+        return false;
+
+    // The small levels always stay on the GPU
+    const PUi32 targetMip = std::min(mip, m_TailMip);
+
+    if (targetMip == m_ResidentMip)
+        return true;
+
+    return CreateStorage(m_Source, targetMip);
+}
+
+bool PTexture::IsCompressionSupported(const PETextureCompression& compression)
+{
+    // S3TC is an extension, RGTC and BPTC are core in the versions that added them
+    switch (compression)
+    {
+    case TC_BC1:
+    case TC_BC3:
+        return GLEW_EXT_texture_compression_s3tc;
+    case TC_BC5:
+        return GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+    case TC_BC7:
+        return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+    default:
+        return false;
+    }
+}
+
+void PTexture::ReadImport(PSTextureImport& import)
+{
+    // Use the cooked texture if it has been made, it is already compressed with every mip map
+    if (PTextureCooker::Read(PTextureCooker::GetCookedPath(import.path), import.path, import.cooked))
+    {
+        if (IsCompressionSupported(import.cooked.compression))
+        {
+            import.isCooked = true;
+            import.success = true;
+            import.levels = import.cooked.levels;
+            import.channels = static_cast<int>(import.cooked.channels);
+        }
+        else
+        {
+            PDebug::Log("Cooked texture format isn't supported, decoding the image instead - " + import.fileName, LT_WARN);
+            import.cooked.file.Close();
+        }
+    }
+
+    if (!import.isCooked)
+        import.success = DecodeImage(import);
+
+    import.loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - import.startTime).count();
+}
+
+bool PTexture::DecodeImage(PSTextureImport& import)
+{
     // stb image imports images upside down
     // but actually open gl reads them in an inverted state (bottom left is x:0, y:0)
-    stbi_set_flip_vertically_on_load(true);
+    // Only set for this thread, the global setting would change images other workers are decoding
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    int width = 0, height = 0;
 
     // Load the image into a computer readable format
     unsigned char* data = stbi_load(
-        m_Path.c_str(), // Path to the image
-        &m_Width, &m_Height, // Width and height of the image
-        &m_Channels, // RGBA
+        import.path.c_str(), // Path to the image
+        &width, &height, // Width and height of the image
+        &import.channels, // RGBA
         0 // Do we want to specifically require a certain amount of channels, 0 = no limit
     );
 
     // Test if the data imported or not
     if (data == nullptr)
     {
-        PString error = "Failed to load texture - " + m_FileName + ": " + stbi_failure_reason();
+        PString error = "Failed to load texture - " + import.fileName + ": " + stbi_failure_reason();
         PDebug::Log(error, LT_ERROR);
         return false;
     }
 
-    // Test the amount of channels
-    if (m_Channels > 4 || m_Channels < 3)
+    const PUi64 pixelCount = static_cast<PUi64>(width) * height;
+    TArray<PUi8> pixels(static_cast<size_t>(pixelCount * 4));
+
+    // Convert every image to RGBA so the upload never has to deal with rows that aren't 4 byte aligned
+    switch (import.channels)
+    {
+    case 4:
+        std::memcpy(pixels.data(), data, pixels.size());
+        break;
+    case 3:
+        ExpandRGBToRGBA(data, pixels.data(), pixelCount);
+        break;
+    default:
+        // Grey or grey and alpha
+        for (PUi64 i = 0; i < pixelCount; ++i)
+        {
+            const PUi8 grey = data[i * import.channels];
+            pixels[i * 4] = pixels[i * 4 + 1] = pixels[i * 4 + 2] = grey;
+            pixels[i * 4 + 3] = import.channels == 2 ? data[i * 2 + 1] : 255;
+        }
+        break;
+    }
+
+    // Clear stbi image data
+    stbi_image_free(data);
+
+    // Work out where each mip map goes so the chain is stored in one block
+    PUi64 totalSize = 0;
+    PUi32 levelWidth = static_cast<PUi32>(width), levelHeight = static_cast<PUi32>(height);
+    import.levels.clear();
+
+    while (true)
+    {
+        PSCookedTextureLevel level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.size = static_cast<PUi64>(levelWidth) * levelHeight * 4;
+        import.levels.push_back(level);
+
+        totalSize += level.size;
+
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+
+        levelWidth = std::max(levelWidth / 2, 1U);
+        levelHeight = std::max(levelHeight / 2, 1U);
+    }
+
+    import.pixels.resize(static_cast<size_t>(totalSize));
+
+    // Build the mip maps on the CPU the same way the cooker does so colours are averaged in linear space
+    const bool isColour = PTextureCooker::GetDefaultSettings(import.path).isColour;
+    TArray<PUi8> nextPixels;
+    PUi64 offset = 0;
+
+    for (size_t i = 0; i < import.levels.size(); ++i)
+    {
+        PSCookedTextureLevel& level = import.levels[i];
+
+        std::memcpy(import.pixels.data() + offset, pixels.data(), static_cast<size_t>(level.size));
+        level.data = import.pixels.data() + offset;
+        offset += level.size;
+
+        if (i + 1 < import.levels.size())
+        {
+            PTextureCooker::DownsampleImage(pixels, level.width, level.height, isColour, nextPixels, levelWidth, levelHeight);
+            pixels.swap(nextPixels);
+        }
+    }
+
+    return true;
+}
+
+bool PTexture::UploadImport(const TShared<PSTextureImport>& import)
+{
+    // Read the size and format of the levels the import made
+    const auto setLevels = [this](const PSTextureImport& source)
+        {
+            m_IsCooked = source.isCooked;
+            m_InternalFormat = source.isCooked ? PBlockCompression::GetGLFormat(source.cooked.compression) : GL_RGBA8;
+            m_LevelCount = static_cast<PUi32>(source.levels.size());
+            m_Width = static_cast<int>(source.levels[0].width);
+            m_Height = static_cast<int>(source.levels[0].height);
+            m_Channels = source.channels;
+
+            // Streamed textures start with only the small levels
+            m_TailMip = 0;
+
+            if (m_IsStreamed)
+            {
+                while (m_TailMip + 1 < m_LevelCount
+                    && std::max(source.levels[m_TailMip].width, source.levels[m_TailMip].height) > streamedTailSize)
+                    ++m_TailMip;
+            }
+        };
+
+    bool success = import->success;
+
+    if (success)
+    {
+        setLevels(*import);
+        success = CreateStorage(import, m_TailMip);
+
+        // The driver refused the cooked format, decode the image here instead
+        if (!success && import->isCooked)
+        {
+            import->cooked.file.Close();
+            import->isCooked = false;
+            success = DecodeImage(*import);
+
+            if (success)
+            {
+                setLevels(*import);
+                success = CreateStorage(import, m_TailMip);
+            }
+        }
+    }
+
+    if (!success)
     {
-        PDebug::Log("Failed to import texture - " + m_FileName + ": Incorrect number of channels, must have 3 or 4 channels");
+        m_LoadState = LS_FAILED;
         return false;
     }
 
-    // Generate the texture ID in open gl
-    glGenTextures(1, &m_ID);
+    m_LoadState = LS_READY;
+
+    // Streamed textures keep the levels on the CPU, the rest are done with them
+    if (m_IsStreamed)
+        m_Source = import;
+
+    const double totalTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - import->startTime).count();
+
+    PDebug::Log("Successfuly " + PString(m_IsCooked ? "loaded cooked" : "imported") + " texture - " + m_FileName + ", "
+        + std::to_string(import->loadTime) + " ms on the CPU, " + std::to_string(totalTime) + " ms total", LT_SUCCESS);
+
+    return true;
+}
+
+bool PTexture::CreateStorage(const TShared<PSTextureImport>& import, const PUi32& firstMip)
+{
+    const PSCookedTextureLevel& topLevel = import->levels[firstMip];
+    const GLsizei levelCount = static_cast<GLsizei>(m_LevelCount - firstMip);
+
+    // Create the texture in open gl without binding it
+    GLuint newID = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &newID);
 
     // Test if the generate failed
-    if (m_ID == 0)
+    if (newID == 0)
     {
         PString error = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
         PString errorMsg = "Failed to generate texture ID - " + m_FileName + ": " + error;
         PDebug::Log(errorMsg, LT_ERROR);
+        return false;
     }
 
-    // Bind the texture
-    // Tells open gl that we want ot use this texture
-    glBindTexture(GL_TEXTURE_2D, m_ID);
+    // Immutable storage for every level at once, the size can't change so it is made again to stream
+    glTextureStorage2D(newID, levelCount, m_InternalFormat,
+        static_cast<GLsizei>(topLevel.width), static_cast<GLsizei>(topLevel.height));
 
     // Set some default parameters for the texture
     // Set the texture wrapping parameters
     // If the texture doesn't fit the model, repeat the texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // s == x
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); // t == x
+    glTextureParameteri(newID, GL_TEXTURE_WRAP_S, GL_REPEAT); // s == x
+    glTextureParameteri(newID, GL_TEXTURE_WRAP_T, GL_REPEAT); // t == x
 
     // Set the filtering parameter
     // How much to blur pixels
     // The resolution of the texture is lower than the size of the model
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // Set the default form at 3 channels
-    GLint intFormat = GL_RGB;
-    
-    // If the channels of the imported image == 4 then set the import type to RGBA
-    if (m_Channels == 4)
-    {
-        intFormat = GL_RGBA;
-    }
-
-    // Load the image data into the texture that we just updated
-    glTexImage2D(
-        GL_TEXTURE_2D, // Use a 2D texture
-        0, // Levels
-        intFormat, // Format of the texture (internal)
-        m_Width, m_Height, // Width and height
-        0, // Border around the image (legacy)
-        intFormat, // Format of the texture (external)
-        GL_UNSIGNED_BYTE, // Type of data assed in
-        data // The image data we got from stbi
-    );
+    // Blend between the two closest mip maps so distant surfaces don't shimmer
+    glTextureParameteri(newID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(newID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Genertae mip maps
-    // Lower resolution versions of the texture (for when rendering images at an increasing distance)
-    glGenerateMipmap(GL_TEXTURE_2D);
+    // Levels of the current storage that have data can be copied on the GPU
+    const PUi32 copiedMip = m_ID > 0 ? std::max(m_LoadedMip, firstMip) : m_LevelCount;
 
-    // Unbind the texture from open gl
-    // Makes room for next texture
-    Unbind();
+    // Only sample the levels that have data, the base level drops as the upload queue fills the rest
+    glTextureParameteri(newID, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(std::min(copiedMip, m_LevelCount - 1) - firstMip));
+    glTextureParameteri(newID, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
 
-    // Clear stbi image data
-    stbi_image_free(data);
+    PUi64 memorySize = 0;
 
-    PDebug::Log("Successfuly imported texture - " + m_FileName, LT_SUCCESS);
+    for (PUi32 mip = firstMip; mip < m_LevelCount; ++mip)
+    {
+        const PSCookedTextureLevel& level = import->levels[mip];
+
+        if (mip >= copiedMip)
+        {
+            // Already on the GPU, copy it without going through the CPU
+            glCopyImageSubData(m_ID, GL_TEXTURE_2D, static_cast<GLint>(mip - m_ResidentMip), 0, 0, 0,
+                newID, GL_TEXTURE_2D, static_cast<GLint>(mip - firstMip), 0, 0, 0,
+                static_cast<GLsizei>(level.width), static_cast<GLsizei>(level.height), 1);
+        }
+
+        memorySize += level.size;
+    }
+
+    // Uploads are checked when they are queued, a bad level shows up as a GL error in a later frame
+    const GLenum errorCode = glGetError();
+
+    if (errorCode != GL_NO_ERROR)
+    {
+        PString error = reinterpret_cast<const char*>(glewGetErrorString(errorCode));
+        PDebug::Log("Failed to create texture storage - " + m_FileName + ": " + error, LT_WARN);
+
+        PGLState::GetState().DeleteTexture(newID);
+        return false;
+    }
+
+    // Uploads still queued for the old storage are queued again for the new one
+    PUploadQueue& uploadQueue = PUploadQueue::GetQueue();
+    uploadQueue.Cancel(this);
+
+    // Swap to the new storage
+    PGLState::GetState().DeleteTexture(m_ID);
+
+    m_ID = newID;
+    m_ResidentMip = firstMip;
+    m_LoadedMip = copiedMip;
+    m_MemorySize = memorySize;
+
+    // Queue the missing levels smallest first so the texture sharpens as they arrive
+    for (PUi32 mip = copiedMip; mip-- > firstMip;)
+    {
+        const PSCookedTextureLevel& level = import->levels[mip];
+
+        uploadQueue.UploadTexture(this, m_ID, mip - firstMip, level.width, level.height,
+            m_IsCooked ? m_InternalFormat : GL_RGBA, m_IsCooked, level.data, level.size, import,
+            [this, mip]()
+            {
+                // Start sampling the level now that it has data
+                m_LoadedMip = mip;
+
+                glTextureParameteri(m_ID, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(mip - m_ResidentMip));
+            });
+    }
 
     return true;
 }
 
-void PTexture::BindTexture(const PUi32& textureNumber)
+void PTexture::BindTexture(const PUi32& unit)
 {
-    // Make active texture for shader in slot 0
-    glActiveTexture(GL_TEXTURE0); 
-
-    glBindTexture(GL_TEXTURE_2D, textureNumber);
+    // Bind the texture to the unit the shader samples it from
+    PGLState::GetState().BindTextures(unit, 1, &m_ID);
 }
 
-void PTexture::Unbind()
+void PTexture::Unbind(const PUi32& unit)
 {
-    glBindTexture(GL_TEXTURE_2D, 0);
+    const PUi32 noTexture = 0;
+    PGLState::GetState().BindTextures(unit, 1, &noTexture);
 }
@@ -0,0 +1,390 @@
+#include "Graphics/PTextureArrays.h"
+#include "Debug/PDebug.h"
+#include "Graphics/PTexture.h"
+#include "Graphics/PGLState.h"
+
+// External Libs
+#include <GLEW/glew.h>
+
+// System Libs
+#include <algorithm>
+#include <bit>
+
+// Width and height of an atlas page in pixels
+const PUi32 atlasSize = 1024;
+
+// Mip levels kept in an atlas page, entries past this size blur into each other
+const PUi32 atlasLevelCount = 3;
+
+// Largest side of a texture that can go into an atlas page
+const PUi32 atlasMaxEntrySize = 512;
+
+// Atlas positions and sizes are multiples of this so every level of an entry starts on a 4 x 4 block
+const PUi32 atlasAlignment = 16;
+
+// Most textures copied into the arrays each frame
+const PUi32 maxPlacementsPerFrame = 8;
+
+// Get the bytes used by one level of a texture in a format
+static PUi64 GetLevelSize(const PUi32& format, const PUi32& width, const PUi32& height)
+{
+	if (format == GL_RGBA8)
+		return static_cast<PUi64>(width) * height * 4;
+
+	// Compressed formats store 4 x 4 blocks, BC1 blocks are 8 bytes and the rest are 16
+	const PUi64 blockCount = static_cast<PUi64>((width + 3) / 4) * ((height + 3) / 4);
+	return blockCount * (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16);
+}
+
+PTextureArrays::PTextureArrays()
+{
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	// Open gl guarantees at least 256
+	m_MaxLayers = maxLayers > 0 ? static_cast<PUi32>(maxLayers) : 256;
+}
+
+PTextureArrays::~PTextureArrays()
+{
+	Clear();
+}
+
+bool PTextureArrays::GetSlot(const TShared<PTexture>& texture, PSTextureArraySlot& outSlot)
+{
+	if (texture == nullptr)
+		return false;
+
+	PSTextureArrayEntry& entry = m_Entries[texture.get()];
+
+	// A new texture at the address of one that was destroyed, its copy belongs to the old texture
+	if (entry.texture.lock() != texture)
+	{
+		FreeSlot(entry.slot);
+		entry.texture = texture;
+		entry.sourceID = 0;
+	}
+
+	// A copy from before the texture streamed is still correct, just at the old size, until Update() copies it again
+	if (!entry.slot.IsValid())
+		return false;
+
+	outSlot = entry.slot;
+	return true;
+}
+
+void PTextureArrays::Update()
+{
+	PUi32 placements = 0;
+
+	for (auto it = m_Entries.begin(); it != m_Entries.end();)
+	{
+		PSTextureArrayEntry& entry = it->second;
+		const TShared<PTexture> texture = entry.texture.lock();
+
+		// Free the copies of textures that have been destroyed
+		if (texture == nullptr)
+		{
+			FreeSlot(entry.slot);
+			it = m_Entries.erase(it);
+			continue;
+		}
+
+		// Wait for the texture to finish loading and streaming so the copy has every level
+		if (placements < maxPlacementsPerFrame && texture->GetLoadState() == LS_READY && !texture->IsStreaming()
+			&& texture->GetID() != 0 && texture->GetID() != entry.sourceID)
+		{
+			PlaceTexture(entry, *texture);
+			++placements;
+		}
+
+		++it;
+	}
+}
+
+PUi64 PTextureArrays::GetMemorySize() const
+{
+	PUi64 size = 0;
+
+	for (const auto& pool : m_Pools)
+		size += pool.layerSize * pool.layerCount;
+
+	return size;
+}
+
+void PTextureArrays::Clear()
+{
+	PGLState& glState = PGLState::GetState();
+
+	for (auto& pool : m_Pools)
+		glState.DeleteTexture(pool.id);
+
+	m_Pools.clear();
+	m_Entries.clear();
+}
+
+bool PTextureArrays::PlaceTexture(PSTextureArrayEntry& entry, const PTexture& texture)
+{
+	FreeSlot(entry.slot);
+
+	// Only try a texture once for each storage, one that doesn't fit keeps being sampled on its own
+	entry.sourceID = texture.GetID();
+
+	const PUi32 sourceID = texture.GetID();
+	const PUi32 format = texture.GetInternalFormat();
+	const PUi32 levelCount = texture.GetLevelCount() - texture.GetResidentMip();
+
+	// Read the size of each level from the storage so odd sizes round the same way open gl does
+	TArray<PUi32> levelWidths(levelCount), levelHeights(levelCount);
+
+	for (PUi32 level = 0; level < levelCount; ++level)
+	{
+		GLint levelWidth = 0, levelHeight = 0;
+		glGetTextureLevelParameteriv(sourceID, static_cast<GLint>(level), GL_TEXTURE_WIDTH, &levelWidth);
+		glGetTextureLevelParameteriv(sourceID, static_cast<GLint>(level), GL_TEXTURE_HEIGHT, &levelHeight);
+		levelWidths[level] = static_cast<PUi32>(levelWidth);
+		levelHeights[level] = static_cast<PUi32>(levelHeight);
+	}
+
+	if (levelCount == 0 || levelWidths[0] == 0 || levelHeights[0] == 0)
+		return false;
+
+	const PUi32 width = levelWidths[0];
+	const PUi32 height = levelHeights[0];
+
+	PSTextureArraySlot slot;
+	PUi32 copiedLevels = levelCount;
+	PUi32 x = 0, y = 0;
+
+	if (std::has_single_bit(width) && std::has_single_bit(height))
+	{
+		// Power of two sizes share a whole layer array with textures of the same size
+		if (!AllocateLayer(format, width, height, levelCount, slot))
+			return false;
+	}
+	else
+	{
+		// Compressed levels can only be copied into the middle of a page in whole blocks
+		const bool isBlockAligned = format == GL_RGBA8 || (width % atlasAlignment == 0 && height % atlasAlignment == 0);
+
+		if (std::max(width, height) > atlasMaxEntrySize || levelCount < atlasLevelCount || !isBlockAligned
+			|| !AllocateAtlas(format, width, height, slot))
+			return false;
+
+		copiedLevels = atlasLevelCount;
+		x = static_cast<PUi32>(slot.rect.x * atlasSize);
+		y = static_cast<PUi32>(slot.rect.y * atlasSize);
+	}
+
+	const PSTextureArrayPool& pool = m_Pools[slot.pool];
+
+	// Copy every level on the GPU, atlas entries are moved down with each level
+	for (PUi32 level = 0; level < copiedLevels; ++level)
+	{
+		glCopyImageSubData(sourceID, GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, 0,
+			pool.id, GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level),
+			static_cast<GLint>(x >> level), static_cast<GLint>(y >> level), static_cast<GLint>(slot.layer),
+			static_cast<GLsizei>(levelWidths[level]), static_cast<GLsizei>(levelHeights[level]), 1);
+	}
+
+	const GLenum errorCode = glGetError();
+
+	if (errorCode != GL_NO_ERROR)
+	{
+		PString error = reinterpret_cast<const char*>(glewGetErrorString(errorCode));
+		PDebug::Log("Failed to copy texture into a texture array - " + texture.GetName() + ": " + error, LT_WARN);
+
+		FreeSlot(slot);
+		return false;
+	}
+
+	entry.slot = slot;
+
+	return true;
+}
+
+bool PTextureArrays::AllocateLayer(const PUi32& format, const PUi32& width, const PUi32& height, const PUi32& levelCount, PSTextureArraySlot& outSlot)
+{
+	auto found = std::find_if(m_Pools.begin(), m_Pools.end(), [&](const PSTextureArrayPool& pool)
+		{
+			return !pool.isAtlas && pool.internalFormat == format && pool.width == width && pool.height == height
+				&& pool.levelCount == levelCount;
+		});
+
+	if (found == m_Pools.end())
+	{
+		PSTextureArrayPool pool;
+		pool.internalFormat = format;
+		pool.width = width;
+		pool.height = height;
+		pool.levelCount = levelCount;
+
+		for (PUi32 level = 0; level < levelCount; ++level)
+			pool.layerSize += GetLevelSize(format, std::max(width >> level, 1U), std::max(height >> level, 1U));
+
+		// Most sizes are only used by a few textures so start small
+		if (!CreatePool(pool, 1))
+			return false;
+
+		m_Pools.push_back(pool);
+		found = m_Pools.end() - 1;
+	}
+
+	PSTextureArrayPool& pool = *found;
+
+	if (pool.freeLayers.empty() && !GrowPool(pool))
+		return false;
+
+	outSlot.pool = static_cast<PUi32>(found - m_Pools.begin());
+	outSlot.layer = pool.freeLayers.back();
+	outSlot.rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	pool.freeLayers.pop_back();
+
+	return true;
+}
+
+bool PTextureArrays::AllocateAtlas(const PUi32& format, const PUi32& width, const PUi32& height, PSTextureArraySlot& outSlot)
+{
+	auto found = std::find_if(m_Pools.begin(), m_Pools.end(), [&format](const PSTextureArrayPool& pool)
+		{
+			return pool.isAtlas && pool.internalFormat == format;
+		});
+
+	if (found == m_Pools.end())
+	{
+		PSTextureArrayPool pool;
+		pool.internalFormat = format;
+		pool.width = pool.height = atlasSize;
+		pool.levelCount = atlasLevelCount;
+		pool.isAtlas = true;
+
+		for (PUi32 level = 0; level < atlasLevelCount; ++level)
+			pool.layerSize += GetLevelSize(format, atlasSize >> level, atlasSize >> level);
+
+		if (!CreatePool(pool, 1))
+			return false;
+
+		m_Pools.push_back(pool);
+		found = m_Pools.end() - 1;
+	}
+
+	PSTextureArrayPool& pool = *found;
+	PUi32 x = 0, y = 0;
+
+	for (PUi32 page = 0; ; ++page)
+	{
+		// Every page is full, add more
+		if (page == pool.pages.size() && !GrowPool(pool))
+			return false;
+
+		if (!pool.pages[page].Allocate(width, height, x, y))
+			continue;
+
+		const float pageSize = static_cast<float>(atlasSize);
+
+		outSlot.pool = static_cast<PUi32>(found - m_Pools.begin());
+		outSlot.layer = page;
+		outSlot.rect = glm::vec4(x / pageSize, y / pageSize, width / pageSize, height / pageSize);
+
+		return true;
+	}
+}
+
+void PTextureArrays::FreeSlot(PSTextureArraySlot& slot)
+{
+	if (!slot.IsValid() || slot.pool >= m_Pools.size())
+	{
+		slot = PSTextureArraySlot();
+		return;
+	}
+
+	PSTextureArrayPool& pool = m_Pools[slot.pool];
+
+	if (pool.isAtlas)
+		pool.pages[slot.layer].Free();
+	else
+		pool.freeLayers.push_back(slot.layer);
+
+	slot = PSTextureArraySlot();
+}
+
+bool PTextureArrays::CreatePool(PSTextureArrayPool& pool, const PUi32& layerCount)
+{
+	GLuint newID = 0;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &newID);
+
+	if (newID == 0)
+	{
+		PString error = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Failed to create texture array: " + error, LT_WARN);
+		return false;
+	}
+
+	glTextureStorage3D(newID, static_cast<GLsizei>(pool.levelCount), pool.internalFormat,
+		static_cast<GLsizei>(pool.width), static_cast<GLsizei>(pool.height), static_cast<GLsizei>(layerCount));
+
+	// Whole layers repeat like the textures they copy, atlas entries wrap in the shader so the page edges clamp
+	const GLint wrap = pool.isAtlas ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+	glTextureParameteri(newID, GL_TEXTURE_WRAP_S, wrap);
+	glTextureParameteri(newID, GL_TEXTURE_WRAP_T, wrap);
+	glTextureParameteri(newID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(newID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	const GLenum errorCode = glGetError();
+
+	if (errorCode != GL_NO_ERROR)
+	{
+		PString error = reinterpret_cast<const char*>(glewGetErrorString(errorCode));
+		PDebug::Log("Failed to create texture array storage: " + error, LT_WARN);
+
+		PGLState::GetState().DeleteTexture(newID);
+		return false;
+	}
+
+	pool.id = newID;
+
+	if (pool.isAtlas)
+	{
+		// Every new layer is an empty page
+		pool.pages.resize(layerCount);
+
+		for (PUi32 page = pool.layerCount; page < layerCount; ++page)
+			pool.pages[page].Reset(atlasSize, atlasAlignment);
+	}
+	else
+	{
+		// Free layers are taken from the back so the lowest new layer is handed out first
+		for (PUi32 layer = layerCount; layer-- > pool.layerCount;)
+			pool.freeLayers.push_back(layer);
+	}
+
+	pool.layerCount = layerCount;
+
+	return true;
+}
+
+bool PTextureArrays::GrowPool(PSTextureArrayPool& pool)
+{
+	if (pool.layerCount >= m_MaxLayers)
+		return false;
+
+	const PUi32 oldID = pool.id;
+	const PUi32 oldLayerCount = pool.layerCount;
+
+	if (!CreatePool(pool, std::min(oldLayerCount * 2, m_MaxLayers)))
+		return false;
+
+	// Copy every layer the old array had in one call for each level
+	for (PUi32 level = 0; level < pool.levelCount; ++level)
+	{
+		glCopyImageSubData(oldID, GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), 0, 0, 0,
+			pool.id, GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), 0, 0, 0,
+			static_cast<GLsizei>(std::max(pool.width >> level, 1U)), static_cast<GLsizei>(std::max(pool.height >> level, 1U)),
+			static_cast<GLsizei>(oldLayerCount));
+	}
+
+	PUi32 deletedID = oldID;
+	PGLState::GetState().DeleteTexture(deletedID);
+
+	return true;
+}
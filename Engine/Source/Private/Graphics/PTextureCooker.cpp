@@ -0,0 +1,443 @@
+#include "Graphics/PTextureCooker.h"
+#include "Debug/PDebug.h"
+#include "Math/PSHash.h"
+#include "Threading/PThreadPool.h"
+
+// External Libs
+#include <STB_IMAGE/stb_image.h>
+
+// System Libs
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Folder the cooked files are written to
+const char* const cookedTextureFolder = "Cache/Textures/";
+
+// Start of every cooked file, the same idea as the KTX2 identifier
+// Catches files that aren't cooked textures and files mangled by text mode transfers
+const PUi8 cookedTextureIdentifier[12] = { 0xAB, 'P', 'T', 'X', ' ', '1', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// Change this whenever the cooked layout or the encoders change
+// Old files then stop matching and are cooked again
+const PUi32 cookedTextureVersion = 1;
+
+// Levels start on this boundary so they can be read directly from the mapped file
+const PUi64 cookedTextureAlignment = 16;
+
+// Enough levels for a 65536 pixel wide image
+const PUi32 maxCookedLevels = 17;
+
+// Start of every cooked file
+struct PSCookedTextureHeader
+{
+	PUi8 identifier[12];
+	PUi32 version;
+
+	// Open gl internal format of the levels
+	PUi32 glFormat;
+
+	// PETextureCompression of the levels
+	PUi32 compression;
+
+	// Size of level 0 in pixels
+	PUi32 width;
+	PUi32 height;
+
+	// Amount of channels in the source image
+	PUi32 channels;
+
+	// Amount of mip levels, these follow the header
+	PUi32 levelCount;
+
+	// Hash of the source image the file was cooked from
+	PUi64 sourceHash;
+
+	// Size of the whole file, catches files that were only partly written
+	PUi64 fileSize;
+};
+
+// Location of a level in the file, offsets are in bytes from the start of the file
+struct PSCookedTextureLevelEntry
+{
+	PUi64 byteOffset;
+	PUi64 byteLength;
+};
+
+// Round an offset up to the level alignment
+static PUi64 AlignTextureOffset(const PUi64& offset)
+{
+	return (offset + cookedTextureAlignment - 1) / cookedTextureAlignment * cookedTextureAlignment;
+}
+
+// Convert an sRGB value to linear
+static float SRGBToLinear(const float& value)
+{
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+// Convert a linear value to sRGB
+static float LinearToSRGB(const float& value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+PString PTextureCooker::GetCookedPath(const PString& sourcePath)
+{
+	// Name the file after the path so images with the same file name don't overwrite each other
+	const PString normalPath = std::filesystem::path(sourcePath).lexically_normal().generic_string();
+	const PUi64 pathHash = PSHash::FNV1a(normalPath.data(), normalPath.size());
+
+	char hashText[17];
+	snprintf(hashText, sizeof(hashText), "%016llx", static_cast<unsigned long long>(pathHash));
+
+	return cookedTextureFolder + std::filesystem::path(sourcePath).filename().string() + "_" + hashText + ".ptex";
+}
+
+PSTextureCookSettings PTextureCooker::GetDefaultSettings(const PString& sourcePath)
+{
+	PString fileName = std::filesystem::path(sourcePath).stem().string();
+
+	for (auto& character : fileName)
+		character = static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+
+	const auto contains = [&fileName](const char* text) { return fileName.find(text) != PString::npos; };
+
+	PSTextureCookSettings settings;
+
+	// Normal maps only need x and y, z can be rebuilt when they are sampled
+	if (contains("normal"))
+	{
+		settings.compression = TC_BC5;
+		settings.isColour = false;
+	}
+	else if (contains("rough") || contains("metal") || contains("_ao") || contains("occlusion") || contains("spec"))
+	{
+		settings.isColour = false;
+	}
+
+	return settings;
+}
+
+bool PTextureCooker::CookTexture(const PString& sourcePath, const PSTextureCookSettings& settings)
+{
+	const PUi64 sourceHash = HashSource(sourcePath);
+
+	if (sourceHash == 0)
+	{
+		PDebug::Log("Failed to cook texture, source can't be read: " + sourcePath, LT_ERROR);
+		return false;
+	}
+
+	// Flip the same way as images loaded by PTexture
+	stbi_set_flip_vertically_on_load_thread(true);
+
+	// Always expand to 4 channels so every encoder reads the same layout
+	int width = 0, height = 0, channels = 0;
+	unsigned char* data = stbi_load(sourcePath.c_str(), &width, &height, &channels, 4);
+
+	if (data == nullptr)
+	{
+		PDebug::Log("Failed to cook texture - " + sourcePath + ": " + stbi_failure_reason(), LT_ERROR);
+		return false;
+	}
+
+	TArray<PUi8> pixels(data, data + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(data);
+
+	PETextureCompression compression = settings.compression;
+
+	// Only pay for an alpha format if the image uses its alpha
+	if (compression == TC_AUTO)
+	{
+		compression = TC_BC1;
+
+		for (size_t i = 3; i < pixels.size(); i += 4)
+		{
+			if (pixels[i] < 255)
+			{
+				compression = TC_BC7;
+				break;
+			}
+		}
+	}
+
+	PSCookedTextureHeader header;
+	std::memcpy(header.identifier, cookedTextureIdentifier, sizeof(header.identifier));
+	header.version = cookedTextureVersion;
+	header.glFormat = PBlockCompression::GetGLFormat(compression);
+	header.compression = compression;
+	header.width = static_cast<PUi32>(width);
+	header.height = static_cast<PUi32>(height);
+	header.channels = static_cast<PUi32>(channels);
+	header.levelCount = 0;
+	header.sourceHash = sourceHash;
+	header.fileSize = 0;
+
+	// Leave room for the header and level index, they are filled in once the offsets are known
+	TArray<PUi8> file(static_cast<size_t>(AlignTextureOffset(sizeof(header))), 0);
+	const PUi64 entriesOffset = file.size();
+
+	TArray<PSCookedTextureLevelEntry> entries;
+	file.resize(static_cast<size_t>(AlignTextureOffset(entriesOffset + maxCookedLevels * sizeof(PSCookedTextureLevelEntry))), 0);
+
+	PUi32 levelWidth = header.width, levelHeight = header.height;
+	TArray<PUi8> compressed, nextPixels;
+
+	// Compress each level then shrink it for the next until the image is 1x1
+	while (true)
+	{
+		PBlockCompression::CompressImage(pixels.data(), levelWidth, levelHeight, compression, compressed);
+
+		PSCookedTextureLevelEntry entry;
+		entry.byteOffset = AlignTextureOffset(file.size());
+		entry.byteLength = compressed.size();
+		entries.push_back(entry);
+
+		file.resize(static_cast<size_t>(entry.byteOffset + entry.byteLength), 0);
+		std::memcpy(file.data() + entry.byteOffset, compressed.data(), compressed.size());
+
+		if ((levelWidth == 1 && levelHeight == 1) || entries.size() == maxCookedLevels)
+			break;
+
+		DownsampleImage(pixels, levelWidth, levelHeight, settings.isColour, nextPixels, levelWidth, levelHeight);
+		pixels.swap(nextPixels);
+	}
+
+	header.levelCount = static_cast<PUi32>(entries.size());
+	header.fileSize = file.size();
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::memcpy(file.data() + entriesOffset, entries.data(), entries.size() * sizeof(PSCookedTextureLevelEntry));
+
+	const PString cookedPath = GetCookedPath(sourcePath);
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(cookedPath).parent_path(), error);
+
+	std::ofstream stream(cookedPath, std::ios::binary | std::ios::trunc);
+
+	if (!stream.is_open())
+	{
+		PDebug::Log("Failed to open cooked texture file for writing: " + cookedPath, LT_ERROR);
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+
+	if (!stream.good())
+	{
+		PDebug::Log("Failed to write cooked texture file: " + cookedPath, LT_ERROR);
+		return false;
+	}
+
+	const char* compressionNames[] = { "Auto", "BC1", "BC3", "BC5", "BC7" };
+
+	PDebug::Log("Cooked texture " + sourcePath + " as " + compressionNames[compression] + " with "
+		+ std::to_string(header.levelCount) + " levels (" + std::to_string(file.size() / 1024) + " KB)", LT_SUCCESS);
+
+	return true;
+}
+
+bool PTextureCooker::CookTexture(const PString& sourcePath)
+{
+	return CookTexture(sourcePath, GetDefaultSettings(sourcePath));
+}
+
+PUi32 PTextureCooker::CookFolder(const PString& folder)
+{
+	std::error_code error;
+
+	if (!std::filesystem::is_directory(folder, error))
+	{
+		PDebug::Log("Failed to cook textures, folder doesn't exist: " + folder, LT_ERROR);
+		return 0;
+	}
+
+	PUi32 cookedCount = 0, failedCount = 0;
+
+	for (const auto& item : std::filesystem::recursive_directory_iterator(folder, error))
+	{
+		if (!item.is_regular_file())
+			continue;
+
+		PString extension = item.path().extension().string();
+
+		for (auto& character : extension)
+			character = static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+
+		if (extension != ".png" && extension != ".jpg" && extension != ".jpeg" && extension != ".tga")
+			continue;
+
+		if (CookTexture(item.path().generic_string()))
+			++cookedCount;
+		else
+			++failedCount;
+	}
+
+	PDebug::Log("Cooked " + std::to_string(cookedCount) + " textures in " + folder
+		+ (failedCount > 0 ? ", " + std::to_string(failedCount) + " failed" : ""), failedCount > 0 ? LT_WARN : LT_SUCCESS);
+
+	return cookedCount;
+}
+
+bool PTextureCooker::Read(const PString& cookedPath, const PString& sourcePath, PSCookedTexture& outTexture)
+{
+	PMappedFile& file = outTexture.file;
+	outTexture.levels.clear();
+
+	// Not cooked yet
+	if (!file.Open(cookedPath))
+		return false;
+
+	const PUi8* data = file.GetData();
+	const PUi64 fileSize = file.GetSize();
+
+	if (fileSize < sizeof(PSCookedTextureHeader))
+	{
+		PDebug::Log("Cooked texture file is too small: " + cookedPath, LT_WARN);
+		return false;
+	}
+
+	PSCookedTextureHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	const bool isValid = std::memcmp(header.identifier, cookedTextureIdentifier, sizeof(header.identifier)) == 0
+		&& header.version == cookedTextureVersion
+		&& header.fileSize == fileSize
+		&& header.compression >= TC_BC1 && header.compression <= TC_BC7
+		&& header.width > 0 && header.height > 0
+		&& header.levelCount > 0 && header.levelCount <= maxCookedLevels;
+
+	if (!isValid)
+	{
+		PDebug::Log("Cooked texture file is not valid, cook it again: " + cookedPath, LT_WARN);
+		return false;
+	}
+
+	// The source has changed since it was cooked
+	std::error_code error;
+
+	if (std::filesystem::exists(sourcePath, error) && HashSource(sourcePath) != header.sourceHash)
+	{
+		PDebug::Log("Cooked texture file is out of date, cook it again: " + cookedPath, LT_WARN);
+		return false;
+	}
+
+	const PETextureCompression compression = static_cast<PETextureCompression>(header.compression);
+	const PUi64 entriesOffset = AlignTextureOffset(sizeof(PSCookedTextureHeader));
+
+	if (entriesOffset + header.levelCount * sizeof(PSCookedTextureLevelEntry) > fileSize)
+	{
+		PDebug::Log("Cooked texture file has a broken level index: " + cookedPath, LT_WARN);
+		return false;
+	}
+
+	outTexture.levels.reserve(header.levelCount);
+
+	for (PUi32 i = 0; i < header.levelCount; ++i)
+	{
+		PSCookedTextureLevelEntry entry;
+		std::memcpy(&entry, data + entriesOffset + i * sizeof(PSCookedTextureLevelEntry), sizeof(entry));
+
+		PSCookedTextureLevel level;
+		level.width = std::max(header.width >> i, 1U);
+		level.height = std::max(header.height >> i, 1U);
+		level.data = data + entry.byteOffset;
+		level.size = entry.byteLength;
+
+		// Make sure every level is inside the file and the size the GPU expects
+		if (entry.byteOffset > fileSize || entry.byteLength > fileSize - entry.byteOffset
+			|| entry.byteLength != PBlockCompression::GetImageSize(compression, level.width, level.height))
+		{
+			PDebug::Log("Cooked texture file has a broken level: " + cookedPath, LT_WARN);
+			return false;
+		}
+
+		outTexture.levels.push_back(level);
+	}
+
+	outTexture.compression = compression;
+	outTexture.channels = header.channels;
+
+	return true;
+}
+
+PUi64 PTextureCooker::HashSource(const PString& sourcePath)
+{
+	PMappedFile source;
+
+	if (!source.Open(sourcePath))
+		return 0;
+
+	PUi64 hash = PSHash::FNV1a(&cookedTextureVersion, sizeof(cookedTextureVersion));
+	hash = PSHash::FNV1a(source.GetData(), static_cast<size_t>(source.GetSize()), hash);
+
+	// 0 is used to say there is no hash
+	return hash != 0 ? hash : 1;
+}
+
+void PTextureCooker::DownsampleImage(const TArray<PUi8>& pixels, const PUi32& width, const PUi32& height,
+	const bool& isColour, TArray<PUi8>& outPixels, PUi32& outWidth, PUi32& outHeight)
+{
+	// Table of every 8 bit value in linear space
+	static const TArray<float> linearTable = [] {
+		TArray<float> table(256);
+
+		for (int i = 0; i < 256; ++i)
+			table[i] = SRGBToLinear(static_cast<float>(i) / 255.0f);
+
+		return table;
+	}();
+
+	// Copy the size first, the outputs can be the same variables as the inputs
+	const PUi32 sourceWidth = width, sourceHeight = height;
+	outWidth = std::max(sourceWidth / 2, 1U);
+	outHeight = std::max(sourceHeight / 2, 1U);
+	outPixels.resize(static_cast<size_t>(outWidth) * outHeight * 4);
+
+	const PUi32 targetWidth = outWidth;
+
+	PThreadPool::GetPool().ParallelFor(outHeight, [&](PUi32 y)
+		{
+			// A side that is already 1 pixel reads the same row or column twice
+			const PUi64 row0 = std::min(y * 2, sourceHeight - 1);
+			const PUi64 row1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+			for (PUi32 x = 0; x < targetWidth; ++x)
+			{
+				const PUi64 column0 = std::min(x * 2, sourceWidth - 1);
+				const PUi64 column1 = std::min(x * 2 + 1, sourceWidth - 1);
+
+				const PUi8* samples[4] = {
+					&pixels[(row0 * sourceWidth + column0) * 4],
+					&pixels[(row0 * sourceWidth + column1) * 4],
+					&pixels[(row1 * sourceWidth + column0) * 4],
+					&pixels[(row1 * sourceWidth + column1) * 4]
+				};
+
+				PUi8* target = &outPixels[(static_cast<PUi64>(y) * targetWidth + x) * 4];
+
+				for (int channel = 0; channel < 4; ++channel)
+				{
+					float value;
+
+					// Alpha is always linear
+					if (isColour && channel < 3)
+					{
+						const float sum = linearTable[samples[0][channel]] + linearTable[samples[1][channel]]
+							+ linearTable[samples[2][channel]] + linearTable[samples[3][channel]];
+
+						value = LinearToSRGB(sum * 0.25f) * 255.0f;
+					}
+					else
+					{
+						value = (samples[0][channel] + samples[1][channel] + samples[2][channel] + samples[3][channel]) * 0.25f;
+					}
+
+					target[channel] = static_cast<PUi8>(std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+				}
+			}
+		});
+}
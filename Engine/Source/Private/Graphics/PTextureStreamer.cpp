@@ -0,0 +1,128 @@
+#include "Graphics/PTextureStreamer.h"
+#include "Graphics/PTexture.h"
+
+// System Libs
+#include <algorithm>
+#include <cmath>
+
+PTextureStreamer::PTextureStreamer()
+{
+	m_Frame = 0;
+	m_MemoryBudget = 256ULL * 1024 * 1024;
+	m_MipBias = 0.0f;
+	m_MemoryUsed = 0;
+}
+
+void PTextureStreamer::RequestTexture(const TShared<PTexture>& texture, const float& screenPixels)
+{
+	if (texture == nullptr || !texture->IsStreamed())
+		return;
+
+	// Find the level where one texel covers about one pixel
+	const float textureSize = static_cast<float>(std::max(texture->GetWidth(), texture->GetHeight()));
+	const float idealMip = std::log2(textureSize / std::max(screenPixels, 1.0f)) + m_MipBias;
+	const PUi32 wantedMip = std::min(static_cast<PUi32>(std::max(idealMip, 0.0f)), texture->GetTailMip());
+
+	PSStreamedTexture& streamed = m_Textures[texture.get()];
+
+	// A new texture or a new one made at the address of a destroyed texture
+	if (streamed.texture.lock() != texture)
+	{
+		streamed.texture = texture;
+		streamed.lastSeenFrame = 0;
+	}
+
+	// The largest size a texture is seen at this frame wins
+	if (streamed.lastSeenFrame != m_Frame || wantedMip < streamed.wantedMip)
+		streamed.wantedMip = wantedMip;
+
+	streamed.lastSeenFrame = m_Frame;
+}
+
+void PTextureStreamer::Update()
+{
+	m_MemoryUsed = 0;
+
+	TArray<std::pair<PSStreamedTexture*, TShared<PTexture>>> textures;
+	textures.reserve(m_Textures.size());
+
+	PUi64 targetMemory = 0;
+
+	for (auto it = m_Textures.begin(); it != m_Textures.end();)
+	{
+		TShared<PTexture> texture = it->second.texture.lock();
+
+		// Forget textures that have been destroyed
+		if (texture == nullptr)
+		{
+			it = m_Textures.erase(it);
+			continue;
+		}
+
+		PSStreamedTexture& streamed = it->second;
+
+		// Textures that weren't seen keep what they have unless the memory is needed
+		streamed.targetMip = streamed.lastSeenFrame == m_Frame ? streamed.wantedMip : texture->GetResidentMip();
+		targetMemory += texture->GetResidentSize(streamed.targetMip);
+
+		textures.emplace_back(&streamed, std::move(texture));
+		++it;
+	}
+
+	// Drop levels until the targets fit in the budget
+	// Take from the textures seen the longest ago first and the largest of those
+	while (targetMemory > m_MemoryBudget)
+	{
+		std::pair<PSStreamedTexture*, TShared<PTexture>>* victim = nullptr;
+		PUi64 victimSize = 0;
+
+		for (auto& entry : textures)
+		{
+			const PSStreamedTexture& streamed = *entry.first;
+
+			if (streamed.targetMip >= entry.second->GetTailMip())
+				continue;
+
+			const PUi64 size = entry.second->GetResidentSize(streamed.targetMip);
+
+			if (victim == nullptr || streamed.lastSeenFrame < victim->first->lastSeenFrame
+				|| (streamed.lastSeenFrame == victim->first->lastSeenFrame && size > victimSize))
+			{
+				victim = &entry;
+				victimSize = size;
+			}
+		}
+
+		// Everything is already at its smallest
+		if (victim == nullptr)
+			break;
+
+		++victim->first->targetMip;
+		targetMemory -= victimSize - victim->second->GetResidentSize(victim->first->targetMip);
+	}
+
+	// Free memory before anything new is uploaded
+	for (auto& entry : textures)
+	{
+		if (entry.first->targetMip > entry.second->GetResidentMip())
+			entry.second->SetResidentMip(entry.first->targetMip);
+	}
+
+	// Queue the textures that were seen most recently first
+	std::sort(textures.begin(), textures.end(), [](const auto& a, const auto& b)
+		{
+			return a.first->lastSeenFrame > b.first->lastSeenFrame;
+		});
+
+	for (auto& entry : textures)
+	{
+		const TShared<PTexture>& texture = entry.second;
+
+		// Jump straight to the target, the upload queue spreads the new levels over the next frames
+		// Wait for a texture's last levels to arrive before growing it again so they aren't copied twice
+		if (entry.first->targetMip < texture->GetResidentMip() && !texture->IsStreaming())
+			texture->SetResidentMip(entry.first->targetMip);
+
+		m_MemoryUsed += texture->GetMemorySize();
+	}
+}
@@ -0,0 +1,423 @@
+#include "Graphics/PUploadQueue.h"
+#include "Graphics/PGLState.h"
+
+// External Libs
+#include <GLEW/glew.h>
+
+// System Libs
+#include <chrono>
+#include <cstring>
+
+// Size of the staging buffer, a few frames of the default byte budget so the GPU can be reading older frames
+const PUi64 stagingBufferSize = 32ULL * 1024 * 1024;
+
+// Staging allocations start on this boundary so the CPU copies stay aligned
+const PUi64 stagingAlignment = 16;
+
+// Longest time a flush waits for the GPU to finish with a staging region in nanoseconds
+const PUi64 stagingWaitTimeout = 1000000000ULL;
+
+PUploadQueue::PUploadQueue()
+{
+	m_StagingBuffer = 0;
+	m_StagingData = nullptr;
+	m_StagingSize = stagingBufferSize;
+	m_Head = m_Tail = 0;
+	m_StagingUsed = m_RegionSize = 0;
+	m_HasInitStaging = false;
+	m_ByteBudget = 8ULL * 1024 * 1024;
+	m_TimeBudget = 2.0;
+	m_BytesUploaded = m_BytesPending = 0;
+}
+
+PUploadQueue::~PUploadQueue()
+{
+	// The GL context is gone by the time the shared queue is destroyed
+	// Open gl objects are deleted in Shutdown() instead
+}
+
+PUploadQueue& PUploadQueue::GetQueue()
+{
+	static PUploadQueue queue;
+
+	return queue;
+}
+
+void PUploadQueue::UploadBuffer(const void* owner, const PUi32& bufferID, const PUi64& offset, const PUi8* data, const PUi64& size,
+	const TShared<const void>& source, const std::function<void()>& onComplete)
+{
+	PSUploadJob job;
+	job.type = UT_BUFFER;
+	job.owner = owner;
+	job.targetID = bufferID;
+	job.offset = offset;
+	job.data = data;
+	job.size = size;
+	job.source = source;
+	job.onComplete = onComplete;
+
+	m_BytesPending += size;
+	m_Jobs.push_back(std::move(job));
+}
+
+void PUploadQueue::UploadTexture(const void* owner, const PUi32& textureID, const PUi32& level, const PUi32& width, const PUi32& height,
+	const PUi32& format, const bool& isCompressed, const PUi8* data, const PUi64& size,
+	const TShared<const void>& source, const std::function<void()>& onComplete)
+{
+	PSUploadJob job;
+	job.type = UT_TEXTURE;
+	job.owner = owner;
+	job.targetID = textureID;
+	job.level = level;
+	job.width = width;
+	job.height = height;
+	job.format = format;
+	job.isCompressed = isCompressed;
+	job.data = data;
+	job.size = size;
+	job.source = source;
+	job.onComplete = onComplete;
+
+	m_BytesPending += size;
+	m_Jobs.push_back(std::move(job));
+}
+
+void PUploadQueue::Cancel(const void* owner)
+{
+	for (auto it = m_Jobs.begin(); it != m_Jobs.end();)
+	{
+		if (it->owner != owner)
+		{
+			++it;
+			continue;
+		}
+
+		// Copies that were already made are left for the GPU to finish
+		m_BytesPending -= it->size - it->uploaded;
+		it = m_Jobs.erase(it);
+	}
+}
+
+void PUploadQueue::Update()
+{
+	m_BytesUploaded = 0;
+
+	// Free the staging memory from earlier frames that the GPU has finished with
+	RetireRegions(false);
+
+	if (m_Jobs.empty())
+		return;
+
+	InitStaging();
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	while (!m_Jobs.empty() && m_BytesUploaded < m_ByteBudget)
+	{
+		// Always copy something so a frame that is already slow can't stop loading
+		const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+		if (m_BytesUploaded > 0 && elapsed >= m_TimeBudget)
+			break;
+
+		PSUploadJob& job = m_Jobs.front();
+		const PUi64 copied = UploadChunk(job, m_ByteBudget - m_BytesUploaded);
+
+		// The GPU is still reading the whole staging buffer, try again next frame rather than wait
+		if (copied == 0)
+			break;
+
+		m_BytesUploaded += copied;
+		m_BytesPending -= copied;
+
+		if (job.uploaded < job.size)
+			continue;
+
+		// Remove the upload before the callback so it can queue more
+		const std::function<void()> onComplete = std::move(job.onComplete);
+		m_Jobs.pop_front();
+
+		if (onComplete)
+			onComplete();
+	}
+
+	EndRegion();
+}
+
+void PUploadQueue::Flush()
+{
+	if (m_Jobs.empty())
+		return;
+
+	InitStaging();
+
+	while (!m_Jobs.empty())
+	{
+		PSUploadJob& job = m_Jobs.front();
+		const PUi64 copied = UploadChunk(job, m_StagingSize);
+
+		if (copied == 0)
+		{
+			// Fence the copies made so far and wait for the GPU to free some of the staging buffer
+			EndRegion();
+
+			if (!RetireRegions(true))
+			{
+				PDebug::Log("Upload queue timed out waiting for the GPU, uploads were left for the next frame", LT_WARN);
+				break;
+			}
+
+			continue;
+		}
+
+		m_BytesPending -= copied;
+
+		if (job.uploaded < job.size)
+			continue;
+
+		const std::function<void()> onComplete = std::move(job.onComplete);
+		m_Jobs.pop_front();
+
+		if (onComplete)
+			onComplete();
+	}
+
+	EndRegion();
+}
+
+void PUploadQueue::Shutdown()
+{
+	for (const auto& region : m_Regions)
+		glDeleteSync(region.fence);
+
+	// Deleting the buffer also unmaps it
+	PGLState::GetState().DeleteBuffer(m_StagingBuffer);
+
+	m_Regions.clear();
+	m_Jobs.clear();
+	m_StagingData = nullptr;
+	m_Head = m_Tail = 0;
+	m_StagingUsed = m_RegionSize = 0;
+	m_HasInitStaging = false;
+	m_BytesPending = 0;
+}
+
+bool PUploadQueue::InitStaging()
+{
+	if (m_HasInitStaging)
+		return m_StagingData != nullptr;
+
+	m_HasInitStaging = true;
+
+	// Persistent mapping requires open gl 4.4
+	if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+	{
+		PDebug::Log("Persistent mapping isn't supported, uploads will be copied straight from the CPU", LT_WARN);
+		return false;
+	}
+
+	glCreateBuffers(1, &m_StagingBuffer);
+
+	if (m_StagingBuffer == 0)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Upload queue failed to create the staging buffer: " + errorMsg, LT_WARN);
+		return false;
+	}
+
+	// Coherent so writes are seen by the GPU without flushing each range
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glNamedBufferStorage(m_StagingBuffer, static_cast<GLsizeiptr>(m_StagingSize), nullptr, flags);
+	m_StagingData = static_cast<PUi8*>(glMapNamedBufferRange(m_StagingBuffer, 0, static_cast<GLsizeiptr>(m_StagingSize), flags));
+
+	if (m_StagingData == nullptr)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Upload queue failed to map the staging buffer: " + errorMsg, LT_WARN);
+
+		PGLState::GetState().DeleteBuffer(m_StagingBuffer);
+		return false;
+	}
+
+	PDebug::Log("Upload queue created a " + std::to_string(m_StagingSize / (1024 * 1024)) + " MB staging buffer", LT_SUCCESS);
+
+	return true;
+}
+
+PUi64 PUploadQueue::UploadChunk(PSUploadJob& job, const PUi64& byteLimit)
+{
+	const bool useStaging = m_StagingData != nullptr;
+	const PUi64 limit = useStaging ? std::min(byteLimit, m_StagingSize) : byteLimit;
+
+	PUi64 chunkSize = 0;
+	PUi32 firstRow = 0, rowCount = 0, rowHeight = 1;
+
+	if (job.type == UT_BUFFER)
+	{
+		chunkSize = std::min(job.size - job.uploaded, limit);
+	}
+	else
+	{
+		// Compressed textures are made of rows of 4x4 blocks so are split every 4 pixels
+		rowHeight = job.isCompressed ? 4 : 1;
+		const PUi32 totalRows = (job.height + rowHeight - 1) / rowHeight;
+		const PUi64 rowSize = job.size / totalRows;
+
+		// At least one row so a row larger than the limit can't get stuck
+		firstRow = static_cast<PUi32>(job.uploaded / rowSize);
+		rowCount = static_cast<PUi32>(std::min(std::max(limit / rowSize, static_cast<PUi64>(1)), static_cast<PUi64>(totalRows - firstRow)));
+		chunkSize = rowSize * rowCount;
+	}
+
+	const PUi8* source = job.data + job.uploaded;
+	const void* gpuSource = source;
+
+	// Buffers are written without binding them, only texture uploads from the staging buffer need a binding
+	PGLState& glState = PGLState::GetState();
+
+	if (useStaging)
+	{
+		PUi64 stagingOffset = 0;
+
+		if (!AllocateStaging(chunkSize, stagingOffset))
+			return 0;
+
+		std::memcpy(m_StagingData + stagingOffset, source, static_cast<size_t>(chunkSize));
+
+		// With a pixel buffer bound the pointer is read as an offset into it
+		gpuSource = reinterpret_cast<const void*>(static_cast<uintptr_t>(stagingOffset));
+
+		if (job.type == UT_BUFFER)
+		{
+			glCopyNamedBufferSubData(m_StagingBuffer, job.targetID, static_cast<GLintptr>(stagingOffset),
+				static_cast<GLintptr>(job.offset + job.uploaded), static_cast<GLsizeiptr>(chunkSize));
+		}
+		else
+		{
+			glState.BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+		}
+	}
+	else if (job.type == UT_BUFFER)
+	{
+		// Buffers are made with dynamic storage so they can be written directly
+		glNamedBufferSubData(job.targetID, static_cast<GLintptr>(job.offset + job.uploaded),
+			static_cast<GLsizeiptr>(chunkSize), source);
+	}
+
+	if (job.type == UT_TEXTURE)
+	{
+		const GLint y = static_cast<GLint>(firstRow * rowHeight);
+		const GLsizei height = static_cast<GLsizei>(std::min(rowCount * rowHeight, job.height - firstRow * rowHeight));
+
+		if (job.isCompressed)
+		{
+			glCompressedTextureSubImage2D(job.targetID, static_cast<GLint>(job.level), 0, y, static_cast<GLsizei>(job.width), height,
+				job.format, static_cast<GLsizei>(chunkSize), gpuSource);
+		}
+		else
+		{
+			// The pixels are always RGBA so rows match the default unpack alignment of 4
+			glTextureSubImage2D(job.targetID, static_cast<GLint>(job.level), 0, y, static_cast<GLsizei>(job.width), height,
+				job.format, GL_UNSIGNED_BYTE, gpuSource);
+		}
+
+		// Texture uploads outside the queue read from the CPU
+		if (useStaging)
+			glState.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	job.uploaded += chunkSize;
+
+	return chunkSize;
+}
+
+bool PUploadQueue::AllocateStaging(const PUi64& size, PUi64& outOffset)
+{
+	if (size > m_StagingSize)
+		return false;
+
+	// Nothing is in use so start again from the beginning
+	if (m_StagingUsed == 0)
+		m_Head = m_Tail = 0;
+
+	const PUi64 alignedHead = (m_Head + stagingAlignment - 1) / stagingAlignment * stagingAlignment;
+
+	if (m_StagingUsed == 0 || m_Head > m_Tail)
+	{
+		// The free space is after the head and before the tail
+		if (alignedHead + size <= m_StagingSize)
+		{
+			outOffset = alignedHead;
+		}
+		else if (size <= m_Tail)
+		{
+			// Skip the end of the buffer, it is freed with the region
+			outOffset = 0;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else if (m_Head < m_Tail && alignedHead + size <= m_Tail)
+	{
+		// The free space is between the head and the tail
+		outOffset = alignedHead;
+	}
+	else
+	{
+		// The head has caught up with the tail so the buffer is full
+		return false;
+	}
+
+	// Count the padding and anything skipped at the end as used until the region is freed
+	const PUi64 usedSize = outOffset >= m_Head ? outOffset + size - m_Head : m_StagingSize - m_Head + size;
+
+	m_StagingUsed += usedSize;
+	m_RegionSize += usedSize;
+	m_Head = outOffset + size;
+
+	return true;
+}
+
+void PUploadQueue::EndRegion()
+{
+	if (m_RegionSize == 0)
+		return;
+
+	PSStagingRegion region;
+	region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	region.size = m_RegionSize;
+	region.end = m_Head;
+	m_Regions.push_back(region);
+
+	m_RegionSize = 0;
+}
+
+bool PUploadQueue::RetireRegions(const bool& wait)
+{
+	bool hasRetired = false;
+
+	while (!m_Regions.empty())
+	{
+		const PSStagingRegion& region = m_Regions.front();
+
+		// Only the oldest region is waited on, the rest are checked without blocking
+		const bool shouldWait = wait && !hasRetired;
+		const GLenum result = glClientWaitSync(region.fence, shouldWait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+			shouldWait ? stagingWaitTimeout : 0);
+
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+			break;
+
+		glDeleteSync(region.fence);
+		m_StagingUsed -= region.size;
+		m_Tail = region.end;
+		m_Regions.pop_front();
+
+		hasRetired = true;
+	}
+
+	return hasRetired;
+}
@@ -0,0 +1,119 @@
+#include "Graphics/PVertexLayouts.h"
+#include "Graphics/PGLState.h"
+
+// External Libs
+#include <GLEW/glew.h>
+
+// System Libs
+#include <cstddef>
+
+PUi32 PVertexLayouts::GetVAO(const PEVertexFormat& format)
+{
+	if (format >= m_VAOs.size())
+		m_VAOs.resize(static_cast<size_t>(format) + 1, 0);
+
+	PUi32& vao = m_VAOs[format];
+
+	if (vao > 0)
+		return vao;
+
+	// Create the VAO without binding it
+	glCreateVertexArrays(1, &vao);
+
+	if (vao == 0)
+	{
+		std::string errorMsg = reinterpret_cast<const char*>(glewGetErrorString(glGetError()));
+		PDebug::Log("Failed to create VAO for vertex format " + std::to_string(format) + ": " + errorMsg, LT_WARN);
+		return 0;
+	}
+
+	SetupAttributes(vao, format);
+
+	return vao;
+}
+
+bool PVertexLayouts::Bind(const PEVertexFormat& format, const PUi32& vertexBuffer, const PUi32& indexBuffer)
+{
+	const PUi32 vao = GetVAO(format);
+
+	if (vao == 0)
+		return false;
+
+	PGLState::GetState().BindVertexBuffers(vao, vertexBuffer, PMesh::GetVertexStride(format), indexBuffer);
+
+	return true;
+}
+
+void PVertexLayouts::Shutdown()
+{
+	PGLState& glState = PGLState::GetState();
+
+	for (auto& vao : m_VAOs)
+		glState.DeleteVertexArray(vao);
+
+	m_VAOs.clear();
+}
+
+void PVertexLayouts::SetupAttributes(const PUi32& vao, const PEVertexFormat& format)
+{
+	if (format != VF_FULL)
+	{
+		// POSITION
+		// Unsigned 16 bit values normalised to 0 - 1, the shader scales them back to the bounds
+		glEnableVertexArrayAttrib(vao, 0);
+		glVertexArrayAttribFormat(vao, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PSCompactVertexData, m_Position));
+
+		// COLOUR
+		if (format == VF_COMPACT_COLOUR)
+		{
+			glEnableVertexArrayAttrib(vao, 1);
+			glVertexArrayAttribFormat(vao, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(PSCompactVertexData, m_Colour));
+		}
+		else
+		{
+			// Without an array the shader reads the constant value which is set to white
+			// The constant belongs to the context not the VAO, nothing else changes it
+			glDisableVertexArrayAttrib(vao, 1);
+			glVertexAttrib4f(1, 1.0f, 1.0f, 1.0f, 1.0f);
+		}
+
+		// TEXTURE COORDINATES
+		glEnableVertexArrayAttrib(vao, 2);
+		glVertexArrayAttribFormat(vao, 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PSCompactVertexData, m_TexCoords));
+
+		// NORMALS
+		// Packed formats must use 4 values, the shader ignores the 4th
+		glEnableVertexArrayAttrib(vao, 3);
+		glVertexArrayAttribFormat(vao, 3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PSCompactVertexData, m_Normal));
+	}
+	else
+	{
+		// Pass out the vertex data in separate formats
+		// POSITION
+		glEnableVertexArrayAttrib(vao, 0);
+		glVertexArrayAttribFormat(
+			vao,
+			0, // Location to store the data in the attribute array
+			3, // How many numbers to pass into the attribute array index
+			GL_FLOAT, // The type of data to store (only one per index)
+			GL_FALSE, // Should we normalise the values, generally no
+			offsetof(PSVertexData, m_Position) // How many bytes to skip in each vertex
+		);
+
+		// COLOUR
+		glEnableVertexArrayAttrib(vao, 1);
+		glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(PSVertexData, m_Colour));
+
+		// TEXTURE COORDINATES
+		glEnableVertexArrayAttrib(vao, 2);
+		glVertexArrayAttribFormat(vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(PSVertexData, m_TexCoords));
+
+		// NORMALS
+		glEnableVertexArrayAttrib(vao, 3);
+		glVertexArrayAttribFormat(vao, 3, 3, GL_FLOAT, GL_FALSE, offsetof(PSVertexData, m_Normal));
+	}
+
+	// Every attribute reads from the buffer attached at binding 0, the stride is given when it is attached
+	for (PUi32 attribute = 0; attribute < 4; ++attribute)
+		glVertexArrayAttribBinding(vao, attribute, 0);
+}
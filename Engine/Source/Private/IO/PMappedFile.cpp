@@ -0,0 +1,105 @@
+#include "IO/PMappedFile.h"
+
+// System Libs
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+PMappedFile::PMappedFile()
+{
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+PMappedFile::~PMappedFile()
+{
+	Close();
+}
+
+bool PMappedFile::Open(const PString& path)
+{
+	Close();
+
+#ifdef _WIN32
+	const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	// The mapping keeps the file open so the handle isn't needed anymore
+	CloseHandle(file);
+
+	if (mapping == nullptr)
+		return false;
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	// The view keeps the mapping alive until it is unmapped
+	CloseHandle(mapping);
+
+	if (view == nullptr)
+		return false;
+
+	m_Data = static_cast<const PUi8*>(view);
+	m_Size = static_cast<PUi64>(fileSize.QuadPart);
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+
+	if (file < 0)
+		return false;
+
+	struct stat fileInfo;
+
+	if (fstat(file, &fileInfo) != 0 || fileInfo.st_size <= 0)
+	{
+		close(file);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+	// The mapping keeps the file open so the descriptor isn't needed anymore
+	close(file);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	m_Data = static_cast<const PUi8*>(view);
+	m_Size = static_cast<PUi64>(fileInfo.st_size);
+#endif
+
+	return true;
+}
+
+void PMappedFile::Close()
+{
+	if (m_Data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_Data);
+#else
+	munmap(const_cast<PUi8*>(m_Data), static_cast<size_t>(m_Size));
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
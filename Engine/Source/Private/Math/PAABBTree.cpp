@@ -0,0 +1,551 @@
+#include "Math/PAABBTree.h"
+
+// System Libs
+#include <algorithm>
+
+// Amount of buckets used to estimate the SAH split
+const int sahBinCount = 12;
+
+PAABBTree::PAABBTree()
+{
+	m_Root = -1;
+	m_ProxyCount = 0;
+	m_NeedsRebuild = false;
+	m_FramesSinceRebuild = 0;
+	m_RebuildInterval = 30;
+	m_RebuildThreshold = 2.0f;
+}
+
+int PAABBTree::CreateProxy(const PSBounds& bounds, void* userData, const PUi32& userIndex, const bool& isStatic)
+{
+	const int leaf = AllocateNode();
+
+	PSAABBNode& node = m_Nodes[leaf];
+	node.bounds = bounds;
+	node.proxyBounds = bounds;
+	node.userData = userData;
+	node.userIndex = userIndex;
+	node.isStatic = isStatic;
+	node.buildArea = SurfaceArea(bounds);
+
+	// Insert straight away so the tree is always valid
+	InsertLeaf(leaf);
+
+	// Static proxies get a proper SAH build on the next update
+	if (isStatic)
+		m_NeedsRebuild = true;
+
+	++m_ProxyCount;
+
+	return leaf;
+}
+
+void PAABBTree::DestroyProxy(const int& proxyID)
+{
+	if (proxyID < 0 || proxyID >= static_cast<int>(m_Nodes.size()) || !m_Nodes[proxyID].IsLeaf())
+		return;
+
+	RemoveLeaf(proxyID);
+	FreeNode(proxyID);
+	--m_ProxyCount;
+}
+
+bool PAABBTree::MoveProxy(const int& proxyID, const PSBounds& bounds)
+{
+	PSAABBNode& node = m_Nodes[proxyID];
+
+	// Queries use the exact bounds even when the tree doesn't need updating
+	node.proxyBounds = bounds;
+
+	// Moving proxies are stored bigger than they are
+	// If the new bounds still fit there is nothing to update
+	if (!node.isStatic
+		&& glm::all(glm::lessThanEqual(node.bounds.min, bounds.min))
+		&& glm::all(glm::lessThanEqual(bounds.max, node.bounds.max)))
+		return false;
+
+	// Once a proxy moves it is treated as dynamic
+	node.isStatic = false;
+
+	// Grow the bounds so small moves in the next frames stay inside
+	const glm::vec3 margin = bounds.Extents() * 0.1f;
+	node.bounds.min = bounds.min - margin;
+	node.bounds.max = bounds.max + margin;
+	node.bounds.UpdateSphere();
+
+	// Refit the parents instead of reinserting
+	// Parts of the tree that grow too much are rebuilt in Update()
+	RefitParents(node.parent);
+
+	return true;
+}
+
+void PAABBTree::Rebuild()
+{
+	m_NeedsRebuild = false;
+
+	if (m_Root == -1)
+		return;
+
+	RebuildSubtree(m_Root);
+
+	// The whole tree is fresh so nothing is dirty anymore
+	for (const int& nodeIndex : m_DirtyNodes)
+		m_Nodes[nodeIndex].isDirty = false;
+
+	m_DirtyNodes.clear();
+	m_FramesSinceRebuild = 0;
+}
+
+void PAABBTree::Update()
+{
+	// Build the static proxies properly after they've been added
+	if (m_NeedsRebuild)
+	{
+		Rebuild();
+		return;
+	}
+
+	// Only check for partial rebuilds every few frames
+	if (++m_FramesSinceRebuild < m_RebuildInterval)
+		return;
+
+	m_FramesSinceRebuild = 0;
+
+	// Find the biggest node that has grown past the threshold since it was built
+	int worstNode = -1;
+	float worstArea = 0.0f;
+
+	for (const int& nodeIndex : m_DirtyNodes)
+	{
+		const PSAABBNode& node = m_Nodes[nodeIndex];
+
+		if (!node.isDirty || node.IsLeaf() || node.buildArea <= 0.0f)
+			continue;
+
+		const float area = SurfaceArea(node.bounds);
+
+		if (area / node.buildArea >= m_RebuildThreshold && area > worstArea)
+		{
+			worstNode = nodeIndex;
+			worstArea = area;
+		}
+	}
+
+	// Rebuild only that part of the tree
+	if (worstNode != -1)
+		RebuildSubtree(worstNode);
+
+	// Remove nodes that were rebuilt or freed from the dirty list
+	std::erase_if(m_DirtyNodes, [this](const int& nodeIndex) { return !m_Nodes[nodeIndex].isDirty; });
+}
+
+void PAABBTree::QueryFrustum(const PSFrustum& frustum, TArray<int>& outProxies, PUi32* nodesTested)
+{
+	if (m_Root == -1)
+		return;
+
+	m_Stack.clear();
+	m_Stack.push_back(m_Root);
+
+	while (!m_Stack.empty())
+	{
+		const int nodeIndex = m_Stack.back();
+		m_Stack.pop_back();
+
+		const PSAABBNode& node = m_Nodes[nodeIndex];
+
+		if (nodesTested)
+			++*nodesTested;
+
+		const PEFrustumResult result = frustum.TestBounds(node.bounds);
+
+		// Skip the whole branch
+		if (result == FR_OUTSIDE)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			// Moved proxies are stored bigger than they are so test the exact bounds before accepting them
+			if (result == FR_INTERSECT && !node.isStatic && frustum.TestBounds(node.proxyBounds) == FR_OUTSIDE)
+				continue;
+
+			outProxies.push_back(nodeIndex);
+			continue;
+		}
+
+		// Everything below is visible so add it without testing
+		// The exact bounds are inside the enlarged bounds so they are visible too
+		if (result == FR_INSIDE)
+		{
+			CollectLeaves(nodeIndex, outProxies, false);
+			continue;
+		}
+
+		m_Stack.push_back(node.left);
+		m_Stack.push_back(node.right);
+	}
+}
+
+void PAABBTree::QueryBounds(const PSBounds& bounds, TArray<int>& outProxies)
+{
+	if (m_Root == -1)
+		return;
+
+	m_Stack.clear();
+	m_Stack.push_back(m_Root);
+
+	while (!m_Stack.empty())
+	{
+		const int nodeIndex = m_Stack.back();
+		m_Stack.pop_back();
+
+		const PSAABBNode& node = m_Nodes[nodeIndex];
+
+		// Skip the branch if the boxes don't overlap
+		if (glm::any(glm::lessThan(node.bounds.max, bounds.min)) || glm::any(glm::lessThan(bounds.max, node.bounds.min)))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			// Test the exact bounds of moved proxies before accepting them
+			if (!node.isStatic
+				&& (glm::any(glm::lessThan(node.proxyBounds.max, bounds.min)) || glm::any(glm::lessThan(bounds.max, node.proxyBounds.min))))
+				continue;
+
+			outProxies.push_back(nodeIndex);
+			continue;
+		}
+
+		m_Stack.push_back(node.left);
+		m_Stack.push_back(node.right);
+	}
+}
+
+int PAABBTree::AllocateNode()
+{
+	// Reuse a free node if there is one
+	if (!m_FreeNodes.empty())
+	{
+		const int nodeIndex = m_FreeNodes.back();
+		m_FreeNodes.pop_back();
+		m_Nodes[nodeIndex] = PSAABBNode();
+		return nodeIndex;
+	}
+
+	m_Nodes.push_back(PSAABBNode());
+	return static_cast<int>(m_Nodes.size()) - 1;
+}
+
+void PAABBTree::FreeNode(const int& nodeIndex)
+{
+	// Reset the node so it doesn't show up as dirty
+	m_Nodes[nodeIndex] = PSAABBNode();
+	m_FreeNodes.push_back(nodeIndex);
+}
+
+void PAABBTree::InsertLeaf(const int& leaf)
+{
+	if (m_Root == -1)
+	{
+		m_Root = leaf;
+		m_Nodes[leaf].parent = -1;
+		return;
+	}
+
+	const PSBounds leafBounds = m_Nodes[leaf].bounds;
+
+	// Walk down the tree to find the sibling with the lowest SAH cost
+	int index = m_Root;
+
+	while (!m_Nodes[index].IsLeaf())
+	{
+		const PSAABBNode& node = m_Nodes[index];
+
+		const float area = SurfaceArea(node.bounds);
+		const float combinedArea = SurfaceArea(Union(node.bounds, leafBounds));
+
+		// Cost of making a new parent for this node and the leaf
+		const float cost = 2.0f * combinedArea;
+
+		// Cost added to every node above if we keep going down
+		const float inheritanceCost = 2.0f * (combinedArea - area);
+
+		// Cost of going down each child
+		float childCosts[2];
+		const int children[2] = { node.left, node.right };
+
+		for (int i = 0; i < 2; ++i)
+		{
+			const PSAABBNode& child = m_Nodes[children[i]];
+			const float childCombined = SurfaceArea(Union(child.bounds, leafBounds));
+
+			if (child.IsLeaf())
+				childCosts[i] = childCombined + inheritanceCost;
+			else
+				childCosts[i] = (childCombined - SurfaceArea(child.bounds)) + inheritanceCost;
+		}
+
+		// Stop here if going down is more expensive
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+
+		index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	// Create a new parent for the sibling and the leaf
+	const int sibling = index;
+	const int oldParent = m_Nodes[sibling].parent;
+	const int newParent = AllocateNode();
+
+	m_Nodes[newParent].parent = oldParent;
+	m_Nodes[newParent].left = sibling;
+	m_Nodes[newParent].right = leaf;
+	m_Nodes[newParent].bounds = Union(leafBounds, m_Nodes[sibling].bounds);
+	m_Nodes[newParent].buildArea = SurfaceArea(m_Nodes[newParent].bounds);
+
+	m_Nodes[sibling].parent = newParent;
+	m_Nodes[leaf].parent = newParent;
+
+	if (oldParent == -1)
+	{
+		m_Root = newParent;
+	}
+	else
+	{
+		if (m_Nodes[oldParent].left == sibling)
+			m_Nodes[oldParent].left = newParent;
+		else
+			m_Nodes[oldParent].right = newParent;
+
+		// Grow the nodes above to fit the leaf
+		RefitParents(oldParent);
+	}
+}
+
+void PAABBTree::RemoveLeaf(const int& leaf)
+{
+	if (leaf == m_Root)
+	{
+		m_Root = -1;
+		return;
+	}
+
+	const int parent = m_Nodes[leaf].parent;
+	const int grandParent = m_Nodes[parent].parent;
+	const int sibling = m_Nodes[parent].left == leaf ? m_Nodes[parent].right : m_Nodes[parent].left;
+
+	// Replace the parent with the sibling
+	if (grandParent == -1)
+	{
+		m_Root = sibling;
+		m_Nodes[sibling].parent = -1;
+	}
+	else
+	{
+		if (m_Nodes[grandParent].left == parent)
+			m_Nodes[grandParent].left = sibling;
+		else
+			m_Nodes[grandParent].right = sibling;
+
+		m_Nodes[sibling].parent = grandParent;
+		RefitParents(grandParent);
+	}
+
+	FreeNode(parent);
+	m_Nodes[leaf].parent = -1;
+}
+
+void PAABBTree::RefitParents(int nodeIndex)
+{
+	while (nodeIndex != -1)
+	{
+		PSAABBNode& node = m_Nodes[nodeIndex];
+		node.bounds = Union(m_Nodes[node.left].bounds, m_Nodes[node.right].bounds);
+
+		// Remember nodes that have grown so they can be checked for a rebuild
+		if (!node.isDirty && SurfaceArea(node.bounds) > node.buildArea)
+		{
+			node.isDirty = true;
+			m_DirtyNodes.push_back(nodeIndex);
+		}
+
+		nodeIndex = node.parent;
+	}
+}
+
+void PAABBTree::RebuildSubtree(const int& nodeIndex)
+{
+	if (m_Nodes[nodeIndex].IsLeaf())
+		return;
+
+	// Remember where the subtree is attached
+	const int parent = m_Nodes[nodeIndex].parent;
+	const bool isLeftChild = parent != -1 && m_Nodes[parent].left == nodeIndex;
+
+	// Take all the leaves out and free the internal nodes
+	TArray<int> leaves;
+	CollectLeaves(nodeIndex, leaves, true);
+
+	// Build a new subtree and attach it in the same place
+	const int newRoot = BuildSAH(leaves.data(), static_cast<int>(leaves.size()));
+	m_Nodes[newRoot].parent = parent;
+
+	if (parent == -1)
+		m_Root = newRoot;
+	else if (isLeftChild)
+		m_Nodes[parent].left = newRoot;
+	else
+		m_Nodes[parent].right = newRoot;
+}
+
+int PAABBTree::BuildSAH(int* leaves, const int& count)
+{
+	if (count == 1)
+		return leaves[0];
+
+	// Find the bounds of the leaf centers to split along
+	PSBounds centerBounds;
+
+	for (int i = 0; i < count; ++i)
+		centerBounds.AddPoint(m_Nodes[leaves[i]].bounds.center);
+
+	// Split along the longest axis
+	const glm::vec3 size = centerBounds.max - centerBounds.min;
+	int axis = 0;
+
+	if (size.y > size.x)
+		axis = 1;
+
+	if (size.z > size[axis])
+		axis = 2;
+
+	int mid = count / 2;
+
+	if (size[axis] > 0.0f)
+	{
+		// Sort the leaves into buckets along the axis
+		PSBounds binBounds[sahBinCount];
+		int binCounts[sahBinCount] = { 0 };
+		const float binScale = static_cast<float>(sahBinCount) / size[axis];
+
+		auto getBin = [&](const int& leaf)
+			{
+				const int bin = static_cast<int>((m_Nodes[leaf].bounds.center[axis] - centerBounds.min[axis]) * binScale);
+				return std::min(bin, sahBinCount - 1);
+			};
+
+		for (int i = 0; i < count; ++i)
+		{
+			const int bin = getBin(leaves[i]);
+			++binCounts[bin];
+			binBounds[bin] = Union(binBounds[bin], m_Nodes[leaves[i]].bounds);
+		}
+
+		// Find the split between buckets with the lowest cost
+		// Cost = area of each side * amount of leaves on that side
+		float bestCost = FLT_MAX;
+		int bestSplit = -1;
+
+		for (int split = 0; split < sahBinCount - 1; ++split)
+		{
+			PSBounds leftBounds, rightBounds;
+			int leftCount = 0, rightCount = 0;
+
+			for (int i = 0; i <= split; ++i)
+			{
+				leftBounds = Union(leftBounds, binBounds[i]);
+				leftCount += binCounts[i];
+			}
+
+			for (int i = split + 1; i < sahBinCount; ++i)
+			{
+				rightBounds = Union(rightBounds, binBounds[i]);
+				rightCount += binCounts[i];
+			}
+
+			if (leftCount == 0 || rightCount == 0)
+				continue;
+
+			const float cost = leftCount * SurfaceArea(leftBounds) + rightCount * SurfaceArea(rightBounds);
+
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = split;
+			}
+		}
+
+		if (bestSplit != -1)
+		{
+			int* split = std::partition(leaves, leaves + count,
+				[&](const int& leaf) { return getBin(leaf) <= bestSplit; });
+
+			mid = static_cast<int>(split - leaves);
+		}
+	}
+
+	// Fall back to splitting the middle if the buckets couldn't split the leaves
+	if (mid <= 0 || mid >= count)
+	{
+		mid = count / 2;
+		std::nth_element(leaves, leaves + mid, leaves + count,
+			[&](const int& a, const int& b) { return m_Nodes[a].bounds.center[axis] < m_Nodes[b].bounds.center[axis]; });
+	}
+
+	// Build the children first so the node pool doesn't move while we use it
+	const int left = BuildSAH(leaves, mid);
+	const int right = BuildSAH(leaves + mid, count - mid);
+
+	const int nodeIndex = AllocateNode();
+	PSAABBNode& node = m_Nodes[nodeIndex];
+	node.left = left;
+	node.right = right;
+	node.bounds = Union(m_Nodes[left].bounds, m_Nodes[right].bounds);
+	node.buildArea = SurfaceArea(node.bounds);
+
+	m_Nodes[left].parent = nodeIndex;
+	m_Nodes[right].parent = nodeIndex;
+
+	return nodeIndex;
+}
+
+void PAABBTree::CollectLeaves(const int& nodeIndex, TArray<int>& outLeaves, const bool& freeInternal)
+{
+	TArray<int> stack;
+	stack.push_back(nodeIndex);
+
+	while (!stack.empty())
+	{
+		const int index = stack.back();
+		stack.pop_back();
+
+		if (m_Nodes[index].IsLeaf())
+		{
+			outLeaves.push_back(index);
+			continue;
+		}
+
+		stack.push_back(m_Nodes[index].left);
+		stack.push_back(m_Nodes[index].right);
+
+		if (freeInternal)
+			FreeNode(index);
+	}
+}
+
+float PAABBTree::SurfaceArea(const PSBounds& bounds)
+{
+	if (!bounds.IsValid())
+		return 0.0f;
+
+	const glm::vec3 size = bounds.max - bounds.min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+PSBounds PAABBTree::Union(const PSBounds& a, const PSBounds& b)
+{
+	PSBounds result = a;
+	result.AddBounds(b);
+	return result;
+}
@@ -3,6 +3,7 @@
 #include "Debug/PDebug.h"
 #include "Listeners/PInput.h"
 #include "Graphics/PSCamera.h"
+#include "Graphics/PAssetManager.h"
 
 // External Libs
 #include <SDL/SDL.h>
@@ -15,6 +16,7 @@ PWindow::PWindow()
 	m_CameraRotation = glm::vec3(0.0f);
 	m_CanZoom = false;
 	m_InputMode = false;
+	m_ShowStats = false;
 
 	std::cout << "Window created" << std::endl;
 }
@@ -97,6 +99,53 @@ void PWindow::RegisterInput(const TShared<PInput>& m_Input)
 				m_InputMode = !m_Input->IsCursorHidden();
 			}
 
+			// Toggle drawing with multi draw indirect
+			if (key == SDL_SCANCODE_F1 && m_GraphicsEngine)
+			{
+				m_GraphicsEngine->SetIndirectDrawEnabled(!m_GraphicsEngine->IsIndirectDrawEnabled());
+			}
+
+			// Toggle hiding meshes behind occluders
+			if (key == SDL_SCANCODE_F3 && m_GraphicsEngine)
+			{
+				m_GraphicsEngine->SetOcclusionCullingEnabled(!m_GraphicsEngine->IsOcclusionCullingEnabled());
+			}
+
+			// Toggle levels of detail
+			if (key == SDL_SCANCODE_F4 && m_GraphicsEngine)
+			{
+				m_GraphicsEngine->SetLODEnabled(!m_GraphicsEngine->IsLODEnabled());
+			}
+
+			// Log the memory and references of every loaded asset
+			if (key == SDL_SCANCODE_F5 && m_GraphicsEngine)
+			{
+				if (const auto& assetRef = m_GraphicsEngine->GetAssetManager().lock())
+					assetRef->LogAssets();
+			}
+
+			// Pack the shared geometry buffer and log how fragmented it was
+			if (key == SDL_SCANCODE_F6 && m_GraphicsEngine)
+			{
+				m_GraphicsEngine->CompactGeometry();
+			}
+
+			// Toggle copying material textures into texture arrays
+			if (key == SDL_SCANCODE_F7 && m_GraphicsEngine)
+			{
+				m_GraphicsEngine->SetTextureArraysEnabled(!m_GraphicsEngine->IsTextureArraysEnabled());
+			}
+
+			// Toggle the render stats in the window title
+			if (key == SDL_SCANCODE_F2)
+			{
+				m_ShowStats = !m_ShowStats;
+				m_StatsText = "";
+
+				if (!m_ShowStats)
+					SDL_SetWindowTitle(m_SDLWindow, m_Params.title.c_str());
+			}
+
 			if (key == SDL_SCANCODE_W) //  Forward
 			{
 				m_CameraDirection.z += 1.0f;
@@ -221,5 +270,18 @@ void PWindow::Render()
 			
 		}
 		m_GraphicsEngine->Render(m_SDLWindow);
+
+		// Report the frame stats in the title
+		if (m_ShowStats)
+		{
+			const PString statsText = m_GraphicsEngine->GetRenderStats().ToString();
+
+			// Setting the title is slow so only do it when the stats change
+			if (statsText != m_StatsText)
+			{
+				m_StatsText = statsText;
+				SDL_SetWindowTitle(m_SDLWindow, (m_Params.title + " | " + m_StatsText).c_str());
+			}
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "Threading/PThreadPool.h"
+
+// System Libs
+#include <atomic>
+#include <algorithm>
+
+PThreadPool::PThreadPool(const PUi32& threadCount)
+{
+	m_ShouldStop = false;
+
+	PUi32 workers = threadCount;
+
+	// Leave a thread free for the main thread
+	if (workers == 0)
+	{
+		const PUi32 cpuThreads = std::thread::hardware_concurrency();
+		workers = cpuThreads > 1 ? cpuThreads - 1 : 1;
+	}
+
+	for (PUi32 i = 0; i < workers; ++i)
+		m_Threads.emplace_back(&PThreadPool::WorkerLoop, this);
+
+	PDebug::Log("Thread pool created with (" + std::to_string(workers) + ") workers");
+}
+
+PThreadPool::~PThreadPool()
+{
+	// Wake every worker and tell them to exit
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_ShouldStop = true;
+	}
+
+	m_JobAdded.notify_all();
+
+	for (auto& thread : m_Threads)
+		thread.join();
+}
+
+PThreadPool& PThreadPool::GetPool()
+{
+	static PThreadPool pool;
+
+	return pool;
+}
+
+void PThreadPool::AddJob(const std::function<void()>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Jobs.push_back(job);
+	}
+
+	m_JobAdded.notify_one();
+}
+
+void PThreadPool::ParallelFor(const PUi32& count, const std::function<void(PUi32)>& func)
+{
+	if (count == 0)
+		return;
+
+	// Shared between the helpers so they can outlive this function safely
+	struct PSParallelState
+	{
+		std::atomic<PUi32> nextIndex = 0;
+		std::atomic<PUi32> completed = 0;
+	};
+
+	const auto state = TMakeShared<PSParallelState>();
+
+	// Each helper takes indices until there are none left
+	// Helpers that start late will find nothing to do and exit
+	auto worker = [state, count, func]()
+		{
+			PUi32 index = 0;
+
+			while ((index = state->nextIndex.fetch_add(1)) < count)
+			{
+				func(index);
+				state->completed.fetch_add(1);
+			}
+		};
+
+	const PUi32 helpers = std::min(GetThreadCount(), count - 1);
+
+	for (PUi32 i = 0; i < helpers; ++i)
+		AddJob(worker);
+
+	// Help on this thread so nested calls can never wait on themselves
+	worker();
+
+	// Wait for the indices that the helpers took
+	while (state->completed.load() < count)
+		std::this_thread::yield();
+}
+
+void PThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			// Sleep until there is a job or the pool is destroyed
+			m_JobAdded.wait(lock, [this]() { return m_ShouldStop || !m_Jobs.empty(); });
+
+			if (m_ShouldStop && m_Jobs.empty())
+				return;
+
+			job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+		}
+
+		job();
+	}
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <string>
 
 enum PELogType : uint8_t
@@ -15,8 +16,12 @@ class PDebug
 {
 public:
 	// Log a message to the console based on the log type
+	// Safe to call from worker threads, messages won't be mixed together
 	static void Log(const std::string& message, const PELogType& logType = LT_LOG)
 	{
+		static std::mutex logMutex;
+		std::lock_guard<std::mutex> lock(logMutex);
+
 		std::cout << message << std::endl;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include "Game/GameObjects/PObject.h"
+
+class PPortalGraph;
+
+// A door that closes a portal so the cells behind it aren't rendered while it's shut
+class PDoor : public PObject
+{
+public:
+	PDoor();
+
+	// Set the portal the door sits in
+	// The portal is updated to match if the door is open or closed
+	void SetPortal(const TWeak<PPortalGraph>& portalGraph, const PUi32& portalIndex);
+
+	// Open the door and the portal
+	void Open() { SetOpen(true); }
+
+	// Close the door and the portal
+	void Close() { SetOpen(false); }
+
+	// Open the door if closed and close it if open
+	void Toggle() { SetOpen(!m_IsOpen); }
+
+	// Test if the door is open
+	bool IsOpen() const { return m_IsOpen; }
+
+private:
+	// Set the door and portal open or closed
+	void SetOpen(const bool& isOpen);
+
+	// The graph that owns the portal
+	TWeak<PPortalGraph> m_PortalGraph;
+
+	// Index of the portal in the graph, -1 if it has none
+	int m_PortalIndex;
+
+	// If the door is open
+	bool m_IsOpen;
+};
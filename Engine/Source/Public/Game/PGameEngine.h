@@ -26,6 +26,9 @@ public:
 	// Return the delta time between frames as a float
 	float DeltaTimeF() const { return static_cast<float>(m_DeltaTime); }
 
+	// Return a weak version of the window
+	TWeak<PWindow> GetWindow() const { return m_Window; }
+
 	// Create a PObject type
 	template<typename T, std::enable_if_t<std::is_base_of_v<PObject, T>, T>* = nullptr>
 	TWeak<T> CreateObject()
@@ -0,0 +1,89 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Graphics/PMesh.h"
+
+// System Libs
+#include <unordered_map>
+
+class PModel;
+class PTexture;
+struct PSMaterial;
+
+// Type of asset stored in the asset manager
+enum PEAssetType : PUi8
+{
+	AT_MODEL = 0U,
+	AT_TEXTURE,
+	AT_MATERIAL
+};
+
+// Memory use and reference count of an asset
+struct PSAssetInfo
+{
+	// Type of the asset
+	PEAssetType type = AT_MODEL;
+
+	// Key the asset is stored with
+	PString key;
+
+	// Memory used on the GPU in bytes
+	PUi64 memorySize = 0;
+
+	// References held outside of the asset manager
+	// For models this is the amount of instances
+	PUi32 refCount = 0;
+};
+
+// Loads assets once and shares them with everything that asks for the same asset
+// Models and textures are keyed by their normalised path and import options
+class PAssetManager
+{
+public:
+	PAssetManager() = default;
+	~PAssetManager();
+
+	// Get the model for a path and settings, starts loading it if it hasn't been loaded
+	// The model returned is the shared source, draw instances of it made with PModel::CreateInstance()
+	TShared<PModel> LoadModel(const PString& path, const PSMeshSettings& meshSettings = PSMeshSettings());
+
+	// Get the texture for a path, starts loading it if it hasn't been loaded
+	// Textures decode on the thread pool so many load in about the time of the slowest one
+	// Textures are streamed, only the small mip maps are uploaded until the renderer asks for more
+	// The texture is LS_LOADING until Update() uploads it, a failed texture is dropped so it can be tried again
+	TShared<PTexture> LoadTexture(const PString& name, const PString& path);
+
+	// Get a material by name, creates it if it doesn't exist
+	TShared<PSMaterial> GetMaterial(const PString& name);
+
+	// Upload models and textures that have finished loading, must be called on the GL thread
+	void Update();
+
+	// Remove assets that are only referenced by the asset manager
+	// Returns the amount of assets removed
+	PUi32 ReleaseUnused();
+
+	// Get the memory use and reference count of every asset
+	TArray<PSAssetInfo> GetAssetInfo() const;
+
+	// Log the memory use and reference count of every asset
+	void LogAssets() const;
+
+	// Turn a path into the form used in keys so different ways of writing it match
+	static PString NormalisePath(const PString& path);
+
+private:
+	// Source models by path and settings
+	std::unordered_map<PString, TShared<PModel>> m_Models;
+
+	// Textures by path
+	std::unordered_map<PString, TShared<PTexture>> m_Textures;
+
+	// Materials by name
+	std::unordered_map<PString, TShared<PSMaterial>> m_Materials;
+
+	// Source models that are still loading
+	TArray<TShared<PModel>> m_LoadingModels;
+
+	// Textures that are still loading
+	TArray<TShared<PTexture>> m_LoadingTextures;
+};
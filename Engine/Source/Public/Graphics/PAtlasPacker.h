@@ -0,0 +1,53 @@
+#pragma once
+#include "EngineTypes.h"
+
+// A row of the atlas that entries of a similar height are placed along
+struct PSAtlasShelf
+{
+	// Top of the shelf in pixels
+	PUi32 y = 0;
+
+	// Height of the tallest entry the shelf can hold
+	PUi32 height = 0;
+
+	// Pixels used from the left of the shelf
+	PUi32 usedWidth = 0;
+};
+
+// Places rectangles into a square page using shelves
+// Each entry goes on the shelf it wastes the least height on, a new shelf is opened below the last one if none fit
+// Positions and sizes are rounded up to the alignment so mip maps and compressed blocks stay lined up
+// Space is only given back once every entry on the page has been freed
+class PAtlasPacker
+{
+public:
+	PAtlasPacker();
+
+	// Forget every entry and start again with an empty page
+	void Reset(const PUi32& size, const PUi32& alignment);
+
+	// Find a place for a rectangle, returns false if the page has no room for it
+	bool Allocate(const PUi32& width, const PUi32& height, PUi32& outX, PUi32& outY);
+
+	// Give an entry back, the page is emptied when the last one is freed
+	void Free();
+
+	// Get the amount of entries on the page
+	PUi32 GetEntryCount() const { return m_EntryCount; }
+
+	// Get the width and height of the page in pixels
+	PUi32 GetSize() const { return m_Size; }
+
+private:
+	// Shelves from the top of the page down
+	TArray<PSAtlasShelf> m_Shelves;
+
+	// Width and height of the page
+	PUi32 m_Size;
+
+	// Positions and sizes are multiples of this
+	PUi32 m_Alignment;
+
+	// Amount of entries on the page
+	PUi32 m_EntryCount;
+};
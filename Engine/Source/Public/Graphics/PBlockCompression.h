@@ -0,0 +1,57 @@
+#pragma once
+#include "EngineTypes.h"
+
+// Block compression formats the GPU can sample directly
+enum PETextureCompression : PUi8
+{
+	// Pick a format from the image when cooking
+	TC_AUTO = 0U,
+
+	// RGB at 4 bits per pixel, no alpha
+	TC_BC1,
+
+	// RGBA at 8 bits per pixel, BC1 colour with a separate alpha block
+	TC_BC3,
+
+	// Two independent channels at 8 bits per pixel, used for normal maps
+	TC_BC5,
+
+	// High quality RGBA at 8 bits per pixel
+	TC_BC7
+};
+
+// CPU encoders for 4x4 blocks of RGBA8 pixels
+class PBlockCompression
+{
+public:
+	// Get the size of an encoded 4x4 block in bytes
+	static PUi32 GetBlockSize(const PETextureCompression& compression);
+
+	// Get the size of a compressed image in bytes
+	static PUi64 GetImageSize(const PETextureCompression& compression, const PUi32& width, const PUi32& height);
+
+	// Get the open gl internal format of a compression format
+	static PUi32 GetGLFormat(const PETextureCompression& compression);
+
+	// Compress a whole RGBA8 image, blocks past the edges repeat the last row and column
+	// Rows of blocks are encoded in parallel on the thread pool
+	static void CompressImage(const PUi8* pixels, const PUi32& width, const PUi32& height,
+		const PETextureCompression& compression, TArray<PUi8>& outData);
+
+	// Encode 16 RGBA8 pixels in row order into an 8 byte BC1 block
+	static void EncodeBC1(const PUi8* pixels, PUi8* outBlock);
+
+	// Encode 16 RGBA8 pixels in row order into a 16 byte BC3 block
+	static void EncodeBC3(const PUi8* pixels, PUi8* outBlock);
+
+	// Encode the red and green of 16 RGBA8 pixels in row order into a 16 byte BC5 block
+	static void EncodeBC5(const PUi8* pixels, PUi8* outBlock);
+
+	// Encode 16 RGBA8 pixels in row order into a 16 byte BC7 block
+	// Only uses mode 6, a single RGBA endpoint pair with 4 bit indices
+	static void EncodeBC7(const PUi8* pixels, PUi8* outBlock);
+
+private:
+	// Encode one channel of 16 RGBA8 pixels into an 8 byte BC4 block
+	static void EncodeBC4(const PUi8* pixels, const PUi32& channel, PUi8* outBlock);
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include "EngineTypes.h"
+
+// A block handed out by PBufferAllocator
+struct PSBufferAllocation
+{
+	// Block ID in the allocator, stays the same when the allocator is compacted
+	PUi32 block = UINT32_MAX;
+
+	// Offset and size of the block in elements at the time it was allocated
+	// Use PBufferAllocator::GetOffset() for the current offset after a compaction
+	PUi32 offset = 0;
+	PUi32 size = 0;
+
+	// Test if the allocation holds a block
+	bool IsValid() const { return block != UINT32_MAX; }
+};
+
+// A range of a buffer that moved when the allocator was compacted, in elements
+struct PSBufferMove
+{
+	PUi32 from = 0;
+	PUi32 to = 0;
+	PUi32 size = 0;
+};
+
+// A range of a buffer tracked by PBufferAllocator, free or allocated
+struct PSBufferBlock
+{
+	// Range of the block in elements
+	PUi32 offset = 0;
+	PUi32 size = 0;
+
+	// Neighbouring blocks in the buffer
+	PUi32 prevPhysical = UINT32_MAX;
+	PUi32 nextPhysical = UINT32_MAX;
+
+	// Neighbouring blocks in the same bin, only used while free
+	PUi32 prevFree = UINT32_MAX;
+	PUi32 nextFree = UINT32_MAX;
+
+	// If the block is in a bin
+	bool isFree = false;
+};
+
+// Usage and fragmentation of an allocator
+struct PSBufferAllocatorStats
+{
+	// Elements the allocator manages
+	PUi32 capacity = 0;
+
+	// Elements in allocated blocks
+	PUi32 used = 0;
+
+	// Amount of allocated blocks
+	PUi32 allocationCount = 0;
+
+	// Amount of free blocks, neighbouring free blocks are always merged
+	PUi32 freeBlockCount = 0;
+
+	// Largest single allocation that would fit without growing
+	PUi32 largestFreeBlock = 0;
+
+	// Fraction of the capacity in use
+	float GetUtilisation() const { return capacity > 0 ? static_cast<float>(used) / static_cast<float>(capacity) : 0.0f; }
+
+	// Fraction of the free space that isn't in the largest free block, 0 is all in one block
+	float GetFragmentation() const
+	{
+		const PUi32 freeSize = capacity - used;
+		return freeSize > 0 ? 1.0f - static_cast<float>(largestFreeBlock) / static_cast<float>(freeSize) : 0.0f;
+	}
+};
+
+// Hands out ranges of a buffer using the two level segregated fit scheme (TLSF)
+// Free blocks are sorted into bins by the top bit of their size and the 3 bits after it
+// A bitmap of the bins that have blocks finds a block that fits in constant time
+// Blocks remember their neighbours in the buffer so freeing one merges it with the free space around it
+// The allocator only tracks offsets, the caller owns the GPU buffer and copies the data
+class PBufferAllocator
+{
+public:
+	PBufferAllocator();
+
+	// Forget every block and manage a new amount of elements
+	void Reset(const PUi32& capacity);
+
+	// Take a block of elements, returns false if no free block is big enough
+	bool Allocate(const PUi32& size, PSBufferAllocation& outAllocation);
+
+	// Return a block, it is merged with any free blocks next to it
+	void Free(const PSBufferAllocation& allocation);
+
+	// Add elements to the end of the managed range
+	void Grow(const PUi32& newCapacity);
+
+	// Move every allocated block to the start of the range, in order, leaving one free block at the end
+	// The moves are returned from the lowest offset up, block IDs stay the same
+	void Compact(TArray<PSBufferMove>& outMoves);
+
+	// Get the current offset of an allocated block in elements
+	PUi32 GetOffset(const PSBufferAllocation& allocation) const { return m_Blocks[allocation.block].offset; }
+
+	// Get the amount of elements the allocator manages
+	PUi32 GetCapacity() const { return m_Capacity; }
+
+	// Get the usage and fragmentation of the allocator
+	PSBufferAllocatorStats GetStats() const;
+
+private:
+	// Find the bin a free block of a size is stored in
+	static void GetBin(const PUi32& size, PUi32& outFirst, PUi32& outSecond);
+
+	// Get a block from the pool of unused block IDs
+	PUi32 CreateBlock();
+
+	// Return a block ID to the pool
+	void DestroyBlock(const PUi32& block);
+
+	// Add a free block to its bin
+	void InsertFree(const PUi32& block);
+
+	// Take a free block out of its bin
+	void RemoveFree(const PUi32& block);
+
+	// Every block including the unused ones waiting in the pool
+	TArray<PSBufferBlock> m_Blocks;
+
+	// Block IDs that can be reused
+	TArray<PUi32> m_UnusedBlocks;
+
+	// First free block in each bin
+	TArray<PUi32> m_BinHeads;
+
+	// Bit for each first level that has a bin with a free block
+	PUi32 m_FirstLevelMap;
+
+	// Bit for each second level bin with a free block, one mask per first level
+	TArray<PUi8> m_SecondLevelMaps;
+
+	// First and last block in the buffer, the last one grows
+	PUi32 m_FirstBlock, m_LastBlock;
+
+	// Elements the allocator manages
+	PUi32 m_Capacity;
+
+	// Elements in allocated blocks
+	PUi32 m_Used;
+
+	// Amount of allocated blocks
+	PUi32 m_AllocationCount;
+};
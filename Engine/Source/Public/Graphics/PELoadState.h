@@ -0,0 +1,18 @@
+#pragma once
+#include "EngineTypes.h"
+
+// Progress of an asset that loads on a worker thread
+enum PELoadState : PUi8
+{
+	// Nothing has been loaded
+	LS_NONE = 0U,
+
+	// Being read and converted on a worker thread or waiting to be uploaded
+	LS_LOADING,
+
+	// Everything is on the GPU and can be used
+	LS_READY,
+
+	// The load failed, the asset has no GPU data
+	LS_FAILED
+};
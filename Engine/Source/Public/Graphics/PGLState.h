@@ -0,0 +1,147 @@
+#pragma once
+#include "EngineTypes.h"
+
+// A range of a buffer bound to an indexed binding point
+struct PSGLBufferRange
+{
+	PUi32 buffer = UINT32_MAX;
+	PUi64 offset = 0;
+	PUi64 size = 0;
+};
+
+// Vertex and index buffers attached to a VAO
+struct PSGLVertexArrayBuffers
+{
+	PUi32 vao = 0;
+	PUi32 vertexBuffer = UINT32_MAX;
+	PUi32 elementBuffer = UINT32_MAX;
+};
+
+// Remembers the open gl state the engine has set so calls that wouldn't change anything are never made
+// Everything starts unknown so the first call for each piece of state is always made
+// Every bind and delete in the engine must go through the cache or the state it remembers will be wrong
+// Open gl state belongs to the context so there is a single cache
+class PGLState
+{
+public:
+	// Get the cache for the engine's context
+	static PGLState& GetState()
+	{
+		static PGLState state;
+		return state;
+	}
+
+	// Use a shader program for the next draws
+	void UseProgram(const PUi32& program);
+
+	// Bind a vertex array object
+	// The element array buffer is part of the VAO so changing the VAO also changes it
+	void BindVertexArray(const PUi32& vao);
+
+	// Bind a VAO with a vertex buffer at binding 0 and an element buffer attached
+	// The buffers are only attached if they aren't already, so VAOs can be shared by meshes with the same layout
+	void BindVertexBuffers(const PUi32& vao, const PUi32& vertexBuffer, const PUi32& stride, const PUi32& elementBuffer);
+
+	// Bind a texture to a unit using its target
+	// Textures made with glGenTextures must be bound this way before they can be multi bound
+	void BindTexture(const PUi32& unit, const PUi32& target, const PUi32& texture);
+
+	// Bind textures to a run of units starting at the first unit, 0 unbinds a unit
+	// Only the units that changed are bound, all together with glBindTextures when open gl 4.4 is available
+	void BindTextures(const PUi32& firstUnit, const PUi32& count, const PUi32* textures);
+
+	// Bind a buffer to a target
+	void BindBuffer(const PUi32& target, const PUi32& buffer);
+
+	// Bind a range of a buffer to an indexed shader storage or uniform buffer binding
+	// Also binds the buffer to the target like open gl does
+	void BindBufferRange(const PUi32& target, const PUi32& index, const PUi32& buffer, const PUi64& offset, const PUi64& size);
+
+	// Bind a whole buffer to an indexed shader storage or uniform buffer binding
+	void BindBufferBase(const PUi32& target, const PUi32& index, const PUi32& buffer);
+
+	// Turn a capability like GL_DEPTH_TEST or GL_BLEND on or off
+	void SetEnabled(const PUi32& capability, const bool& enabled);
+
+	// Set how new colours are blended with the colours already drawn
+	void SetBlendFunc(const PUi32& source, const PUi32& destination);
+
+	// Set the test used to compare depths
+	void SetDepthFunc(const PUi32& func);
+
+	// Set if drawing writes to the depth buffer
+	void SetDepthMask(const bool& write);
+
+	// Delete a texture and forget any unit it was bound to
+	// Open gl unbinds deleted objects and can reuse their IDs so the cache must know
+	void DeleteTexture(PUi32& texture);
+
+	// Delete a buffer and forget any target it was bound to
+	void DeleteBuffer(PUi32& buffer);
+
+	// Delete a vertex array object and forget it and its buffers
+	void DeleteVertexArray(PUi32& vao);
+
+	// Delete a shader program and forget it if it's in use
+	void DeleteProgram(PUi32& program);
+
+	// Forget all the state, use after anything outside the engine changes the context
+	void Invalidate();
+
+	// Get the amount of state changing calls made since the counters were reset
+	PUi64 GetIssuedCalls() const { return m_IssuedCalls; }
+
+	// Get the amount of calls skipped because the state was already set
+	PUi64 GetFilteredCalls() const { return m_FilteredCalls; }
+
+	// Reset the call counters, the engine does this at the start of every frame
+	void ResetCounters() { m_IssuedCalls = m_FilteredCalls = 0; }
+
+private:
+	PGLState();
+
+	// Get the index of a buffer target in the cache, returns false if it isn't tracked
+	static bool GetBufferSlot(const PUi32& target, PUi32& outSlot);
+
+	// Get the index of a capability in the cache, returns false if it isn't tracked
+	static bool GetCapabilitySlot(const PUi32& capability, PUi32& outSlot);
+
+	// Get the indexed bindings for a target, null if it isn't tracked
+	PSGLBufferRange* GetIndexedBindings(const PUi32& target);
+
+	// Bound shader program
+	PUi32 m_Program;
+
+	// Bound vertex array object
+	PUi32 m_VAO;
+
+	// Buffers attached to each VAO bound with BindVertexBuffers()
+	TArray<PSGLVertexArrayBuffers> m_VertexArrayBuffers;
+
+	// Active texture unit for glBindTexture
+	PUi32 m_ActiveUnit;
+
+	// Texture bound to each tracked unit
+	TArray<PUi32> m_Textures;
+
+	// Buffer bound to each tracked target
+	TArray<PUi32> m_Buffers;
+
+	// Ranges bound to the tracked indexed shader storage and uniform buffer bindings
+	TArray<PSGLBufferRange> m_StorageRanges, m_UniformRanges;
+
+	// State of depth testing, blending and face culling, 0 = off, 1 = on and anything else is unknown
+	TArray<PUi8> m_Capabilities;
+
+	// Blend factors
+	PUi32 m_BlendSource, m_BlendDestination;
+
+	// Depth test
+	PUi32 m_DepthFunc;
+
+	// Depth writes, 0 = off, 1 = on and anything else is unknown
+	PUi8 m_DepthMask;
+
+	// Calls made and skipped since the counters were reset
+	PUi64 m_IssuedCalls, m_FilteredCalls;
+};
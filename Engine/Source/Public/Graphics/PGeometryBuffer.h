@@ -0,0 +1,200 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Graphics/PMesh.h"
+#include "Graphics/PBufferAllocator.h"
+
+class PRingBuffer;
+
+// External Libs
+#include <GLM/mat4x4.hpp>
+
+// System Libs
+#include <functional>
+
+// Layout that open gl expects for each glMultiDrawElementsIndirect command
+// Do not reorder, the GPU reads this struct directly
+struct PSDrawElementsIndirectCommand
+{
+	// Amount of indices to draw
+	PUi32 count = 0;
+
+	// Amount of instances to draw, 1 for a normal draw
+	PUi32 instanceCount = 1;
+
+	// Index in the shared index buffer to start at
+	PUi32 firstIndex = 0;
+
+	// Value added to every index to find the vertex in the shared vertex buffer
+	int baseVertex = 0;
+
+	// First instance ID, unused but required by the layout
+	PUi32 baseInstance = 0;
+};
+
+// Per draw data read by the indirect vertex shader using gl_DrawID
+// Matches the std430 DrawData struct in the shader
+struct PSIndirectDrawData
+{
+	// Transform of the model in world space
+	glm::mat4 model = glm::mat4(1.0f);
+
+	// Transform of the mesh relative to the model
+	glm::mat4 mesh = glm::mat4(1.0f);
+
+	// Turns the stored positions back into mesh space, position = stored * scale + offset
+	// vec4 to match the std430 alignment, w is unused
+	glm::vec4 positionOffset = glm::vec4(0.0f);
+	glm::vec4 positionScale = glm::vec4(1.0f);
+
+	// ID of the draw's material in the material buffer
+	PUi32 materialID = 0;
+
+	// Pads the struct to the 16 byte std430 array stride
+	PUi32 padding[3] = { 0, 0, 0 };
+};
+
+// Shared vertex and index arena that meshes are given ranges of
+// Every mesh in an arena has the same vertex format and index size so its data is uploaded as it is
+// Both the standard draws and multi draw indirect draw from the same ranges
+class PGeometryBuffer
+{
+public:
+	PGeometryBuffer();
+	~PGeometryBuffer();
+
+	// Turn on the mesh arenas, meshes uploaded after this go into the arena for their vertex format and index size
+	// Each arena starts with the capacity and grows as meshes are added
+	// Returns false if the arenas aren't supported, meshes then create their own buffers
+	static bool InitMeshArenas(const PUi32& vertexCapacity, const PUi32& indexCapacity);
+
+	// Get the arena for a vertex format and index size, it is created the first time it is asked for
+	// Returns null if the arenas are off or the arena couldn't be created
+	static PGeometryBuffer* GetMeshArena(const PEVertexFormat& vertexFormat, const PUi32& indexSize);
+
+	// Get every arena that has been created
+	static const TArray<PGeometryBuffer*>& GetMeshArenas();
+
+	// Delete every arena and turn them off
+	// Every mesh in them must be destroyed first and the context must still be alive
+	static void ShutdownMeshArenas();
+
+	// Create the shared buffers with a starting capacity
+	// Every mesh added is stored in the same vertex format and index size, 2 or 4 bytes
+	// The buffers will grow if more data is added than the capacity allows
+	bool Init(const PEVertexFormat& vertexFormat, const PUi32& indexSize, const PUi32& vertexCapacity, const PUi32& indexCapacity);
+
+	// Make room for a mesh in the shared buffers and queue its vertex and index data to be copied in
+	// The data must already be in the buffer's vertex format and index size
+	// The indices stay relative to the mesh, use GetRange() for the offsets
+	bool AddMeshData(const void* owner, const TShared<TArray<PUi8>>& vertexData, const PUi32& vertexCount,
+		const TShared<TArray<PUi8>>& indexData, const PUi32& indexCount, PSGeometryAllocation& outAllocation,
+		const std::function<void()>& onComplete = nullptr);
+
+	// Free a mesh's ranges so they can be reused, neighbouring free ranges are merged
+	void RemoveMeshData(const PSGeometryAllocation& allocation);
+
+	// Get where a mesh's data currently is in the shared buffers
+	PSGeometryRange GetRange(const PSGeometryAllocation& allocation) const;
+
+	// Move every mesh to the start of the buffers so the free space is in one block
+	// The data is copied on the GPU, ranges from GetRange() before this are out of date
+	bool Compact();
+
+	// Get the usage and fragmentation of the vertex buffer in vertices
+	PSBufferAllocatorStats GetVertexStats() const { return m_VertexAllocator.GetStats(); }
+
+	// Get the usage and fragmentation of the index buffer in indices
+	PSBufferAllocatorStats GetIndexStats() const { return m_IndexAllocator.GetStats(); }
+
+	// Get the vertex format of the shared vertex buffer
+	PEVertexFormat GetVertexFormat() const { return m_VertexFormat; }
+
+	// Get the size of each vertex in bytes
+	PUi32 GetVertexStride() const { return m_VertexStride; }
+
+	// Get the size of each index in bytes
+	PUi32 GetIndexSize() const { return m_IndexSize; }
+
+	// Get the open gl type of the indices
+	PUi32 GetIndexType() const;
+
+	// Bind the VAO of the buffer's vertex format with the shared buffers attached
+	// Draw a range with its base vertex and first index
+	bool BindBuffers();
+
+	// Start a pass with room for an amount of draws
+	// The commands and per draw data are written straight into the frame's ring buffer when one is given
+	// Without one, or if it is full, they are kept on the CPU and uploaded when the pass is drawn
+	void BeginPass(PRingBuffer* ringBuffer, const PUi32& drawCount);
+
+	// Add a draw of a mesh range for this pass, draws past the amount given to BeginPass() are ignored
+	// The position offset and scale come from PMesh::GetPositionDecode for the buffer's format
+	// The material ID picks the material from the material buffer
+	void AddDraw(const PSGeometryRange& range, const glm::mat4& model, const glm::mat4& mesh,
+		const glm::vec3& positionOffset, const glm::vec3& positionScale, const PUi32& materialID = 0);
+
+	// Draw the pass in one call
+	void Draw();
+
+	// Get the amount of draws added this pass
+	PUi32 GetDrawCount() const { return m_DrawCount; }
+
+private:
+	// Take a range from an allocator, growing its buffer if no free block is big enough
+	bool AllocateRange(PBufferAllocator& allocator, PUi32& bufferID, const PUi32& stride,
+		const PUi32& count, PSBufferAllocation& outAllocation);
+
+	// Resize a buffer and keep its existing data
+	// Queued uploads into the old buffer are finished first
+	bool GrowBuffer(PUi32& bufferID, const PUi64& usedBytes, const PUi64& newBytes);
+
+	// Pack an allocator's ranges and copy the data to match into a new buffer
+	bool CompactBuffer(PBufferAllocator& allocator, PUi32& bufferID, const PUi32& stride);
+
+	// Create a buffer with immutable storage and no data
+	bool CreateStorage(PUi32& outBuffer, const PUi64& bytes);
+
+	// Store the ID for the shared vertex buffer object
+	PUi32 m_VBO;
+
+	// Store the ID for the shared element array object
+	PUi32 m_EAO;
+
+	// Store the ID for the buffer of indirect commands
+	PUi32 m_CommandBuffer;
+
+	// Store the ID for the shader storage buffer of per draw data
+	PUi32 m_DrawDataBuffer;
+
+	// Format of every vertex in the shared vertex buffer
+	PEVertexFormat m_VertexFormat;
+
+	// Size of each vertex in bytes
+	PUi32 m_VertexStride;
+
+	// Size of each index in bytes
+	PUi32 m_IndexSize;
+
+	// Ranges of the vertex buffer in vertices and the index buffer in indices
+	PBufferAllocator m_VertexAllocator, m_IndexAllocator;
+
+	// Commands and per draw data kept on the CPU when the pass isn't in a ring buffer
+	TArray<PSDrawElementsIndirectCommand> m_Commands;
+	TArray<PSIndirectDrawData> m_DrawData;
+
+	// Where this pass's commands and per draw data are written, the ring buffer or the arrays above
+	PSDrawElementsIndirectCommand* m_PassCommands;
+	PSIndirectDrawData* m_PassDrawData;
+
+	// Ring buffer the pass is written into, 0 if it is kept on the CPU
+	PUi32 m_PassBuffer;
+
+	// Byte offsets of the pass's commands and per draw data in the ring buffer
+	PUi64 m_PassCommandOffset, m_PassDrawDataOffset;
+
+	// Amount of draws added this pass and the most that fit
+	PUi32 m_DrawCount, m_PassCapacity;
+
+	// Alignment open gl needs for the offset of a shader storage buffer range
+	PUi32 m_StorageAlignment;
+};
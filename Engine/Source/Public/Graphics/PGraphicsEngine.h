@@ -1,21 +1,170 @@
 #pragma once
 #include "EngineTypes.h"
 #include "Graphics/PSMaterial.h"
+#include "Graphics/PMesh.h"
+#include "Math/PSFrustum.h"
+#include "Math/PAABBTree.h"
+#include "Graphics/POcclusionCuller.h"
+#include "Graphics/PShaderProgram.h"
+#include "Math/PSHash.h"
+
+// System Libs
+#include <array>
+#include <unordered_map>
 
 typedef void* SDL_GLContext;
 struct SDL_Window;
-class PShaderProgram;
 struct PSCamera;
 struct PSLight;
 struct PSPointLight;
 struct PSDirLight;
 class PModel;
+class PGeometryBuffer;
+class PPortalGraph;
+class PAssetManager;
+class PTexture;
+class PTextureStreamer;
+class PRingBuffer;
+class PTextureArrays;
+class PMaterialBuffer;
+class PShaderVariants;
+class PLightClusters;
+
+// A mesh that passed culling and will be drawn this frame
+struct PSMeshDraw
+{
+	// The model that owns the mesh
+	PModel* model = nullptr;
+
+	// Index of the mesh in the model
+	PUi32 meshIndex = 0;
+
+	// ID of the mesh's material in the material buffer
+	PUi32 materialID = 0;
+
+	// Keywords of the smallest shader variant that can draw the mesh
+	PSShaderKeywords keywords;
+};
+
+// Draws in one geometry buffer that share textures and a shader variant and are drawn with one multi draw call
+struct PSIndirectPass
+{
+	// Textures bound to units 0 - 3 for the pass
+	std::array<PUi32, 4> textures = {};
+
+	// Keywords of the shader variant the pass is drawn with
+	PSShaderKeywords keywords;
+
+	// Geometry buffer every mesh in the pass is in
+	PGeometryBuffer* geometryBuffer = nullptr;
+
+	// Indexes of the pass's draws in the draw list
+	TArray<PUi32> draws;
+};
+
+// Key the indirect passes are found by each frame
+struct PSIndirectPassKey
+{
+	// Textures the pass binds
+	std::array<PUi32, 4> textures = {};
+
+	// Key of the pass's shader keywords
+	PUi64 keywordKey = 0;
+
+	// Geometry buffer the pass draws from
+	PGeometryBuffer* geometryBuffer = nullptr;
+};
+
+// Counters that are reset at the start of every frame
+struct PSRenderStats
+{
+	// Meshes that passed culling and were drawn
+	PUi32 visibleMeshes = 0;
+
+	// Meshes that were skipped by frustum culling
+	PUi32 culledMeshes = 0;
+
+	// Meshes in the frustum that were in cells that can't be seen through portals
+	PUi32 portalCulledMeshes = 0;
+
+	// Meshes in the frustum that were hidden behind occluders
+	PUi32 occludedMeshes = 0;
+
+	// Meshes in the frustum that were too small on screen to draw
+	PUi32 tooSmallMeshes = 0;
+
+	// Culling tree nodes tested against the frustum
+	PUi32 nodesTested = 0;
+
+	// Triangles drawn using the selected levels of detail
+	PUi64 triangles = 0;
+
+	// Triangles the same meshes would have drawn at full detail
+	PUi64 fullTriangles = 0;
+
+	// Memory used on the GPU by streamed textures in bytes
+	PUi64 textureMemory = 0;
+
+	// Memory used on the GPU by the texture array copies in bytes
+	PUi64 textureArrayMemory = 0;
+
+	// Materials written to the material buffer because they were new or changed
+	PUi32 materialUpdates = 0;
+
+	// Point lights that reached into the frustum
+	PUi32 visibleLights = 0;
+
+	// Light indices written to the light clusters, each is one light shading one cluster
+	PUi32 clusterLightIndices = 0;
+
+	// Shader variants asked for since the engine started
+	PUi32 shaderVariants = 0;
+
+	// Shader variants still compiling, their draws use the variant with every keyword
+	PUi32 pendingShaderVariants = 0;
+
+	// Bytes the upload queue copied to the GPU
+	PUi64 uploadedBytes = 0;
+
+	// Bytes waiting in the upload queue
+	PUi64 pendingUploadBytes = 0;
+
+	// Time the CPU waited for the GPU to finish with the frame's ring buffer region in milliseconds
+	double fenceWaitTime = 0.0;
+
+	// Frames that have waited on a ring buffer fence since the engine started
+	// If this keeps rising the CPU is getting a whole ring ahead of the GPU
+	PUi64 fenceWaits = 0;
+
+	// Open gl state calls made this frame
+	PUi64 stateChanges = 0;
+
+	// Open gl state calls skipped this frame because the state was already set
+	PUi64 filteredStateChanges = 0;
+
+	// Get the stats as a single line of text
+	PString ToString() const
+	{
+		return "Visible: " + std::to_string(visibleMeshes) + " | Culled: " + std::to_string(culledMeshes)
+			+ " | Portal: " + std::to_string(portalCulledMeshes) + " | Occluded: " + std::to_string(occludedMeshes) + " | Small: " + std::to_string(tooSmallMeshes)
+			+ " | Nodes: " + std::to_string(nodesTested)
+			+ " | Tris: " + std::to_string(triangles) + " / " + std::to_string(fullTriangles)
+			+ " | Tex: " + std::to_string(textureMemory / (1024 * 1024)) + " MB"
+			+ " | Arrays: " + std::to_string(textureArrayMemory / (1024 * 1024)) + " MB"
+			+ " | Materials: " + std::to_string(materialUpdates)
+			+ " | Lights: " + std::to_string(visibleLights) + " (" + std::to_string(clusterLightIndices) + " in clusters)"
+			+ " | Variants: " + std::to_string(shaderVariants) + " (" + std::to_string(pendingShaderVariants) + " compiling)"
+			+ " | Upload: " + std::to_string(uploadedBytes / 1024) + " KB / " + std::to_string(pendingUploadBytes / 1024) + " KB"
+			+ " | Fence waits: " + std::to_string(fenceWaits) + " (" + std::to_string(static_cast<int>(fenceWaitTime * 1000.0)) + " us)"
+			+ " | State: " + std::to_string(stateChanges) + " / " + std::to_string(stateChanges + filteredStateChanges);
+	}
+};
 
 class PGraphicsEngine
 {
 public:
-	PGraphicsEngine() = default;
-	~PGraphicsEngine() = default;
+	PGraphicsEngine();
+	~PGraphicsEngine();
 
 	//  Initialise the graphics engine
 	bool InitEngine(SDL_Window* sdlWindow, const bool& vsync);
@@ -32,24 +181,209 @@ public:
 	// Create a directional light and return a weak pointer
 	TWeak<PSDirLight> CreateDirLight();
 
-	// Import a model and return a weak pointer
-	TWeak<PModel> ImportModel(const PString& path);
+	// Start importing a model and return a weak pointer straight away
+	// The model loads on a worker thread, check PModel::GetLoadState() to see when it is ready
+	// Its meshes upload into the shared geometry buffers and it is added to the culling tree once it is ready
+	// Importing the same path and settings again makes an instance that shares the meshes
+	TWeak<PModel> ImportModel(const PString& path, const PSMeshSettings& meshSettings = PSMeshSettings());
+
+	// Load a texture through the asset manager, the same path always returns the same texture
+	// The texture decodes on a worker thread and is uploaded at the start of a later frame
+	TShared<PTexture> LoadTexture(const PString& name, const PString& path);
+
+	// Return a weak version of the asset manager
+	TWeak<PAssetManager> GetAssetManager() { return m_AssetManager; }
 
 	// Create a material for the engine
 	TShared<PSMaterial> CreateMaterial();
 
+	// Draw meshes from the shared geometry buffers with multi draw indirect
+	// Does nothing if the geometry buffers or the indirect shader couldn't be created
+	void SetIndirectDrawEnabled(const bool& enable);
+
+	// Test if meshes are being drawn with multi draw indirect
+	bool IsIndirectDrawEnabled() const { return m_UseIndirectDraw; }
+
+	// Copy material textures into shared texture arrays
+	// Indirect draws of materials whose textures share arrays are drawn in the same multi draw call
+	// Disabling frees the arrays and binds each material's textures again
+	void SetTextureArraysEnabled(const bool& enable);
+
+	// Test if material textures are being copied into texture arrays
+	bool IsTextureArraysEnabled() const { return m_UseTextureArrays; }
+
+	// Return a weak version of the portal graph
+	// Add cells and portals to it and then assign models to the cells
+	TWeak<PPortalGraph> GetPortalGraph() { return m_PortalGraph; }
+
+	// Skip meshes hidden behind meshes marked as occluders
+	void SetOcclusionCullingEnabled(const bool& enable) { m_UseOcclusionCulling = enable; }
+
+	// Test if occlusion culling is being used
+	bool IsOcclusionCullingEnabled() const { return m_UseOcclusionCulling; }
+
+	// Pick levels of detail by screen size and skip meshes smaller than the minimum pixel size
+	// Disabled draws every mesh at full detail
+	void SetLODEnabled(const bool& enable) { m_UseLOD = enable; }
+
+	// Test if levels of detail are being used
+	bool IsLODEnabled() const { return m_UseLOD; }
+
+	// Set the size in pixels a mesh must cover on screen to be drawn
+	void SetMinPixelSize(const float& pixels) { m_MinPixelSize = pixels; }
+
+	// Set how far past a switch size a mesh must be before its level of detail changes
+	// 0.1 = 10% of the switch size
+	void SetLODHysteresis(const float& hysteresis) { m_LODHysteresis = hysteresis; }
+
+	// Set the most memory streamed textures can use on the GPU in bytes
+	// Textures lose their most detailed mip maps when the visible textures need more than this
+	void SetTextureMemoryBudget(const PUi64& bytes);
+
+	// Added to the mip level each texture is streamed to, 1 = half the resolution
+	void SetTextureMipBias(const float& bias);
+
+	// Set the most mesh and texture data copied to the GPU each frame
+	// Loading stops for the frame at whichever is reached first, the bytes or the milliseconds
+	void SetUploadBudget(const PUi64& bytes, const double& milliseconds);
+
+	// Pack the meshes in each shared geometry buffer together and log the fragmentation before and after
+	void CompactGeometry();
+
+	// Start compiling shader variants before they are drawn so their first draws don't use the fallback
+	// Call during loading screens, check GetPendingShaderCount() to see when they are done
+	void WarmUpShaders(const TArray<PSShaderKeywords>& keywords);
+
+	// Get the amount of shader variants still compiling
+	PUi32 GetPendingShaderCount() const;
+
+	// Get the render stats from the last frame
+	const PSRenderStats& GetRenderStats() const { return m_Stats; }
+
 private:
+	// Upload models that have finished loading and add them to the culling tree
+	void UpdateImports();
+
+	// Find the meshes inside the camera frustum and store them in the draw list
+	void BuildDrawList();
+
+	// Remove draws in cells that can't be seen through the portals
+	void PortalCullDrawList();
+
+	// Rasterize the visible occluders and remove draws hidden behind them
+	void OcclusionCullDrawList();
+
+	// Pick the level of detail of each draw and remove draws too small to see
+	void SelectDrawLODs();
+
+	// Ask for the textures of every draw at the size they cover on screen and stream their mip maps
+	void StreamTextures();
+
+	// Give the material of every draw its ID and write the materials that changed to the material buffer
+	// Picks the shader keywords of every draw from its material, vertex format and the scene's lights
+	void UpdateMaterials();
+
+	// Activate the variant for a set of keywords, the fallback is used while the variant compiles or if it failed
+	// The camera and lights are set the first time a variant is used each frame
+	TShared<PShaderProgram> UseShaderVariant(PShaderVariants& variants, const TShared<PShaderProgram>& fallback, const PSShaderKeywords& keywords);
+
+	// Render all models through the shared geometry buffers
+	// One multi draw call is made for each set of bound textures, materials are read by ID
+	void RenderIndirect();
+
 	// Storing memory location for open gl context
 	SDL_GLContext m_SDLGLContext;
 
 	// Store the shader for trhe engine
 	TShared<PShaderProgram> m_Shader;
 
+	// Store the shader that reads per draw data using gl_DrawID
+	TShared<PShaderProgram> m_IndirectShader;
+
+	// Variants of the standard and indirect shaders compiled with only the lights and maps a draw needs
+	// m_Shader and m_IndirectShader are the variants with every keyword and are used if a variant fails
+	TUnique<PShaderVariants> m_ShaderVariants;
+	TUnique<PShaderVariants> m_IndirectShaderVariants;
+
+	// Shader variants that have had the camera and lights set this frame
+	TArray<PShaderProgram*> m_PreparedShaders;
+
+	// Triple buffered ring buffer that per frame data is written into, null without persistent mapping
+	TUnique<PRingBuffer> m_FrameRingBuffer;
+
+	// If models are drawn with multi draw indirect
+	bool m_UseIndirectDraw;
+
+	// Shared texture arrays that material textures are copied into
+	TUnique<PTextureArrays> m_TextureArrays;
+
+	// Properties of every material, draws pick theirs by material ID
+	TUnique<PMaterialBuffer> m_MaterialBuffer;
+
+	// If material textures are copied into the texture arrays
+	bool m_UseTextureArrays;
+
+	// Grid over the view frustum holding the point lights that reach each cluster
+	TUnique<PLightClusters> m_LightClusters;
+
 	// Store the camera
 	TShared<PSCamera> m_Camera;
 
 	TArray<TShared<PSLight>> m_Lights;
 
+	// Shared meshes, textures and materials
+	TShared<PAssetManager> m_AssetManager;
+
+	// Loads and drops texture mip maps by their size on screen
+	TUnique<PTextureStreamer> m_TextureStreamer;
+
 	// Stores all of the models in the engine
 	TArray<TShared<PModel>> m_Models;
+
+	// Models that are still loading
+	TArray<TShared<PModel>> m_LoadingModels;
+
+	// Planes of the camera view used for culling
+	PSFrustum m_Frustum;
+
+	// Bounding volume tree over the world bounds of every mesh
+	PAABBTree m_CullingTree;
+
+	// Proxies returned by the culling tree this frame
+	TArray<int> m_VisibleProxies;
+
+	// Cells and portals of the level
+	TShared<PPortalGraph> m_PortalGraph;
+
+	// CPU depth buffer used to find meshes hidden behind occluders
+	POcclusionCuller m_OcclusionCuller;
+
+	// If meshes are tested against the occluders after frustum culling
+	bool m_UseOcclusionCulling;
+
+	// If levels of detail are picked by screen size
+	bool m_UseLOD;
+
+	// Size in pixels a mesh must cover on screen to be drawn
+	float m_MinPixelSize;
+
+	// How far past a switch size a mesh must be before its level of detail changes
+	float m_LODHysteresis;
+
+	// Height of the window in pixels
+	int m_ViewportHeight;
+
+	// Meshes to be drawn this frame
+	TArray<PSMeshDraw> m_DrawList;
+
+	// Passes the indirect draws are grouped into, kept between frames so their draw arrays are reused
+	// Only the first m_IndirectPassCount are used this frame
+	TArray<PSIndirectPass> m_IndirectPasses;
+	PUi32 m_IndirectPassCount;
+
+	// Index of the pass for each set of textures and shader keywords this frame
+	std::unordered_map<PSIndirectPassKey, PUi32, PSBytesHash<PSIndirectPassKey>, PSBytesEqual<PSIndirectPassKey>> m_IndirectPassLookup;
+
+	// Counters for the last frame
+	PSRenderStats m_Stats;
 };
\ No newline at end of file
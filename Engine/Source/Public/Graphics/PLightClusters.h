@@ -0,0 +1,114 @@
+#pragma once
+#include "EngineTypes.h"
+
+struct PSCamera;
+struct PSLight;
+struct PSFrustum;
+
+// External Libs
+#include <GLM/vec3.hpp>
+#include <GLM/vec4.hpp>
+#include <GLM/mat4x4.hpp>
+
+// A point light as read by the fragment shader
+// Matches the std430 PointLight struct in the shader
+struct PSPointLightData
+{
+	// World position and the distance the light reaches
+	glm::vec4 positionRadius = glm::vec4(0.0f);
+
+	// Colour of the light multiplied by its intensity
+	glm::vec4 colour = glm::vec4(0.0f);
+
+	// Fall off values
+	float linear = 0.0f;
+	float quadratic = 0.0f;
+
+	// Rounds the struct up to the std430 alignment of its vec4s
+	float padding[2] = { 0.0f, 0.0f };
+};
+
+// Start of the cluster buffer, the range of each cluster in the light index buffer follows it
+// Matches the std430 ClusterBuffer block in the shader
+struct PSClusterHeader
+{
+	// Amount of clusters across, down and deep
+	PUi32 grid[4] = { 0, 0, 0, 0 };
+
+	// Slices per log of depth, depth the log slices start at, near and far clip
+	float depth[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	// Clusters per pixel across and down
+	float tileScale[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+// Splits the view frustum into a 3D grid of clusters and finds the point lights that reach each one
+// The grid is tiles on screen by slices of depth, the slices get deeper further from the camera
+// Lights are assigned on the CPU testing 4 lights against a cluster at once with SSE
+// The fragment shader only loops over the lights of the cluster it is in
+class PLightClusters
+{
+public:
+	PLightClusters();
+	~PLightClusters();
+
+	// Create the light, cluster and light index buffers
+	bool Init();
+
+	// Assign this frame's point lights to the clusters and upload them
+	// Lights outside the frustum are skipped, the buffers are bound to shader storage bindings 2 - 4
+	void Update(const TShared<PSCamera>& camera, const TArray<TShared<PSLight>>& lights, const PSFrustum& frustum,
+		const int& viewportWidth, const int& viewportHeight);
+
+	// Get the amount of point lights that were in the frustum last update
+	PUi32 GetVisibleLightCount() const { return static_cast<PUi32>(m_LightData.size()); }
+
+	// Get the amount of light indices written to the clusters last update
+	PUi32 GetLightIndexCount() const { return static_cast<PUi32>(m_LightIndices.size()); }
+
+private:
+	// Work out the view space bounds of every cluster for a projection
+	void BuildClusterBounds(const glm::mat4& projection, const float& nearClip, const float& farClip);
+
+	// Test every cluster in a depth slice against the lights that reach the slice
+	void AssignSlice(const PUi32& slice);
+
+	// Write a buffer, growing it if the data doesn't fit
+	static void UploadBuffer(const PUi32& buffer, PUi64& capacity, const void* data, const PUi64& size);
+
+	// Shader storage buffers for the lights, the cluster ranges and the light indices
+	PUi32 m_LightBuffer, m_ClusterBuffer, m_IndexBuffer;
+
+	// Bytes each buffer has room for
+	PUi64 m_LightCapacity, m_ClusterCapacity, m_IndexCapacity;
+
+	// Projection the cluster bounds were built for
+	glm::mat4 m_Projection;
+
+	// Distance to the start of each depth slice, one more than there are slices so the last is the far clip
+	TArray<float> m_SliceDepths;
+
+	// View space bounds of every cluster
+	TArray<glm::vec3> m_ClusterMin, m_ClusterMax;
+
+	// Header written in front of the cluster ranges
+	PSClusterHeader m_Header;
+
+	// Lights in the frustum this frame
+	TArray<PSPointLightData> m_LightData;
+
+	// View space position and radius of the visible lights, kept apart so 4 lights load into one SSE register
+	TArray<float> m_LightX, m_LightY, m_LightZ, m_LightRadius;
+
+	// Lights that reach the slice being assigned, in the same layout as the visible lights
+	TArray<float> m_SliceX, m_SliceY, m_SliceZ, m_SliceRadius;
+
+	// Light index of each entry in the slice lists
+	TArray<PUi32> m_SliceLights;
+
+	// Offset and count in the light index buffer of each cluster
+	TArray<PUi32> m_ClusterRanges;
+
+	// Indices of the lights that reach each cluster, grouped by cluster
+	TArray<PUi32> m_LightIndices;
+};
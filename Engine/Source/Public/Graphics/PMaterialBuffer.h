@@ -0,0 +1,118 @@
+#pragma once
+#include "EngineTypes.h"
+
+struct PSMaterial;
+class PTextureArrays;
+
+// External Libs
+#include <GLM/vec4.hpp>
+
+// System Libs
+#include <array>
+
+// Per material data read by the fragment shader using the draw's material index
+// Matches the std430 MaterialData struct in the shader
+struct PSMaterialData
+{
+	// Part of the texture array layer each map covers as x, y, width and height from 0 - 1
+	glm::vec4 baseColourRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	glm::vec4 specularRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+	// Layer of the texture array bound for each map, -1 samples the map's own texture instead
+	int baseColourLayer = -1;
+	int specularLayer = -1;
+
+	// Material properties
+	float shininess = 32.0f;
+	float specularStrength = 0.5f;
+
+	// Test if the GPU copy needs writing again
+	bool operator==(const PSMaterialData& other) const = default;
+};
+
+// A material with a slot in the material buffer
+struct PSMaterialSlot
+{
+	// The material, the buffer doesn't keep materials alive
+	TWeak<PSMaterial> material;
+
+	// Textures the material needs bound, its own base colour and specular maps then the arrays they are in
+	std::array<PUi32, 4> textures = { 0, 0, 0, 0 };
+
+	// Last frame the slot's textures were looked up
+	PUi64 lastUsedFrame = 0;
+
+	// If a material has the slot, false once it is back in the free list
+	bool isUsed = false;
+};
+
+// Keeps the properties of every material in one shader storage buffer indexed by material ID
+// Draws pick their material by index so no material uniforms are set per draw
+// A material is only written to the GPU when it is new, marked dirty or its maps moved in the texture arrays
+// Slots of destroyed materials are reused, slot 0 is the default material used by meshes without one
+class PMaterialBuffer
+{
+public:
+	PMaterialBuffer();
+	~PMaterialBuffer();
+
+	// Create the buffer with room for an amount of materials
+	bool Init(const PUi32& capacity = 64);
+
+	// Start a new frame, slots of destroyed materials are freed
+	void BeginFrame();
+
+	// Get the ID of a material to draw with this frame, null gets the default material
+	// The first use each frame looks up where the material's maps are
+	PUi32 UseMaterial(const TShared<PSMaterial>& material);
+
+	// Write every changed material to the GPU and bind the buffer to shader storage binding 1
+	// Must be called after the frame's materials have been used and before they are drawn
+	void Upload();
+
+	// Bind the textures a material needs to units 0 - 3
+	void BindTextures(const PUi32& materialID) const;
+
+	// Get the textures a material needs bound, draws with the same textures can share a call
+	const std::array<PUi32, 4>& GetTextures(const PUi32& materialID) const { return m_Slots[materialID].textures; }
+
+	// Copy maps into texture arrays when they fit, null samples every map on its own
+	void SetTextureArrays(PTextureArrays* textureArrays) { m_TextureArrays = textureArrays; }
+
+	// Get the amount of materials written to the GPU by the last upload
+	PUi32 GetUpdateCount() const { return m_UpdateCount; }
+
+private:
+	// Take a free slot, growing the buffer if there are none
+	PUi32 AllocateSlot();
+
+	// Material buffer ID in open gl
+	PUi32 m_Buffer;
+
+	// Amount of materials the buffer has room for
+	PUi32 m_Capacity;
+
+	// Slot of each material ID
+	TArray<PSMaterialSlot> m_Slots;
+
+	// CPU copy of the buffer, dirty slots are written from here
+	TArray<PSMaterialData> m_Data;
+
+	// Material IDs that can be reused
+	TArray<PUi32> m_FreeSlots;
+
+	// Lowest and highest slot that changed since the last upload, the range is written in one call
+	PUi32 m_DirtyFirst, m_DirtyLast;
+
+	// Default material for meshes without one, always in slot 0
+	TShared<PSMaterial> m_DefaultMaterial;
+
+	// Texture arrays the maps are looked up in, null if they aren't used
+	PTextureArrays* m_TextureArrays;
+
+	// Counts frames so slots are only looked up once a frame
+	PUi64 m_Frame;
+
+	// Amount of materials changed since the last upload and written by the last upload
+	PUi32 m_DirtyCount, m_UpdateCount;
+};
@@ -1,12 +1,15 @@
 #pragma once
 #include "EngineTypes.h"
+#include "Math/PSBounds.h"
+#include "Math/PSHash.h"
+#include "Graphics/PBufferAllocator.h"
 
 // External Libs
 #include <GLM/mat4x4.hpp>
 
 class PShaderProgram;
+class PGeometryBuffer;
 struct PSTransform;
-struct PSLight;
 struct PSMaterial;
 
 struct PSVertexData
@@ -31,6 +34,154 @@ struct PSVertexData
 	float m_Normal[3] = { 0.0f, 0.0f, 0.0f };
 };
 
+// Layout of the vertex data on the GPU
+enum PEVertexFormat : PUi8
+{
+	// 32-bit floats for everything, 44 bytes, same as PSVertexData
+	VF_FULL = 0U,
+
+	// 16 byte quantized layout with no colour, the shader sees white
+	VF_COMPACT,
+
+	// Quantized layout with an 8-bit RGBA colour, 20 bytes
+	// Compact meshes that have vertex colours use this automatically
+	VF_COMPACT_COLOUR
+};
+
+// Quantized vertex used by the compact formats
+// VF_COMPACT only uploads the first 16 bytes
+struct PSCompactVertexData
+{
+	// Position inside the mesh bounds, 0 = min and 65535 = max
+	// The 4th value keeps the next attribute 4 byte aligned
+	PUi16 m_Position[4] = { 0, 0, 0, 0 };
+
+	// Normal packed as signed 10:10:10:2
+	PUi32 m_Normal = 0;
+
+	// Half float texture coordinates
+	PUi16 m_TexCoords[2] = { 0, 0 };
+
+	// 0 = r
+	// 1 = g
+	// 2 = b
+	// 3 = a
+	PUi8 m_Colour[4] = { 255, 255, 255, 255 };
+};
+
+// Location of a mesh's data inside the geometry buffer
+struct PSGeometryRange
+{
+	// First vertex of the mesh in the shared vertex buffer
+	PUi32 baseVertex = 0;
+
+	// First index of the mesh in the shared index buffer
+	PUi32 firstIndex = 0;
+
+	// Amount of indices the mesh uses
+	PUi32 indexCount = 0;
+};
+
+// Blocks a mesh holds in the geometry buffer's vertex and index buffers
+struct PSGeometryAllocation
+{
+	PSBufferAllocation vertices;
+	PSBufferAllocation indices;
+};
+
+// Settings for the levels of detail made when a mesh is created
+struct PSLODSettings
+{
+	// Amount of levels including the full detail mesh, 1 turns off LODs
+	PUi32 levelCount = 4;
+
+	// Fraction of the triangles each level keeps from the level before
+	float triangleRatio = 0.5f;
+
+	// Largest distance a level can move from the original surface, relative to the mesh radius
+	float maxError = 0.05f;
+
+	// Fraction of the screen height the mesh must be smaller than to use the first reduced level
+	// Each level after switches at half the size of the level before
+	float screenSize = 0.25f;
+};
+
+// A level of detail stored in the mesh's index buffer
+struct PSMeshLOD
+{
+	// First index of the level in the index buffer
+	PUi32 firstIndex = 0;
+
+	// Amount of indices in the level
+	PUi32 indexCount = 0;
+
+	// The level is used when the mesh covers less than this fraction of the screen height
+	float screenSize = 0.0f;
+};
+
+// Settings used when a mesh is created
+struct PSMeshSettings
+{
+	// Layout of the vertex data on the GPU
+	PEVertexFormat vertexFormat = VF_COMPACT;
+
+	// Weld duplicate vertices and reorder the triangles and vertices for the GPU caches
+	bool optimise = true;
+
+	// Levels of detail generated from the mesh
+	PSLODSettings lod;
+
+	// Hash every setting, used to tell imports with different settings apart
+	// Each value is hashed on its own so padding in the struct can't change the result
+	PUi64 GetHash(const PUi64& seed = PSHash::fnvOffset) const
+	{
+		PUi64 hash = PSHash::FNV1a(&vertexFormat, sizeof(vertexFormat), seed);
+		hash = PSHash::FNV1a(&optimise, sizeof(optimise), hash);
+		hash = PSHash::FNV1a(&lod.levelCount, sizeof(lod.levelCount), hash);
+		hash = PSHash::FNV1a(&lod.triangleRatio, sizeof(lod.triangleRatio), hash);
+		hash = PSHash::FNV1a(&lod.maxError, sizeof(lod.maxError), hash);
+		return PSHash::FNV1a(&lod.screenSize, sizeof(lod.screenSize), hash);
+	}
+};
+
+// Mesh data that is already in its GPU layout, usually read from a cooked mesh file
+// The GPU streams are uploaded as they are without converting any vertices
+struct PSCookedMeshData
+{
+	// Layout of the GPU vertex stream
+	PEVertexFormat vertexFormat = VF_FULL;
+
+	// Size of each index in the GPU index stream in bytes
+	PUi32 indexSize = sizeof(PUi32);
+
+	// Amount of vertices in the streams
+	PUi32 vertexCount = 0;
+
+	// Amount of indices in the streams, every level of detail one after the other
+	PUi32 indexCount = 0;
+
+	// Vertices and 32 bit indices kept on the CPU for occlusion and the geometry buffer
+	const PSVertexData* vertices = nullptr;
+	const PUi32* indices = nullptr;
+
+	// Vertex and index data in the GPU layout
+	const void* vertexData = nullptr;
+	const void* indexData = nullptr;
+
+	// Levels of detail in the indices
+	const PSMeshLOD* lods = nullptr;
+	PUi32 lodCount = 0;
+
+	// Bounds of the vertices, compact positions are stored relative to these
+	PSBounds bounds;
+
+	// Transform of the mesh relative to the model
+	glm::mat4 relativeTransform = glm::mat4(1.0f);
+
+	// The index for the material relative to the model
+	PUi32 materialIndex = 0;
+};
+
 class PMesh
 {
 public:
@@ -38,33 +189,157 @@ public:
 	~PMesh();
 
 	// Creating a mesh using vertex ad index data
-	bool CreateMesh(const std::vector<PSVertexData>& vertices, const std::vector<uint32_t>& indices);
+	// The bounds and the reduced levels of detail are generated from the data
+	// Same as calling PrepareMesh() and then UploadMesh()
+	bool CreateMesh(const std::vector<PSVertexData>& vertices, const std::vector<uint32_t>& indices,
+		const PSMeshSettings& settings = PSMeshSettings());
+
+	// Generate everything the mesh needs on the CPU without using open gl
+	// Safe to call on a worker thread, UploadMesh() must be called on the GL thread after
+	bool PrepareMesh(const std::vector<PSVertexData>& vertices, const std::vector<uint32_t>& indices,
+		const PSMeshSettings& settings = PSMeshSettings());
+
+	// Upload the data made by PrepareMesh() to the GPU, must be called on the GL thread
+	bool UploadMesh();
+
+	// Create a mesh from data that is already in its GPU layout
+	// Nothing is generated, the streams are uploaded directly
+	bool CreateMesh(const PSCookedMeshData& data);
 
-	void Render(const std::shared_ptr<PShaderProgram>& shader, const PSTransform& transform, 
-		const TArray<TShared<PSLight>>& lights, const TShared<PSMaterial>& material);
+	// Render a level of detail of the mesh using the world matrix of the model
+	// The shader reads the material from the material buffer, its textures must already be bound
+	// The camera and lights must already be set on the shader
+	void Render(const std::shared_ptr<PShaderProgram>& shader, const glm::mat4& modelMatrix, 
+		const TShared<PSMaterial>& material, const PUi32& lod = 0);
+
+	// Get the bounds of the mesh in mesh space
+	const PSBounds& GetBounds() const { return m_Bounds; }
+
+	// Get the amount of triangles in a level of detail
+	PUi32 GetTriangleCount(const PUi32& lod = 0) const { return m_LODs[lod].indexCount / 3; }
+
+	// Get the amount of levels of detail including the full detail level
+	PUi32 GetLODCount() const { return static_cast<PUi32>(m_LODs.size()); }
+
+	// Get a level of detail
+	const PSMeshLOD& GetLOD(const PUi32& lod) const { return m_LODs[lod]; }
+
+	// Pick the level of detail for the fraction of the screen height the mesh covers
+	// A level only changes once the size is past its switch size by the hysteresis fraction
+	// This stops meshes flickering between levels at the switch distance
+	PUi32 SelectLOD(const float& screenSize, const PUi32& currentLOD, const float& hysteresis) const;
 
 	// Set the transform of the mesh relative to the model
 	void SetRelativeTransform(const glm::mat4& transform) { m_MatTransform = transform; }
 
+	// Get the transform of the mesh relative to the model
+	const glm::mat4& GetRelativeTransform() const { return m_MatTransform; }
+
+	// Test if the mesh data has finished copying into the shared geometry buffer
+	// Meshes that couldn't get a range in it are drawn from their own buffers and can't be drawn indirectly
+	bool IsInGeometryBuffer() const { return m_GeometryBuffer != nullptr && m_IsUploaded; }
+
+	// Test if the upload queue has finished copying the mesh's data to the GPU
+	// The mesh isn't drawn until it has
+	bool IsUploaded() const { return m_IsUploaded; }
+
+	// Get the shared geometry buffer the mesh has a range of, null if it uses its own buffers
+	PGeometryBuffer* GetGeometryBuffer() const { return m_GeometryBuffer; }
+
+	// Get the location of a level of detail in the shared geometry buffer
+	PSGeometryRange GetGeometryRange(const PUi32& lod = 0) const;
+
+	// Set if the mesh should hide other meshes behind it in occlusion culling
+	// Best used for large simple meshes like walls and floors
+	void SetOccluder(const bool& isOccluder) { m_IsOccluder = isOccluder; }
+
+	// Test if the mesh is used as an occluder
+	bool IsOccluder() const { return m_IsOccluder; }
+
+	// Get the vertices stored on the CPU
+	const TArray<PSVertexData>& GetVertices() const { return m_Vertices; }
+
+	// Get the indices stored on the CPU, every level of detail one after the other
+	const TArray<PUi32>& GetIndices() const { return m_Indices; }
+
+	// Get the layout of the vertex data on the GPU
+	PEVertexFormat GetVertexFormat() const { return m_VertexFormat; }
+
+	// Get the size of each index on the GPU in bytes
+	// Meshes with less than 65536 vertices use 16 bit indices
+	PUi32 GetIndexSize() const { return m_IndexSize; }
+
+	// Get the size of the index data on the GPU in bytes
+	// Meshes in a geometry buffer report the range they were given
+	PUi64 GetIndexBufferSize() const;
+
+	// Get the size of the vertex data on the GPU in bytes
+	// Meshes in a geometry buffer report the range they were given
+	PUi64 GetVertexBufferSize() const;
+
+	// Convert the vertices into the GPU layout of a vertex format
+	void BuildVertexData(const PEVertexFormat& format, TArray<PUi8>& outData) const;
+
+	// Get the values that turn a vertex format's stored positions back into mesh space
+	// position = stored * scale + offset
+	void GetPositionDecode(const PEVertexFormat& format, glm::vec3& outOffset, glm::vec3& outScale) const;
+
+	// Get the size of a vertex in bytes
+	static PUi32 GetVertexStride(const PEVertexFormat& format);
+
 	// The index for the material relative to the model
 	unsigned int materialIndex;
 
 private:
+	// Queue the vertex and index data that is in the GPU layout to be copied into a range of a mesh arena
+	// The arena must have the mesh's vertex format and index size
+	// Returns false if the arena has no room
+	bool RegisterGeometry(PGeometryBuffer& geometryBuffer, const TShared<TArray<PUi8>>& vertexData, const TShared<TArray<PUi8>>& indexData);
+
+	// Create the mesh's own buffers and queue the vertex and index data that is in the GPU layout to be uploaded
+	// Only used when the mesh couldn't be given a range of a mesh arena
+	bool CreateBuffers(const TShared<TArray<PUi8>>& vertexData, const TShared<TArray<PUi8>>& indexData);
+
+	// Put the mesh in the mesh arena for its vertex format and index size, or in its own buffers if that fails
+	bool UploadData(const TShared<TArray<PUi8>>& vertexData, const TShared<TArray<PUi8>>& indexData);
+
 	// Store the vertices
 	std::vector<PSVertexData> m_Vertices;
 
 	// Store the indices for the data
 	std::vector<uint32_t> m_Indices;
 
-	// Store the ID for the vertex array object
-	uint32_t m_VAO;
+	// Levels of detail in the indices, 0 is the full detail mesh
+	TArray<PSMeshLOD> m_LODs;
 
-	// Store the ID for the vertex buffer object
-	uint32_t m_VBO;
+	// Vertex and index data in the GPU layout waiting for UploadMesh()
+	TArray<PUi8> m_UploadVertexData, m_UploadIndexData;
 
-	// Store the ID for the element array object
+	// The mesh's own vertex and index buffers, 0 unless a mesh arena couldn't fit the mesh
+	uint32_t m_VBO;
 	uint32_t m_EAO;
 
 	// Relative transform of the mesh
 	glm::mat4 m_MatTransform;
+
+	// Bounds of the vertices before any transforms
+	PSBounds m_Bounds;
+
+	// Layout of the vertex data on the GPU
+	PEVertexFormat m_VertexFormat;
+
+	// Size of each index in the index buffer in bytes
+	PUi32 m_IndexSize;
+
+	// Shared geometry buffer the mesh has a range of, null if it uses its own buffers
+	PGeometryBuffer* m_GeometryBuffer;
+
+	// Blocks the mesh holds in the shared geometry buffer
+	PSGeometryAllocation m_GeometryAllocation;
+
+	// If the vertex and index data has been copied to the GPU
+	bool m_IsUploaded;
+
+	// If the mesh is rasterized into the occlusion depth buffer
+	bool m_IsOccluder;
 };
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Graphics/PMesh.h"
+#include "IO/PMappedFile.h"
+
+// A cooked file that has been mapped and checked
+// The mesh data points into the mapped file so it must stay open until the meshes are created
+struct PSCookedModel
+{
+	// The mapped cooked file
+	PMappedFile file;
+
+	// Data of each mesh in the file
+	TArray<PSCookedMeshData> meshes;
+
+	// Amount of material slots on the model
+	PUi32 materialCount = 0;
+};
+
+// Reads and writes cooked mesh files
+// A cooked file stores every mesh of a model already in its GPU layout
+// Loading one skips ASSIMP and uploads the streams straight from the mapped file
+class PMeshCache
+{
+public:
+	// Get the path of the cooked file for a source model
+	static PString GetCookedPath(const PString& sourcePath);
+
+	// Make the key a cooked file must match to be used
+	// Hashes the bytes of the source file together with the import settings
+	// Returns 0 if the source file can't be read
+	static PUi64 MakeKey(const PString& sourcePath, const PSMeshSettings& settings);
+
+	// Map a cooked file and check every mesh in it without using open gl
+	// Safe to call on a worker thread, create the meshes from the result on the GL thread
+	// Returns false if the file is missing, out of date or broken
+	static bool Read(const PString& cookedPath, const PUi64& key, PSCookedModel& outModel);
+
+	// Write meshes into a cooked file
+	// Only reads the CPU data of the meshes so it can run before they are uploaded
+	static bool Save(const PString& cookedPath, const PUi64& key, const TArray<TUnique<PMesh>>& meshes, const PUi32& materialCount);
+};
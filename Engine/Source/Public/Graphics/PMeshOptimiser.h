@@ -0,0 +1,29 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Graphics/PMesh.h"
+
+// Reorders mesh data at import so the GPU does less work drawing it
+class PMeshOptimiser
+{
+public:
+	// Merge vertices that have exactly the same attributes
+	// Returns the amount of vertices that were removed
+	static PUi32 WeldVertices(TArray<PSVertexData>& vertices, TArray<PUi32>& indices);
+
+	// Reorder the triangles so vertices are reused while still in the post transform cache
+	// Uses Tom Forsyth's linear-speed vertex cache optimisation
+	static void OptimiseVertexCache(TArray<PUi32>& indices, const PUi32& vertexCount);
+
+	// Reorder clusters of triangles so the ones facing out from the mesh are drawn first
+	// Run after OptimiseVertexCache, the clusters are split where the cache would restart
+	// so the cache order inside each cluster is kept
+	static void OptimiseOverdraw(const TArray<PSVertexData>& vertices, TArray<PUi32>& indices);
+
+	// Reorder the vertices into the order the indices first use them
+	// Vertices that aren't used are removed
+	static void OptimiseVertexFetch(TArray<PSVertexData>& vertices, TArray<PUi32>& indices);
+
+	// Average amount of vertices transformed per triangle with a FIFO cache
+	// 3 is the worst, around 0.6 is the best a real mesh can get
+	static float CalculateACMR(const TArray<PUi32>& indices, const PUi32& vertexCount, const PUi32& cacheSize = 16);
+};
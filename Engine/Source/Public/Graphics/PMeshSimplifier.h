@@ -0,0 +1,17 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Graphics/PMesh.h"
+
+// Reduces the triangles of a mesh using quadric error metrics (Garland and Heckbert)
+// Only the indices change, the simplified triangles reuse the original vertices
+// so every level of detail can share one vertex buffer
+class PMeshSimplifier
+{
+public:
+	// Collapse edges until the mesh has the target amount of indices or the error gets too big
+	// maxError is the largest allowed distance from the original surface, relative to the mesh radius
+	// Vertices on open borders and texture seams are never moved so the mesh doesn't crack
+	// Returns the amount of indices in the result
+	static PUi32 Simplify(const TArray<PSVertexData>& vertices, const TArray<PUi32>& indices,
+		const PUi32& targetIndexCount, const float& maxError, TArray<PUi32>& outIndices);
+};
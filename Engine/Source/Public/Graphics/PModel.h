@@ -1,6 +1,7 @@
 #pragma once
 #include "EngineTypes.h"
 #include "Graphics/PMesh.h"
+#include "Graphics/PELoadState.h"
 #include "Math/PSTransform.h"
 
 // External Libs
@@ -8,34 +9,122 @@
 
 class PTexture;
 class PShaderProgram;
+class PGeometryBuffer;
 struct aiScene;
 struct aiNode;
+struct aiMesh;
+struct PSModelImport;
+struct PSImportedMesh;
 struct PSLight;
 struct PSMaterial;
 
 class PModel
 {
 public:
-	PModel() {  }
+	PModel() { m_WorldMatrix = glm::mat4(1.0f); m_BoundsDirty = true; m_Cell = -1; m_LoadState = LS_NONE; m_IsOccluder = false; }
 	~PModel() = default;
 
 	// Import a 3D model from file
 	// Uses the ASSIMP import library, check docs to know file types accepted
-	void ImportModel(const PString& filePath);
+	// Each mesh is created with the settings
+	// The result is cooked to a file so later imports with the same source and settings skip ASSIMP
+	// Blocks until the model is on the GPU, the meshes are still converted in parallel
+	void ImportModel(const PString& filePath, const PSMeshSettings& meshSettings = PSMeshSettings());
+
+	// Start importing a 3D model on a worker thread and return straight away
+	// The model is LS_LOADING until UpdateImport() uploads it on the GL thread
+	void ImportModelAsync(const PString& filePath, const PSMeshSettings& meshSettings = PSMeshSettings());
+
+	// Upload the model if the worker has finished reading it, must be called on the GL thread
+	// Returns true on the call that the model becomes ready or fails
+	bool UpdateImport();
+
+	// Get the progress of the model's import
+	PELoadState GetLoadState() const { return m_LoadState; }
+
+	// Make this model an instance of another model
+	// The instance has its own transform and materials but shares the meshes and their GPU data
+	// The instance is LS_LOADING until UpdateImport() finds the source is ready
+	void CreateInstance(const TShared<PModel>& source);
+
+	// Get the model this is an instance of, null if it isn't an instance
+	const TShared<PModel>& GetSource() const { return m_Source; }
+
+	// Get the memory used by the meshes on the GPU in bytes
+	// Instances report the memory of the meshes they share
+	PUi64 GetMemorySize() const;
 
 	// Render all of the meshes within the model
 	// Transform of mesges will be based on the models transform
 	void Render(const TShared<PShaderProgram>& shader, const TArray<TShared<PSLight>>& lights);
 
+	// Render a single mesh within the model at its current level of detail
+	// The camera and lights must already be set on the shader
+	void RenderMesh(const PUi32& meshIndex, const TShared<PShaderProgram>& shader);
+
+	// Update the world matrix and world bounds if the transform has changed
+	// Returns true if the model moved since the last update
+	bool UpdateWorldBounds();
+
+	// Get the bounds around all of the meshes in world space
+	const PSBounds& GetWorldBounds() const { return m_WorldBounds; }
+
+	// Get the bounds of a mesh in world space
+	const PSBounds& GetMeshWorldBounds(const PUi32& meshIndex) const { return m_MeshWorldBounds[meshIndex]; }
+
+	// Get the world matrix from the last bounds update
+	const glm::mat4& GetWorldMatrix() const { return m_WorldMatrix; }
+
+	// Get the amount of meshes in the model
+	PUi32 GetMeshCount() const { return static_cast<PUi32>(m_MeshStack.size()); }
+
+	// Get a mesh by index
+	PMesh* GetMesh(const PUi32& meshIndex) const { return m_MeshStack[meshIndex].get(); }
+
+	// Set the ID of the culling tree proxy for a mesh
+	void SetMeshProxy(const PUi32& meshIndex, const int& proxyID) { m_MeshProxies[meshIndex] = proxyID; }
+
+	// Get the ID of the culling tree proxy for a mesh, -1 if it has none
+	int GetMeshProxy(const PUi32& meshIndex) const { return m_MeshProxies[meshIndex]; }
+
+	// Set the level of detail a mesh is drawn with
+	void SetMeshLOD(const PUi32& meshIndex, const PUi32& lod) { m_MeshLODs[meshIndex] = lod; }
+
+	// Get the level of detail a mesh is drawn with
+	PUi32 GetMeshLOD(const PUi32& meshIndex) const { return m_MeshLODs[meshIndex]; }
+
+	// Get the material used by a mesh
+	const TShared<PSMaterial>& GetMeshMaterial(const PUi32& meshIndex) const { return m_MaterialsStack[m_MeshStack[meshIndex]->materialIndex]; }
+
+	// Test if every mesh in the model is in a shared geometry buffer
+	bool IsInGeometryBuffer() const;
+
+	// Set if every mesh in the model is used as an occluder
+	// Meshes that finish loading later use the same setting
+	// The flag is stored on the meshes so every instance sharing them is affected
+	void SetOccluder(const bool& isOccluder);
+
+	// Set the portal cell the model is in, -1 if it isn't part of the level
+	// Models in cells are only drawn when the cell can be seen through the portals
+	void SetCell(const int& cellIndex) { m_Cell = cellIndex; }
+
+	// Get the portal cell the model is in, -1 if it has none
+	int GetCell() const { return m_Cell; }
+
 	// Get the transform of the model
 	PSTransform& GetTransform() { return m_Transform; }
 
 	// Set a material by the slot number
+	// Slots can be set while the model is loading, they are kept once it is ready
+	// Slots past the model's material count are dropped with a warning when it finishes loading
 	void SetMaterialBySlot(unsigned int slot, const TShared<PSMaterial>& material);
 	
 private:
-	// Array of meshes
-	TArray<TUnique<PMesh>> m_MeshStack;
+	// Array of meshes, shared with every instance of the model
+	TArray<TShared<PMesh>> m_MeshStack;
+
+	// The model this is an instance of, null if the model owns its meshes
+	TShared<PModel> m_Source;
 
 	// Transform for the model in 3D space
 	PSTransform m_Transform;
@@ -43,7 +132,52 @@ private:
 	// Array of materials for the model
 	TArray<TShared<PSMaterial>> m_MaterialsStack;
 
-	// Find all of the meshes in a scene and convert them to a LMesh
-	bool FindAndImportMeshes(const aiNode& node, const aiScene& scene, 
-		const aiMatrix4x4& parentTransform, PUi32* meshesCreated);
+	// The transform used for the last world bounds update
+	PSTransform m_LastTransform;
+
+	// The world matrix from the last world bounds update
+	glm::mat4 m_WorldMatrix;
+
+	// Bounds of all of the meshes in world space
+	PSBounds m_WorldBounds;
+
+	// Bounds of each mesh in world space, same order as the mesh stack
+	TArray<PSBounds> m_MeshWorldBounds;
+
+	// IDs of the culling tree proxies for each mesh
+	TArray<int> m_MeshProxies;
+
+	// Level of detail each mesh is drawn with
+	TArray<PUi32> m_MeshLODs;
+
+	// Index of the portal cell the model is in
+	int m_Cell;
+
+	// If the meshes are used as occluders
+	bool m_IsOccluder;
+
+	// Force the world bounds to update even if the transform hasn't changed
+	bool m_BoundsDirty;
+
+	// Progress of the model's import
+	PELoadState m_LoadState;
+
+	// Import waiting for a worker to finish, null when nothing is loading
+	TShared<PSModelImport> m_Import;
+
+	// Read and convert a model on the CPU without using open gl
+	// Runs on a worker thread for async imports so it must not touch the model
+	static void LoadImport(PSModelImport& import);
+
+	// Create the meshes from a finished import on the GL thread
+	void UploadImport(PSModelImport& import);
+
+	// Size the per mesh arrays for the meshes that were just added and log their memory
+	void FinishImport(const PUi32& materialCount);
+
+	// Find all of the meshes in a scene and their transforms relative to the model
+	static void FindMeshes(const aiNode& node, const aiMatrix4x4& parentTransform, TArray<PSImportedMesh>& outMeshes);
+
+	// Convert an ASSIMP mesh into a PMesh that is ready to upload
+	static bool ConvertMesh(const aiMesh& aMesh, const PSMeshSettings& meshSettings, PMesh& outMesh);
 };
\ No newline at end of file
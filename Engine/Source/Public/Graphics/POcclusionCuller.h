@@ -0,0 +1,87 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Math/PSBounds.h"
+
+// External Libs
+#include <GLM/mat4x4.hpp>
+
+// An occluder triangle after being projected to the depth buffer
+struct PSOcclusionTriangle
+{
+	// Position of each corner in depth buffer pixels
+	float x[3] = { 0.0f, 0.0f, 0.0f };
+	float y[3] = { 0.0f, 0.0f, 0.0f };
+
+	// Depth of each corner from 0 (near) to 1 (far)
+	float z[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// Rasterizes occluders into a small depth buffer on the CPU
+// Bounds can then be tested against it to skip meshes hidden behind the occluders
+// Doesn't use open gl so it can run without a window
+class POcclusionCuller
+{
+public:
+	POcclusionCuller();
+	~POcclusionCuller() = default;
+
+	// Set the size of the depth buffer
+	// The width is rounded up to fit whole tiles
+	void SetResolution(const PUi32& width, const PUi32& height);
+
+	// Clear the depth buffer and the occluders from the last frame
+	void BeginFrame(const glm::mat4& viewProjection);
+
+	// Project and add the triangles of an occluder mesh
+	// stride is the amount of bytes between each position
+	void AddOccluder(const float* positions, const PUi32& stride, const PUi32& vertexCount,
+		const PUi32* indices, const PUi32& indexCount, const glm::mat4& worldMatrix);
+
+	// Rasterize all of the occluders and build the hierarchical depth
+	// Each tile of the depth buffer is rasterized on a separate job
+	void Rasterize();
+
+	// Test if any part of a world space box could be in front of the occluders
+	// Returns false if the box is completely hidden
+	bool TestBounds(const PSBounds& bounds) const;
+
+	// Get the depth buffer from the last rasterize
+	const TArray<float>& GetDepthBuffer() const { return m_HiZ[0]; }
+
+	// Get the width of the depth buffer
+	PUi32 GetWidth() const { return m_Width; }
+
+	// Get the height of the depth buffer
+	PUi32 GetHeight() const { return m_Height; }
+
+	// Get the amount of occluder triangles added this frame
+	PUi32 GetTriangleCount() const { return static_cast<PUi32>(m_Triangles.size()); }
+
+private:
+	// Rasterize every triangle binned to a tile
+	void RasterizeTile(const PUi32& tileIndex);
+
+	// Build each smaller depth level using the farthest depth of 2x2 pixels
+	void BuildHiZ();
+
+	// Size of the depth buffer
+	PUi32 m_Width, m_Height;
+
+	// Amount of tiles across and down
+	PUi32 m_TilesX, m_TilesY;
+
+	// Camera matrix for this frame
+	glm::mat4 m_ViewProjection;
+
+	// Occluder triangles for this frame
+	TArray<PSOcclusionTriangle> m_Triangles;
+
+	// Triangle indexes that touch each tile
+	TArray<TArray<PUi32>> m_TileBins;
+
+	// Depth levels, 0 is the full depth buffer and each level after is half the size
+	TArray<TArray<float>> m_HiZ;
+
+	// Width and height of each depth level
+	TArray<PUi32> m_HiZWidth, m_HiZHeight;
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Math/PSBounds.h"
+#include "Math/PSFrustum.h"
+
+// External Libs
+#include <GLM/glm.hpp>
+
+// A room or corridor of the level
+struct PSCell
+{
+	// Name of the cell for debugging
+	PString name;
+
+	// Area the cell takes up, used to find which cell a point is in
+	PSBounds bounds;
+
+	// Indexes of the portals that connect to this cell
+	TArray<PUi32> portals;
+};
+
+// An opening between two cells, like a doorway or window
+struct PSPortal
+{
+	// Corners of the portal in world space
+	// Must be a flat convex polygon
+	TArray<glm::vec3> points;
+
+	// Box around the corners
+	PSBounds bounds;
+
+	// The cells on each side of the portal
+	PUi32 cellA = 0;
+	PUi32 cellB = 0;
+
+	// Closed portals block visibility, for example a shut door
+	bool isOpen = true;
+};
+
+// Finds the cells that can be seen from the camera by looking through portals
+// The view is narrowed by every portal it passes through
+class PPortalGraph
+{
+public:
+	PPortalGraph();
+	~PPortalGraph() = default;
+
+	// Add a cell and return its index
+	PUi32 AddCell(const PString& name, const PSBounds& bounds);
+
+	// Add a portal between two cells and return its index
+	// Returns -1 if the cells don't exist or there are less than 3 points
+	int AddPortal(const PUi32& cellA, const PUi32& cellB, const TArray<glm::vec3>& points);
+
+	// Open or close a portal
+	void SetPortalOpen(const PUi32& portalIndex, const bool& isOpen);
+
+	// Test if a portal is open
+	bool IsPortalOpen(const PUi32& portalIndex) const;
+
+	// Find the smallest cell that contains a point
+	// Returns -1 if the point is outside every cell
+	int FindCell(const glm::vec3& point) const;
+
+	// Trace the cells that can be seen from the camera
+	// Returns false if the camera isn't in a cell, in that case nothing should be portal culled
+	bool UpdateVisibility(const glm::vec3& cameraPosition, const glm::mat4& viewProjection);
+
+	// Test if a cell was reached by the last visibility update
+	bool IsCellVisible(const int& cellIndex) const;
+
+	// Test if bounds in a cell can be seen through any of the portal views into that cell
+	bool TestBounds(const int& cellIndex, const PSBounds& bounds) const;
+
+	// Get the amount of cells
+	PUi32 GetCellCount() const { return static_cast<PUi32>(m_Cells.size()); }
+
+	// Get the amount of cells reached by the last visibility update
+	PUi32 GetVisibleCellCount() const { return m_VisibleCellCount; }
+
+	// Get a cell by index
+	const PSCell& GetCell(const PUi32& cellIndex) const { return m_Cells[cellIndex]; }
+
+	// Get a portal by index
+	const PSPortal& GetPortal(const PUi32& portalIndex) const { return m_Portals[portalIndex]; }
+
+	// Distance from a portal that the camera counts as standing in it
+	// Stops the near clip plane from cutting away the portal the camera is walking through
+	void SetPortalMargin(const float& margin) { m_PortalMargin = margin; }
+
+private:
+	// Add a view into a cell then continue through its open portals
+	// rect is the screen area the view covers as min x, min y, max x, max y
+	void VisitCell(const PUi32& cellIndex, const PSFrustum& frustum, const glm::vec4& rect, const PUi32& depth);
+
+	// Add a view to a cell
+	void AddCellView(const PUi32& cellIndex, const PSFrustum& frustum);
+
+	// Clip a polygon so only the part inside the frustum is left
+	static void ClipPolygon(const PSFrustum& frustum, TArray<glm::vec3>& polygon);
+
+	// All of the cells
+	TArray<PSCell> m_Cells;
+
+	// All of the portals
+	TArray<PSPortal> m_Portals;
+
+	// Views that can see into each cell from the last update
+	TArray<TArray<PSFrustum>> m_CellViews;
+
+	// Cells that are being looked through in the current trace
+	// Stops the trace from looping back into a cell it came from
+	TArray<bool> m_CellOnPath;
+
+	// The full camera frustum from the last update
+	PSFrustum m_CameraFrustum;
+
+	// Camera matrix and position from the last update
+	glm::mat4 m_ViewProjection;
+	glm::vec3 m_CameraPosition;
+
+	// Amount of cells reached by the last update
+	PUi32 m_VisibleCellCount;
+
+	// Distance from a portal that the camera counts as standing in it
+	float m_PortalMargin;
+};
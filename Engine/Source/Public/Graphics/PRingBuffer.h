@@ -0,0 +1,108 @@
+#pragma once
+#include "EngineTypes.h"
+
+typedef struct __GLsync* GLsync;
+
+// Part of a ring buffer handed out for this frame
+struct PSRingAllocation
+{
+	// Where the CPU writes the data, stays valid until the end of the frame
+	void* data = nullptr;
+
+	// Byte offset of the data in the ring buffer, used to bind the range or as an indirect offset
+	PUi64 offset = 0;
+
+	// Size of the allocation in bytes
+	PUi64 size = 0;
+};
+
+// A persistently mapped buffer for data that is written every frame
+// The buffer is split into a region for each frame in flight, 3 by default
+// The CPU writes straight into the current frame's region while the GPU reads the regions of earlier frames
+// A fence is placed at the end of each frame and the region is only written again once the GPU has passed it
+// If the CPU gets a whole ring ahead of the GPU it waits on that fence, the waits are counted so it shows up in the stats
+class PRingBuffer
+{
+public:
+	PRingBuffer();
+	~PRingBuffer();
+
+	// Create the buffer with room for a frame's data in each region
+	// Requires open gl 4.4 or ARB_buffer_storage
+	bool Init(const PUi64& frameSize, const PUi32& frameCount = 3);
+
+	// Move to the next frame's region, waiting for the GPU if it is still reading it
+	// Regions that overflowed last frame are made bigger here
+	void BeginFrame();
+
+	// Place the fence for the data written this frame
+	void EndFrame();
+
+	// Take an aligned part of this frame's region
+	// Returns false if the region is full, the next frame's region is then made bigger
+	bool Allocate(const PUi64& size, const PUi64& alignment, PSRingAllocation& outAllocation);
+
+	// Test if the buffer was created and mapped
+	bool IsValid() const { return m_Data != nullptr; }
+
+	// Get the ID of the buffer in open gl
+	PUi32 GetID() const { return m_Buffer; }
+
+	// Get the size of each frame's region in bytes
+	PUi64 GetFrameSize() const { return m_FrameSize; }
+
+	// Get the bytes allocated so far this frame
+	PUi64 GetBytesUsed() const { return m_FrameUsed; }
+
+	// Test if the CPU had to wait for the GPU at the start of this frame
+	bool HasWaited() const { return m_HasWaited; }
+
+	// Get the time waited for the GPU at the start of this frame in milliseconds
+	double GetWaitTime() const { return m_WaitTime; }
+
+	// Get the amount of frames that have waited for the GPU since the buffer was created
+	PUi64 GetWaitCount() const { return m_WaitCount; }
+
+private:
+	// Create and map the storage for every region
+	bool CreateStorage();
+
+	// Delete the storage and every fence
+	void DestroyStorage();
+
+	// Wait for a fence and delete it, returns false if the wait failed
+	bool WaitFence(GLsync& fence);
+
+	// Buffer ID in open gl
+	PUi32 m_Buffer;
+
+	// CPU address of the mapped buffer
+	PUi8* m_Data;
+
+	// Size of each frame's region in bytes
+	PUi64 m_FrameSize;
+
+	// Amount of frames that can be in flight
+	PUi32 m_FrameCount;
+
+	// Region being written this frame
+	PUi32 m_FrameIndex;
+
+	// Bytes allocated this frame
+	PUi64 m_FrameUsed;
+
+	// Fence for each region, null if the GPU has nothing to read in it
+	TArray<GLsync> m_Fences;
+
+	// If an allocation didn't fit this frame
+	bool m_HasOverflowed;
+
+	// If the CPU waited for the GPU at the start of this frame
+	bool m_HasWaited;
+
+	// Time waited at the start of this frame in milliseconds
+	double m_WaitTime;
+
+	// Frames that have waited for the GPU
+	PUi64 m_WaitCount;
+};
@@ -63,6 +63,27 @@ struct PSCamera
 		defaultFov = defaultFov;
 	}
 
+	// Get the view matrix based on the camera position and rotation
+	glm::mat4 GetViewMatrix()
+	{
+		return glm::lookAt(
+			transform.position,
+			transform.position + transform.Forward(),
+			transform.Up()
+		);
+	}
+
+	// Get the perspective projection matrix of the camera
+	glm::mat4 GetProjectionMatrix() const
+	{
+		return glm::perspective(
+			glm::radians(fov), // The zoom of your camera
+			aspectRatio, // How wide the view is
+			nearClip, // How close you can see 3D models
+			farClip // How far you can see 3D models - all other models woll not render
+		);
+	}
+
 	PSTransform transform;
 	float fov;
 	float defaultFov; // don't change, will auto set based on the fov on initialisation
@@ -2,6 +2,10 @@
 
 // External Libs
 #include <GLM/vec3.hpp>
+#include <GLM/common.hpp>
+
+// System Libs
+#include <cmath>
 
 struct PSLight
 {
@@ -42,4 +46,23 @@ struct PSPointLight : public PSLight
 	// Fall off values for how far the lights can reach
 	float linear; 
 	float quadratic; 
+
+	// Get the distance where the light's brightest channel falls to the cutoff
+	// The shader fades the light to nothing at this distance so lights only shade the clusters it reaches
+	float GetRadius(const float& cutoff = 1.0f / 256.0f) const
+	{
+		// Solve brightness / (1 + linear * d + quadratic * d^2) = cutoff for d
+		const float brightness = glm::max(glm::max(colour.r, colour.g), colour.b) * intensity;
+		const float constant = 1.0f - brightness / cutoff;
+
+		// Too dim to ever reach the cutoff
+		if (constant >= 0.0f)
+			return 0.0f;
+
+		if (quadratic > 0.0f)
+			return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * constant)) / (2.0f * quadratic);
+
+		// Without any fall off the light reaches everything
+		return linear > 0.0f ? -constant / linear : INFINITY;
+	}
 };
\ No newline at end of file
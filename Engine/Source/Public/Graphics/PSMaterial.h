@@ -21,4 +21,14 @@ struct PSMaterial
 
 	// Intensity of specular
 	float specularStrength = 0.5f;
-};
\ No newline at end of file
+
+	// Write the properties to the material buffer again, call after changing them
+	// Changes to the maps are found without this
+	void MarkDirty() { isDirty = true; }
+
+	// Index of the material in the material buffer, given out the first time the material is drawn
+	PUi32 materialID = UINT32_MAX;
+
+	// If the properties have changed since the material buffer last wrote them
+	bool isDirty = true;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include "EngineTypes.h"
+
+// Reads and writes linked shader program binaries
+// A binary is only valid for the driver that made it so the key includes the GL vendor, renderer and version
+// Drivers can still reject a binary after an update, the program is then compiled from source and saved again
+class PShaderCache
+{
+public:
+	// Test if the driver can give and take program binaries
+	static bool IsSupported();
+
+	// Make the key a cached binary must match to be used
+	// Hashes the shader sources and defines together with the driver strings
+	static PUi64 MakeKey(const PString& vShaderSource, const PString& fShaderSource, const PString& defines);
+
+	// Get the path of the cached binary for a key
+	static PString GetCachedPath(const PUi64& key);
+
+	// Load a cached binary into a program
+	// Returns false if there is no binary for the key or the driver rejected it
+	static bool Load(const PUi32& program, const PUi64& key);
+
+	// Write the binary of a linked program to the cache
+	// The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	static bool Save(const PUi32& program, const PUi64& key);
+};
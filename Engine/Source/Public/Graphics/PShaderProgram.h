@@ -1,12 +1,15 @@
 #pragma once
 #include "EngineTypes.h"
+#include "Graphics/PELoadState.h"
 
 // External Libs
 #include <GLM/mat4x4.hpp>
 
+// System Libs
+#include <chrono>
+
 class PTexture;
 struct PSCamera;
-struct PSMaterial;
 
 // Enum to determine the typw of shader
 enum PEShaderType : PUi8
@@ -18,6 +21,32 @@ enum PEShaderType : PUi8
 struct PSTransform;
 struct PSLight;
 
+// Keywords a shader variant is compiled with, each one is injected into the shader source as a #define
+// Smaller variants skip the work for lights and maps a draw doesn't have
+struct PSShaderKeywords
+{
+	// Amount of directional lights the shader loops over
+	PUi32 dirLights = 2;
+
+	// If the shader loops over the point lights of its light cluster
+	bool hasPointLights = true;
+
+	// If the specular map is sampled, without it there is no specular lighting
+	bool hasSpecularMap = true;
+
+	// If the base colour is tinted by the vertex colours
+	bool hasVertexColours = true;
+
+	// Get a number that is unique to these keywords
+	PUi64 GetKey() const;
+
+	// Get the #define lines for these keywords
+	PString ToDefines() const;
+
+	// Set the light keywords to the lights in the scene, up to the most directional lights the shader supports
+	void SetLightCounts(const TArray<TShared<PSLight>>& lights);
+};
+
 class PShaderProgram 
 {
 public:
@@ -25,7 +54,33 @@ public:
 	~PShaderProgram();
 
 	// Create the shader using a vertex and fragment file
-	bool InitShader(const PString& vShaderPath, const PString& fShaderPath);
+	// Defines are added to both shaders after their #version line
+	bool InitShader(const PString& vShaderPath, const PString& fShaderPath, const PString& defines = "");
+
+	// Create the shader using vertex and fragment source that has already been read
+	// The linked binary is cached on disk and loaded instead of compiling on later launches
+	// Async returns once the driver has been asked to compile, the program is LS_LOADING until UpdateLoad() finds it done
+	// Drivers without parallel compiling finish the program before returning either way
+	bool InitShaderSource(const PString& vShaderSource, const PString& fShaderSource, const PString& defines = "", const bool& async = false);
+
+	// Finish the program if the driver has compiled it, only waits for the driver if asked to
+	// Returns true on the call that the program becomes ready or fails
+	bool UpdateLoad(const bool& wait = false);
+
+	// Get the progress of the program's compile, only LS_READY programs can be drawn with
+	PELoadState GetLoadState() const { return m_LoadState; }
+
+	// Test if the driver can compile and link on its own threads
+	static bool IsParallelCompileSupported();
+
+	// Test if the program was loaded from the binary cache instead of compiled
+	bool IsFromCache() const { return m_IsFromCache; }
+
+	// Get the time the program took to compile or load in milliseconds, async programs include the frames they waited
+	double GetInitTime() const { return m_InitTime; }
+
+	// Convert a file into a string
+	static PString ConvertFileToString(const PString& filePath);
 
 	// Activate the shader to update
 	// You can't change values in a shader without activating it
@@ -37,15 +92,20 @@ public:
 	// Set the transform of the model in the shader
 	void SetModelTransform(const PSTransform& transform);
 
+	// Set the transform of the model in the shader using a world matrix
+	void SetModelTransform(const glm::mat4& matTransform);
+
+	// Set how stored vertex positions are turned back into mesh space
+	// position = stored * scale + offset
+	void SetPositionDecode(const glm::vec3& offset, const glm::vec3& scale);
+
 	// Set the 3D coordinates for the model
 	void SetWorldTransform(const TShared<PSCamera>& camera);
 
-	// Set the lights in the shader
+	// Set the directional lights in the shader
+	// Point lights are read from the light cluster buffers instead
 	void SetLights(const TArray<TShared<PSLight>>& lights);
 
-	// Set the material in the shader
-	void SetMaterial(const TShared<PSMaterial>& material);
-
 private:
 	// Store the file paths
 	PString m_FilePath[2] = { "", "" };
@@ -56,12 +116,30 @@ private:
 	// Store the ID for the program
 	PUi32 m_ProgramID;
 
-	// Import a shader based on the shader type
-	bool ImportShaderByType(const PString& filePath, PEShaderType shaderType);
+	// Compile shader source with the defines added and attach it to the program
+	bool CompileShaderByType(const PString& source, PEShaderType shaderType, const PString& defines);
 
-	// Convert a file into a string
-	PString ConvertFileToString(const PString& filePath);
+	// Progress of the program's compile
+	PELoadState m_LoadState;
+
+	// If the program was loaded from the binary cache
+	bool m_IsFromCache;
+
+	// Key of the program's binary in the cache, 0 if binaries can't be cached
+	PUi64 m_CacheKey;
+
+	// Time the compile or load started
+	std::chrono::steady_clock::time_point m_StartTime;
+
+	// Time the program took to compile or load in milliseconds
+	double m_InitTime;
+
+	// Start linking the shader on the GPU through open gl
+	void LinkToGPU();
+
+	// Read the compile and link results and get the program ready to draw with, waits for the driver if it isn't done
+	bool FinishLink();
 
-	// Link the shader to the GPU through open gl
-	bool LinkToGPU();
+	// Point each sampler at its texture unit, needed after linking or loading a binary
+	void SetSamplerUnits();
 };
@@ -0,0 +1,53 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Graphics/PShaderProgram.h"
+
+// System Libs
+#include <unordered_map>
+
+// Every variant of one vertex and fragment shader pair, keyed by the keywords they were compiled with
+// The source files are read once and each variant is compiled the first time a draw asks for it
+// Variants compile on the driver's threads where it supports parallel compiling, draws use a fallback until they are ready
+// Variants that fail to compile are remembered so they aren't compiled again every frame
+class PShaderVariants
+{
+public:
+	PShaderVariants() = default;
+
+	// Read the vertex and fragment shader files the variants are compiled from
+	bool Init(const PString& vShaderPath, const PString& fShaderPath);
+
+	// Get the variant for a set of keywords, starting its compile if it hasn't been asked for before
+	// Returns null while the variant is compiling or if it failed, draw with a fallback instead
+	// Wait compiles the variant before returning, use it for variants that are needed straight away
+	TShared<PShaderProgram> GetVariant(const PSShaderKeywords& keywords, const bool& wait = false);
+
+	// Start compiling a list of variants so they are ready before they are drawn, call during loading screens
+	void WarmUp(const TArray<PSShaderKeywords>& keywords);
+
+	// Finish the variants the driver has compiled since the last call, never waits for the driver
+	// Call once a frame on the GL thread
+	void Update();
+
+	// Get the amount of variants that have been asked for
+	PUi32 GetVariantCount() const { return static_cast<PUi32>(m_Variants.size()); }
+
+	// Get the amount of variants still compiling
+	PUi32 GetPendingCount() const { return static_cast<PUi32>(m_Pending.size()); }
+
+private:
+	// Create a variant and start its compile
+	TShared<PShaderProgram> StartVariant(const PSShaderKeywords& keywords);
+
+	// Paths of the shader files, used in the logs
+	PString m_VertexPath, m_FragmentPath;
+
+	// Source of the shader files
+	PString m_VertexSource, m_FragmentSource;
+
+	// Variants by keyword key, null for variants that failed
+	std::unordered_map<PUi64, TShared<PShaderProgram>> m_Variants;
+
+	// Keys of the variants still compiling
+	TArray<PUi64> m_Pending;
+};
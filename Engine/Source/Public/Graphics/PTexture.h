@@ -1,5 +1,10 @@
 #pragma once
 #include "EngineTypes.h"
+#include "Graphics/PELoadState.h"
+#include "Graphics/PBlockCompression.h"
+
+struct PSTextureImport;
+
 class PTexture
 {
 public:
@@ -7,13 +12,28 @@ public:
 	~PTexture();
 
 	// Import a file and convert it to a texture
+	// Uses the cooked texture for the file if there is one, otherwise the image is decoded
+	// Blocks until the texture is on the GPU
 	bool LoadTexture(const PString& fileName, const PString& path);
 
-	// Activates the texture to use for open gl
-	void BindTexture(const PUi32& textureNumber);
+	// Start reading the texture on a worker thread and return straight away
+	// The texture is LS_LOADING until UpdateLoad() uploads it on the GL thread
+	// A streamed texture only uploads its small mip maps, call SetResidentMip() to load the rest
+	void LoadTextureAsync(const PString& fileName, const PString& path, const bool& streamed = false);
+
+	// Upload the texture if the worker has finished reading it, must be called on the GL thread
+	// Returns true on the call that the texture becomes ready or fails
+	bool UpdateLoad();
+
+	// Get the progress of the texture's load
+	PELoadState GetLoadState() const { return m_LoadState; }
+
+	// Bind the texture to a texture unit for the shader to sample
+	// The bind is skipped if the texture is already bound to the unit
+	void BindTexture(const PUi32& unit);
 
-	// Deactiavtes the texture in open gl
-	void Unbind();
+	// Clear a texture unit
+	void Unbind(const PUi32& unit = 0);
 
 	// Gets the import path of the texture
 	PString GetImportPath() const { return m_Path; }
@@ -22,9 +42,71 @@ public:
 	PString GetName() const { return m_FileName; }
 
 	// Get the ID of the texture for open gl
+	// The ID changes when a streamed texture loads or drops mip maps
 	PUi32 GetID() const { return m_ID; }
 
+	// Get the size of the texture in pixels
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+
+	// Get the amount of colour channels in the texture
+	int GetChannels() const { return m_Channels; }
+
+	// Get the memory used on the GPU in bytes including the mip maps
+	PUi64 GetMemorySize() const { return m_ID > 0 ? m_MemorySize : 0; }
+
+	// Test if the texture was loaded from a cooked file
+	bool IsCooked() const { return m_IsCooked; }
+
+	// Get the open gl internal format of the storage, a block compression format for cooked textures
+	PUi32 GetInternalFormat() const { return m_InternalFormat; }
+
+	// Test if the texture keeps its mip maps on the CPU so they can be streamed in and out
+	bool IsStreamed() const { return m_Source != nullptr; }
+
+	// Get the amount of mip levels in the full texture
+	PUi32 GetLevelCount() const { return m_LevelCount; }
+
+	// Get the most detailed mip level with storage on the GPU, 0 is the full size image
+	PUi32 GetResidentMip() const { return m_ResidentMip; }
+
+	// Get the most detailed mip level that has been uploaded, only levels from here down are sampled
+	// Greater than the resident mip while the upload queue is still copying levels in
+	PUi32 GetLoadedMip() const { return m_LoadedMip; }
+
+	// Test if the upload queue is still copying levels into the storage
+	bool IsStreaming() const { return m_LoadedMip != m_ResidentMip; }
+
+	// Get the most detailed mip level a streamed texture loads with, it never drops below this
+	PUi32 GetTailMip() const { return m_TailMip; }
+
+	// Get the memory on the GPU a texture would use with a mip level as its most detailed level
+	PUi64 GetResidentSize(const PUi32& mip) const;
+
+	// Change the most detailed mip level on the GPU of a streamed texture, must be called on the GL thread
+	// The storage is made again at the new size, levels both sizes share are copied on the GPU
+	// Only the levels that weren't on the GPU are queued to upload, smallest first
+	bool SetResidentMip(const PUi32& mip);
+
+	// Test if the GPU can sample a block compression format
+	static bool IsCompressionSupported(const PETextureCompression& compression);
+
 private:
+	// Read the cooked file or decode the image without using open gl
+	// Safe to call on a worker thread
+	static void ReadImport(PSTextureImport& import);
+
+	// Decode the source image into RGBA8 pixels with every mip map, safe to call on a worker thread
+	static bool DecodeImage(PSTextureImport& import);
+
+	// Upload what ReadImport() made, must be called on the GL thread
+	bool UploadImport(const TShared<PSTextureImport>& import);
+
+	// Make immutable storage for the levels from a mip level down and fill it
+	// Levels already on the GPU are copied from the current storage which is then deleted
+	// The rest are queued on the upload queue and the base level drops as each one arrives
+	bool CreateStorage(const TShared<PSTextureImport>& import, const PUi32& firstMip);
+
 	// Import path of the image
 	PString m_Path;
 
@@ -37,4 +119,36 @@ private:
 	// Texture parameters
 	int m_Width, m_Height, m_Channels;
 
-};
\ No newline at end of file
+	// Memory used on the GPU in bytes including the mip maps
+	PUi64 m_MemorySize;
+
+	// If the texture was loaded from a cooked file
+	bool m_IsCooked;
+
+	// Open gl internal format of the storage
+	PUi32 m_InternalFormat;
+
+	// Amount of mip levels in the full texture
+	PUi32 m_LevelCount;
+
+	// Most detailed mip level with storage on the GPU
+	PUi32 m_ResidentMip;
+
+	// Most detailed mip level that has been uploaded
+	PUi32 m_LoadedMip;
+
+	// Most detailed mip level a streamed texture loads with
+	PUi32 m_TailMip;
+
+	// If the texture should keep its levels on the CPU for streaming
+	bool m_IsStreamed;
+
+	// Progress of the texture's load
+	PELoadState m_LoadState;
+
+	// Load running on a worker thread, null once it has been uploaded
+	TShared<PSTextureImport> m_Import;
+
+	// Levels of a streamed texture kept on the CPU, points into the cooked file or the decoded mip maps
+	TShared<PSTextureImport> m_Source;
+};
@@ -0,0 +1,130 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Graphics/PAtlasPacker.h"
+
+class PTexture;
+
+// External Libs
+#include <GLM/vec4.hpp>
+
+// System Libs
+#include <unordered_map>
+
+// Where the copy of a texture is in the texture arrays
+struct PSTextureArraySlot
+{
+	// Pool the copy is in, UINT32_MAX if the texture isn't in an array
+	PUi32 pool = UINT32_MAX;
+
+	// Layer of the pool's array
+	PUi32 layer = 0;
+
+	// Part of the layer the texture covers as x, y, width and height from 0 - 1
+	// Whole layers are 0, 0, 1, 1, only atlas entries cover less
+	glm::vec4 rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+	// Test if the slot holds a copy
+	bool IsValid() const { return pool != UINT32_MAX; }
+};
+
+// A texture array holding textures of one format and size, or atlas pages of one format
+struct PSTextureArrayPool
+{
+	// Texture array ID in open gl, changes when the pool grows
+	PUi32 id = 0;
+
+	// Open gl internal format of every layer
+	PUi32 internalFormat = 0;
+
+	// Size of each layer in pixels
+	PUi32 width = 0;
+	PUi32 height = 0;
+
+	// Amount of mip levels in each layer
+	PUi32 levelCount = 0;
+
+	// Amount of layers with storage
+	PUi32 layerCount = 0;
+
+	// Memory used by each layer on the GPU in bytes including the mip maps
+	PUi64 layerSize = 0;
+
+	// If the layers are atlas pages that hold many small textures
+	bool isAtlas = false;
+
+	// Layers that no texture is using, whole layer pools only
+	TArray<PUi32> freeLayers;
+
+	// Packer for each layer, atlas pools only
+	TArray<PAtlasPacker> pages;
+};
+
+// A texture that has been asked for in the arrays
+struct PSTextureArrayEntry
+{
+	// The texture, the arrays don't keep textures alive
+	TWeak<PTexture> texture;
+
+	// ID of the texture's storage when it was last copied, the copy is made again when it changes
+	PUi32 sourceID = 0;
+
+	// Where the copy is, invalid if the texture doesn't fit in any pool
+	PSTextureArraySlot slot;
+};
+
+// Copies textures into shared GL_TEXTURE_2D_ARRAY pools so materials can be told apart by a layer instead of a bind
+// Textures with power of two sizes share an array with every texture of the same format, size and mip count
+// Small textures with odd sizes are packed into 1024 x 1024 atlas pages with a few mip levels
+// Textures that fit neither keep being sampled on their own
+// The copies are made on the GPU once a texture has finished streaming, a texture that streams to another size moves pools
+class PTextureArrays
+{
+public:
+	PTextureArrays();
+	~PTextureArrays();
+
+	// Get where a texture's copy is, returns false if it isn't in an array yet
+	// Textures asked for that aren't in an array are copied in by a later Update()
+	bool GetSlot(const TShared<PTexture>& texture, PSTextureArraySlot& outSlot);
+
+	// Copy in textures that were asked for and copy again any that streamed to a new size
+	// Copies for textures that no longer exist are freed, must be called on the GL thread
+	void Update();
+
+	// Get the texture array ID of a pool
+	PUi32 GetArrayID(const PUi32& pool) const { return pool < m_Pools.size() ? m_Pools[pool].id : 0; }
+
+	// Get the memory used on the GPU by every pool in bytes
+	PUi64 GetMemorySize() const;
+
+	// Delete every pool and forget every texture, must be called on the GL thread
+	void Clear();
+
+private:
+	// Copy a texture's current storage into a pool, the entry's old copy is freed first
+	bool PlaceTexture(PSTextureArrayEntry& entry, const PTexture& texture);
+
+	// Take a layer of a whole layer pool that matches the texture, creating or growing the pool if needed
+	bool AllocateLayer(const PUi32& format, const PUi32& width, const PUi32& height, const PUi32& levelCount, PSTextureArraySlot& outSlot);
+
+	// Take a space on an atlas page of a format, adding a page if none have room
+	bool AllocateAtlas(const PUi32& format, const PUi32& width, const PUi32& height, PSTextureArraySlot& outSlot);
+
+	// Give a slot back to its pool
+	void FreeSlot(PSTextureArraySlot& slot);
+
+	// Create a pool's array with room for an amount of layers
+	bool CreatePool(PSTextureArrayPool& pool, const PUi32& layerCount);
+
+	// Move a pool into an array with twice the layers, the layers it had are copied on the GPU
+	bool GrowPool(PSTextureArrayPool& pool);
+
+	// Every pool, a pool's index stays the same for as long as the arrays exist
+	TArray<PSTextureArrayPool> m_Pools;
+
+	// Textures asked for by address
+	std::unordered_map<const PTexture*, PSTextureArrayEntry> m_Entries;
+
+	// Most layers an array can have on this GPU
+	PUi32 m_MaxLayers;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Graphics/PBlockCompression.h"
+#include "IO/PMappedFile.h"
+
+// Settings used when a texture is cooked
+struct PSTextureCookSettings
+{
+	// Block compression format, TC_AUTO picks one from the file name and the image
+	PETextureCompression compression = TC_AUTO;
+
+	// If the image stores colours in sRGB, the mip maps are then averaged in linear space
+	// Data like normals, roughness and masks is averaged as it is
+	bool isColour = true;
+};
+
+// A level of a cooked texture, the data points into the mapped file
+struct PSCookedTextureLevel
+{
+	// Size of the level in pixels
+	PUi32 width = 0;
+	PUi32 height = 0;
+
+	// The compressed blocks of the level
+	const PUi8* data = nullptr;
+	PUi64 size = 0;
+};
+
+// A cooked texture file that has been mapped and checked
+// The levels point into the mapped file so it must stay open until they are uploaded
+struct PSCookedTexture
+{
+	// The mapped cooked file
+	PMappedFile file;
+
+	// Compression format of every level
+	PETextureCompression compression = TC_AUTO;
+
+	// Amount of channels in the source image
+	PUi32 channels = 0;
+
+	// Every mip level, 0 is the full size image
+	TArray<PSCookedTextureLevel> levels;
+};
+
+// Cooks images into block compressed textures with a full mip chain
+// A cooked file is laid out like a KTX2 file, a header then an index of the levels
+// Loading one uploads every level straight from the mapped file without decoding an image
+class PTextureCooker
+{
+public:
+	// Get the path of the cooked file for a source image
+	static PString GetCookedPath(const PString& sourcePath);
+
+	// Get the settings a source image is cooked with when none are given
+	// Normal maps use BC5, images with transparency use BC7 and everything else uses BC1
+	// Normal, roughness, metallic, ambient occlusion and specular maps are treated as data
+	static PSTextureCookSettings GetDefaultSettings(const PString& sourcePath);
+
+	// Cook a source image into its cooked file
+	// Runs the block encoders on the thread pool
+	static bool CookTexture(const PString& sourcePath, const PSTextureCookSettings& settings);
+
+	// Cook a source image using its default settings
+	static bool CookTexture(const PString& sourcePath);
+
+	// Cook every png, jpg and tga image in a folder and the folders inside it
+	// Returns the amount of images that were cooked
+	static PUi32 CookFolder(const PString& folder);
+
+	// Map a cooked file and check every level in it without using open gl
+	// If the source image exists the cooked file must have been made from it
+	// If it doesn't exist the cooked file is used as it is, so a build can ship without the images
+	// Returns false if the file is missing, out of date or broken
+	static bool Read(const PString& cookedPath, const PString& sourcePath, PSCookedTexture& outTexture);
+
+	// Halve an RGBA8 image with a 2x2 box filter
+	// Colour images are converted to linear before averaging and back to sRGB after
+	static void DownsampleImage(const TArray<PUi8>& pixels, const PUi32& width, const PUi32& height,
+		const bool& isColour, TArray<PUi8>& outPixels, PUi32& outWidth, PUi32& outHeight);
+
+private:
+	// Hash the bytes of a source image, returns 0 if it can't be read
+	static PUi64 HashSource(const PString& sourcePath);
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include "EngineTypes.h"
+
+// System Libs
+#include <unordered_map>
+
+class PTexture;
+
+// A streamed texture and the mip level the renderer wants for it
+struct PSStreamedTexture
+{
+	// The texture, the streamer doesn't keep textures alive
+	TWeak<PTexture> texture;
+
+	// Most detailed mip level asked for this frame
+	PUi32 wantedMip = 0;
+
+	// Mip level picked after fitting every texture into the budget
+	PUi32 targetMip = 0;
+
+	// Last frame the texture was asked for
+	PUi64 lastSeenFrame = 0;
+};
+
+// Loads and drops the mip maps of streamed textures based on how large they are on screen
+// Each frame the renderer asks for the textures of the visible meshes with their size in pixels
+// Textures then move to the size asked for while staying inside a memory budget
+// New levels are copied in by the upload queue so streaming never adds more than its budget to a frame
+// When over budget the textures that haven't been seen for the longest lose their detailed levels first
+class PTextureStreamer
+{
+public:
+	PTextureStreamer();
+
+	// Start a new frame of requests
+	void BeginFrame() { ++m_Frame; }
+
+	// Ask for a texture to cover an amount of pixels on screen this frame
+	// The texture is expected to stretch once across that size
+	// Textures that aren't streamed are ignored
+	void RequestTexture(const TShared<PTexture>& texture, const float& screenPixels);
+
+	// Move the textures towards the mip levels asked for while staying inside the memory budget
+	// Must be called on the GL thread after every request for the frame has been made
+	void Update();
+
+	// Set the most memory streamed textures can use on the GPU in bytes
+	void SetMemoryBudget(const PUi64& bytes) { m_MemoryBudget = bytes; }
+
+	// Get the most memory streamed textures can use on the GPU in bytes
+	PUi64 GetMemoryBudget() const { return m_MemoryBudget; }
+
+	// Added to every mip level asked for, 1 = half the resolution
+	void SetMipBias(const float& bias) { m_MipBias = bias; }
+
+	// Get the memory used on the GPU by streamed textures after the last update in bytes
+	PUi64 GetMemoryUsed() const { return m_MemoryUsed; }
+
+private:
+	// Streamed textures by address
+	std::unordered_map<const PTexture*, PSStreamedTexture> m_Textures;
+
+	// Counts up each frame, used to find textures that haven't been seen
+	PUi64 m_Frame;
+
+	// Most memory streamed textures can use on the GPU in bytes
+	PUi64 m_MemoryBudget;
+
+	// Added to every mip level asked for
+	float m_MipBias;
+
+	// Memory used on the GPU by streamed textures after the last update
+	PUi64 m_MemoryUsed;
+};
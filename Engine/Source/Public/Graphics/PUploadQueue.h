@@ -0,0 +1,190 @@
+#pragma once
+#include "EngineTypes.h"
+
+// System Libs
+#include <algorithm>
+#include <functional>
+#include <deque>
+
+typedef struct __GLsync* GLsync;
+
+// What an upload is copied into
+enum PEUploadType : PUi8
+{
+	UT_BUFFER = 0U,
+	UT_TEXTURE
+};
+
+// Data waiting to be copied into a buffer or a texture level
+struct PSUploadJob
+{
+	// What the data is copied into
+	PEUploadType type = UT_BUFFER;
+
+	// Used to cancel every upload of an object when it is destroyed
+	const void* owner = nullptr;
+
+	// The buffer or texture ID in open gl
+	PUi32 targetID = 0;
+
+	// Byte offset into the buffer
+	PUi64 offset = 0;
+
+	// Mip level of the texture
+	PUi32 level = 0;
+
+	// Size of the texture level in pixels
+	PUi32 width = 0;
+	PUi32 height = 0;
+
+	// Open gl format of the texture level, the compressed format or the pixel format of RGBA8 data
+	PUi32 format = 0;
+
+	// If the data is block compressed, rows are then 4 pixels tall
+	bool isCompressed = false;
+
+	// The data to copy and its size in bytes
+	const PUi8* data = nullptr;
+	PUi64 size = 0;
+
+	// Bytes that have already been copied
+	PUi64 uploaded = 0;
+
+	// Keeps the data alive until it has been copied
+	TShared<const void> source;
+
+	// Called once the last of the data has been copied
+	std::function<void()> onComplete;
+};
+
+// Part of the staging buffer the GPU may still be reading
+struct PSStagingRegion
+{
+	// Signalled once the GPU has run every copy that reads the region
+	GLsync fence = nullptr;
+
+	// Bytes of the staging buffer the region uses, including any skipped at the end when it wrapped
+	PUi64 size = 0;
+
+	// Where the next region starts once this one is free
+	PUi64 end = 0;
+};
+
+// Spreads GPU uploads across frames so loading never adds more than a set amount to a frame
+// Data is written into a persistently mapped staging buffer that acts as a pixel buffer for textures
+// Each frame the GPU copies from the staging buffer into the real buffers and textures
+// A fence is placed after every frame's copies so the staging memory is only written again once the GPU has read it
+// Large uploads are split into chunks, buffers at any byte and textures by rows, and finish over several frames
+// Uploads finish in the order they are queued, must only be used on the GL thread
+class PUploadQueue
+{
+public:
+	PUploadQueue();
+	~PUploadQueue();
+
+	// Get the shared queue for the engine, creates it if it doesn't exist
+	static PUploadQueue& GetQueue();
+
+	// Queue data to be copied into part of a buffer
+	// The buffer must already have storage and must not be resized until the upload finishes
+	// The data must stay valid until the upload finishes, source can be used to keep it alive
+	void UploadBuffer(const void* owner, const PUi32& bufferID, const PUi64& offset, const PUi8* data, const PUi64& size,
+		const TShared<const void>& source = nullptr, const std::function<void()>& onComplete = nullptr);
+
+	// Queue data to be copied into a level of a texture that has immutable storage
+	// Uncompressed data must be RGBA8 pixels
+	// The data must stay valid until the upload finishes, source can be used to keep it alive
+	void UploadTexture(const void* owner, const PUi32& textureID, const PUi32& level, const PUi32& width, const PUi32& height,
+		const PUi32& format, const bool& isCompressed, const PUi8* data, const PUi64& size,
+		const TShared<const void>& source = nullptr, const std::function<void()>& onComplete = nullptr);
+
+	// Remove every upload of an owner that hasn't finished, their callbacks are never called
+	// Must be called before an owner is destroyed or deletes what it is uploading into
+	void Cancel(const void* owner);
+
+	// Copy queued data until the frame's byte or time budget is used up
+	// Called once each frame by the graphics engine
+	void Update();
+
+	// Copy everything that is queued, waiting on the GPU if the staging buffer fills up
+	void Flush();
+
+	// Delete the staging buffer and drop every upload, must be called before the GL context is destroyed
+	void Shutdown();
+
+	// Set the most bytes copied each frame, at least one chunk is always copied so nothing gets stuck
+	void SetByteBudget(const PUi64& bytes) { m_ByteBudget = std::max(bytes, static_cast<PUi64>(1)); }
+
+	// Set the most time spent copying each frame in milliseconds
+	void SetTimeBudget(const double& milliseconds) { m_TimeBudget = milliseconds; }
+
+	// Get the bytes copied in the last update
+	PUi64 GetBytesUploaded() const { return m_BytesUploaded; }
+
+	// Get the bytes waiting to be copied
+	PUi64 GetBytesPending() const { return m_BytesPending; }
+
+	// Get the amount of uploads waiting to be copied
+	PUi32 GetUploadsPending() const { return static_cast<PUi32>(m_Jobs.size()); }
+
+private:
+	// Create the staging buffer the first time it is needed
+	// Returns false if persistent mapping isn't supported, data is then copied straight from the CPU
+	bool InitStaging();
+
+	// Copy the next chunk of the front upload, no larger than the byte limit
+	// Returns the bytes copied or 0 if the staging buffer is full
+	PUi64 UploadChunk(PSUploadJob& job, const PUi64& byteLimit);
+
+	// Find space in the staging buffer, returns false if the GPU is still reading too much of it
+	bool AllocateStaging(const PUi64& size, PUi64& outOffset);
+
+	// Place a fence after the copies made since the last one
+	void EndRegion();
+
+	// Free the staging regions the GPU has finished reading
+	// Waits for the oldest region if wait is true, returns false if nothing was freed
+	bool RetireRegions(const bool& wait);
+
+	// Uploads waiting to be copied
+	std::deque<PSUploadJob> m_Jobs;
+
+	// Staging regions in the order they were written
+	std::deque<PSStagingRegion> m_Regions;
+
+	// Staging buffer ID in open gl
+	PUi32 m_StagingBuffer;
+
+	// CPU address of the mapped staging buffer
+	PUi8* m_StagingData;
+
+	// Size of the staging buffer in bytes
+	PUi64 m_StagingSize;
+
+	// Where the next staging allocation starts
+	PUi64 m_Head;
+
+	// Start of the oldest region the GPU may still be reading
+	PUi64 m_Tail;
+
+	// Bytes of the staging buffer in use, including the regions waiting on fences
+	PUi64 m_StagingUsed;
+
+	// Bytes of the staging buffer written since the last fence
+	PUi64 m_RegionSize;
+
+	// If the staging buffer has been created or failed to be
+	bool m_HasInitStaging;
+
+	// Most bytes copied each frame
+	PUi64 m_ByteBudget;
+
+	// Most time spent copying each frame in milliseconds
+	double m_TimeBudget;
+
+	// Bytes copied in the last update
+	PUi64 m_BytesUploaded;
+
+	// Bytes waiting to be copied
+	PUi64 m_BytesPending;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Graphics/PMesh.h"
+
+// One VAO for each vertex format, shared by every mesh that uses the format
+// The attribute formats are set once when a format is first used
+// Meshes attach their own vertex and index buffers when they are drawn, the state cache skips it if they are already attached
+class PVertexLayouts
+{
+public:
+	// Get the layouts for the engine's context
+	static PVertexLayouts& GetLayouts()
+	{
+		static PVertexLayouts layouts;
+		return layouts;
+	}
+
+	// Get the VAO for a vertex format, it is created the first time the format is used
+	// Returns 0 if the VAO couldn't be created
+	PUi32 GetVAO(const PEVertexFormat& format);
+
+	// Bind the VAO for a vertex format with a vertex and index buffer attached
+	// Returns false if the VAO couldn't be created
+	bool Bind(const PEVertexFormat& format, const PUi32& vertexBuffer, const PUi32& indexBuffer);
+
+	// Delete every VAO, must be called while the context is still alive
+	void Shutdown();
+
+private:
+	PVertexLayouts() = default;
+
+	// Describe a vertex format's attributes to a VAO, every attribute reads from binding 0
+	static void SetupAttributes(const PUi32& vao, const PEVertexFormat& format);
+
+	// VAO for each vertex format, 0 if the format hasn't been used
+	TArray<PUi32> m_VAOs;
+};
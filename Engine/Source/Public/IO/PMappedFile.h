@@ -0,0 +1,37 @@
+#pragma once
+#include "EngineTypes.h"
+
+// A read only view of a whole file mapped into memory
+// Pages are only read from disk when they are first touched
+class PMappedFile
+{
+public:
+	PMappedFile();
+	~PMappedFile();
+
+	PMappedFile(const PMappedFile&) = delete;
+	PMappedFile& operator=(const PMappedFile&) = delete;
+
+	// Map a file into memory, closes any file already mapped
+	// Returns false if the file doesn't exist or is empty
+	bool Open(const PString& path);
+
+	// Unmap the file
+	void Close();
+
+	// Test if a file is mapped
+	bool IsOpen() const { return m_Data != nullptr; }
+
+	// Get the start of the file in memory
+	const PUi8* GetData() const { return m_Data; }
+
+	// Get the size of the file in bytes
+	PUi64 GetSize() const { return m_Size; }
+
+private:
+	// Start of the mapped view
+	const PUi8* m_Data;
+
+	// Size of the mapped view in bytes
+	PUi64 m_Size;
+};
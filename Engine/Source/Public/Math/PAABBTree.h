@@ -0,0 +1,149 @@
+#pragma once
+#include "EngineTypes.h"
+#include "Math/PSBounds.h"
+#include "Math/PSFrustum.h"
+
+// A node in the tree
+// Leaves store the proxies and internal nodes store the bounds of their children
+struct PSAABBNode
+{
+	// Test if the node is a leaf
+	bool IsLeaf() const { return left == -1; }
+
+	// Bounds of the proxy or of both children
+	// Moved proxies are stored slightly bigger so small moves don't need a refit
+	PSBounds bounds;
+
+	// Exact bounds of the proxy, queries test leaves against these instead of the enlarged bounds
+	PSBounds proxyBounds;
+
+	// Index of the parent node, -1 for the root
+	int parent = -1;
+
+	// Indexes of the children, -1 for leaves
+	int left = -1;
+	int right = -1;
+
+	// Data passed in with the proxy
+	void* userData = nullptr;
+	PUi32 userIndex = 0;
+
+	// Surface area of the node when it was last built
+	// Used to find parts of the tree that have become poor from refitting
+	float buildArea = 0.0f;
+
+	// If the proxy has never moved, static proxies are built with SAH
+	bool isStatic = true;
+
+	// If the node has grown since it was built
+	bool isDirty = false;
+};
+
+class PAABBTree
+{
+public:
+	PAABBTree();
+	~PAABBTree() = default;
+
+	// Add a proxy into the tree and return the ID
+	// Static proxies are rebuilt with SAH on the next update
+	int CreateProxy(const PSBounds& bounds, void* userData, const PUi32& userIndex, const bool& isStatic = true);
+
+	// Remove a proxy from the tree
+	void DestroyProxy(const int& proxyID);
+
+	// Update the bounds of a proxy
+	// Returns true if the tree had to be refit
+	bool MoveProxy(const int& proxyID, const PSBounds& bounds);
+
+	// Rebuild the whole tree with SAH
+	void Rebuild();
+
+	// Run once per frame to do any pending or periodic rebuilds
+	void Update();
+
+	// Find all of the proxies that are inside or touching a frustum
+	// Whole branches that are fully inside are added without testing each proxy
+	// Leaves are tested with the proxy's exact bounds so moved proxies just outside aren't returned
+	void QueryFrustum(const PSFrustum& frustum, TArray<int>& outProxies, PUi32* nodesTested = nullptr);
+
+	// Find all of the proxies that overlap a box
+	void QueryBounds(const PSBounds& bounds, TArray<int>& outProxies);
+
+	// Get the data that was passed in with the proxy
+	void* GetUserData(const int& proxyID) const { return m_Nodes[proxyID].userData; }
+
+	// Get the index that was passed in with the proxy
+	PUi32 GetUserIndex(const int& proxyID) const { return m_Nodes[proxyID].userIndex; }
+
+	// Get the amount of proxies in the tree
+	PUi32 GetProxyCount() const { return m_ProxyCount; }
+
+	// Set how many frames to wait between partial rebuilds
+	void SetRebuildInterval(const PUi32& frames) { m_RebuildInterval = frames; }
+
+	// Set how much a node can grow from refitting before it gets rebuilt
+	// 2.0 = rebuild when the surface area has doubled
+	void SetRebuildThreshold(const float& ratio) { m_RebuildThreshold = ratio; }
+
+private:
+	// Get a free node from the pool
+	int AllocateNode();
+
+	// Return a node to the pool
+	void FreeNode(const int& nodeIndex);
+
+	// Add a leaf into the tree at the place with the lowest SAH cost
+	void InsertLeaf(const int& leaf);
+
+	// Take a leaf out of the tree without freeing it
+	void RemoveLeaf(const int& leaf);
+
+	// Update the bounds of every parent above a node
+	void RefitParents(int nodeIndex);
+
+	// Rebuild the part of the tree below a node with SAH
+	void RebuildSubtree(const int& nodeIndex);
+
+	// Build a tree over leaves with binned SAH and return the root
+	int BuildSAH(int* leaves, const int& count);
+
+	// Add every leaf below a node to an array
+	void CollectLeaves(const int& nodeIndex, TArray<int>& outLeaves, const bool& freeInternal);
+
+	// Surface area of a box
+	static float SurfaceArea(const PSBounds& bounds);
+
+	// Combine two boxes
+	static PSBounds Union(const PSBounds& a, const PSBounds& b);
+
+	// Pool of all the nodes
+	TArray<PSAABBNode> m_Nodes;
+
+	// Indexes of nodes that can be reused
+	TArray<int> m_FreeNodes;
+
+	// Internal nodes that have grown since they were built
+	TArray<int> m_DirtyNodes;
+
+	// Reused stack for traversing the tree
+	TArray<int> m_Stack;
+
+	// Index of the top node, -1 if the tree is empty
+	int m_Root;
+
+	// Amount of proxies in the tree
+	PUi32 m_ProxyCount;
+
+	// Static proxies have been added since the last SAH build
+	bool m_NeedsRebuild;
+
+	// Frames since the last partial rebuild check
+	PUi32 m_FramesSinceRebuild;
+
+	// Frames to wait between partial rebuilds
+	PUi32 m_RebuildInterval;
+
+	// How much a node can grow before it is rebuilt
+	float m_RebuildThreshold;
+};
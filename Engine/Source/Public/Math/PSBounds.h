@@ -0,0 +1,92 @@
+#pragma once
+
+// External Libs
+#include <GLM/glm.hpp>
+
+// System Libs
+#include <cfloat>
+
+struct PSBounds
+{
+	PSBounds()
+	{
+		min = glm::vec3(FLT_MAX);
+		max = glm::vec3(-FLT_MAX);
+		center = glm::vec3(0.0f);
+		radius = 0.0f;
+	}
+
+	// Grow the box to include a point
+	// Call UpdateSphere() after adding all of the points
+	void AddPoint(const glm::vec3& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	// Grow the box to include another box
+	void AddBounds(const PSBounds& other)
+	{
+		if (!other.IsValid())
+			return;
+
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+		UpdateSphere();
+	}
+
+	// Fit the sphere around the box
+	void UpdateSphere()
+	{
+		center = (min + max) * 0.5f;
+		radius = glm::length(max - center);
+	}
+
+	// Test if any points have been added
+	bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+	// Half the size of the box on each axis
+	glm::vec3 Extents() const { return (max - min) * 0.5f; }
+
+	// Get the bounds after being moved by a matrix
+	// The box stays axis aligned so it fits around the rotated box
+	PSBounds Transformed(const glm::mat4& matrix) const
+	{
+		PSBounds result;
+
+		if (!IsValid())
+			return result;
+
+		// Transform the center and then add the absolute value of each rotated axis
+		// This gives the same box as transforming all 8 corners but is much cheaper
+		const glm::vec3 boxCenter = glm::vec3(matrix * glm::vec4((min + max) * 0.5f, 1.0f));
+		const glm::vec3 boxExtents = Extents();
+
+		const glm::mat3 absMatrix = glm::mat3(
+			glm::abs(glm::vec3(matrix[0])),
+			glm::abs(glm::vec3(matrix[1])),
+			glm::abs(glm::vec3(matrix[2]))
+		);
+
+		const glm::vec3 newExtents = absMatrix * boxExtents;
+
+		result.min = boxCenter - newExtents;
+		result.max = boxCenter + newExtents;
+
+		// The sphere moves with the matrix and grows with the largest scale
+		const float maxScale = glm::max(glm::length(glm::vec3(matrix[0])),
+			glm::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+
+		result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+		result.radius = radius * maxScale;
+
+		return result;
+	}
+
+	// Corners of the box
+	glm::vec3 min, max;
+
+	// Sphere that fits around the box
+	glm::vec3 center;
+	float radius;
+};
@@ -0,0 +1,155 @@
+#pragma once
+#include "Math/PSBounds.h"
+
+// External Libs
+#include <GLM/glm.hpp>
+
+// System Libs
+#include <emmintrin.h>
+
+// Result of testing a volume against the frustum
+enum PEFrustumResult : unsigned char
+{
+	FR_OUTSIDE = 0U,
+	FR_INTERSECT,
+	FR_INSIDE
+};
+
+struct PSFrustum
+{
+	PSFrustum()
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			m_PlaneX[i] = m_PlaneY[i] = m_PlaneZ[i] = 0.0f;
+			m_PlaneD[i] = 1.0f;
+		}
+	}
+
+	// Build the planes from a view projection matrix
+	// Uses the Gribb/Hartmann method so the planes are in world space
+	void FromMatrix(const glm::mat4& viewProjection)
+	{
+		// glm matrices are column major so build the rows first
+		const glm::vec4 rowX(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		const glm::vec4 rowY(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		const glm::vec4 rowZ(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		const glm::vec4 rowW(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		const glm::vec4 planes[6] = {
+			rowW + rowX, // Left
+			rowW - rowX, // Right
+			rowW + rowY, // Bottom
+			rowW - rowY, // Top
+			rowW + rowZ, // Near
+			rowW - rowZ  // Far
+		};
+
+		for (int i = 0; i < 6; ++i)
+			SetPlane(i, planes[i]);
+
+		// The SIMD test works on 4 planes at a time so repeat the first planes to fill 8
+		SetPlane(6, planes[0]);
+		SetPlane(7, planes[1]);
+	}
+
+	// Set a plane with the normal pointing into the frustum
+	// Unused planes should repeat an existing plane
+	void SetPlane(const int& index, const glm::vec4& plane)
+	{
+		const float length = glm::length(glm::vec3(plane));
+		const glm::vec4 normalised = length > 0.0f ? plane / length : plane;
+
+		m_PlaneX[index] = normalised.x;
+		m_PlaneY[index] = normalised.y;
+		m_PlaneZ[index] = normalised.z;
+		m_PlaneD[index] = normalised.w;
+	}
+
+	// Get a plane as normal and distance
+	glm::vec4 GetPlane(const int& index) const
+	{
+		return glm::vec4(m_PlaneX[index], m_PlaneY[index], m_PlaneZ[index], m_PlaneD[index]);
+	}
+
+	// Test an axis aligned box against all of the planes
+	// 4 planes are tested at once with SSE
+	PEFrustumResult TestBounds(const PSBounds& bounds) const
+	{
+		if (!bounds.IsValid())
+			return FR_OUTSIDE;
+
+		const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+		const glm::vec3 extents = bounds.Extents();
+
+		const __m128 cx = _mm_set1_ps(center.x);
+		const __m128 cy = _mm_set1_ps(center.y);
+		const __m128 cz = _mm_set1_ps(center.z);
+		const __m128 ex = _mm_set1_ps(extents.x);
+		const __m128 ey = _mm_set1_ps(extents.y);
+		const __m128 ez = _mm_set1_ps(extents.z);
+
+		// Clears the sign bit to get the absolute value
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+		int outsideMask = 0;
+		int intersectMask = 0;
+
+		for (int i = 0; i < 8; i += 4)
+		{
+			const __m128 nx = _mm_loadu_ps(&m_PlaneX[i]);
+			const __m128 ny = _mm_loadu_ps(&m_PlaneY[i]);
+			const __m128 nz = _mm_loadu_ps(&m_PlaneZ[i]);
+			const __m128 d = _mm_loadu_ps(&m_PlaneD[i]);
+
+			// Signed distance from the center of the box to each plane
+			__m128 dist = _mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy));
+			dist = _mm_add_ps(dist, _mm_mul_ps(nz, cz));
+			dist = _mm_add_ps(dist, d);
+
+			// Projected radius of the box onto each plane normal
+			__m128 radius = _mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, absMask), ex), _mm_mul_ps(_mm_and_ps(ny, absMask), ey));
+			radius = _mm_add_ps(radius, _mm_mul_ps(_mm_and_ps(nz, absMask), ez));
+
+			// Fully behind a plane means the box is outside
+			outsideMask |= _mm_movemask_ps(_mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), radius)));
+
+			// Crossing a plane means the box is only partly inside
+			intersectMask |= _mm_movemask_ps(_mm_cmplt_ps(dist, radius));
+		}
+
+		if (outsideMask != 0)
+			return FR_OUTSIDE;
+
+		return intersectMask != 0 ? FR_INTERSECT : FR_INSIDE;
+	}
+
+	// Test a sphere against all of the planes
+	bool TestSphere(const glm::vec3& center, const float& radius) const
+	{
+		const __m128 cx = _mm_set1_ps(center.x);
+		const __m128 cy = _mm_set1_ps(center.y);
+		const __m128 cz = _mm_set1_ps(center.z);
+		const __m128 negRadius = _mm_set1_ps(-radius);
+
+		int outsideMask = 0;
+
+		for (int i = 0; i < 8; i += 4)
+		{
+			__m128 dist = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m_PlaneX[i]), cx), _mm_mul_ps(_mm_loadu_ps(&m_PlaneY[i]), cy));
+			dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(&m_PlaneZ[i]), cz));
+			dist = _mm_add_ps(dist, _mm_loadu_ps(&m_PlaneD[i]));
+
+			outsideMask |= _mm_movemask_ps(_mm_cmplt_ps(dist, negRadius));
+		}
+
+		return outsideMask == 0;
+	}
+
+private:
+	// Planes stored as separate arrays so 4 planes can be loaded into one SSE register
+	float m_PlaneX[8];
+	float m_PlaneY[8];
+	float m_PlaneZ[8];
+	float m_PlaneD[8];
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include "EngineTypes.h"
+
+// System Libs
+#include <cstring>
+
+struct PSHash
+{
+	// Starting value for a new FNV-1a hash
+	static constexpr PUi64 fnvOffset = 14695981039346656037ULL;
+
+	// Hash raw bytes using 64-bit FNV-1a
+	// Pass a previous hash as the seed to hash more data onto it
+	static PUi64 FNV1a(const void* data, const size_t& size, const PUi64& seed = fnvOffset)
+	{
+		const PUi8* bytes = static_cast<const PUi8*>(data);
+		PUi64 hash = seed;
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+
+		return hash;
+	}
+};
+
+// Hashes the raw bytes of a key so plain structs can be used in unordered maps
+// Only use with structs that have no padding
+template<typename T>
+struct PSBytesHash
+{
+	size_t operator()(const T& key) const { return static_cast<size_t>(PSHash::FNV1a(&key, sizeof(T))); }
+};
+
+// Compares the raw bytes of two keys
+template<typename T>
+struct PSBytesEqual
+{
+	bool operator()(const T& a, const T& b) const { return std::memcmp(&a, &b, sizeof(T)) == 0; }
+};
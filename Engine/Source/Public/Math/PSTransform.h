@@ -65,6 +65,27 @@ struct PSTransform
 		return up;
 	}
 
+	// Get the transform as a model matrix
+	// Translate (move) > rotate > scale (this allows us to rotate around the new location)
+	glm::mat4 GetMatrix() const
+	{
+		// Initialise a default matrix transform
+		glm::mat4 matrixT = glm::mat4(1.0f);
+
+		// Translate the matrix
+		matrixT = glm::translate(matrixT, position);
+
+		// Rotate per axis
+		matrixT = glm::rotate(matrixT, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+		matrixT = glm::rotate(matrixT, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+		matrixT = glm::rotate(matrixT, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+
+		// Scale the matrix
+		matrixT = glm::scale(matrixT, scale);
+
+		return matrixT;
+	}
+
 	PSTransform operator+(const PSTransform& other) const
 	{
 		return
@@ -80,6 +101,16 @@ struct PSTransform
 		return *this = *this + other;
 	}
 
+	bool operator==(const PSTransform& other) const
+	{
+		return position == other.position && rotation == other.rotation && scale == other.scale;
+	}
+
+	bool operator!=(const PSTransform& other) const
+	{
+		return !(*this == other);
+	}
+
 	glm::vec3 position;
 	glm::vec3 rotation;
 	glm::vec3 scale;
@@ -67,6 +67,9 @@ public:
 	// Render the graphics engine
 	void Render();
 
+	// Get the graphics engine, null if it failed to initialise
+	PGraphicsEngine* GetGraphicsEngine() const { return m_GraphicsEngine.get(); }
+
 private:
 	// A ref to the window in sdl
 	SDL_Window* m_SDLWindow;
@@ -91,4 +94,10 @@ private:
 
 	// Is the user in input mode
 	bool m_InputMode;
+
+	// Show the render stats in the window title
+	bool m_ShowStats;
+
+	// The last stats shown so the title only updates when they change
+	PString m_StatsText;
 };
\ No newline at end of file
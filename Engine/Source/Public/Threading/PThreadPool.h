@@ -0,0 +1,50 @@
+#pragma once
+#include "EngineTypes.h"
+
+// System Libs
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+class PThreadPool
+{
+public:
+	// Create the pool with a set amount of worker threads
+	// 0 will use one less than the amount of CPU threads so the main thread has room
+	PThreadPool(const PUi32& threadCount = 0);
+	~PThreadPool();
+
+	// Get the shared pool for the engine, creates it if it doesn't exist
+	static PThreadPool& GetPool();
+
+	// Add a job to be run on a worker thread
+	void AddJob(const std::function<void()>& job);
+
+	// Run a function for every index from 0 to count split across the workers
+	// The calling thread helps with the work and returns when every index is done
+	void ParallelFor(const PUi32& count, const std::function<void(PUi32)>& func);
+
+	// Get the amount of worker threads
+	PUi32 GetThreadCount() const { return static_cast<PUi32>(m_Threads.size()); }
+
+private:
+	// Loop run by each worker thread
+	void WorkerLoop();
+
+	// The worker threads
+	TArray<std::thread> m_Threads;
+
+	// Jobs waiting for a worker
+	std::deque<std::function<void()>> m_Jobs;
+
+	// Guards the job queue
+	std::mutex m_Mutex;
+
+	// Wakes a worker when a job is added
+	std::condition_variable m_JobAdded;
+
+	// Tells the workers to exit
+	bool m_ShouldStop;
+};
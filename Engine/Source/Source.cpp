@@ -1,4 +1,8 @@
 #include "Game/PGameEngine.h"
+#include "Graphics/PTextureCooker.h"
+
+// System Libs
+#include <cstring>
 
 // Smart pointers delete themselves when there is no reference
 // Shared pointer = Shares ownership across all references
@@ -7,6 +11,10 @@
 
 int main(int argc, char* argv[])
 {
+	// -cooktextures <folder> cooks every image in the folder and exits without opening a window
+	if (argc == 3 && std::strcmp(argv[1], "-cooktextures") == 0)
+		return PTextureCooker::CookFolder(argv[2]) > 0 ? 0 : -1;
+
 	int result = 0;
 	// Initialise the engine
 	// Test if int fails